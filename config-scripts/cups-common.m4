@@ -185,11 +185,14 @@ AS_CASE(["$host_os_name"], [linux* | gnu*], [
 AC_CHECK_FUNCS([sigaction])
 
 dnl Checks for wait functions.
-AC_CHECK_FUNCS([waitpid wait3])
+AC_CHECK_FUNCS([waitpid wait3 wait4])
 
 dnl Check for posix_spawn
 AC_CHECK_FUNCS([posix_spawn])
 
+dnl Check for memfd_create
+AC_CHECK_FUNCS([memfd_create])
+
 dnl Check for getgrouplist
 AC_CHECK_FUNCS([getgrouplist])
 
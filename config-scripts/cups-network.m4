@@ -27,6 +27,12 @@ AC_SEARCH_LIBS([getifaddrs], [nsl], [
 AC_SEARCH_LIBS([hstrerror], [nsl socket resolv], [
     AC_DEFINE([HAVE_HSTRERROR], [1], [Have the hstrerror function?])
 ])
+AC_CHECK_FUNC([accept4], [
+    AC_DEFINE([HAVE_ACCEPT4], [1], [Have the accept4 function?])
+])
+AC_CHECK_FUNC([splice], [
+    AC_DEFINE([HAVE_SPLICE], [1], [Have the splice function?])
+])
 AC_SEARCH_LIBS([rresvport_af], [nsl], [
     AC_DEFINE([HAVE_RRESVPORT_AF], [1], [Have the rresvport_af function?])
 ])
@@ -18,3 +18,23 @@ AC_CHECK_FUNC([epoll_create], [
 AC_CHECK_FUNC([kqueue], [
     AC_DEFINE([HAVE_KQUEUE], [1], [Have kqueue function?])
 ])
+
+dnl See if we can use io_uring (Linux 5.13 or later) for the scheduler...
+AC_ARG_ENABLE([io_uring], AS_HELP_STRING([--disable-io-uring], [do not use io_uring in the scheduler]))
+
+AS_IF([test "x$enable_io_uring" != xno], [
+    AC_MSG_CHECKING([for io_uring poll update support])
+    AC_COMPILE_IFELSE([
+	AC_LANG_PROGRAM([[#include <linux/io_uring.h>
+#include <sys/syscall.h>]], [[
+	    struct io_uring_getevents_arg arg;
+	    int f = IORING_FEAT_RSRC_TAGS | IORING_POLL_UPDATE_EVENTS;
+	    long n = __NR_io_uring_setup + __NR_io_uring_enter;
+	]])
+    ], [
+	AC_MSG_RESULT([yes])
+	AC_DEFINE([HAVE_IO_URING], [1], [Have io_uring interface?])
+    ], [
+	AC_MSG_RESULT([no])
+    ])
+])
@@ -80,6 +80,9 @@ typedef enum				/**** _cupsFileCheck file type values ****/
 typedef void (*_cups_fc_func_t)(void *context, _cups_fc_result_t result,
 				const char *message);
 
+typedef struct _cups_ring_s _cups_ring_t;
+					/**** Shared memory ring buffer ****/
+
 /*
  * Prototypes...
  */
@@ -87,6 +90,10 @@ typedef void (*_cups_fc_func_t)(void *context, _cups_fc_result_t result,
 extern _cups_fc_result_t	_cupsFileCheck(const char *filename, _cups_fc_filetype_t filetype, int dorootchecks, _cups_fc_func_t cb, void *context) _CUPS_PRIVATE;
 extern void			_cupsFileCheckFilter(void *context, _cups_fc_result_t result, const char *message) _CUPS_PRIVATE;
 extern int			_cupsFilePeekAhead(cups_file_t *fp, int ch);
+extern int			_cupsRingCreate(int fd, size_t size) _CUPS_PRIVATE;
+extern _cups_ring_t		*_cupsRingOpen(int fd) _CUPS_PRIVATE;
+extern ssize_t			_cupsRingRead(_cups_ring_t *ring, char *buffer, size_t bytes) _CUPS_PRIVATE;
+extern ssize_t			_cupsRingWrite(_cups_ring_t *ring, const char *buffer, size_t bytes) _CUPS_PRIVATE;
 
 #  ifdef __cplusplus
 }
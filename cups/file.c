@@ -27,6 +27,15 @@
 #    include <zlib.h>
 #  endif /* HAVE_LIBZ */
 
+#  if defined(HAVE_MEMFD_CREATE) && defined(__linux__)
+#    include <sys/mman.h>
+#    include <sys/syscall.h>
+#    include <linux/futex.h>
+#    include <limits.h>
+#    include <poll.h>
+#    define _CUPS_RING 1
+#  endif /* HAVE_MEMFD_CREATE && __linux__ */
+
 
 /*
  * Internal structures...
@@ -53,6 +62,50 @@ struct _cups_file_s			/**** CUPS file structure... ****/
 
   char		*printf_buffer;		/* cupsFilePrintf buffer */
   size_t	printf_size;		/* Size of cupsFilePrintf buffer */
+
+  _cups_ring_t	*ring;			/* Shared memory ring for stdin/out */
+};
+
+#ifdef _CUPS_RING
+/*
+ * A ring is created by the scheduler for the pipe between two filters.  Data
+ * written before the reader attaches goes through the pipe; after that the
+ * data goes through the ring and the pipe only carries single "doorbell"
+ * bytes that wake up a waiting reader.  The pipe still closes when the
+ * writer exits, which is how the reader sees the end of the data.
+ */
+
+#  define _CUPS_RING_MAGIC	0x43555052	/* "CUPR" */
+
+typedef struct _cups_ring_hdr_s		/**** Shared memory ring header ****/
+{
+  unsigned		magic,		/* Magic number */
+			reader,		/* Non-zero once a reader attached */
+			writer,		/* Non-zero once the writer uses the ring */
+			reader_waiting,	/* Non-zero while the reader waits for data */
+			writer_waiting,	/* Non-zero while the writer waits for space */
+			tail_seq;	/* Futex word, bumped when data is read */
+  unsigned long long	size,		/* Size of data area */
+			pipe_dev,	/* Device number of pipe */
+			pipe_ino,	/* Inode number of pipe */
+			pipe_written,	/* Bytes written to the pipe */
+			pipe_read;	/* Bytes read from the pipe */
+  char			pad1[64];	/* Keep head and tail in their own lines */
+  unsigned long long	head;		/* Bytes written to the ring */
+  char			pad2[64];
+  unsigned long long	tail;		/* Bytes read from the ring */
+  char			pad3[64];
+} _cups_ring_hdr_t;
+#endif /* _CUPS_RING */
+
+struct _cups_ring_s			/**** Shared memory ring buffer ****/
+{
+  int			fd;		/* Pipe file descriptor */
+  int			eof;		/* Did the pipe close? */
+#ifdef _CUPS_RING
+  _cups_ring_hdr_t	*hdr;		/* Shared header */
+  char			*data;		/* Shared data area */
+#endif /* _CUPS_RING */
 };
 
 
@@ -1995,7 +2048,10 @@ cupsFileStdin(void)
     */
 
     if ((cg->stdio_files[0] = cupsFileOpenFd(0, "r")) != NULL)
+    {
       cg->stdio_files[0]->is_stdio = 1;
+      cg->stdio_files[0]->ring     = _cupsRingOpen(0);
+    }
   }
 
   return (cg->stdio_files[0]);
@@ -2031,7 +2087,10 @@ cupsFileStdout(void)
     */
 
     if ((cg->stdio_files[1] = cupsFileOpenFd(1, "w")) != NULL)
+    {
       cg->stdio_files[1]->is_stdio = 1;
+      cg->stdio_files[1]->ring     = _cupsRingOpen(1);
+    }
   }
 
   return (cg->stdio_files[1]);
@@ -2149,6 +2208,401 @@ cupsFileWrite(cups_file_t *fp,		/* I - CUPS file */
 }
 
 
+/*
+ * '_cupsRingCreate()' - Create a shared memory ring buffer for a pipe.
+ *
+ * The returned file descriptor is given to the processes on both ends of the
+ * pipe, which find it using the "CUPS_STDIN_RING" and "CUPS_STDOUT_RING"
+ * environment variables.
+ */
+
+int					/* O - Ring file descriptor or -1 on error */
+_cupsRingCreate(int    fd,		/* I - Pipe file descriptor */
+                size_t size)		/* I - Size of ring in bytes */
+{
+#ifdef _CUPS_RING
+  int			ringfd;		/* Ring file descriptor */
+  struct stat		fileinfo;	/* Pipe information */
+  _cups_ring_hdr_t	hdr;		/* Ring header */
+
+
+  if (size == 0 || fstat(fd, &fileinfo) || !S_ISFIFO(fileinfo.st_mode))
+  {
+    errno = EINVAL;
+    return (-1);
+  }
+
+  if ((ringfd = memfd_create("cups-ring", MFD_CLOEXEC)) < 0)
+    return (-1);
+
+  memset(&hdr, 0, sizeof(hdr));
+
+  hdr.magic    = _CUPS_RING_MAGIC;
+  hdr.size     = (unsigned long long)size;
+  hdr.pipe_dev = (unsigned long long)fileinfo.st_dev;
+  hdr.pipe_ino = (unsigned long long)fileinfo.st_ino;
+
+  if (ftruncate(ringfd, (off_t)(sizeof(hdr) + size)) ||
+      pwrite(ringfd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr))
+  {
+    int error = errno;			/* Saved error */
+
+    close(ringfd);
+    errno = error;
+    return (-1);
+  }
+
+  return (ringfd);
+
+#else
+  (void)fd;
+  (void)size;
+
+  errno = ENOSYS;
+  return (-1);
+#endif /* _CUPS_RING */
+}
+
+
+/*
+ * '_cupsRingOpen()' - Open the shared memory ring buffer for stdin or stdout.
+ *
+ * @code NULL@ is returned when the process was not given a ring for the pipe
+ * on the file descriptor.  Opening the stdin ring tells the writer to use it
+ * for all further data.
+ */
+
+_cups_ring_t *				/* O - Ring or @code NULL@ */
+_cupsRingOpen(int fd)			/* I - 0 for stdin or 1 for stdout */
+{
+#ifdef _CUPS_RING
+  static _cups_mutex_t	ring_mutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex for rings */
+  static _cups_ring_t	rings[2];	/* Rings for stdin and stdout */
+  static int		checked[2] = { 0, 0 };
+					/* Did we look for the rings? */
+  _cups_ring_t		*ring = NULL;	/* Ring */
+  const char		*value;		/* Environment variable value */
+  int			ringfd;		/* Ring file descriptor */
+  struct stat		fileinfo,	/* Pipe information */
+			ringinfo;	/* Ring information */
+  _cups_ring_hdr_t	*hdr;		/* Shared header */
+
+
+  if (fd != 0 && fd != 1)
+    return (NULL);
+
+  _cupsMutexLock(&ring_mutex);
+
+  if (checked[fd])
+  {
+    ring = rings[fd].hdr ? rings + fd : NULL;
+    _cupsMutexUnlock(&ring_mutex);
+    return (ring);
+  }
+
+  checked[fd] = 1;
+
+  if ((value = getenv(fd ? "CUPS_STDOUT_RING" : "CUPS_STDIN_RING")) == NULL ||
+      (ringfd = atoi(value)) <= 2 || fstat(ringfd, &ringinfo) ||
+      ringinfo.st_size < (off_t)sizeof(_cups_ring_hdr_t) ||
+      fstat(fd, &fileinfo))
+  {
+    _cupsMutexUnlock(&ring_mutex);
+    return (NULL);
+  }
+
+  if ((hdr = mmap(NULL, (size_t)ringinfo.st_size, PROT_READ | PROT_WRITE,
+                  MAP_SHARED, ringfd, 0)) == MAP_FAILED)
+  {
+    DEBUG_printf(("1_cupsRingOpen: Unable to map ring: %s", strerror(errno)));
+    _cupsMutexUnlock(&ring_mutex);
+    return (NULL);
+  }
+
+ /*
+  * Only use the ring with the pipe it was created for, since programs run by
+  * a filter inherit the environment...
+  */
+
+  if (hdr->magic != _CUPS_RING_MAGIC ||
+      hdr->size > (unsigned long long)ringinfo.st_size - sizeof(_cups_ring_hdr_t) ||
+      hdr->pipe_dev != (unsigned long long)fileinfo.st_dev ||
+      hdr->pipe_ino != (unsigned long long)fileinfo.st_ino)
+  {
+    munmap(hdr, (size_t)ringinfo.st_size);
+    _cupsMutexUnlock(&ring_mutex);
+    return (NULL);
+  }
+
+  ring       = rings + fd;
+  ring->fd   = fd;
+  ring->hdr  = hdr;
+  ring->data = (char *)(hdr + 1);
+
+  if (fd == 0)
+    __atomic_store_n(&hdr->reader, 1, __ATOMIC_SEQ_CST);
+
+  _cupsMutexUnlock(&ring_mutex);
+
+  return (ring);
+
+#else
+  (void)fd;
+
+  return (NULL);
+#endif /* _CUPS_RING */
+}
+
+
+/*
+ * '_cupsRingRead()' - Read from a shared memory ring buffer.
+ */
+
+ssize_t					/* O - Number of bytes read or -1 on error */
+_cupsRingRead(_cups_ring_t *ring,	/* I - Ring */
+              char         *buffer,	/* I - Buffer */
+	      size_t       bytes)	/* I - Maximum number of bytes to read */
+{
+#ifdef _CUPS_RING
+  _cups_ring_hdr_t	*hdr = ring->hdr;
+					/* Shared header */
+  unsigned long long	head,		/* Bytes written to the ring */
+			tail,		/* Bytes read from the ring */
+			remaining;	/* Bytes left in the pipe */
+  size_t		pos,		/* Position in ring */
+			count;		/* Bytes to copy */
+  ssize_t		pbytes;		/* Bytes read from the pipe */
+  char			doorbell[64];	/* Doorbell bytes */
+
+
+  if (bytes == 0)
+    return (0);
+
+  for (;;)
+  {
+    if (!__atomic_load_n(&hdr->writer, __ATOMIC_ACQUIRE))
+    {
+     /*
+      * The writer still uses the pipe...
+      */
+
+      if ((pbytes = read(ring->fd, buffer, bytes)) < 0)
+        return (-1);
+      else if (pbytes == 0 && !__atomic_load_n(&hdr->writer, __ATOMIC_ACQUIRE))
+        return (0);
+
+     /*
+      * Drop the doorbell if the writer switched to the ring while we were
+      * reading...
+      */
+
+      if (__atomic_load_n(&hdr->writer, __ATOMIC_ACQUIRE) &&
+          hdr->pipe_read + (unsigned long long)pbytes > hdr->pipe_written)
+        pbytes = (ssize_t)(hdr->pipe_written - hdr->pipe_read);
+
+      hdr->pipe_read += (unsigned long long)pbytes;
+
+      if (pbytes > 0)
+        return (pbytes);
+
+      continue;
+    }
+
+    if ((remaining = hdr->pipe_written - hdr->pipe_read) > 0)
+    {
+     /*
+      * Read what was written to the pipe before the switch...
+      */
+
+      if (bytes > remaining)
+        bytes = (size_t)remaining;
+
+      if ((pbytes = read(ring->fd, buffer, bytes)) > 0)
+        hdr->pipe_read += (unsigned long long)pbytes;
+
+      return (pbytes);
+    }
+
+    head = __atomic_load_n(&hdr->head, __ATOMIC_SEQ_CST);
+    tail = hdr->tail;
+
+    if (head != tail)
+    {
+     /*
+      * Copy data from the ring, wrapping around as needed...
+      */
+
+      if (bytes > head - tail)
+        bytes = (size_t)(head - tail);
+
+      pos   = (size_t)(tail % hdr->size);
+      count = (size_t)hdr->size - pos;
+
+      if (count > bytes)
+        count = bytes;
+
+      memcpy(buffer, ring->data + pos, count);
+      if (count < bytes)
+        memcpy(buffer + count, ring->data, bytes - count);
+
+      __atomic_store_n(&hdr->tail, tail + bytes, __ATOMIC_SEQ_CST);
+      __atomic_add_fetch(&hdr->tail_seq, 1, __ATOMIC_SEQ_CST);
+
+      if (__atomic_exchange_n(&hdr->writer_waiting, 0, __ATOMIC_SEQ_CST))
+        syscall(SYS_futex, &hdr->tail_seq, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+
+      return ((ssize_t)bytes);
+    }
+
+    if (ring->eof)
+      return (0);
+
+   /*
+    * Wait for the writer to ring the doorbell or exit...
+    */
+
+    __atomic_store_n(&hdr->reader_waiting, 1, __ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(&hdr->head, __ATOMIC_SEQ_CST) != tail)
+    {
+      __atomic_store_n(&hdr->reader_waiting, 0, __ATOMIC_SEQ_CST);
+      continue;
+    }
+
+    if ((pbytes = read(ring->fd, doorbell, sizeof(doorbell))) == 0)
+      ring->eof = 1;
+    else if (pbytes < 0 && errno != EINTR && errno != EAGAIN)
+      return (-1);
+  }
+
+#else
+  return (read(ring->fd, buffer, bytes));
+#endif /* _CUPS_RING */
+}
+
+
+/*
+ * '_cupsRingWrite()' - Write to a shared memory ring buffer.
+ */
+
+ssize_t					/* O - Number of bytes written or -1 on error */
+_cupsRingWrite(_cups_ring_t *ring,	/* I - Ring */
+               const char   *buffer,	/* I - Buffer */
+	       size_t       bytes)	/* I - Number of bytes to write */
+{
+#ifdef _CUPS_RING
+  _cups_ring_hdr_t	*hdr = ring->hdr;
+					/* Shared header */
+  unsigned long long	head,		/* Bytes written to the ring */
+			tail;		/* Bytes read from the ring */
+  unsigned		seq;		/* Futex value */
+  size_t		pos,		/* Position in ring */
+			count;		/* Bytes to copy */
+  ssize_t		pbytes;		/* Bytes written to the pipe */
+  struct timespec	timeout;	/* Futex timeout */
+  struct pollfd		pfd;		/* Pipe status */
+
+
+  if (bytes == 0)
+    return (0);
+
+  if (!__atomic_load_n(&hdr->writer, __ATOMIC_ACQUIRE))
+  {
+    if (!__atomic_load_n(&hdr->reader, __ATOMIC_ACQUIRE))
+    {
+     /*
+      * No reader is using the ring, keep using the pipe...
+      */
+
+      if ((pbytes = write(ring->fd, buffer, bytes)) > 0)
+        __atomic_add_fetch(&hdr->pipe_written, (unsigned long long)pbytes, __ATOMIC_SEQ_CST);
+
+      return (pbytes);
+    }
+
+   /*
+    * Switch to the ring and wake up the reader in case it is blocked on the
+    * pipe...
+    */
+
+    __atomic_store_n(&hdr->writer, 1, __ATOMIC_SEQ_CST);
+
+    if (write(ring->fd, "", 1) < 0)
+      return (-1);
+  }
+
+  for (;;)
+  {
+    head = hdr->head;
+    tail = __atomic_load_n(&hdr->tail, __ATOMIC_SEQ_CST);
+
+    if (head - tail < hdr->size)
+    {
+     /*
+      * Copy data to the ring, wrapping around as needed...
+      */
+
+      if (bytes > hdr->size - (head - tail))
+        bytes = (size_t)(hdr->size - (head - tail));
+
+      pos   = (size_t)(head % hdr->size);
+      count = (size_t)hdr->size - pos;
+
+      if (count > bytes)
+        count = bytes;
+
+      memcpy(ring->data + pos, buffer, count);
+      if (count < bytes)
+        memcpy(ring->data, buffer + count, bytes - count);
+
+      __atomic_store_n(&hdr->head, head + bytes, __ATOMIC_SEQ_CST);
+
+      if (__atomic_exchange_n(&hdr->reader_waiting, 0, __ATOMIC_SEQ_CST) &&
+          write(ring->fd, "", 1) < 0)
+        return (-1);
+
+      return ((ssize_t)bytes);
+    }
+
+   /*
+    * The ring is full, wait for the reader...
+    */
+
+    seq = __atomic_load_n(&hdr->tail_seq, __ATOMIC_SEQ_CST);
+
+    __atomic_store_n(&hdr->writer_waiting, 1, __ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(&hdr->tail, __ATOMIC_SEQ_CST) != tail)
+      continue;
+
+    timeout.tv_sec  = 1;
+    timeout.tv_nsec = 0;
+
+    if (syscall(SYS_futex, &hdr->tail_seq, FUTEX_WAIT, seq, &timeout, NULL, 0) && errno == ETIMEDOUT)
+    {
+     /*
+      * See if the reader went away...
+      */
+
+      pfd.fd      = ring->fd;
+      pfd.events  = POLLOUT;
+      pfd.revents = 0;
+
+      if (poll(&pfd, 1, 0) > 0 && (pfd.revents & (POLLERR | POLLHUP)))
+      {
+        errno = EPIPE;
+        return (-1);
+      }
+    }
+  }
+
+#else
+  return (write(ring->fd, buffer, bytes));
+#endif /* _CUPS_RING */
+}
+
+
 #ifdef HAVE_LIBZ
 /*
  * 'cups_compress()' - Compress a buffer of data.
@@ -2717,6 +3171,8 @@ cups_read(cups_file_t *fp,		/* I - CUPS file */
 #else
     if (fp->mode == 's')
       total = recv(fp->fd, buf, bytes, 0);
+    else if (fp->ring)
+      total = _cupsRingRead(fp->ring, buf, bytes);
     else
       total = read(fp->fd, buf, bytes);
 #endif /* _WIN32 */
@@ -2774,6 +3230,8 @@ cups_write(cups_file_t *fp,		/* I - CUPS file */
 #else
     if (fp->mode == 's')
       count = send(fp->fd, buf, bytes, 0);
+    else if (fp->ring)
+      count = _cupsRingWrite(fp->ring, buf, bytes);
     else
       count = write(fp->fd, buf, bytes);
 #endif /* _WIN32 */
@@ -156,6 +156,19 @@ httpAddrLength(const http_addr_t *addr)	/* I - Address */
 int					/* O - Socket or -1 on error */
 httpAddrListen(http_addr_t *addr,	/* I - Address to bind to */
                int         port)	/* I - Port number to bind to */
+{
+  return (_httpAddrListen(addr, port, 128));
+}
+
+
+/*
+ * '_httpAddrListen()' - Create a listening socket with the specified backlog.
+ */
+
+int					/* O - Socket or -1 on error */
+_httpAddrListen(http_addr_t *addr,	/* I - Address to bind to */
+                int         port,	/* I - Port number to bind to */
+                int         backlog)	/* I - Maximum pending connections */
 {
   int		fd = -1,		/* Socket */
 		val,			/* Socket value */
@@ -249,7 +262,7 @@ httpAddrListen(http_addr_t *addr,	/* I - Address to bind to */
   * Listen...
   */
 
-  if (listen(fd, 128))
+  if (listen(fd, backlog))
   {
     _cupsSetHTTPError(HTTP_STATUS_ERROR);
 
@@ -30,10 +30,16 @@
 #    include <io.h>
 #    include <winsock2.h>
 #    define CUPS_SOCAST (const char *)
+struct iovec				/* Buffer for vectored writes */
+{
+  void	*iov_base;			/* Start of buffer */
+  size_t iov_len;			/* Length of buffer */
+};
 #  else
 #    include <unistd.h>
 #    include <fcntl.h>
 #    include <sys/socket.h>
+#    include <sys/uio.h>
 #    define CUPS_SOCAST
 #  endif /* _WIN32 */
 
@@ -121,6 +127,9 @@ extern "C" {
  */
 
 #  define _HTTP_MAX_SBUFFER	65536	/* Size of (de)compression buffer */
+#  define _HTTP_MAX_IOV		128	/* Max buffers for _httpWritev */
+#  define _HTTP_MAX_RBUFFER	262144	/* Max size of adaptive read buffer */
+#  define _HTTP_MAX_WBUFFER	65536	/* Max size of adaptive write buffer */
 #  define _HTTP_RESOLVE_DEFAULT	0	/* Just resolve with default options */
 #  define _HTTP_RESOLVE_STDERR	1	/* Log resolve progress to stderr */
 #  define _HTTP_RESOLVE_FQDN	2	/* Resolve to a FQDN */
@@ -306,6 +315,13 @@ struct _http_s				/**** HTTP connection structure ****/
 					/* Allocated field values */
   			*default_fields[HTTP_FIELD_MAX];
 					/* Default field values, if any */
+
+  /**** New in CUPS 2.4.3 ****/
+  char			*rbuf;		/* Read buffer (buffer or allocated) */
+  size_t		rsize,		/* Size of read buffer */
+			rpos;		/* Offset of unread data in read buffer */
+  char			*wbuf;		/* Write buffer (wbuffer or allocated) */
+  size_t		wsize;		/* Size of write buffer */
 };
 #  endif /* !_HTTP_NO_PRIVATE */
 
@@ -324,6 +340,7 @@ extern const char *_cups_hstrerror(int error);
  * Prototypes...
  */
 
+extern int		_httpAddrListen(http_addr_t *addr, int port, int backlog) _CUPS_PRIVATE;
 extern void		_httpAddrSetPort(http_addr_t *addr, int port) _CUPS_PRIVATE;
 extern http_tls_credentials_t
 			_httpCreateCredentials(cups_array_t *credentials) _CUPS_PRIVATE;
@@ -337,6 +354,7 @@ extern const char	*_httpResolveURI(const char *uri, char *resolved_uri,
 			                 size_t resolved_size, int options,
 					 int (*cb)(void *context),
 					 void *context) _CUPS_PRIVATE;
+extern ssize_t		_httpReadSplice(http_t *http, int fd, int *pipefds, size_t length) _CUPS_PRIVATE;
 extern int		_httpSetDigestAuthString(http_t *http, const char *nonce, const char *method, const char *resource) _CUPS_PRIVATE;
 extern const char	*_httpStatus(cups_lang_t *lang, http_status_t status) _CUPS_PRIVATE;
 extern void		_httpTLSInitialize(void) _CUPS_PRIVATE;
@@ -348,6 +366,7 @@ extern void		_httpTLSStop(http_t *http) _CUPS_PRIVATE;
 extern int		_httpTLSWrite(http_t *http, const char *buf, int len) _CUPS_PRIVATE;
 extern int		_httpUpdate(http_t *http, http_status_t *status) _CUPS_PRIVATE;
 extern int		_httpWait(http_t *http, int msec, int usessl) _CUPS_PRIVATE;
+extern ssize_t		_httpWritev(http_t *http, struct iovec *iov, int num_iov) _CUPS_PRIVATE;
 
 
 /*
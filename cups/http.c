@@ -56,15 +56,22 @@ static void		http_debug_hex(const char *prefix, const char *buffer,
 static ssize_t		http_read(http_t *http, char *buffer, size_t length);
 static ssize_t		http_read_buffered(http_t *http, char *buffer, size_t length);
 static ssize_t		http_read_chunk(http_t *http, char *buffer, size_t length);
+static int		http_resize_rbuf(http_t *http, size_t size);
+static int		http_resize_wbuf(http_t *http, size_t size);
 static int		http_send(http_t *http, http_state_t request,
 			          const char *uri);
 static ssize_t		http_write(http_t *http, const char *buffer,
 			           size_t length);
 static ssize_t		http_write_chunk(http_t *http, const char *buffer,
 			                 size_t length);
+#ifndef _WIN32
+static ssize_t		http_writev(http_t *http, struct iovec *iov,
+			            int num_iov);
+#endif /* !_WIN32 */
 static off_t		http_set_length(http_t *http);
 static void		http_set_timeout(int fd, double timeout);
 static void		http_set_wait(http_t *http);
+static int		http_wait_write(http_t *http);
 
 #ifdef HAVE_TLS
 static int		http_tls_upgrade(http_t *http);
@@ -165,12 +172,21 @@ httpAcceptConnection(int fd,		/* I - Listen socket file descriptor */
 
   addrlen = sizeof(http_addr_t);
 
+#ifdef HAVE_ACCEPT4
+  if ((http->fd = accept4(fd, (struct sockaddr *)&(http->addrlist->addr),
+			  &addrlen, SOCK_CLOEXEC)) < 0)
+#else
   if ((http->fd = accept(fd, (struct sockaddr *)&(http->addrlist->addr),
 			 &addrlen)) < 0)
+#endif /* HAVE_ACCEPT4 */
   {
+    int	error = errno;			/* Error from accept() */
+
     _cupsSetHTTPError(HTTP_STATUS_ERROR);
     httpClose(http);
 
+    errno = error;
+
     return (NULL);
   }
 
@@ -200,13 +216,13 @@ httpAcceptConnection(int fd,		/* I - Listen socket file descriptor */
   val = 1;
   setsockopt(http->fd, IPPROTO_TCP, TCP_NODELAY, CUPS_SOCAST &val, sizeof(val));
 
-#ifdef FD_CLOEXEC
+#if defined(FD_CLOEXEC) && !defined(HAVE_ACCEPT4)
  /*
   * Close this socket when starting another process...
   */
 
   fcntl(http->fd, F_SETFD, FD_CLOEXEC);
-#endif /* FD_CLOEXEC */
+#endif /* FD_CLOEXEC && !HAVE_ACCEPT4 */
 
   return (http);
 }
@@ -385,6 +401,12 @@ httpClose(http_t *http)			/* I - HTTP connection */
   if (http->authstring && http->authstring != http->_authstring)
     free(http->authstring);
 
+  if (http->rbuf != http->buffer)
+    free(http->rbuf);
+
+  if (http->wbuf != http->wbuffer)
+    free(http->wbuf);
+
   free(http);
 }
 
@@ -701,9 +723,9 @@ httpFlushWrite(http_t *http)		/* I - HTTP connection */
   }
 
   if (http->data_encoding == HTTP_ENCODING_CHUNKED)
-    bytes = http_write_chunk(http, http->wbuffer, (size_t)http->wused);
+    bytes = http_write_chunk(http, http->wbuf, (size_t)http->wused);
   else
-    bytes = http_write(http, http->wbuffer, (size_t)http->wused);
+    bytes = http_write(http, http->wbuf, (size_t)http->wused);
 
   http->wused = 0;
 
@@ -1188,7 +1210,9 @@ httpGets(char   *line,			/* I - Line to read into */
         return (NULL);
       }
 
-      bytes = http_read(http, http->buffer + http->used, (size_t)(HTTP_MAX_BUFFER - http->used));
+      http->rpos = 0;
+
+      bytes = http_read(http, http->rbuf, http->rsize);
 
       DEBUG_printf(("4httpGets: read " CUPS_LLFMT " bytes.", CUPS_LLCAST bytes));
 
@@ -1257,7 +1281,7 @@ httpGets(char   *line,			/* I - Line to read into */
     * Now copy as much of the current line as possible...
     */
 
-    for (bufptr = http->buffer, bufend = http->buffer + http->used;
+    for (bufptr = http->rbuf + http->rpos, bufend = bufptr + http->used;
          lineptr < lineend && bufptr < bufend;)
     {
       if (*bufptr == 0x0a)
@@ -1272,9 +1296,11 @@ httpGets(char   *line,			/* I - Line to read into */
 	*lineptr++ = *bufptr++;
     }
 
-    http->used -= (int)(bufptr - http->buffer);
+    http->used -= (int)(bufptr - http->rbuf - http->rpos);
     if (http->used > 0)
-      memmove(http->buffer, bufptr, (size_t)http->used);
+      http->rpos = (size_t)(bufptr - http->rbuf);
+    else
+      http->rpos = 0;
 
     if (eol)
     {
@@ -1717,20 +1743,21 @@ httpPeek(http_t *http,			/* I - HTTP connection */
       }
     }
 
-    if ((size_t)http->data_remaining > sizeof(http->buffer))
-      buflen = sizeof(http->buffer);
+    if ((size_t)http->data_remaining > http->rsize)
+      buflen = (ssize_t)http->rsize;
     else
       buflen = (ssize_t)http->data_remaining;
 
     DEBUG_printf(("2httpPeek: Reading %d bytes into buffer.", (int)buflen));
-    bytes = http_read(http, http->buffer, (size_t)buflen);
+    http->rpos = 0;
+    bytes      = http_read(http, http->rbuf, (size_t)buflen);
 
     DEBUG_printf(("2httpPeek: Read " CUPS_LLFMT " bytes into buffer.",
                   CUPS_LLCAST bytes));
     if (bytes > 0)
     {
 #ifdef DEBUG
-      http_debug_hex("httpPeek", http->buffer, (int)bytes);
+      http_debug_hex("httpPeek", http->rbuf, (int)bytes);
 #endif /* DEBUG */
 
       http->used = (int)bytes;
@@ -1764,13 +1791,15 @@ httpPeek(http_t *http,			/* I - HTTP connection */
       DEBUG_printf(("1httpPeek: Copying %d more bytes of data into "
 		    "decompression buffer.", (int)buflen));
 
-      memcpy(http->sbuffer + ((z_stream *)http->stream)->avail_in, http->buffer, buflen);
+      memcpy(http->sbuffer + ((z_stream *)http->stream)->avail_in, http->rbuf + http->rpos, buflen);
       ((z_stream *)http->stream)->avail_in += buflen;
       http->used            -= (int)buflen;
       http->data_remaining  -= (off_t)buflen;
 
       if (http->used > 0)
-        memmove(http->buffer, http->buffer + buflen, (size_t)http->used);
+        http->rpos += buflen;
+      else
+        http->rpos = 0;
     }
 
     DEBUG_printf(("2httpPeek: length=%d, avail_in=%d", (int)length,
@@ -1820,7 +1849,7 @@ httpPeek(http_t *http,			/* I - HTTP connection */
     DEBUG_printf(("2httpPeek: grabbing %d bytes from input buffer...",
                   (int)bytes));
 
-    memcpy(buffer, http->buffer, length);
+    memcpy(buffer, http->rbuf + http->rpos, length);
   }
   else
     bytes = 0;
@@ -2129,6 +2158,8 @@ httpRead2(http_t *http,			/* I - HTTP connection */
       http_content_coding_finish(http);
 #endif /* HAVE_LIBZ */
 
+    http_resize_rbuf(http, HTTP_MAX_BUFFER);
+
     if (http->state == HTTP_STATE_POST_RECV)
       http->state ++;
     else if (http->state == HTTP_STATE_GET_SEND ||
@@ -2307,6 +2338,105 @@ httpReadRequest(http_t *http,		/* I - HTTP connection */
 }
 
 
+/*
+ * '_httpReadSplice()' - Move message body data from a HTTP connection to a file.
+ *
+ * This function uses splice() to move up to "length" bytes of a
+ * non-chunked, unencrypted, uncompressed message body from the socket to
+ * "fd" through the pipe "pipefds" without copying it through user space.
+ * It returns 0 when that is not possible or no data is available, in which
+ * case the caller should use @link httpRead2@ instead.  On error the pipe
+ * may still contain data and must not be reused.
+ */
+
+ssize_t					/* O - Number of bytes moved, 0 to use httpRead2, or -1 on error */
+_httpReadSplice(http_t *http,		/* I - HTTP connection */
+                int    fd,		/* I - File to write to */
+                int    *pipefds,	/* I - Pipe to use */
+                size_t length)		/* I - Maximum bytes to move */
+{
+#ifdef HAVE_SPLICE
+  ssize_t	bytes,			/* Bytes read from socket */
+		total,			/* Bytes written to file */
+		count;			/* Bytes written this pass */
+
+
+  DEBUG_printf(("_httpReadSplice(http=%p, fd=%d, pipefds=%p, length=" CUPS_LLFMT ")", (void *)http, fd, (void *)pipefds, CUPS_LLCAST length));
+
+  if (!http || fd < 0 || !pipefds || pipefds[0] < 0 || http->used > 0 ||
+      http->tls || http->data_encoding != HTTP_ENCODING_LENGTH ||
+#  ifdef HAVE_LIBZ
+      http->coding != _HTTP_CODING_IDENTITY ||
+#  endif /* HAVE_LIBZ */
+      http->data_remaining <= 0 || length == 0)
+    return (0);
+
+  if (length > (size_t)http->data_remaining)
+    length = (size_t)http->data_remaining;
+
+  while ((bytes = splice(http->fd, NULL, pipefds[1], NULL, length, SPLICE_F_MOVE | SPLICE_F_NONBLOCK)) < 0 && errno == EINTR);
+
+  if (bytes <= 0)
+  {
+   /*
+    * Let httpRead2 deal with EOF and errors...
+    */
+
+    DEBUG_printf(("1_httpReadSplice: splice from socket returned " CUPS_LLFMT ", errno=%d.", CUPS_LLCAST bytes, errno));
+    return (0);
+  }
+
+  for (total = 0; total < bytes; total += count)
+  {
+    if ((count = splice(pipefds[0], NULL, fd, NULL, (size_t)(bytes - total), SPLICE_F_MOVE)) < 0 && errno == EINTR)
+    {
+      count = 0;
+      continue;
+    }
+    else if (count <= 0)
+    {
+      http->error = count < 0 ? errno : EIO;
+
+      DEBUG_printf(("1_httpReadSplice: splice to file failed: %s", strerror(http->error)));
+      return (-1);
+    }
+  }
+
+  DEBUG_printf(("1_httpReadSplice: Moved " CUPS_LLFMT " bytes.", CUPS_LLCAST bytes));
+
+  http->activity       = time(NULL);
+  http->data_remaining -= bytes;
+
+  if (http->data_remaining <= 0)
+  {
+   /*
+    * End of content, same as httpRead2...
+    */
+
+    if (http->state == HTTP_STATE_POST_RECV)
+      http->state ++;
+    else if (http->state == HTTP_STATE_GET_SEND ||
+             http->state == HTTP_STATE_POST_SEND)
+      http->state = HTTP_STATE_WAITING;
+    else
+      http->state = HTTP_STATE_STATUS;
+
+    DEBUG_printf(("1_httpReadSplice: End of content, set state to %s.", httpStateString(http->state)));
+  }
+
+  return (bytes);
+
+#else
+  (void)http;
+  (void)fd;
+  (void)pipefds;
+  (void)length;
+
+  return (0);
+#endif /* HAVE_SPLICE */
+}
+
+
 /*
  * 'httpReconnect()' - Reconnect to a HTTP server.
  *
@@ -2382,10 +2512,14 @@ httpReconnect2(http_t *http,		/* I - HTTP connection */
   http->data_encoding   = HTTP_ENCODING_FIELDS;
   http->_data_remaining = 0;
   http->used            = 0;
+  http->rpos            = 0;
   http->data_remaining  = 0;
   http->hostaddr        = NULL;
   http->wused           = 0;
 
+  http_resize_rbuf(http, HTTP_MAX_BUFFER);
+  http_resize_wbuf(http, HTTP_MAX_BUFFER);
+
  /*
   * Connect to the server...
   */
@@ -3235,15 +3369,22 @@ httpWrite2(http_t     *http,		/* I - HTTP connection */
 #endif /* HAVE_LIBZ */
   if (length > 0)
   {
-    if (http->wused && (length + (size_t)http->wused) > sizeof(http->wbuffer))
+    if (http->wused && (length + (size_t)http->wused) > http->wsize)
     {
       DEBUG_printf(("2httpWrite2: Flushing buffer (wused=%d, length="
                     CUPS_LLFMT ")", http->wused, CUPS_LLCAST length));
 
       httpFlushWrite(http);
+
+     /*
+      * Bulk transfer, use a larger buffer for the rest of the message...
+      */
+
+      if (http->wsize < _HTTP_MAX_WBUFFER)
+        http_resize_wbuf(http, 2 * http->wsize);
     }
 
-    if ((length + (size_t)http->wused) <= sizeof(http->wbuffer) && length < sizeof(http->wbuffer))
+    if ((length + (size_t)http->wused) <= http->wsize && length < http->wsize)
     {
      /*
       * Write to buffer...
@@ -3252,7 +3393,7 @@ httpWrite2(http_t     *http,		/* I - HTTP connection */
       DEBUG_printf(("2httpWrite2: Copying " CUPS_LLFMT " bytes to wbuffer...",
                     CUPS_LLCAST length));
 
-      memcpy(http->wbuffer + http->wused, buffer, length);
+      memcpy(http->wbuf + http->wused, buffer, length);
       http->wused += (int)length;
       bytes = (ssize_t)length;
     }
@@ -3303,6 +3444,8 @@ httpWrite2(http_t     *http,		/* I - HTTP connection */
         return (-1);
     }
 
+    http_resize_wbuf(http, HTTP_MAX_BUFFER);
+
     if (http->data_encoding == HTTP_ENCODING_CHUNKED)
     {
      /*
@@ -3565,6 +3708,107 @@ httpWriteResponse(http_t        *http,	/* I - HTTP connection */
 }
 
 
+/*
+ * '_httpWritev()' - Write multiple buffers to a HTTP connection.
+ *
+ * Unencrypted, uncompressed data is sent with a single vectored write along
+ * with any buffered data and the chunk framing.  Otherwise the buffers are
+ * written using httpWrite2().
+ */
+
+ssize_t					/* O - Number of bytes written or -1 on error */
+_httpWritev(http_t       *http,		/* I - HTTP connection */
+            struct iovec *iov,		/* I - Buffers to write */
+            int          num_iov)	/* I - Number of buffers */
+{
+  int		i;			/* Looping var */
+  size_t	total;			/* Total bytes to write */
+#ifndef _WIN32
+  int		num_vec;		/* Number of buffers to send */
+  struct iovec	vec[_HTTP_MAX_IOV + 3];	/* Buffers to send */
+  char		header[16];		/* Chunk header */
+  ssize_t	bytes;			/* Bytes written */
+#endif /* !_WIN32 */
+
+
+  DEBUG_printf(("_httpWritev(http=%p, iov=%p, num_iov=%d)", (void *)http, (void *)iov, num_iov));
+
+  if (!http || !iov || num_iov < 0)
+    return (-1);
+
+  for (i = 0, total = 0; i < num_iov; i ++)
+    total += iov[i].iov_len;
+
+#ifndef _WIN32
+#  ifdef HAVE_LIBZ
+  if (http->coding == _HTTP_CODING_IDENTITY)
+#  endif /* HAVE_LIBZ */
+  if (!http->tls && num_iov <= _HTTP_MAX_IOV && total > 0 && (total + (size_t)http->wused) > http->wsize && (http->data_encoding == HTTP_ENCODING_CHUNKED || (http->data_encoding == HTTP_ENCODING_LENGTH && (off_t)total <= http->data_remaining)))
+  {
+   /*
+    * Send the buffered data and the new buffers in a single chunk...
+    */
+
+    http->activity = time(NULL);
+    num_vec        = 0;
+
+    if (http->data_encoding == HTTP_ENCODING_CHUNKED)
+    {
+      snprintf(header, sizeof(header), "%x\r\n", (unsigned)(total + (size_t)http->wused));
+      vec[num_vec].iov_base = header;
+      vec[num_vec].iov_len  = strlen(header);
+      num_vec ++;
+    }
+
+    if (http->wused)
+    {
+      vec[num_vec].iov_base = http->wbuf;
+      vec[num_vec].iov_len  = (size_t)http->wused;
+      num_vec ++;
+    }
+
+    memcpy(vec + num_vec, iov, (size_t)num_iov * sizeof(struct iovec));
+    num_vec += num_iov;
+
+    if (http->data_encoding == HTTP_ENCODING_CHUNKED)
+    {
+      vec[num_vec].iov_base = (void *)"\r\n";
+      vec[num_vec].iov_len  = 2;
+      num_vec ++;
+    }
+
+    bytes       = http_writev(http, vec, num_vec);
+    http->wused = 0;
+
+    if (bytes < 0)
+      return (-1);
+
+    if (http->data_encoding == HTTP_ENCODING_LENGTH && (http->data_remaining -= (off_t)total) == 0)
+    {
+     /*
+      * Let httpWrite2 handle the end of the request...
+      */
+
+      if (httpWrite2(http, "", 0) < 0)
+        return (-1);
+    }
+
+    DEBUG_printf(("1_httpWritev: Returning " CUPS_LLFMT ".", CUPS_LLCAST total));
+
+    return ((ssize_t)total);
+  }
+#endif /* !_WIN32 */
+
+  for (i = 0; i < num_iov; i ++)
+  {
+    if (iov[i].iov_len > 0 && httpWrite2(http, iov[i].iov_base, iov[i].iov_len) < 0)
+      return (-1);
+  }
+
+  return ((ssize_t)total);
+}
+
+
 /*
  * 'http_add_field()' - Add a value for a HTTP field, appending if needed.
  */
@@ -4004,6 +4248,10 @@ http_create(
   http->addrlist = myaddrlist;
   http->blocking = blocking;
   http->fd       = -1;
+  http->rbuf     = http->buffer;
+  http->rsize    = sizeof(http->buffer);
+  http->wbuf     = http->wbuffer;
+  http->wsize    = sizeof(http->wbuffer);
 #ifdef HAVE_GSSAPI
   http->gssctx   = GSS_C_NO_CONTEXT;
   http->gssname  = GSS_C_NO_NAME;
@@ -4189,6 +4437,8 @@ http_read(http_t *http,			/* I - HTTP connection */
  * 'http_read_buffered()' - Do a buffered read from a HTTP connection.
  *
  * This function reads data from the HTTP buffer or from the socket, as needed.
+ * Small reads are satisfied from the read buffer, which grows for bulk
+ * transfers so that a message body is read with fewer system calls.
  */
 
 static ssize_t				/* O - Number of bytes read or -1 on error */
@@ -4201,6 +4451,36 @@ http_read_buffered(http_t *http,	/* I - HTTP connection */
 
   DEBUG_printf(("7http_read_buffered(http=%p, buffer=%p, length=" CUPS_LLFMT ") used=%d", (void *)http, (void *)buffer, CUPS_LLCAST length, http->used));
 
+  if (http->used == 0 && length < http->rsize && http->data_remaining > (off_t)length)
+  {
+   /*
+    * Fill the read buffer with as much of the message body as is available;
+    * chunked bodies may also pull in the next chunk header...
+    */
+
+    size_t	buflen = http->rsize;	/* Bytes to read into buffer */
+
+    if (http->data_encoding == HTTP_ENCODING_LENGTH && (off_t)buflen > http->data_remaining)
+      buflen = (size_t)http->data_remaining;
+
+    http->rpos = 0;
+
+    if ((bytes = http_read(http, http->rbuf, buflen)) <= 0)
+      return (bytes);
+
+    DEBUG_printf(("8http_read_buffered: Read " CUPS_LLFMT " bytes into input buffer.", CUPS_LLCAST bytes));
+
+    http->used = (int)bytes;
+
+   /*
+    * If the socket filled the buffer and more data is coming, use a larger
+    * buffer for the rest of the message...
+    */
+
+    if ((size_t)bytes == http->rsize && http->rsize < _HTTP_MAX_RBUFFER && (http->data_encoding == HTTP_ENCODING_CHUNKED || http->data_remaining > bytes))
+      http_resize_rbuf(http, 2 * http->rsize);
+  }
+
   if (http->used > 0)
   {
     if (length > (size_t)http->used)
@@ -4211,11 +4491,13 @@ http_read_buffered(http_t *http,	/* I - HTTP connection */
     DEBUG_printf(("8http_read: Grabbing %d bytes from input buffer.",
                   (int)bytes));
 
-    memcpy(buffer, http->buffer, (size_t)bytes);
+    memcpy(buffer, http->rbuf + http->rpos, (size_t)bytes);
     http->used -= (int)bytes;
 
     if (http->used > 0)
-      memmove(http->buffer, http->buffer + bytes, (size_t)http->used);
+      http->rpos += (size_t)bytes;
+    else
+      http->rpos = 0;
   }
   else
     bytes = http_read(http, buffer, length);
@@ -4292,6 +4574,85 @@ http_read_chunk(http_t *http,		/* I - HTTP connection */
 }
 
 
+
+/*
+ * 'http_resize_rbuf()' - Resize the read buffer, preserving unread data.
+ *
+ * Sizes up to HTTP_MAX_BUFFER use the buffer embedded in the connection.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+http_resize_rbuf(http_t *http,		/* I - HTTP connection */
+                 size_t size)		/* I - New size of buffer */
+{
+  char	*rbuf;				/* New read buffer */
+
+
+  if (size <= sizeof(http->buffer))
+    size = sizeof(http->buffer);
+
+  if (size == http->rsize || (size_t)http->used > size)
+    return (size == http->rsize);
+
+  if (size == sizeof(http->buffer))
+    rbuf = http->buffer;
+  else if ((rbuf = malloc(size)) == NULL)
+    return (0);
+
+  DEBUG_printf(("8http_resize_rbuf: Resizing read buffer from " CUPS_LLFMT " to " CUPS_LLFMT " bytes.", CUPS_LLCAST http->rsize, CUPS_LLCAST size));
+
+  if (http->used > 0)
+    memcpy(rbuf, http->rbuf + http->rpos, (size_t)http->used);
+
+  if (http->rbuf != http->buffer)
+    free(http->rbuf);
+
+  http->rbuf  = rbuf;
+  http->rsize = size;
+  http->rpos  = 0;
+
+  return (1);
+}
+
+
+/*
+ * 'http_resize_wbuf()' - Resize the write buffer, preserving pending data.
+ *
+ * Sizes up to HTTP_MAX_BUFFER use the buffer embedded in the connection.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+http_resize_wbuf(http_t *http,		/* I - HTTP connection */
+                 size_t size)		/* I - New size of buffer */
+{
+  char	*wbuf;				/* New write buffer */
+
+
+  if (size <= sizeof(http->wbuffer))
+    size = sizeof(http->wbuffer);
+
+  if (size == http->wsize || (size_t)http->wused > size)
+    return (size == http->wsize);
+
+  if (size == sizeof(http->wbuffer))
+    wbuf = http->wbuffer;
+  else if ((wbuf = malloc(size)) == NULL)
+    return (0);
+
+  DEBUG_printf(("8http_resize_wbuf: Resizing write buffer from " CUPS_LLFMT " to " CUPS_LLFMT " bytes.", CUPS_LLCAST http->wsize, CUPS_LLCAST size));
+
+  if (http->wused > 0)
+    memcpy(wbuf, http->wbuf, (size_t)http->wused);
+
+  if (http->wbuf != http->wbuffer)
+    free(http->wbuf);
+
+  http->wbuf  = wbuf;
+  http->wsize = size;
+
+  return (1);
+}
+
 /*
  * 'http_send()' - Send a request with all fields and the trailing blank line.
  */
@@ -4671,82 +5032,94 @@ http_tls_upgrade(http_t *http)		/* I - HTTP connection */
 
 
 /*
- * 'http_write()' - Write a buffer to a HTTP connection.
+ * 'http_wait_write()' - Wait for a HTTP connection to become writable.
  */
 
-static ssize_t				/* O - Number of bytes written */
-http_write(http_t     *http,		/* I - HTTP connection */
-           const char *buffer,		/* I - Buffer for data */
-	   size_t     length)		/* I - Number of bytes to write */
+static int				/* O - 0 when writable, -1 on error or timeout */
+http_wait_write(http_t *http)		/* I - HTTP connection */
 {
-  ssize_t	tbytes,			/* Total bytes sent */
-		bytes;			/* Bytes sent */
-
-
-  DEBUG_printf(("7http_write(http=%p, buffer=%p, length=" CUPS_LLFMT ")", (void *)http, (void *)buffer, CUPS_LLCAST length));
-  http->error = 0;
-  tbytes      = 0;
-
-  while (length > 0)
-  {
-    DEBUG_printf(("8http_write: About to write %d bytes.", (int)length));
-
-    if (http->timeout_value > 0.0)
-    {
 #ifdef HAVE_POLL
-      struct pollfd	pfd;		/* Polled file descriptor */
+  struct pollfd	pfd;			/* Polled file descriptor */
 #else
-      fd_set		output_set;	/* Output ready for write? */
-      struct timeval	timeout;	/* Timeout value */
+  fd_set	output_set;		/* Output ready for write? */
+  struct timeval timeout;		/* Timeout value */
 #endif /* HAVE_POLL */
-      int		nfds;		/* Result from select()/poll() */
+  int		nfds;			/* Result from select()/poll() */
 
-      do
-      {
+
+  do
+  {
 #ifdef HAVE_POLL
-	pfd.fd     = http->fd;
-	pfd.events = POLLOUT;
+    pfd.fd     = http->fd;
+    pfd.events = POLLOUT;
 
-	while ((nfds = poll(&pfd, 1, http->wait_value)) < 0 &&
-	       (errno == EINTR || errno == EAGAIN))
-	  /* do nothing */;
+    while ((nfds = poll(&pfd, 1, http->wait_value)) < 0 &&
+	   (errno == EINTR || errno == EAGAIN))
+      /* do nothing */;
 
 #else
-	do
-	{
-	  FD_ZERO(&output_set);
-	  FD_SET(http->fd, &output_set);
+    do
+    {
+      FD_ZERO(&output_set);
+      FD_SET(http->fd, &output_set);
 
-	  timeout.tv_sec  = http->wait_value / 1000;
-	  timeout.tv_usec = 1000 * (http->wait_value % 1000);
+      timeout.tv_sec  = http->wait_value / 1000;
+      timeout.tv_usec = 1000 * (http->wait_value % 1000);
 
-	  nfds = select(http->fd + 1, NULL, &output_set, NULL, &timeout);
-	}
+      nfds = select(http->fd + 1, NULL, &output_set, NULL, &timeout);
+    }
 #  ifdef _WIN32
-	while (nfds < 0 && (WSAGetLastError() == WSAEINTR ||
-			    WSAGetLastError() == WSAEWOULDBLOCK));
+    while (nfds < 0 && (WSAGetLastError() == WSAEINTR ||
+			WSAGetLastError() == WSAEWOULDBLOCK));
 #  else
-	while (nfds < 0 && (errno == EINTR || errno == EAGAIN));
+    while (nfds < 0 && (errno == EINTR || errno == EAGAIN));
 #  endif /* _WIN32 */
 #endif /* HAVE_POLL */
 
-        if (nfds < 0)
-	{
-	  http->error = errno;
-	  return (-1);
-	}
-	else if (nfds == 0 && (!http->timeout_cb || !(*http->timeout_cb)(http, http->timeout_data)))
-	{
+    if (nfds < 0)
+    {
+      http->error = errno;
+      return (-1);
+    }
+    else if (nfds == 0 && (!http->timeout_cb || !(*http->timeout_cb)(http, http->timeout_data)))
+    {
 #ifdef _WIN32
-	  http->error = WSAEWOULDBLOCK;
+      http->error = WSAEWOULDBLOCK;
 #else
-	  http->error = EWOULDBLOCK;
+      http->error = EWOULDBLOCK;
 #endif /* _WIN32 */
-	  return (-1);
-	}
-      }
-      while (nfds <= 0);
+      return (-1);
     }
+  }
+  while (nfds <= 0);
+
+  return (0);
+}
+
+
+/*
+ * 'http_write()' - Write a buffer to a HTTP connection.
+ */
+
+static ssize_t				/* O - Number of bytes written */
+http_write(http_t     *http,		/* I - HTTP connection */
+           const char *buffer,		/* I - Buffer for data */
+	   size_t     length)		/* I - Number of bytes to write */
+{
+  ssize_t	tbytes,			/* Total bytes sent */
+		bytes;			/* Bytes sent */
+
+
+  DEBUG_printf(("7http_write(http=%p, buffer=%p, length=" CUPS_LLFMT ")", (void *)http, (void *)buffer, CUPS_LLCAST length));
+  http->error = 0;
+  tbytes      = 0;
+
+  while (length > 0)
+  {
+    DEBUG_printf(("8http_write: About to write %d bytes.", (int)length));
+
+    if (http->timeout_value > 0.0 && http_wait_write(http) < 0)
+      return (-1);
 
 #ifdef HAVE_TLS
     if (http->tls)
@@ -4855,3 +5228,81 @@ http_write_chunk(http_t     *http,	/* I - HTTP connection */
 
   return (bytes);
 }
+
+
+#ifndef _WIN32
+/*
+ * 'http_writev()' - Write multiple buffers to a HTTP connection.
+ */
+
+static ssize_t				/* O - Number of bytes written */
+http_writev(http_t       *http,		/* I - HTTP connection */
+            struct iovec *iov,		/* I - Buffers to write */
+            int          num_iov)	/* I - Number of buffers */
+{
+  ssize_t	tbytes,			/* Total bytes sent */
+		bytes;			/* Bytes sent */
+
+
+  DEBUG_printf(("7http_writev(http=%p, iov=%p, num_iov=%d)", (void *)http, (void *)iov, num_iov));
+  http->error = 0;
+  tbytes      = 0;
+
+  while (num_iov > 0)
+  {
+    if (http->timeout_value > 0.0 && http_wait_write(http) < 0)
+      return (-1);
+
+    bytes = writev(http->fd, iov, num_iov);
+
+    DEBUG_printf(("8http_writev: Write of %d buffers returned " CUPS_LLFMT ".", num_iov, CUPS_LLCAST bytes));
+
+    if (bytes < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      else if (errno == EWOULDBLOCK || errno == EAGAIN)
+      {
+	if (http->timeout_cb && (*http->timeout_cb)(http, http->timeout_data))
+          continue;
+        else if (!http->timeout_cb && errno == EAGAIN)
+	  continue;
+
+        http->error = errno;
+      }
+      else if (errno != http->error && errno != ECONNRESET)
+      {
+        http->error = errno;
+	continue;
+      }
+
+      DEBUG_printf(("8http_writev: error writing data (%s).", strerror(http->error)));
+
+      return (-1);
+    }
+
+    tbytes += bytes;
+
+   /*
+    * Skip the buffers that have been written...
+    */
+
+    while (num_iov > 0 && (size_t)bytes >= iov->iov_len)
+    {
+      bytes -= (ssize_t)iov->iov_len;
+      iov ++;
+      num_iov --;
+    }
+
+    if (num_iov > 0)
+    {
+      iov->iov_base = (char *)iov->iov_base + bytes;
+      iov->iov_len  -= (size_t)bytes;
+    }
+  }
+
+  DEBUG_printf(("8http_writev: Returning " CUPS_LLFMT ".", CUPS_LLCAST tbytes));
+
+  return (tbytes);
+}
+#endif /* !_WIN32 */
@@ -33,6 +33,13 @@ extern "C" {
 
 #  define IPP_BUF_SIZE	(IPP_MAX_LENGTH + 2)
 					/* Size of buffer */
+#  define IPP_ARENA_MIN	4096		/* Size of first arena chunk */
+#  define IPP_ARENA_MAX	65536		/* Max size of arena chunks */
+#  define IPP_INDEX_MIN	16		/* Min attributes for name index */
+#  define IPP_INDEX_LOOKUPS 8		/* Lookups before building an index */
+#  define IPP_MAX_IOV	64		/* Max buffers per vectored write */
+#  define IPP_MIN_IOV	128		/* Min length of values written in place */
+#  define IPP_RSET_MAX	2048		/* Max attribute names with IDs */
 
 
 /*
@@ -115,9 +122,40 @@ struct _ipp_attribute_s			/**** IPP attribute ****/
 		value_tag;		/* What type of value is it? */
   char		*name;			/* Name of attribute */
   int		num_values;		/* Number of values */
+  int		arena;			/* Allocated from the message arena? */
   _ipp_value_t	values[1];		/* Values */
 };
 
+typedef struct _ipp_buffer_s		/**** Zero-copy source buffer ****/
+{
+  int		use;			/* Use count */
+  ipp_uchar_t	*data,			/* Start of buffer */
+		*end;			/* End of buffer */
+} _ipp_buffer_t;
+
+typedef struct _ipp_chunk_s		/**** Arena memory chunk ****/
+{
+  struct _ipp_chunk_s *next;		/* Next (older) chunk */
+  char		*ptr,			/* Next free byte */
+		*end;			/* End of chunk */
+} _ipp_chunk_t;
+
+typedef struct _ipp_ientry_s		/**** Attribute name index entry ****/
+{
+  struct _ipp_ientry_s *next;		/* Next entry in hash bucket */
+  unsigned	hash;			/* Hash of attribute name */
+  int		count;			/* Number of attributes with this name */
+  ipp_attribute_t *attr,		/* First attribute with this name */
+		*prev;			/* Attribute before it or NULL */
+} _ipp_ientry_t;
+
+typedef struct _ipp_index_s		/**** Attribute name index ****/
+{
+  size_t	num_entries,		/* Number of entries */
+		num_buckets;		/* Number of hash buckets (power of 2) */
+  _ipp_ientry_t	**buckets;		/* Hash buckets */
+} _ipp_index_t;
+
 struct _ipp_s				/**** IPP Request/Response/Notification ****/
 {
   ipp_state_t		state;		/* State of request */
@@ -135,6 +173,11 @@ struct _ipp_s				/**** IPP Request/Response/Notification ****/
 /**** New in CUPS 2.0 ****/
   int			atend,		/* At end of list? */
 			curindex;	/* Current attribute index for hierarchical search */
+/**** New in CUPS 2.4.3 ****/
+  _ipp_index_t		*index;		/* Attribute name index, if any */
+  int			lookups;	/* Unindexed lookups since last check */
+  _ipp_chunk_t		*arena;		/* Arena chunks, if any */
+  _ipp_buffer_t		*buffer;	/* Source buffer for zero-copy values, if any */
 };
 
 typedef struct _ipp_option_s		/**** Attribute mapping data ****/
@@ -148,6 +191,12 @@ typedef struct _ipp_option_s		/**** Attribute mapping data ****/
   const ipp_op_t *operations;		/* Allowed operations for this attr */
 } _ipp_option_t;
 
+typedef struct _ipp_rset_s		/**** Requested attributes set ****/
+{
+  unsigned	bits[IPP_RSET_MAX / 32];/* Registered attributes, by ID */
+  cups_array_t	*names;			/* Other attribute names */
+} _ipp_rset_t;
+
 typedef struct _ipp_file_s _ipp_file_t;/**** File Parser ****/
 typedef struct _ipp_vars_s _ipp_vars_t;/**** Variables ****/
 
@@ -195,11 +244,21 @@ struct _ipp_file_s			/**** File Parser */
 extern const char	*_ippCheckOptions(void) _CUPS_PRIVATE;
 #endif /* DEBUG */
 extern _ipp_option_t	*_ippFindOption(const char *name) _CUPS_PRIVATE;
+extern ipp_t		*_ippNewArena(void) _CUPS_PRIVATE;
+extern ipp_t		*_ippNewFromBuffer(ipp_uchar_t *data, size_t length) _CUPS_PRIVATE;
 
 /* ipp-file.c */
 extern ipp_t		*_ippFileParse(_ipp_vars_t *v, const char *filename, void *user_data) _CUPS_PRIVATE;
 extern int		_ippFileReadToken(_ipp_file_t *f, char *token, size_t tokensize) _CUPS_PRIVATE;
 
+/* ipp-support.c */
+extern _ipp_rset_t	*_ippCreateRequestedSet(ipp_t *request) _CUPS_PRIVATE;
+extern void		_ippRSetAdd(_ipp_rset_t *rs, const char *name) _CUPS_PRIVATE;
+extern void		_ippRSetDelete(_ipp_rset_t *rs) _CUPS_PRIVATE;
+extern int		_ippRSetFind(_ipp_rset_t *rs, const char *name) _CUPS_PRIVATE;
+extern _ipp_rset_t	*_ippRSetNew(void) _CUPS_PRIVATE;
+extern void		_ippRSetRemove(_ipp_rset_t *rs, const char *name) _CUPS_PRIVATE;
+
 /* ipp-vars.c */
 extern void		_ippVarsDeinit(_ipp_vars_t *v) _CUPS_PRIVATE;
 extern void		_ippVarsExpand(_ipp_vars_t *v, char *dst, const char *src, size_t dstsize) _CUPS_NONNULL(1,2,3) _CUPS_PRIVATE;
@@ -635,12 +635,167 @@ static const char * const ipp_document_states[] =
 		  "stopped"
 		};
 
+static _cups_mutex_t	ipp_rset_mutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex for attribute ID table */
+static int		ipp_rset_ready = 0,
+					/* Attribute ID table built? */
+			ipp_rset_count = 0,
+					/* Number of attribute IDs */
+			ipp_rset_nbuckets = 0;
+					/* Number of displacement buckets */
+static unsigned		ipp_rset_mask = 0;
+					/* Slot mask */
+static const char	**ipp_rset_names = NULL;
+					/* Attribute names, by ID */
+static unsigned short	*ipp_rset_disp = NULL;
+					/* Displacement for each bucket */
+static short		*ipp_rset_slots = NULL;
+					/* Attribute ID for each slot */
+
 
 /*
  * Local functions...
  */
 
 static size_t	ipp_col_string(ipp_t *col, char *buffer, size_t bufsize);
+static unsigned	ipp_rset_hash(const char *name);
+static int	ipp_rset_id(const char *name);
+static void	ipp_rset_init(void);
+static unsigned	ipp_rset_slot(unsigned hash, unsigned disp);
+
+
+/*
+ * '_ippCreateRequestedSet()' - Create a set of requested attributes.
+ *
+ * This is the set version of @link ippCreateRequestedArray@.  Attribute names
+ * from the IANA IPP registry groups are stored as bits, so checking whether an
+ * attribute was requested is a hash and a single bit test.  A @code NULL@ set
+ * means "all" attributes.
+ */
+
+_ipp_rset_t *				/* O - Requested attributes set or @code NULL@ if all */
+_ippCreateRequestedSet(ipp_t *request)	/* I - IPP request */
+{
+  cups_array_t	*ra;			/* Requested attributes array */
+  const char	*name;			/* Current attribute name */
+  _ipp_rset_t	*rs;			/* Requested attributes set */
+
+
+  if ((ra = ippCreateRequestedArray(request)) == NULL)
+    return (NULL);
+
+  if ((rs = _ippRSetNew()) != NULL)
+  {
+    for (name = (const char *)cupsArrayFirst(ra); name; name = (const char *)cupsArrayNext(ra))
+      _ippRSetAdd(rs, name);
+  }
+
+  cupsArrayDelete(ra);
+
+  return (rs);
+}
+
+
+/*
+ * '_ippRSetAdd()' - Add an attribute name to a requested attributes set.
+ */
+
+void
+_ippRSetAdd(_ipp_rset_t *rs,		/* I - Requested attributes set */
+            const char  *name)		/* I - Attribute name */
+{
+  int	id;				/* Attribute ID */
+
+
+  if (!rs || !name)
+    return;
+
+  if ((id = ipp_rset_id(name)) >= 0)
+  {
+    rs->bits[id / 32] |= 1U << (id & 31);
+  }
+  else
+  {
+    if (!rs->names)
+      rs->names = cupsArrayNew3((cups_array_func_t)strcmp, NULL, NULL, 0, (cups_acopy_func_t)_cupsStrAlloc, (cups_afree_func_t)_cupsStrFree);
+
+    if (!cupsArrayFind(rs->names, (void *)name))
+      cupsArrayAdd(rs->names, (void *)name);
+  }
+}
+
+
+/*
+ * '_ippRSetDelete()' - Free a requested attributes set.
+ */
+
+void
+_ippRSetDelete(_ipp_rset_t *rs)		/* I - Requested attributes set */
+{
+  if (!rs)
+    return;
+
+  cupsArrayDelete(rs->names);
+  free(rs);
+}
+
+
+/*
+ * '_ippRSetFind()' - Check whether an attribute is in a requested attributes set.
+ */
+
+int					/* O - 1 if present, 0 otherwise */
+_ippRSetFind(_ipp_rset_t *rs,		/* I - Requested attributes set */
+             const char  *name)		/* I - Attribute name */
+{
+  int	id;				/* Attribute ID */
+
+
+  if (!rs || !name)
+    return (0);
+
+  if ((id = ipp_rset_id(name)) >= 0)
+    return ((rs->bits[id / 32] >> (id & 31)) & 1);
+  else
+    return (cupsArrayFind(rs->names, (void *)name) != NULL);
+}
+
+
+/*
+ * '_ippRSetNew()' - Create an empty requested attributes set.
+ */
+
+_ipp_rset_t *				/* O - Requested attributes set */
+_ippRSetNew(void)
+{
+  _cupsMutexLock(&ipp_rset_mutex);
+  if (!ipp_rset_ready)
+    ipp_rset_init();
+  _cupsMutexUnlock(&ipp_rset_mutex);
+
+  return ((_ipp_rset_t *)calloc(1, sizeof(_ipp_rset_t)));
+}
+
+
+/*
+ * '_ippRSetRemove()' - Remove an attribute name from a requested attributes set.
+ */
+
+void
+_ippRSetRemove(_ipp_rset_t *rs,		/* I - Requested attributes set */
+               const char  *name)	/* I - Attribute name */
+{
+  int	id;				/* Attribute ID */
+
+
+  if (!rs || !name)
+    return;
+
+  if ((id = ipp_rset_id(name)) >= 0)
+    rs->bits[id / 32] &= ~(1U << (id & 31));
+  else
+    cupsArrayRemove(rs->names, (void *)name);
+}
 
 
 /*
@@ -2571,3 +2726,276 @@ ipp_col_string(ipp_t  *col,		/* I - Collection attribute */
 
   return ((size_t)(bufptr - buffer));
 }
+
+
+/*
+ * 'ipp_rset_hash()' - Compute the FNV-1a hash of an attribute name.
+ */
+
+static unsigned				/* O - Hash value */
+ipp_rset_hash(const char *name)		/* I - Attribute name */
+{
+  unsigned	hash = 2166136261U;	/* Hash value */
+
+
+  while (*name)
+  {
+    hash ^= (unsigned char)*name++;
+    hash *= 16777619U;
+  }
+
+  return (hash);
+}
+
+
+/*
+ * 'ipp_rset_id()' - Look up the ID for an attribute name.
+ *
+ * The slot table is a perfect hash, so a single probe and compare is enough.
+ */
+
+static int				/* O - Attribute ID or -1 if none */
+ipp_rset_id(const char *name)		/* I - Attribute name */
+{
+  unsigned	hash;			/* Hash of name */
+  int		id;			/* Attribute ID */
+
+
+  if (!ipp_rset_count)
+    return (-1);
+
+  hash = ipp_rset_hash(name);
+  id   = ipp_rset_slots[ipp_rset_slot(hash, ipp_rset_disp[hash % (unsigned)ipp_rset_nbuckets]) & ipp_rset_mask];
+
+  if (id >= 0 && !strcmp(ipp_rset_names[id], name))
+    return (id);
+  else
+    return (-1);
+}
+
+
+/*
+ * 'ipp_rset_init()' - Build the attribute ID table.
+ *
+ * IDs are assigned to every attribute in the registry groups known to
+ * @link ippCreateRequestedArray@, in sorted order.  The slot table is built
+ * using "hash and displace": names are grouped into buckets by hash, and each
+ * bucket (largest first) gets the first displacement that puts all of its
+ * names into free slots.  Must be called with the mutex held.
+ */
+
+static void
+ipp_rset_init(void)
+{
+  int		i, j,			/* Looping vars */
+		count,			/* Number of names */
+		nbuckets,		/* Number of buckets */
+		*bucket_count = NULL,	/* Names per bucket */
+		*bucket_order = NULL,	/* Buckets, largest first */
+		*bucket_first = NULL,	/* First name index for each bucket */
+		*name_order = NULL;	/* Names sorted by bucket */
+  unsigned	*hashes = NULL,		/* Name hashes */
+		tsize,			/* Slot table size */
+		slots[64];		/* Slots for current bucket */
+  short		*table = NULL;		/* Slot table */
+  unsigned short *disp = NULL;		/* Displacements */
+  const char	**names = NULL,		/* Names */
+		*name;			/* Current name */
+  ipp_t		*request;		/* Request for all groups */
+  cups_array_t	*ra;			/* Array of all names */
+  static const char * const groups[] =	/* Registry groups */
+  {
+    "document-description",
+    "document-template",
+    "job-description",
+    "job-template",
+    "printer-description",
+    "resource-description",
+    "resource-status",
+    "resource-template",
+    "subscription-description",
+    "subscription-template",
+    "system-description",
+    "system-status"
+  };
+
+
+  ipp_rset_ready = 1;
+
+ /*
+  * Get the sorted list of names...
+  */
+
+  request = ippNewRequest(IPP_OP_GET_PRINTER_ATTRIBUTES);
+  ippAddStrings(request, IPP_TAG_OPERATION, IPP_CONST_TAG(IPP_TAG_KEYWORD), "requested-attributes", (int)(sizeof(groups) / sizeof(groups[0])), NULL, groups);
+
+  ra = ippCreateRequestedArray(request);
+  ippDelete(request);
+
+  if ((count = cupsArrayCount(ra)) > IPP_RSET_MAX)
+    count = IPP_RSET_MAX;
+
+  nbuckets = count / 2 + 1;
+
+  if (count == 0 ||
+      (names = calloc((size_t)count, sizeof(char *))) == NULL ||
+      (hashes = calloc((size_t)count, sizeof(unsigned))) == NULL ||
+      (name_order = calloc((size_t)count, sizeof(int))) == NULL ||
+      (bucket_count = calloc((size_t)nbuckets, sizeof(int))) == NULL ||
+      (bucket_first = calloc((size_t)nbuckets + 1, sizeof(int))) == NULL ||
+      (bucket_order = calloc((size_t)nbuckets, sizeof(int))) == NULL ||
+      (disp = calloc((size_t)nbuckets, sizeof(unsigned short))) == NULL)
+    goto done;
+
+  for (i = 0, name = (const char *)cupsArrayFirst(ra); name && i < count; name = (const char *)cupsArrayNext(ra))
+  {
+    if (i > 0 && !strcmp(name, names[i - 1]))
+      continue;				/* Names are listed in more than one group */
+
+    names[i]  = name;
+    hashes[i] = ipp_rset_hash(name);
+
+    bucket_count[hashes[i] % (unsigned)nbuckets] ++;
+    i ++;
+  }
+
+  count = i;
+
+ /*
+  * Sort the names by bucket and the buckets by size...
+  */
+
+  for (i = 0; i < nbuckets; i ++)
+    bucket_first[i + 1] = bucket_first[i] + bucket_count[i];
+
+  for (i = 0; i < nbuckets; i ++)
+    bucket_count[i] = 0;
+
+  for (i = 0; i < count; i ++)
+  {
+    j = (int)(hashes[i] % (unsigned)nbuckets);
+
+    name_order[bucket_first[j] + bucket_count[j]] = i;
+    bucket_count[j] ++;
+  }
+
+  for (i = 0, j = 0; i <= 64; i ++)
+  {
+    int	k;				/* Looping var */
+
+    for (k = 0; k < nbuckets; k ++)
+      if (bucket_count[k] == 64 - i)
+        bucket_order[j ++] = k;
+  }
+
+  if (j < nbuckets)
+    goto done;				/* Bucket with more than 64 names */
+
+ /*
+  * Find displacements, growing the table as needed...
+  */
+
+  for (tsize = 2; tsize < (unsigned)count * 2; tsize *= 2);
+
+  for (; tsize <= 65536; tsize *= 2)
+  {
+    free(table);
+
+    if ((table = malloc(tsize * sizeof(short))) == NULL)
+      goto done;
+
+    memset(table, 0xff, tsize * sizeof(short));
+
+    for (i = 0; i < nbuckets; i ++)
+    {
+      int	b = bucket_order[i],	/* Current bucket */
+		k, l;			/* Looping vars */
+      unsigned	d;			/* Current displacement */
+
+      if (bucket_count[b] == 0)
+        break;
+
+      for (d = 0; d < 65536; d ++)
+      {
+        for (k = 0; k < bucket_count[b]; k ++)
+	{
+	  slots[k] = ipp_rset_slot(hashes[name_order[bucket_first[b] + k]], d) & (tsize - 1);
+
+	  if (table[slots[k]] >= 0)
+	    break;
+
+          for (l = 0; l < k; l ++)
+	    if (slots[l] == slots[k])
+	      break;
+
+	  if (l < k)
+	    break;
+	}
+
+        if (k == bucket_count[b])
+	  break;
+      }
+
+      if (d >= 65536)
+        break;
+
+      disp[b] = (unsigned short)d;
+
+      for (k = 0; k < bucket_count[b]; k ++)
+        table[slots[k]] = (short)name_order[bucket_first[b] + k];
+    }
+
+    if (i >= nbuckets || bucket_count[bucket_order[i]] == 0)
+    {
+     /*
+      * All buckets placed...
+      */
+
+      ipp_rset_names    = names;
+      ipp_rset_disp     = disp;
+      ipp_rset_slots    = table;
+      ipp_rset_mask     = tsize - 1;
+      ipp_rset_nbuckets = nbuckets;
+      ipp_rset_count    = count;
+
+      names = NULL;
+      disp  = NULL;
+      table = NULL;
+      break;
+    }
+  }
+
+  DEBUG_printf(("4ipp_rset_init: %d names, %u slots", ipp_rset_count, ipp_rset_mask + 1));
+
+  done:
+
+  free(names);
+  free(hashes);
+  free(name_order);
+  free(bucket_count);
+  free(bucket_first);
+  free(bucket_order);
+  free(disp);
+  free(table);
+
+  cupsArrayDelete(ra);
+}
+
+
+/*
+ * 'ipp_rset_slot()' - Compute the slot for a hash and displacement.
+ */
+
+static unsigned				/* O - Slot (before masking) */
+ipp_rset_slot(unsigned hash,		/* I - Hash of name */
+              unsigned disp)		/* I - Displacement for bucket */
+{
+  hash ^= disp * 0x9E3779B9U;
+  hash ^= hash >> 16;
+  hash *= 0x85EBCA6BU;
+  hash ^= hash >> 13;
+  hash *= 0xC2B2AE35U;
+  hash ^= hash >> 16;
+
+  return (hash);
+}
@@ -20,6 +20,32 @@
 #endif /* _WIN32 */
 
 
+/*
+ * Local types...
+ */
+
+typedef struct _ipp_zcread_s		/**** Zero-copy read state ****/
+{
+  ipp_uchar_t	*ptr,			/* Current position */
+		*end,			/* End of data */
+		*saved_ptr,		/* Byte replaced by a nul, if any */
+		saved;			/* Original value of that byte */
+} _ipp_zcread_t;
+
+typedef struct _ipp_wbuf_s		/**** Write buffer ****/
+{
+  void		*dst;			/* Destination */
+  ipp_iocb_t	cb;			/* Write callback function */
+  int		vec,			/* Write large values in place? */
+		flushed;		/* Number of batches written */
+  ipp_uchar_t	*buffer,		/* Copy buffer */
+		*bufptr,		/* Current position in copy buffer */
+		*segment;		/* Start of unqueued data in copy buffer */
+  int		num_iov;		/* Number of queued buffers */
+  struct iovec	iov[IPP_MAX_IOV];	/* Queued buffers */
+} _ipp_wbuf_t;
+
+
 /*
  * Local functions...
  */
@@ -27,21 +53,47 @@
 static ipp_attribute_t	*ipp_add_attr(ipp_t *ipp, const char *name,
 			              ipp_tag_t  group_tag, ipp_tag_t value_tag,
 			              int num_values);
-static void		ipp_free_values(ipp_attribute_t *attr, int element,
-			                int count);
+static void		*ipp_alloc(ipp_t *ipp, size_t size);
+static void		ipp_free_values(ipp_t *ipp, ipp_attribute_t *attr,
+			                int element, int count);
 static char		*ipp_get_code(const char *locale, char *buffer, size_t bufsize) _CUPS_NONNULL(1,2);
+static int		ipp_in_buffer(ipp_t *ipp, const void *ptr);
+static void		ipp_index_add(ipp_t *ipp, ipp_attribute_t *attr,
+			              ipp_attribute_t *prev);
+static void		ipp_index_delete(ipp_t *ipp, ipp_attribute_t *attr,
+			                 ipp_attribute_t *prev);
+static void		ipp_index_free(ipp_t *ipp);
+static _ipp_index_t	*ipp_index_get(ipp_t *ipp);
+static unsigned		ipp_index_hash(const char *name);
+static _ipp_ientry_t	*ipp_index_lookup(_ipp_index_t *index,
+			                  const char *name, unsigned hash);
+static void		ipp_index_move(ipp_t *ipp, ipp_attribute_t *oldattr,
+			               ipp_attribute_t *newattr);
 static char		*ipp_lang_code(const char *locale, char *buffer, size_t bufsize) _CUPS_NONNULL(1,2);
 static size_t		ipp_length(ipp_t *ipp, int collection);
+static ipp_t		*ipp_new_arena(size_t size);
 static ssize_t		ipp_read_http(http_t *http, ipp_uchar_t *buffer,
 			              size_t length);
 static ssize_t		ipp_read_file(int *fd, ipp_uchar_t *buffer,
 			              size_t length);
+static ipp_uchar_t	*ipp_read_ptr(void *src, ipp_iocb_t cb, int n);
+static char		*ipp_read_string(void *src, ipp_iocb_t cb,
+			                 ipp_uchar_t *buffer, int n);
+static ssize_t		ipp_read_zc(_ipp_zcread_t *zc, ipp_uchar_t *buffer,
+			            size_t length);
 static void		ipp_set_error(ipp_status_t status, const char *format,
 			              ...);
 static _ipp_value_t	*ipp_set_value(ipp_t *ipp, ipp_attribute_t **attr,
 			               int element);
+static char		*ipp_str_alloc(ipp_t *ipp, const char *s);
+static void		ipp_str_free(ipp_t *ipp, const char *s);
+static ipp_uchar_t	*ipp_write_data(_ipp_wbuf_t *wb, ipp_uchar_t *bufptr,
+			               const void *data, size_t length);
 static ssize_t		ipp_write_file(int *fd, ipp_uchar_t *buffer,
 			               size_t length);
+static ipp_uchar_t	*ipp_write_flush(_ipp_wbuf_t *wb, ipp_uchar_t *bufptr);
+static ipp_state_t	ipp_write_io(_ipp_wbuf_t *wb, int blocking,
+			             ipp_t *parent, ipp_t *ipp);
 
 
 /*
@@ -95,6 +147,81 @@ _cupsBufferRelease(char *b)		/* I - Buffer to release */
 }
 
 
+/*
+ * '_ippNewArena()' - Allocate a new arena-backed IPP message.
+ *
+ * Attributes, names, and values added to the message are carved out of a few
+ * large chunks that are freed together by @link ippDelete@, without using the
+ * global string pool.  Strings replaced with the ippSet functions come from
+ * the string pool as usual, and the memory of deleted attributes is only
+ * released when the message is deleted, so arena messages are meant for
+ * short-lived requests and responses.
+ */
+
+ipp_t *					/* O - New IPP message */
+_ippNewArena(void)
+{
+  DEBUG_puts("_ippNewArena()");
+
+  return (ipp_new_arena(IPP_ARENA_MIN));
+}
+
+
+/*
+ * '_ippNewFromBuffer()' - Parse an IPP message from a memory buffer without
+ *                         copying.
+ *
+ * The buffer must be allocated with malloc and is owned by the new message,
+ * which parses it in place: attribute names, string values, and octetString
+ * values point into the buffer, which is freed once the message and any
+ * collections read from it have been deleted.  The buffer is freed if the
+ * message cannot be parsed.
+ *
+ * Unlike @link _ippNewArena@ messages, attributes and values that are added,
+ * replaced, or deleted later are allocated and freed as usual, so the
+ * message can be kept and changed for as long as needed.
+ */
+
+ipp_t *					/* O - New IPP message or NULL on error */
+_ippNewFromBuffer(ipp_uchar_t *data,	/* I - Message data */
+                  size_t      length)	/* I - Length of data */
+{
+  ipp_t			*ipp;		/* New IPP message */
+  _ipp_zcread_t		zc;		/* Read state */
+  ipp_state_t		state;		/* State of read */
+
+
+  DEBUG_printf(("_ippNewFromBuffer(data=%p, length=" CUPS_LLFMT ")", (void *)data, CUPS_LLCAST length));
+
+  if ((ipp = ippNew()) == NULL || (ipp->buffer = calloc(1, sizeof(_ipp_buffer_t))) == NULL)
+  {
+    ippDelete(ipp);
+    free(data);
+    return (NULL);
+  }
+
+  ipp->buffer->use  = 1;
+  ipp->buffer->data = data;
+  ipp->buffer->end  = data + length;
+
+  zc.ptr       = data;
+  zc.end       = data + length;
+  zc.saved_ptr = NULL;
+  zc.saved     = 0;
+
+  while ((state = ippReadIO(&zc, (ipp_iocb_t)ipp_read_zc, 1, NULL, ipp)) != IPP_STATE_DATA)
+  {
+    if (state == IPP_STATE_ERROR)
+    {
+      ippDelete(ipp);
+      return (NULL);
+    }
+  }
+
+  return (ipp);
+}
+
+
 /*
  * 'ippAddBoolean()' - Add a boolean attribute to an IPP message.
  *
@@ -528,7 +655,7 @@ ippAddOctetString(ipp_t      *ipp,	/* I - IPP message */
 
   if (data)
   {
-    if ((attr->values[0].unknown.data = malloc((size_t)datalen)) == NULL)
+    if ((attr->values[0].unknown.data = ipp_alloc(ipp, (size_t)datalen)) == NULL)
     {
       ippDeleteAttribute(ipp, attr);
       return (NULL);
@@ -942,19 +1069,19 @@ ippAddString(ipp_t      *ipp,		/* I - IPP message */
   else
   {
     if (language)
-      attr->values[0].string.language = _cupsStrAlloc(ipp_lang_code(language, code,
+      attr->values[0].string.language = ipp_str_alloc(ipp, ipp_lang_code(language, code,
 						      sizeof(code)));
 
     if (value)
     {
       if (value_tag == IPP_TAG_CHARSET)
-	attr->values[0].string.text = _cupsStrAlloc(ipp_get_code(value, code,
+	attr->values[0].string.text = ipp_str_alloc(ipp, ipp_get_code(value, code,
 								 sizeof(code)));
       else if (value_tag == IPP_TAG_LANGUAGE)
-	attr->values[0].string.text = _cupsStrAlloc(ipp_lang_code(value, code,
+	attr->values[0].string.text = ipp_str_alloc(ipp, ipp_lang_code(value, code,
 								  sizeof(code)));
       else
-	attr->values[0].string.text = _cupsStrAlloc(value);
+	attr->values[0].string.text = ipp_str_alloc(ipp, value);
     }
   }
 
@@ -1291,7 +1418,7 @@ ippAddStrings(
         if ((int)value_tag & IPP_TAG_CUPS_CONST)
           value->string.language = (char *)language;
         else
-          value->string.language = _cupsStrAlloc(ipp_lang_code(language, code,
+          value->string.language = ipp_str_alloc(ipp, ipp_lang_code(language, code,
                                                                sizeof(code)));
       }
       else
@@ -1303,11 +1430,11 @@ ippAddStrings(
       if ((int)value_tag & IPP_TAG_CUPS_CONST)
         value->string.text = (char *)*values++;
       else if (value_tag == IPP_TAG_CHARSET)
-	value->string.text = _cupsStrAlloc(ipp_get_code(*values++, code, sizeof(code)));
+	value->string.text = ipp_str_alloc(ipp, ipp_get_code(*values++, code, sizeof(code)));
       else if (value_tag == IPP_TAG_LANGUAGE)
-	value->string.text = _cupsStrAlloc(ipp_lang_code(*values++, code, sizeof(code)));
+	value->string.text = ipp_str_alloc(ipp, ipp_lang_code(*values++, code, sizeof(code)));
       else
-	value->string.text = _cupsStrAlloc(*values++);
+	value->string.text = ipp_str_alloc(ipp, *values++);
     }
   }
 
@@ -1550,7 +1677,7 @@ ippCopyAttribute(
 	  */
 
 	  for (i = srcattr->num_values, srcval = srcattr->values, dstval = dstattr->values; i > 0; i --, srcval ++, dstval ++)
-	    dstval->string.text = _cupsStrAlloc(srcval->string.text);
+	    dstval->string.text = ipp_str_alloc(dst, srcval->string.text);
 	}
         break;
 
@@ -1567,7 +1694,7 @@ ippCopyAttribute(
 
 	  memcpy(dstattr->values, srcattr->values, (size_t)srcattr->num_values * sizeof(_ipp_value_t));
         }
-	else if (srcattr->value_tag & IPP_TAG_CUPS_CONST)
+	else
 	{
 	 /*
 	  * Otherwise do a normal reference counted copy...
@@ -1576,11 +1703,11 @@ ippCopyAttribute(
 	  for (i = srcattr->num_values, srcval = srcattr->values, dstval = dstattr->values; i > 0; i --, srcval ++, dstval ++)
 	  {
 	    if (srcval == srcattr->values)
-              dstval->string.language = _cupsStrAlloc(srcval->string.language);
+              dstval->string.language = ipp_str_alloc(dst, srcval->string.language);
 	    else
               dstval->string.language = dstattr->values[0].string.language;
 
-	    dstval->string.text = _cupsStrAlloc(srcval->string.text);
+	    dstval->string.text = ipp_str_alloc(dst, srcval->string.text);
           }
         }
         break;
@@ -1607,7 +1734,7 @@ ippCopyAttribute(
 
 	  if (dstval->unknown.length > 0)
 	  {
-	    if ((dstval->unknown.data = malloc((size_t)dstval->unknown.length)) == NULL)
+	    if ((dstval->unknown.data = ipp_alloc(dst, (size_t)dstval->unknown.length)) == NULL)
 	      dstval->unknown.length = 0;
 	    else
 	      memcpy(dstval->unknown.data, srcval->unknown.data, (size_t)dstval->unknown.length);
@@ -1752,15 +1879,40 @@ ippDelete(ipp_t *ipp)			/* I - IPP message */
 
     DEBUG_printf(("4debug_free: %p %s %s%s (%d values)", (void *)attr, attr->name, attr->num_values > 1 ? "1setOf " : "", ippTagString(attr->value_tag), attr->num_values));
 
-    ipp_free_values(attr, 0, attr->num_values);
+    ipp_free_values(ipp, attr, 0, attr->num_values);
 
     if (attr->name)
-      _cupsStrFree(attr->name);
+      ipp_str_free(ipp, attr->name);
 
-    free(attr);
+    if (!attr->arena)
+      free(attr);
+  }
+
+  ipp_index_free(ipp);
+
+  if (ipp->buffer && -- ipp->buffer->use == 0)
+  {
+    free(ipp->buffer->data);
+    free(ipp->buffer);
   }
 
-  free(ipp);
+  if (ipp->arena)
+  {
+   /*
+    * Free the arena chunks, the last of which holds the message itself...
+    */
+
+    _ipp_chunk_t	*chunk,		/* Current chunk */
+			*next;		/* Next chunk */
+
+    for (chunk = ipp->arena; chunk; chunk = next)
+    {
+      next = chunk->next;
+      free(chunk);
+    }
+  }
+  else
+    free(ipp);
 }
 
 
@@ -1796,40 +1948,61 @@ ippDeleteAttribute(
 
   if (ipp)
   {
-    for (current = ipp->attrs, prev = NULL;
-	 current;
-	 prev = current, current = current->next)
-      if (current == attr)
-      {
-       /*
-	* Found it, remove the attribute from the list...
-	*/
+    if (ipp->current == attr && (ipp->prev ? ipp->prev->next == attr : ipp->attrs == attr))
+    {
+     /*
+      * Use the "previous" pointer from the last lookup...
+      */
 
-	if (prev)
-	  prev->next = current->next;
-	else
-	  ipp->attrs = current->next;
+      prev = ipp->prev;
+    }
+    else
+    {
+      for (current = ipp->attrs, prev = NULL;
+	   current;
+	   prev = current, current = current->next)
+	if (current == attr)
+	  break;
 
-	if (current == ipp->last)
-	  ipp->last = prev;
+      if (!current)
+	return;
+    }
 
-        break;
-      }
+   /*
+    * Remove the attribute from the list...
+    */
 
-    if (!current)
-      return;
+    if (prev)
+      prev->next = attr->next;
+    else
+      ipp->attrs = attr->next;
+
+    if (attr == ipp->last)
+      ipp->last = prev;
+
+    if (ipp->index)
+      ipp_index_delete(ipp, attr, prev);
+
+    if (ipp->current == attr)
+    {
+      ipp->current = prev;
+      ipp->prev    = NULL;
+    }
+    else if (ipp->prev == attr)
+      ipp->prev = prev;
   }
 
  /*
   * Free memory used by the attribute...
   */
 
-  ipp_free_values(attr, 0, attr->num_values);
+  ipp_free_values(ipp, attr, 0, attr->num_values);
 
   if (attr->name)
-    _cupsStrFree(attr->name);
+    ipp_str_free(ipp, attr->name);
 
-  free(attr);
+  if (!attr->arena)
+    free(attr);
 }
 
 
@@ -1877,7 +2050,7 @@ ippDeleteValues(
   * Otherwise free the values in question and return.
   */
 
-  ipp_free_values(*attr, element, count);
+  ipp_free_values(ipp, *attr, element, count);
 
   return (1);
 }
@@ -1930,7 +2103,9 @@ ippFindNextAttribute(ipp_t      *ipp,	/* I - IPP message */
 		     ipp_tag_t  type)	/* I - Type of attribute */
 {
   ipp_attribute_t	*attr,		/* Current atttribute */
-			*childattr;	/* Child attribute */
+			*childattr,	/* Child attribute */
+			*stop = NULL;	/* Attribute to stop at */
+  _ipp_ientry_t		*entry;		/* Name index entry */
   ipp_tag_t		value_tag;	/* Value tag */
   char			parent[1024],	/* Parent attribute name */
 			*child = NULL;	/* Child attribute name */
@@ -2005,7 +2180,26 @@ ippFindNextAttribute(ipp_t      *ipp,	/* I - IPP message */
     attr      = ipp->attrs;
   }
 
-  for (; attr != NULL; ipp->prev = attr, attr = attr->next)
+  if (attr && attr == ipp->attrs && ipp_index_get(ipp))
+  {
+   /*
+    * Searching from the start of the message, use the name index to skip
+    * to the first attribute with this name...
+    */
+
+    if ((entry = ipp_index_lookup(ipp->index, name, ipp_index_hash(name))) != NULL)
+    {
+      ipp->prev = entry->prev;
+      attr      = entry->attr;
+
+      if (entry->count == 1)
+        stop = attr->next;
+    }
+    else
+      attr = NULL;
+  }
+
+  for (; attr != NULL && attr != stop; ipp->prev = attr, attr = attr->next)
   {
     DEBUG_printf(("4ippFindAttribute: attr=%p, name=\"%s\"", (void *)attr, attr->name));
 
@@ -2868,6 +3062,7 @@ ippReadIO(void       *src,		/* I - Data source */
 					/* Small string buffer */
 			*bufptr,	/* Pointer into buffer */
 			*bufend;	/* End of buffer */
+  char			*name;		/* Name or string value */
   ipp_attribute_t	*attr = NULL;	/* Current attribute */
   ipp_tag_t		tag;		/* Current tag */
   ipp_tag_t		value_tag;	/* Current value tag */
@@ -3194,18 +3389,16 @@ ippReadIO(void       *src,		/* I - Data source */
 	    * New attribute; read the name and add it...
 	    */
 
-	    if ((*cb)(src, buffer, (size_t)n) < n)
+	    if ((name = ipp_read_string(src, cb, buffer, n)) == NULL)
 	    {
 	      DEBUG_puts("1ippReadIO: unable to read name.");
 	      goto rollback;
 	    }
 
-	    buffer[n] = '\0';
-
             if (ipp->current)
 	      ipp->prev = ipp->current;
 
-	    if ((attr = ipp->current = ipp_add_attr(ipp, (char *)buffer, ipp->curtag, tag,
+	    if ((attr = ipp->current = ipp_add_attr(ipp, name, ipp->curtag, tag,
 	                                            1)) == NULL)
 	    {
 	      _cupsSetHTTPError(HTTP_STATUS_ERROR);
@@ -3213,7 +3406,7 @@ ippReadIO(void       *src,		/* I - Data source */
 	      goto rollback;
 	    }
 
-	    DEBUG_printf(("2ippReadIO: name=\"%s\", ipp->current=%p, ipp->prev=%p", buffer, (void *)ipp->current, (void *)ipp->prev));
+	    DEBUG_printf(("2ippReadIO: name=\"%s\", ipp->current=%p, ipp->prev=%p", name, (void *)ipp->current, (void *)ipp->prev));
 
 	    value = attr->values;
 	  }
@@ -3319,17 +3512,13 @@ ippReadIO(void       *src,		/* I - Data source */
 	    case IPP_TAG_CHARSET :
 	    case IPP_TAG_LANGUAGE :
 	    case IPP_TAG_MIMETYPE :
-	        if (n > 0)
-	        {
-		  if ((*cb)(src, buffer, (size_t)n) < n)
-		  {
-		    DEBUG_puts("1ippReadIO: unable to read string value.");
-		    goto rollback;
-		  }
+	        if ((name = ipp_read_string(src, cb, buffer, n)) == NULL)
+		{
+		  DEBUG_puts("1ippReadIO: unable to read string value.");
+		  goto rollback;
 		}
 
-		buffer[n] = '\0';
-		value->string.text = _cupsStrAlloc((char *)buffer);
+		value->string.text = ipp_str_alloc(ipp, name);
 		DEBUG_printf(("2ippReadIO: value=\"%s\"", value->string.text));
 	        break;
 
@@ -3456,7 +3645,7 @@ ippReadIO(void       *src,		/* I - Data source */
 		memcpy(string, bufptr + 2, (size_t)n);
 		string[n] = '\0';
 
-		value->string.language = _cupsStrAlloc((char *)string);
+		value->string.language = ipp_str_alloc(ipp, (char *)string);
 
                 bufptr += 2 + n;
 		n = (bufptr[0] << 8) | bufptr[1];
@@ -3470,7 +3659,7 @@ ippReadIO(void       *src,		/* I - Data source */
 		}
 
 		bufptr[2 + n] = '\0';
-                value->string.text = _cupsStrAlloc((char *)bufptr + 2);
+                value->string.text = ipp_str_alloc(ipp, (char *)bufptr + 2);
 	        break;
 
             case IPP_TAG_BEGIN_COLLECTION :
@@ -3478,7 +3667,24 @@ ippReadIO(void       *src,		/* I - Data source */
 	        * Oh, boy, here comes a collection value, so read it...
 		*/
 
-                value->collection = ippNew();
+                if (ipp->buffer)
+                {
+                 /*
+                  * Collections read without copying share the source
+                  * buffer...
+                  */
+
+                  if ((value->collection = ipp_new_arena(IPP_ARENA_MIN / 8)) == NULL)
+                  {
+		    _cupsSetHTTPError(HTTP_STATUS_ERROR);
+		    goto rollback;
+                  }
+
+                  value->collection->buffer = ipp->buffer;
+                  ipp->buffer->use ++;
+                }
+                else
+                  value->collection = ippNew();
 
                 if (n > 0)
 		{
@@ -3531,14 +3737,16 @@ ippReadIO(void       *src,		/* I - Data source */
 	          DEBUG_puts("1ippReadIO: Empty member name value.");
 		  goto rollback;
 		}
-		else if ((*cb)(src, buffer, (size_t)n) < n)
+		else if ((name = ipp_read_string(src, cb, buffer, n)) == NULL)
 		{
 	          DEBUG_puts("1ippReadIO: Unable to read member name value.");
 		  goto rollback;
 		}
 
-		buffer[n] = '\0';
-		attr->name = _cupsStrAlloc((char *)buffer);
+		attr->name = ipp_str_alloc(ipp, name);
+
+		if (ipp->index)
+		  ipp_index_free(ipp);
 
                /*
 	        * Since collection members are encoded differently than
@@ -3564,9 +3772,9 @@ ippReadIO(void       *src,		/* I - Data source */
 
                 value->unknown.length = n;
 
-	        if (n > 0)
+	        if (n > 0 && (!ipp->buffer || (value->unknown.data = ipp_read_ptr(src, cb, n)) == NULL))
 		{
-		  if ((value->unknown.data = malloc((size_t)n)) == NULL)
+		  if ((value->unknown.data = ipp_alloc(ipp, (size_t)n)) == NULL)
 		  {
 		    _cupsSetHTTPError(HTTP_STATUS_ERROR);
 		    DEBUG_puts("1ippReadIO: Unable to allocate value");
@@ -3579,7 +3787,7 @@ ippReadIO(void       *src,		/* I - Data source */
 		    goto rollback;
 		  }
 		}
-		else
+		else if (n <= 0)
 		  value->unknown.data = NULL;
 	        break;
 	  }
@@ -3871,9 +4079,12 @@ ippSetName(ipp_t           *ipp,	/* I  - IPP message */
   if ((temp = _cupsStrAlloc(name)) != NULL)
   {
     if ((*attr)->name)
-      _cupsStrFree((*attr)->name);
+      ipp_str_free(ipp, (*attr)->name);
 
     (*attr)->name = temp;
+
+    if (ipp->index)
+      ipp_index_free(ipp);
   }
 
   return (temp != NULL);
@@ -3941,7 +4152,8 @@ ippSetOctetString(
 	* Free previous data...
 	*/
 
-	free(value->unknown.data);
+	if (!(*attr)->arena && !ipp_in_buffer(ipp, value->unknown.data))
+	  free(value->unknown.data);
 
 	value->unknown.data   = NULL;
         value->unknown.length = 0;
@@ -3951,7 +4163,7 @@ ippSetOctetString(
       {
 	void	*temp;			/* Temporary data pointer */
 
-	if ((temp = malloc((size_t)datalen)) != NULL)
+	if ((temp = ipp_alloc(ipp, (size_t)datalen)) != NULL)
 	{
 	  memcpy(temp, data, (size_t)datalen);
 
@@ -4239,7 +4451,7 @@ ippSetString(ipp_t           *ipp,	/* I  - IPP message */
     else if ((temp = _cupsStrAlloc(strvalue)) != NULL)
     {
       if (value->string.text)
-        _cupsStrFree(value->string.text);
+        ipp_str_free(ipp, value->string.text);
 
       value->string.text = temp;
     }
@@ -4507,7 +4719,7 @@ ippSetValueTag(
         */
 
         if ((*attr)->num_values > 0)
-          ipp_free_values(*attr, 0, (*attr)->num_values);
+          ipp_free_values(ipp, *attr, 0, (*attr)->num_values);
 
        /*
         * Set out-of-band value...
@@ -5255,6 +5467,10 @@ ippWriteFile(int   fd,			/* I - HTTP data */
 /*
  * 'ippWriteIO()' - Write data for an IPP message.
  *
+ * Data is written in batches of attributes.  When writing to a HTTP
+ * connection, large values are sent in place with a vectored write instead of
+ * being copied.  When "blocking" is 0, a single batch of attributes is written.
+ *
  * @since CUPS 1.2/macOS 10.5@
  */
 
@@ -5265,12 +5481,8 @@ ippWriteIO(void       *dst,		/* I - Destination */
 	   ipp_t      *parent,		/* I - Parent IPP message */
            ipp_t      *ipp)		/* I - IPP data */
 {
-  int			i;		/* Looping var */
-  int			n;		/* Length of data */
-  unsigned char		*buffer,	/* Data buffer */
-			*bufptr;	/* Pointer into buffer */
-  ipp_attribute_t	*attr;		/* Current attribute */
-  _ipp_value_t		*value;		/* Current value */
+  ipp_state_t	state;			/* Current state */
+  _ipp_wbuf_t	wb;			/* Write buffer */
 
 
   DEBUG_printf(("ippWriteIO(dst=%p, cb=%p, blocking=%d, parent=%p, ipp=%p)", (void *)dst, (void *)cb, blocking, (void *)parent, (void *)ipp));
@@ -5278,1086 +5490,638 @@ ippWriteIO(void       *dst,		/* I - Destination */
   if (!dst || !ipp)
     return (IPP_STATE_ERROR);
 
-  if ((buffer = (unsigned char *)_cupsBufferGet(IPP_BUF_SIZE)) == NULL)
+  if ((wb.buffer = (ipp_uchar_t *)_cupsBufferGet(IPP_BUF_SIZE)) == NULL)
   {
     DEBUG_puts("1ippWriteIO: Unable to get write buffer");
     return (IPP_STATE_ERROR);
   }
 
-  switch (ipp->state)
+  wb.dst     = dst;
+  wb.cb      = cb;
+  wb.vec     = cb == (ipp_iocb_t)httpWrite2;
+  wb.flushed = 0;
+  wb.bufptr  = wb.buffer;
+  wb.segment = wb.buffer;
+  wb.num_iov = 0;
+
+  if ((state = ipp_write_io(&wb, blocking, parent, ipp)) != IPP_STATE_ERROR &&
+      ipp_write_flush(&wb, wb.bufptr) == NULL)
   {
-    case IPP_STATE_IDLE :
-        ipp->state ++; /* Avoid common problem... */
+    DEBUG_puts("1ippWriteIO: Could not write IPP data...");
+    state = IPP_STATE_ERROR;
+  }
 
-    case IPP_STATE_HEADER :
-        if (parent == NULL)
-	{
-	 /*
-	  * Send the request header:
-	  *
-	  *                 Version = 2 bytes
-	  *   Operation/Status Code = 2 bytes
-	  *              Request ID = 4 bytes
-	  *                   Total = 8 bytes
-	  */
+  _cupsBufferRelease((char *)wb.buffer);
 
-          bufptr = buffer;
+  return (state);
+}
 
-	  *bufptr++ = ipp->request.any.version[0];
-	  *bufptr++ = ipp->request.any.version[1];
-	  *bufptr++ = (ipp_uchar_t)(ipp->request.any.op_status >> 8);
-	  *bufptr++ = (ipp_uchar_t)ipp->request.any.op_status;
-	  *bufptr++ = (ipp_uchar_t)(ipp->request.any.request_id >> 24);
-	  *bufptr++ = (ipp_uchar_t)(ipp->request.any.request_id >> 16);
-	  *bufptr++ = (ipp_uchar_t)(ipp->request.any.request_id >> 8);
-	  *bufptr++ = (ipp_uchar_t)ipp->request.any.request_id;
+/*
+ * 'ipp_add_attr()' - Add a new attribute to the message.
+ */
 
-	  DEBUG_printf(("2ippWriteIO: version=%d.%d", buffer[0], buffer[1]));
-	  DEBUG_printf(("2ippWriteIO: op_status=%04x",
-			ipp->request.any.op_status));
-	  DEBUG_printf(("2ippWriteIO: request_id=%d",
-			ipp->request.any.request_id));
+static ipp_attribute_t *		/* O - New attribute */
+ipp_add_attr(ipp_t      *ipp,		/* I - IPP message */
+             const char *name,		/* I - Attribute name or NULL */
+             ipp_tag_t  group_tag,	/* I - Group tag or IPP_TAG_ZERO */
+             ipp_tag_t  value_tag,	/* I - Value tag or IPP_TAG_ZERO */
+             int        num_values)	/* I - Number of values */
+{
+  int			alloc_values;	/* Number of values to allocate */
+  ipp_attribute_t	*attr;		/* New attribute */
 
-          if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
-	  {
-	    DEBUG_puts("1ippWriteIO: Could not write IPP header...");
-	    _cupsBufferRelease((char *)buffer);
-	    return (IPP_STATE_ERROR);
-	  }
-	}
 
-       /*
-	* Reset the state engine to point to the first attribute
-	* in the request/response, with no current group.
-	*/
+  DEBUG_printf(("4ipp_add_attr(ipp=%p, name=\"%s\", group_tag=0x%x, value_tag=0x%x, num_values=%d)", (void *)ipp, name, group_tag, value_tag, num_values));
 
-        ipp->state   = IPP_STATE_ATTRIBUTE;
-	ipp->current = ipp->attrs;
-	ipp->curtag  = IPP_TAG_ZERO;
+ /*
+  * Range check input...
+  */
 
-	DEBUG_printf(("1ippWriteIO: ipp->current=%p", (void *)ipp->current));
+  if (!ipp || num_values < 0)
+    return (NULL);
 
-       /*
-        * If blocking is disabled, stop here...
-	*/
+ /*
+  * Allocate memory, rounding the allocation up as needed...
+  */
 
-        if (!blocking)
-	  break;
+  if (num_values <= 1)
+    alloc_values = 1;
+  else
+    alloc_values = (num_values + IPP_MAX_VALUES - 1) & ~(IPP_MAX_VALUES - 1);
 
-    case IPP_STATE_ATTRIBUTE :
-        while (ipp->current != NULL)
-	{
-	 /*
-	  * Write this attribute...
-	  */
+  attr = ipp_alloc(ipp, sizeof(ipp_attribute_t) + (size_t)(alloc_values - 1) * sizeof(_ipp_value_t));
 
-	  bufptr = buffer;
-	  attr   = ipp->current;
+  if (attr)
+  {
+   /*
+    * Initialize attribute...
+    */
 
-	  ipp->current = ipp->current->next;
+    DEBUG_printf(("4debug_alloc: %p %s %s%s (%d values)", (void *)attr, name, num_values > 1 ? "1setOf " : "", ippTagString(value_tag), num_values));
 
-          if (!parent)
-	  {
-	    if (ipp->curtag != attr->group_tag)
-	    {
-	     /*
-	      * Send a group tag byte...
-	      */
+    if (name)
+      attr->name = ipp_str_alloc(ipp, name);
 
-	      ipp->curtag = attr->group_tag;
+    attr->group_tag  = group_tag;
+    attr->value_tag  = value_tag;
+    attr->num_values = num_values;
+    attr->arena      = ipp->arena != NULL;
 
-	      if (attr->group_tag == IPP_TAG_ZERO)
-		continue;
+   /*
+    * Add it to the end of the linked list...
+    */
 
-	      DEBUG_printf(("2ippWriteIO: wrote group tag=%x(%s)",
-			    attr->group_tag, ippTagString(attr->group_tag)));
-	      *bufptr++ = (ipp_uchar_t)attr->group_tag;
-	    }
-	    else if (attr->group_tag == IPP_TAG_ZERO)
-	      continue;
-	  }
+    if (ipp->last)
+      ipp->last->next = attr;
+    else
+      ipp->attrs = attr;
 
-	  DEBUG_printf(("1ippWriteIO: %s (%s%s)", attr->name,
-	                attr->num_values > 1 ? "1setOf " : "",
-			ippTagString(attr->value_tag)));
+    if (ipp->index)
+      ipp_index_add(ipp, attr, ipp->last);
 
-         /*
-	  * Write the attribute tag and name.
-	  *
-	  * The attribute name length does not include the trailing nul
-	  * character in the source string.
-	  *
-	  * Collection values (parent != NULL) are written differently...
-	  */
+    ipp->prev = ipp->last;
+    ipp->last = ipp->current = attr;
+  }
 
-          if (parent == NULL)
-	  {
-           /*
-	    * Get the length of the attribute name, and make sure it won't
-	    * overflow the buffer...
-	    */
+  DEBUG_printf(("5ipp_add_attr: Returning %p", (void *)attr));
 
-            if ((n = (int)strlen(attr->name)) > (IPP_BUF_SIZE - 8))
-	    {
-	      DEBUG_printf(("1ippWriteIO: Attribute name too long (%d)", n));
-	      _cupsBufferRelease((char *)buffer);
-	      return (IPP_STATE_ERROR);
-	    }
+  return (attr);
+}
 
-           /*
-	    * Write the value tag, name length, and name string...
-	    */
 
-            DEBUG_printf(("2ippWriteIO: writing value tag=%x(%s)",
-	                  attr->value_tag, ippTagString(attr->value_tag)));
-            DEBUG_printf(("2ippWriteIO: writing name=%d,\"%s\"", n,
-	                  attr->name));
+/*
+ * 'ipp_alloc()' - Allocate zeroed memory for a message.
+ */
 
-            if (attr->value_tag > 0xff)
-            {
-              *bufptr++ = IPP_TAG_EXTENSION;
-	      *bufptr++ = (ipp_uchar_t)(attr->value_tag >> 24);
-	      *bufptr++ = (ipp_uchar_t)(attr->value_tag >> 16);
-	      *bufptr++ = (ipp_uchar_t)(attr->value_tag >> 8);
-	      *bufptr++ = (ipp_uchar_t)attr->value_tag;
-            }
-            else
-	      *bufptr++ = (ipp_uchar_t)attr->value_tag;
+static void *				/* O - Memory or NULL */
+ipp_alloc(ipp_t  *ipp,			/* I - IPP message */
+          size_t size)			/* I - Number of bytes */
+{
+  _ipp_chunk_t	*chunk,			/* Current chunk */
+		*temp;			/* New chunk */
+  size_t	csize;			/* Size of new chunk */
+  char		*ptr;			/* Allocated memory */
 
-	    *bufptr++ = (ipp_uchar_t)(n >> 8);
-	    *bufptr++ = (ipp_uchar_t)n;
-	    memcpy(bufptr, attr->name, (size_t)n);
-	    bufptr += n;
-          }
-	  else
-	  {
-           /*
-	    * Get the length of the attribute name, and make sure it won't
-	    * overflow the buffer...
-	    */
 
-            if ((n = (int)strlen(attr->name)) > (IPP_BUF_SIZE - 12))
-	    {
-	      DEBUG_printf(("1ippWriteIO: Attribute name too long (%d)", n));
-	      _cupsBufferRelease((char *)buffer);
-	      return (IPP_STATE_ERROR);
-	    }
+  if ((chunk = ipp->arena) == NULL)
+    return (calloc(1, size));
 
-           /*
-	    * Write the member name tag, name length, name string, value tag,
-	    * and empty name for the collection member attribute...
-	    */
+ /*
+  * Keep allocations 8-byte aligned...
+  */
 
-            DEBUG_printf(("2ippWriteIO: writing value tag=%x(memberName)",
-	                  IPP_TAG_MEMBERNAME));
-            DEBUG_printf(("2ippWriteIO: writing name=%d,\"%s\"", n,
-	                  attr->name));
-            DEBUG_printf(("2ippWriteIO: writing value tag=%x(%s)",
-	                  attr->value_tag, ippTagString(attr->value_tag)));
-            DEBUG_puts("2ippWriteIO: writing name=0,\"\"");
+  size = (size + 7) & ~(size_t)7;
 
-            *bufptr++ = IPP_TAG_MEMBERNAME;
-	    *bufptr++ = 0;
-	    *bufptr++ = 0;
-	    *bufptr++ = (ipp_uchar_t)(n >> 8);
-	    *bufptr++ = (ipp_uchar_t)n;
-	    memcpy(bufptr, attr->name, (size_t)n);
-	    bufptr += n;
+  if ((size_t)(chunk->end - chunk->ptr) < size)
+  {
+   /*
+    * Add a new chunk, doubling the chunk size up to IPP_ARENA_MAX.  Large
+    * allocations get a chunk of their own so that the space left in the
+    * current chunk is not wasted...
+    */
 
-            if (attr->value_tag > 0xff)
-            {
-              *bufptr++ = IPP_TAG_EXTENSION;
-	      *bufptr++ = (ipp_uchar_t)(attr->value_tag >> 24);
-	      *bufptr++ = (ipp_uchar_t)(attr->value_tag >> 16);
-	      *bufptr++ = (ipp_uchar_t)(attr->value_tag >> 8);
-	      *bufptr++ = (ipp_uchar_t)attr->value_tag;
-            }
-            else
-	      *bufptr++ = (ipp_uchar_t)attr->value_tag;
+    if ((csize = 2 * (size_t)(chunk->end - (char *)(chunk + 1))) > IPP_ARENA_MAX)
+      csize = IPP_ARENA_MAX;
 
-            *bufptr++ = 0;
-            *bufptr++ = 0;
-	  }
+    if (size > IPP_ARENA_MAX / 4)
+      csize = size;
 
-         /*
-	  * Now write the attribute value(s)...
-	  */
+    if ((temp = calloc(1, sizeof(_ipp_chunk_t) + csize)) == NULL)
+      return (NULL);
 
-	  switch (attr->value_tag & ~IPP_TAG_CUPS_CONST)
-	  {
-	    case IPP_TAG_UNSUPPORTED_VALUE :
-	    case IPP_TAG_DEFAULT :
-	    case IPP_TAG_UNKNOWN :
-	    case IPP_TAG_NOVALUE :
-	    case IPP_TAG_NOTSETTABLE :
-	    case IPP_TAG_DELETEATTR :
-	    case IPP_TAG_ADMINDEFINE :
-		*bufptr++ = 0;
-		*bufptr++ = 0;
-	        break;
+    temp->ptr = (char *)(temp + 1);
+    temp->end = temp->ptr + csize;
 
-	    case IPP_TAG_INTEGER :
-	    case IPP_TAG_ENUM :
-	        for (i = 0, value = attr->values;
-		     i < attr->num_values;
-		     i ++, value ++)
-		{
-                  if ((IPP_BUF_SIZE - (bufptr - buffer)) < 9)
-		  {
-                    if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
-	            {
-	              DEBUG_puts("1ippWriteIO: Could not write IPP "
-		                 "attribute...");
-		      _cupsBufferRelease((char *)buffer);
-	              return (IPP_STATE_ERROR);
-	            }
-
-		    bufptr = buffer;
-		  }
+    if (csize == size)
+    {
+      temp->next  = chunk->next;
+      chunk->next = temp;
+      chunk       = temp;
+    }
+    else
+    {
+      temp->next = chunk;
+      ipp->arena = chunk = temp;
+    }
+  }
 
-		  if (i)
-		  {
-		   /*
-		    * Arrays and sets are done by sending additional
-		    * values with a zero-length name...
-		    */
+  ptr        = chunk->ptr;
+  chunk->ptr += size;
 
-                    *bufptr++ = (ipp_uchar_t)attr->value_tag;
-		    *bufptr++ = 0;
-		    *bufptr++ = 0;
-		  }
+  return (ptr);
+}
 
-		 /*
-	          * Integers and enumerations are both 4-byte signed
-		  * (twos-complement) values.
-		  *
-		  * Put the 2-byte length and 4-byte value into the buffer...
-		  */
 
-	          *bufptr++ = 0;
-		  *bufptr++ = 4;
-		  *bufptr++ = (ipp_uchar_t)(value->integer >> 24);
-		  *bufptr++ = (ipp_uchar_t)(value->integer >> 16);
-		  *bufptr++ = (ipp_uchar_t)(value->integer >> 8);
-		  *bufptr++ = (ipp_uchar_t)value->integer;
-		}
-		break;
+/*
+ * 'ipp_free_values()' - Free attribute values.
+ */
 
-	    case IPP_TAG_BOOLEAN :
-	        for (i = 0, value = attr->values;
-		     i < attr->num_values;
-		     i ++, value ++)
-		{
-                  if ((IPP_BUF_SIZE - (bufptr - buffer)) < 6)
-		  {
-                    if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
-	            {
-	              DEBUG_puts("1ippWriteIO: Could not write IPP "
-		                 "attribute...");
-		      _cupsBufferRelease((char *)buffer);
-	              return (IPP_STATE_ERROR);
-	            }
-
-		    bufptr = buffer;
-		  }
+static void
+ipp_free_values(ipp_t           *ipp,	/* I - IPP message or NULL */
+                ipp_attribute_t *attr,	/* I - Attribute to free values from */
+                int             element,/* I - First value to free */
+                int             count)	/* I - Number of values to free */
+{
+  int		i;			/* Looping var */
+  _ipp_value_t	*value;			/* Current value */
 
-		  if (i)
-		  {
-		   /*
-		    * Arrays and sets are done by sending additional
-		    * values with a zero-length name...
-		    */
 
-                    *bufptr++ = (ipp_uchar_t)attr->value_tag;
-		    *bufptr++ = 0;
-		    *bufptr++ = 0;
-		  }
+  DEBUG_printf(("4ipp_free_values(attr=%p, element=%d, count=%d)", (void *)attr, element, count));
 
-                 /*
-		  * Boolean values are 1-byte; 0 = false, 1 = true.
-		  *
-		  * Put the 2-byte length and 1-byte value into the buffer...
-		  */
+  if (!(attr->value_tag & IPP_TAG_CUPS_CONST))
+  {
+   /*
+    * Free values as needed...
+    */
 
-	          *bufptr++ = 0;
-		  *bufptr++ = 1;
-		  *bufptr++ = (ipp_uchar_t)value->boolean;
-		}
-		break;
+    switch (attr->value_tag)
+    {
+      case IPP_TAG_TEXTLANG :
+      case IPP_TAG_NAMELANG :
+	  if (element == 0 && count == attr->num_values &&
+	      attr->values[0].string.language)
+	  {
+	    ipp_str_free(ipp, attr->values[0].string.language);
+	    attr->values[0].string.language = NULL;
+	  }
+	  /* Fall through to other string values */
 
-	    case IPP_TAG_TEXT :
-	    case IPP_TAG_NAME :
-	    case IPP_TAG_KEYWORD :
-	    case IPP_TAG_URI :
-	    case IPP_TAG_URISCHEME :
-	    case IPP_TAG_CHARSET :
-	    case IPP_TAG_LANGUAGE :
-	    case IPP_TAG_MIMETYPE :
-	        for (i = 0, value = attr->values;
-		     i < attr->num_values;
-		     i ++, value ++)
-		{
-		  if (i)
-		  {
-		   /*
-		    * Arrays and sets are done by sending additional
-		    * values with a zero-length name...
-		    */
+      case IPP_TAG_TEXT :
+      case IPP_TAG_NAME :
+      case IPP_TAG_RESERVED_STRING :
+      case IPP_TAG_KEYWORD :
+      case IPP_TAG_URI :
+      case IPP_TAG_URISCHEME :
+      case IPP_TAG_CHARSET :
+      case IPP_TAG_LANGUAGE :
+      case IPP_TAG_MIMETYPE :
+	  for (i = count, value = attr->values + element;
+	       i > 0;
+	       i --, value ++)
+	  {
+	    ipp_str_free(ipp, value->string.text);
+	    value->string.text = NULL;
+	  }
+	  break;
 
-        	    DEBUG_printf(("2ippWriteIO: writing value tag=%x(%s)",
-		                  attr->value_tag,
-				  ippTagString(attr->value_tag)));
-        	    DEBUG_printf(("2ippWriteIO: writing name=0,\"\""));
+      case IPP_TAG_UNSUPPORTED_VALUE :
+      case IPP_TAG_DEFAULT :
+      case IPP_TAG_UNKNOWN :
+      case IPP_TAG_NOVALUE :
+      case IPP_TAG_NOTSETTABLE :
+      case IPP_TAG_DELETEATTR :
+      case IPP_TAG_ADMINDEFINE :
+      case IPP_TAG_INTEGER :
+      case IPP_TAG_ENUM :
+      case IPP_TAG_BOOLEAN :
+      case IPP_TAG_DATE :
+      case IPP_TAG_RESOLUTION :
+      case IPP_TAG_RANGE :
+	  break;
 
-                    if ((IPP_BUF_SIZE - (bufptr - buffer)) < 3)
-		    {
-                      if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
-	              {
-	        	DEBUG_puts("1ippWriteIO: Could not write IPP "
-			           "attribute...");
-			_cupsBufferRelease((char *)buffer);
-	        	return (IPP_STATE_ERROR);
-	              }
-
-		      bufptr = buffer;
-		    }
+      case IPP_TAG_BEGIN_COLLECTION :
+	  for (i = count, value = attr->values + element;
+	       i > 0;
+	       i --, value ++)
+	  {
+	    ippDelete(value->collection);
+	    value->collection = NULL;
+	  }
+	  break;
 
-                    *bufptr++ = (ipp_uchar_t)attr->value_tag;
-		    *bufptr++ = 0;
-		    *bufptr++ = 0;
-		  }
+      case IPP_TAG_STRING :
+      default :
+	  for (i = count, value = attr->values + element;
+	       i > 0;
+	       i --, value ++)
+	  {
+	    if (value->unknown.data)
+	    {
+	      if (!attr->arena && !ipp_in_buffer(ipp, value->unknown.data))
+	        free(value->unknown.data);
 
-                  if (value->string.text != NULL)
-                    n = (int)strlen(value->string.text);
-		  else
-		    n = 0;
+	      value->unknown.data = NULL;
+	    }
+	  }
+	  break;
+    }
+  }
 
-                  if (n > (IPP_BUF_SIZE - 2))
-		  {
-		    DEBUG_printf(("1ippWriteIO: String too long (%d)", n));
-		    _cupsBufferRelease((char *)buffer);
-		    return (IPP_STATE_ERROR);
-		  }
+ /*
+  * If we are not freeing values from the end, move the remaining values up...
+  */
 
-                  DEBUG_printf(("2ippWriteIO: writing string=%d,\"%s\"", n,
-		                value->string.text));
+  if ((element + count) < attr->num_values)
+    memmove(attr->values + element, attr->values + element + count,
+            (size_t)(attr->num_values - count - element) * sizeof(_ipp_value_t));
 
-                  if ((int)(IPP_BUF_SIZE - (bufptr - buffer)) < (n + 2))
-		  {
-                    if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
-	            {
-	              DEBUG_puts("1ippWriteIO: Could not write IPP "
-		                 "attribute...");
-		      _cupsBufferRelease((char *)buffer);
-	              return (IPP_STATE_ERROR);
-	            }
-
-		    bufptr = buffer;
-		  }
+  attr->num_values -= count;
+}
 
-		 /*
-		  * All simple strings consist of the 2-byte length and
-		  * character data without the trailing nul normally found
-		  * in C strings.  Also, strings cannot be longer than IPP_MAX_LENGTH
-		  * bytes since the 2-byte length is a signed (twos-complement)
-		  * value.
-		  *
-		  * Put the 2-byte length and string characters in the buffer.
-		  */
 
-	          *bufptr++ = (ipp_uchar_t)(n >> 8);
-		  *bufptr++ = (ipp_uchar_t)n;
+/*
+ * 'ipp_get_code()' - Convert a C locale/charset name into an IPP language/charset code.
+ *
+ * This typically converts strings of the form "ll_CC", "ll-REGION", and "CHARSET_NUMBER"
+ * to "ll-cc", "ll-region", and "charset-number", respectively.
+ */
 
-		  if (n > 0)
-		  {
-		    memcpy(bufptr, value->string.text, (size_t)n);
-		    bufptr += n;
-		  }
-		}
-		break;
+static char *				/* O - Language code string */
+ipp_get_code(const char *value,		/* I - Locale/charset string */
+             char       *buffer,	/* I - String buffer */
+             size_t     bufsize)	/* I - Size of string buffer */
+{
+  char	*bufptr,			/* Pointer into buffer */
+	*bufend;			/* End of buffer */
 
-	    case IPP_TAG_DATE :
-	        for (i = 0, value = attr->values;
-		     i < attr->num_values;
-		     i ++, value ++)
-		{
-                  if ((IPP_BUF_SIZE - (bufptr - buffer)) < 16)
-		  {
-                    if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
-	            {
-	              DEBUG_puts("1ippWriteIO: Could not write IPP "
-		                 "attribute...");
-		      _cupsBufferRelease((char *)buffer);
-	              return (IPP_STATE_ERROR);
-	            }
-
-		    bufptr = buffer;
-		  }
 
-		  if (i)
-		  {
-		   /*
-		    * Arrays and sets are done by sending additional
-		    * values with a zero-length name...
-		    */
+ /*
+  * Convert values to lowercase and change _ to - as needed...
+  */
 
-                    *bufptr++ = (ipp_uchar_t)attr->value_tag;
-		    *bufptr++ = 0;
-		    *bufptr++ = 0;
-		  }
+  for (bufptr = buffer, bufend = buffer + bufsize - 1;
+       *value && bufptr < bufend;
+       value ++)
+    if (*value == '_')
+      *bufptr++ = '-';
+    else
+      *bufptr++ = (char)_cups_tolower(*value);
 
-                 /*
-		  * Date values consist of a 2-byte length and an
-		  * 11-byte date/time structure defined by RFC 1903.
-		  *
-		  * Put the 2-byte length and 11-byte date/time
-		  * structure in the buffer.
-		  */
+  *bufptr = '\0';
 
-	          *bufptr++ = 0;
-		  *bufptr++ = 11;
-		  memcpy(bufptr, value->date, 11);
-		  bufptr += 11;
-		}
-		break;
+ /*
+  * Return the converted string...
+  */
 
-	    case IPP_TAG_RESOLUTION :
-	        for (i = 0, value = attr->values;
-		     i < attr->num_values;
-		     i ++, value ++)
-		{
-                  if ((IPP_BUF_SIZE - (bufptr - buffer)) < 14)
-		  {
-                    if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
-	            {
-	              DEBUG_puts("1ippWriteIO: Could not write IPP "
-		                 "attribute...");
-		      _cupsBufferRelease((char *)buffer);
-		      return (IPP_STATE_ERROR);
-	            }
+  return (buffer);
+}
 
-		    bufptr = buffer;
-		  }
 
-		  if (i)
-		  {
-		   /*
-		    * Arrays and sets are done by sending additional
-		    * values with a zero-length name...
-		    */
+/*
+ * 'ipp_in_buffer()' - Determine whether memory is part of the zero-copy source
+ *                     buffer of a message.
+ */
 
-                    *bufptr++ = (ipp_uchar_t)attr->value_tag;
-		    *bufptr++ = 0;
-		    *bufptr++ = 0;
-		  }
+static int				/* O - 1 if in the buffer, 0 otherwise */
+ipp_in_buffer(ipp_t      *ipp,		/* I - IPP message or NULL */
+              const void *ptr)		/* I - Memory */
+{
+  return (ipp && ipp->buffer && (const ipp_uchar_t *)ptr >= ipp->buffer->data && (const ipp_uchar_t *)ptr < ipp->buffer->end);
+}
 
-                 /*
-		  * Resolution values consist of a 2-byte length,
-		  * 4-byte horizontal resolution value, 4-byte vertical
-		  * resolution value, and a 1-byte units value.
-		  *
-		  * Put the 2-byte length and resolution value data
-		  * into the buffer.
-		  */
 
-	          *bufptr++ = 0;
-		  *bufptr++ = 9;
-		  *bufptr++ = (ipp_uchar_t)(value->resolution.xres >> 24);
-		  *bufptr++ = (ipp_uchar_t)(value->resolution.xres >> 16);
-		  *bufptr++ = (ipp_uchar_t)(value->resolution.xres >> 8);
-		  *bufptr++ = (ipp_uchar_t)value->resolution.xres;
-		  *bufptr++ = (ipp_uchar_t)(value->resolution.yres >> 24);
-		  *bufptr++ = (ipp_uchar_t)(value->resolution.yres >> 16);
-		  *bufptr++ = (ipp_uchar_t)(value->resolution.yres >> 8);
-		  *bufptr++ = (ipp_uchar_t)value->resolution.yres;
-		  *bufptr++ = (ipp_uchar_t)value->resolution.units;
-		}
-		break;
+/*
+ * 'ipp_index_add()' - Add an attribute to the name index.
+ *
+ * The attribute must be the last one in the message.
+ */
 
-	    case IPP_TAG_RANGE :
-	        for (i = 0, value = attr->values;
-		     i < attr->num_values;
-		     i ++, value ++)
-		{
-                  if ((IPP_BUF_SIZE - (bufptr - buffer)) < 13)
-		  {
-                    if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
-	            {
-	              DEBUG_puts("1ippWriteIO: Could not write IPP "
-		                 "attribute...");
-		      _cupsBufferRelease((char *)buffer);
-	              return (IPP_STATE_ERROR);
-	            }
-
-		    bufptr = buffer;
-		  }
+static void
+ipp_index_add(ipp_t           *ipp,	/* I - IPP message */
+              ipp_attribute_t *attr,	/* I - New attribute */
+              ipp_attribute_t *prev)	/* I - Attribute before it or NULL */
+{
+  _ipp_index_t	*index = ipp->index;	/* Name index */
+  _ipp_ientry_t	*entry,			/* Index entry */
+		*next,			/* Next entry */
+		**buckets;		/* New hash buckets */
+  unsigned	hash;			/* Hash of attribute name */
+  size_t	i,			/* Looping var */
+		num_buckets;		/* New number of buckets */
 
-		  if (i)
-		  {
-		   /*
-		    * Arrays and sets are done by sending additional
-		    * values with a zero-length name...
-		    */
 
-                    *bufptr++ = (ipp_uchar_t)attr->value_tag;
-		    *bufptr++ = 0;
-		    *bufptr++ = 0;
-		  }
+  if (!attr->name)
+    return;
 
-                 /*
-		  * Range values consist of a 2-byte length,
-		  * 4-byte lower value, and 4-byte upper value.
-		  *
-		  * Put the 2-byte length and range value data
-		  * into the buffer.
-		  */
+  hash = ipp_index_hash(attr->name);
 
-	          *bufptr++ = 0;
-		  *bufptr++ = 8;
-		  *bufptr++ = (ipp_uchar_t)(value->range.lower >> 24);
-		  *bufptr++ = (ipp_uchar_t)(value->range.lower >> 16);
-		  *bufptr++ = (ipp_uchar_t)(value->range.lower >> 8);
-		  *bufptr++ = (ipp_uchar_t)value->range.lower;
-		  *bufptr++ = (ipp_uchar_t)(value->range.upper >> 24);
-		  *bufptr++ = (ipp_uchar_t)(value->range.upper >> 16);
-		  *bufptr++ = (ipp_uchar_t)(value->range.upper >> 8);
-		  *bufptr++ = (ipp_uchar_t)value->range.upper;
-		}
-		break;
+  if ((entry = ipp_index_lookup(index, attr->name, hash)) != NULL)
+  {
+   /*
+    * Already have an attribute with this name...
+    */
 
-	    case IPP_TAG_TEXTLANG :
-	    case IPP_TAG_NAMELANG :
-	        for (i = 0, value = attr->values;
-		     i < attr->num_values;
-		     i ++, value ++)
-		{
-		  if (i)
-		  {
-		   /*
-		    * Arrays and sets are done by sending additional
-		    * values with a zero-length name...
-		    */
+    entry->count ++;
+    return;
+  }
 
-                    if ((IPP_BUF_SIZE - (bufptr - buffer)) < 3)
-		    {
-                      if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
-	              {
-	        	DEBUG_puts("1ippWriteIO: Could not write IPP "
-		                   "attribute...");
-			_cupsBufferRelease((char *)buffer);
-	        	return (IPP_STATE_ERROR);
-	              }
-
-		      bufptr = buffer;
-		    }
+  if ((entry = calloc(1, sizeof(_ipp_ientry_t))) == NULL)
+  {
+   /*
+    * Out of memory, stop indexing this message...
+    */
 
-                    *bufptr++ = (ipp_uchar_t)attr->value_tag;
-		    *bufptr++ = 0;
-		    *bufptr++ = 0;
-		  }
+    ipp_index_free(ipp);
+    return;
+  }
 
-                 /*
-		  * textWithLanguage and nameWithLanguage values consist
-		  * of a 2-byte length for both strings and their
-		  * individual lengths, a 2-byte length for the
-		  * character string, the character string without the
-		  * trailing nul, a 2-byte length for the character
-		  * set string, and the character set string without
-		  * the trailing nul.
-		  */
+  entry->hash  = hash;
+  entry->count = 1;
+  entry->attr  = attr;
+  entry->prev  = prev;
+  entry->next  = index->buckets[hash & (index->num_buckets - 1)];
 
-                  n = 4;
+  index->buckets[hash & (index->num_buckets - 1)] = entry;
+  index->num_entries ++;
 
-		  if (value->string.language != NULL)
-                    n += (int)strlen(value->string.language);
+  if (index->num_entries > 2 * index->num_buckets)
+  {
+   /*
+    * Grow the hash table...
+    */
 
-		  if (value->string.text != NULL)
-                    n += (int)strlen(value->string.text);
+    num_buckets = 2 * index->num_buckets;
 
-                  if (n > (IPP_BUF_SIZE - 2))
-		  {
-		    DEBUG_printf(("1ippWriteIO: text/nameWithLanguage value "
-		                  "too long (%d)", n));
-		    _cupsBufferRelease((char *)buffer);
-		    return (IPP_STATE_ERROR);
-                  }
+    if ((buckets = calloc(num_buckets, sizeof(_ipp_ientry_t *))) == NULL)
+      return;
 
-                  if ((int)(IPP_BUF_SIZE - (bufptr - buffer)) < (n + 2))
-		  {
-                    if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
-	            {
-	              DEBUG_puts("1ippWriteIO: Could not write IPP "
-		                 "attribute...");
-		      _cupsBufferRelease((char *)buffer);
-	              return (IPP_STATE_ERROR);
-	            }
-
-		    bufptr = buffer;
-		  }
+    for (i = 0; i < index->num_buckets; i ++)
+    {
+      for (entry = index->buckets[i]; entry; entry = next)
+      {
+        next        = entry->next;
+        entry->next = buckets[entry->hash & (num_buckets - 1)];
 
-                 /* Length of entire value */
-	          *bufptr++ = (ipp_uchar_t)(n >> 8);
-		  *bufptr++ = (ipp_uchar_t)n;
+        buckets[entry->hash & (num_buckets - 1)] = entry;
+      }
+    }
 
-                 /* Length of language */
-		  if (value->string.language != NULL)
-		    n = (int)strlen(value->string.language);
-		  else
-		    n = 0;
+    free(index->buckets);
 
-	          *bufptr++ = (ipp_uchar_t)(n >> 8);
-		  *bufptr++ = (ipp_uchar_t)n;
+    index->buckets     = buckets;
+    index->num_buckets = num_buckets;
+  }
+}
 
-                 /* Language */
-		  if (n > 0)
-		  {
-		    memcpy(bufptr, value->string.language, (size_t)n);
-		    bufptr += n;
-		  }
 
-                 /* Length of text */
-                  if (value->string.text != NULL)
-		    n = (int)strlen(value->string.text);
-		  else
-		    n = 0;
+/*
+ * 'ipp_index_delete()' - Remove an attribute from the name index.
+ *
+ * The attribute must already be unlinked from the message.
+ */
 
-	          *bufptr++ = (ipp_uchar_t)(n >> 8);
-		  *bufptr++ = (ipp_uchar_t)n;
+static void
+ipp_index_delete(
+    ipp_t           *ipp,		/* I - IPP message */
+    ipp_attribute_t *attr,		/* I - Deleted attribute */
+    ipp_attribute_t *prev)		/* I - Attribute that was before it or NULL */
+{
+  _ipp_index_t		*index = ipp->index;
+					/* Name index */
+  _ipp_ientry_t		*entry,		/* Index entry */
+			**eptr;		/* Pointer to entry */
+  ipp_attribute_t	*current;	/* Current attribute */
+  unsigned		hash;		/* Hash of attribute name */
 
-                 /* Text */
-		  if (n > 0)
-		  {
-		    memcpy(bufptr, value->string.text, (size_t)n);
-		    bufptr += n;
-		  }
-		}
-		break;
 
-            case IPP_TAG_BEGIN_COLLECTION :
-	        for (i = 0, value = attr->values;
-		     i < attr->num_values;
-		     i ++, value ++)
-		{
-		 /*
-		  * Collections are written with the begin-collection
-		  * tag first with a value of 0 length, followed by the
-		  * attributes in the collection, then the end-collection
-		  * value...
-		  */
+ /*
+  * Update the "previous" pointer of the following attribute...
+  */
 
-                  if ((IPP_BUF_SIZE - (bufptr - buffer)) < 5)
-		  {
-                    if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
-	            {
-	              DEBUG_puts("1ippWriteIO: Could not write IPP "
-		                 "attribute...");
-		      _cupsBufferRelease((char *)buffer);
-	              return (IPP_STATE_ERROR);
-	            }
-
-		    bufptr = buffer;
-		  }
+  if ((current = attr->next) != NULL && current->name && (entry = ipp_index_lookup(index, current->name, ipp_index_hash(current->name))) != NULL && entry->attr == current)
+    entry->prev = prev;
 
-		  if (i)
-		  {
-		   /*
-		    * Arrays and sets are done by sending additional
-		    * values with a zero-length name...
-		    */
+  if (!attr->name)
+    return;
 
-                    *bufptr++ = (ipp_uchar_t)attr->value_tag;
-		    *bufptr++ = 0;
-		    *bufptr++ = 0;
-		  }
+  hash = ipp_index_hash(attr->name);
 
-                 /*
-		  * Write a data length of 0 and flush the buffer...
-		  */
+  for (eptr = index->buckets + (hash & (index->num_buckets - 1)); (entry = *eptr) != NULL; eptr = &(entry->next))
+    if (entry->hash == hash && !_cups_strcasecmp(entry->attr->name, attr->name))
+      break;
 
-	          *bufptr++ = 0;
-		  *bufptr++ = 0;
+  if (!entry)
+    return;
 
-                  if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
-	          {
-	            DEBUG_puts("1ippWriteIO: Could not write IPP "
-		               "attribute...");
-		    _cupsBufferRelease((char *)buffer);
-	            return (IPP_STATE_ERROR);
-	          }
+  if (-- entry->count <= 0)
+  {
+   /*
+    * Last attribute with this name, remove the entry...
+    */
 
-		  bufptr = buffer;
+    *eptr = entry->next;
+    index->num_entries --;
 
-                 /*
-		  * Then write the collection attribute...
-		  */
+    free(entry);
+  }
+  else if (entry->attr == attr)
+  {
+   /*
+    * First attribute with this name, advance to the next one...
+    */
 
-                  value->collection->state = IPP_STATE_IDLE;
+    for (current = attr->next; current; prev = current, current = current->next)
+    {
+      if (current->name && !_cups_strcasecmp(current->name, attr->name))
+      {
+        entry->attr = current;
+        entry->prev = prev;
+        break;
+      }
+    }
 
-		  if (ippWriteIO(dst, cb, 1, ipp,
-		                 value->collection) == IPP_STATE_ERROR)
-		  {
-		    DEBUG_puts("1ippWriteIO: Unable to write collection value");
-		    _cupsBufferRelease((char *)buffer);
-		    return (IPP_STATE_ERROR);
-		  }
-		}
-		break;
+    if (!current)
+      ipp_index_free(ipp);		/* Count is out of sync, rebuild later */
+  }
+}
 
-            default :
-	        for (i = 0, value = attr->values;
-		     i < attr->num_values;
-		     i ++, value ++)
-		{
-		  if (i)
-		  {
-		   /*
-		    * Arrays and sets are done by sending additional
-		    * values with a zero-length name...
-		    */
 
-                    if ((IPP_BUF_SIZE - (bufptr - buffer)) < 3)
-		    {
-                      if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
-	              {
-	        	DEBUG_puts("1ippWriteIO: Could not write IPP "
-		                   "attribute...");
-			_cupsBufferRelease((char *)buffer);
-	        	return (IPP_STATE_ERROR);
-	              }
-
-		      bufptr = buffer;
-		    }
+/*
+ * 'ipp_index_free()' - Free the name index.
+ */
 
-                    *bufptr++ = (ipp_uchar_t)attr->value_tag;
-		    *bufptr++ = 0;
-		    *bufptr++ = 0;
-		  }
+static void
+ipp_index_free(ipp_t *ipp)		/* I - IPP message */
+{
+  _ipp_index_t	*index = ipp->index;	/* Name index */
+  _ipp_ientry_t	*entry,			/* Current entry */
+		*next;			/* Next entry */
+  size_t	i;			/* Looping var */
 
-                 /*
-		  * An unknown value might some new value that a
-		  * vendor has come up with. It consists of a
-		  * 2-byte length and the bytes in the unknown
-		  * value buffer.
-		  */
 
-                  n = value->unknown.length;
+  if (!index)
+    return;
 
-                  if (n > (IPP_BUF_SIZE - 2))
-		  {
-		    DEBUG_printf(("1ippWriteIO: Data length too long (%d)",
-		                  n));
-		    _cupsBufferRelease((char *)buffer);
-		    return (IPP_STATE_ERROR);
-		  }
+  for (i = 0; i < index->num_buckets; i ++)
+  {
+    for (entry = index->buckets[i]; entry; entry = next)
+    {
+      next = entry->next;
+      free(entry);
+    }
+  }
 
-                  if ((int)(IPP_BUF_SIZE - (bufptr - buffer)) < (n + 2))
-		  {
-                    if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
-	            {
-	              DEBUG_puts("1ippWriteIO: Could not write IPP "
-		                 "attribute...");
-		      _cupsBufferRelease((char *)buffer);
-	              return (IPP_STATE_ERROR);
-	            }
-
-		    bufptr = buffer;
-		  }
+  free(index->buckets);
+  free(index);
 
-                 /* Length of unknown value */
-	          *bufptr++ = (ipp_uchar_t)(n >> 8);
-		  *bufptr++ = (ipp_uchar_t)n;
+  ipp->index   = NULL;
+  ipp->lookups = 0;
+}
 
-                 /* Value */
-		  if (n > 0)
-		  {
-		    memcpy(bufptr, value->unknown.data, (size_t)n);
-		    bufptr += n;
-		  }
-		}
-		break;
-	  }
 
-         /*
-	  * Write the data out...
-	  */
+/*
+ * 'ipp_index_get()' - Get the name index, building it as needed.
+ *
+ * Small messages and messages that are only searched a few times are not
+ * indexed.
+ */
 
-	  if (bufptr > buffer)
-	  {
-	    if ((*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0)
-	    {
-	      DEBUG_puts("1ippWriteIO: Could not write IPP attribute...");
-	      _cupsBufferRelease((char *)buffer);
-	      return (IPP_STATE_ERROR);
-	    }
+static _ipp_index_t *			/* O - Name index or NULL */
+ipp_index_get(ipp_t *ipp)		/* I - IPP message */
+{
+  ipp_attribute_t	*attr,		/* Current attribute */
+			*prev;		/* Previous attribute */
+  size_t		count;		/* Number of attributes */
+  _ipp_index_t		*index;		/* Name index */
 
-	    DEBUG_printf(("2ippWriteIO: wrote %d bytes",
-			  (int)(bufptr - buffer)));
-	  }
 
-	 /*
-          * If blocking is disabled and we aren't at the end of the attribute
-          * list, stop here...
-	  */
+  if (ipp->index)
+    return (ipp->index);
 
-          if (!blocking && ipp->current)
-	    break;
-	}
+  if (++ ipp->lookups < IPP_INDEX_LOOKUPS)
+    return (NULL);
 
-	if (ipp->current == NULL)
-	{
-         /*
-	  * Done with all of the attributes; add the end-of-attributes
-	  * tag or end-collection attribute...
-	  */
+  ipp->lookups = 0;
 
-          if (parent == NULL)
-	  {
-            buffer[0] = IPP_TAG_END;
-	    n         = 1;
-	  }
-	  else
-	  {
-            buffer[0] = IPP_TAG_END_COLLECTION;
-	    buffer[1] = 0; /* empty name */
-	    buffer[2] = 0;
-	    buffer[3] = 0; /* empty value */
-	    buffer[4] = 0;
-	    n         = 5;
-	  }
+  for (count = 0, attr = ipp->attrs; attr; attr = attr->next)
+    count ++;
 
-	  if ((*cb)(dst, buffer, (size_t)n) < 0)
-	  {
-	    DEBUG_puts("1ippWriteIO: Could not write IPP end-tag...");
-	    _cupsBufferRelease((char *)buffer);
-	    return (IPP_STATE_ERROR);
-	  }
+  if (count < IPP_INDEX_MIN)
+    return (NULL);
 
-	  ipp->state = IPP_STATE_DATA;
-	}
-        break;
+  if ((index = calloc(1, sizeof(_ipp_index_t))) == NULL)
+    return (NULL);
 
-    case IPP_STATE_DATA :
-        break;
+  for (index->num_buckets = IPP_INDEX_MIN; index->num_buckets < count; index->num_buckets *= 2);
 
-    default :
-        break; /* anti-compiler-warning-code */
+  if ((index->buckets = calloc(index->num_buckets, sizeof(_ipp_ientry_t *))) == NULL)
+  {
+    free(index);
+    return (NULL);
   }
 
-  _cupsBufferRelease((char *)buffer);
+  ipp->index = index;
 
-  return (ipp->state);
+  for (attr = ipp->attrs, prev = NULL; attr && ipp->index; prev = attr, attr = attr->next)
+    ipp_index_add(ipp, attr, prev);
+
+  return (ipp->index);
 }
 
 
 /*
- * 'ipp_add_attr()' - Add a new attribute to the message.
+ * 'ipp_index_hash()' - Compute the case-insensitive hash of a name.
  */
 
-static ipp_attribute_t *		/* O - New attribute */
-ipp_add_attr(ipp_t      *ipp,		/* I - IPP message */
-             const char *name,		/* I - Attribute name or NULL */
-             ipp_tag_t  group_tag,	/* I - Group tag or IPP_TAG_ZERO */
-             ipp_tag_t  value_tag,	/* I - Value tag or IPP_TAG_ZERO */
-             int        num_values)	/* I - Number of values */
+static unsigned				/* O - Hash value */
+ipp_index_hash(const char *name)	/* I - Attribute name */
 {
-  int			alloc_values;	/* Number of values to allocate */
-  ipp_attribute_t	*attr;		/* New attribute */
-
-
-  DEBUG_printf(("4ipp_add_attr(ipp=%p, name=\"%s\", group_tag=0x%x, value_tag=0x%x, num_values=%d)", (void *)ipp, name, group_tag, value_tag, num_values));
-
- /*
-  * Range check input...
-  */
-
-  if (!ipp || num_values < 0)
-    return (NULL);
-
- /*
-  * Allocate memory, rounding the allocation up as needed...
-  */
-
-  if (num_values <= 1)
-    alloc_values = 1;
-  else
-    alloc_values = (num_values + IPP_MAX_VALUES - 1) & ~(IPP_MAX_VALUES - 1);
+  unsigned	hash = 2166136261U;	/* FNV-1a hash value */
 
-  attr = calloc(sizeof(ipp_attribute_t) +
-                (size_t)(alloc_values - 1) * sizeof(_ipp_value_t), 1);
 
-  if (attr)
+  while (*name)
   {
-   /*
-    * Initialize attribute...
-    */
-
-    DEBUG_printf(("4debug_alloc: %p %s %s%s (%d values)", (void *)attr, name, num_values > 1 ? "1setOf " : "", ippTagString(value_tag), num_values));
+    hash ^= (unsigned)_cups_tolower(*name);
+    hash *= 16777619U;
+    name ++;
+  }
 
-    if (name)
-      attr->name = _cupsStrAlloc(name);
+  return (hash);
+}
 
-    attr->group_tag  = group_tag;
-    attr->value_tag  = value_tag;
-    attr->num_values = num_values;
 
-   /*
-    * Add it to the end of the linked list...
-    */
+/*
+ * 'ipp_index_lookup()' - Find the index entry for a name.
+ */
 
-    if (ipp->last)
-      ipp->last->next = attr;
-    else
-      ipp->attrs = attr;
+static _ipp_ientry_t *			/* O - Index entry or NULL */
+ipp_index_lookup(_ipp_index_t *index,	/* I - Name index */
+                 const char   *name,	/* I - Attribute name */
+                 unsigned     hash)	/* I - Hash of attribute name */
+{
+  _ipp_ientry_t	*entry;			/* Current entry */
 
-    ipp->prev = ipp->last;
-    ipp->last = ipp->current = attr;
-  }
 
-  DEBUG_printf(("5ipp_add_attr: Returning %p", (void *)attr));
+  for (entry = index->buckets[hash & (index->num_buckets - 1)]; entry; entry = entry->next)
+    if (entry->hash == hash && !_cups_strcasecmp(entry->attr->name, name))
+      return (entry);
 
-  return (attr);
+  return (NULL);
 }
 
 
 /*
- * 'ipp_free_values()' - Free attribute values.
+ * 'ipp_index_move()' - Update the name index after an attribute is reallocated.
  */
 
 static void
-ipp_free_values(ipp_attribute_t *attr,	/* I - Attribute to free values from */
-                int             element,/* I - First value to free */
-                int             count)	/* I - Number of values to free */
+ipp_index_move(
+    ipp_t           *ipp,		/* I - IPP message */
+    ipp_attribute_t *oldattr,		/* I - Old attribute pointer */
+    ipp_attribute_t *newattr)		/* I - New attribute pointer */
 {
-  int		i;			/* Looping var */
-  _ipp_value_t	*value;			/* Current value */
+  _ipp_index_t	*index = ipp->index;	/* Name index */
+  _ipp_ientry_t	*entry;			/* Index entry */
 
 
-  DEBUG_printf(("4ipp_free_values(attr=%p, element=%d, count=%d)", (void *)attr, element, count));
+ /*
+  * The old attribute has been freed, so compare pointers only...
+  */
 
-  if (!(attr->value_tag & IPP_TAG_CUPS_CONST))
+  if (newattr->name)
   {
-   /*
-    * Free values as needed...
-    */
-
-    switch (attr->value_tag)
+    for (entry = index->buckets[ipp_index_hash(newattr->name) & (index->num_buckets - 1)]; entry; entry = entry->next)
     {
-      case IPP_TAG_TEXTLANG :
-      case IPP_TAG_NAMELANG :
-	  if (element == 0 && count == attr->num_values &&
-	      attr->values[0].string.language)
-	  {
-	    _cupsStrFree(attr->values[0].string.language);
-	    attr->values[0].string.language = NULL;
-	  }
-	  /* Fall through to other string values */
-
-      case IPP_TAG_TEXT :
-      case IPP_TAG_NAME :
-      case IPP_TAG_RESERVED_STRING :
-      case IPP_TAG_KEYWORD :
-      case IPP_TAG_URI :
-      case IPP_TAG_URISCHEME :
-      case IPP_TAG_CHARSET :
-      case IPP_TAG_LANGUAGE :
-      case IPP_TAG_MIMETYPE :
-	  for (i = count, value = attr->values + element;
-	       i > 0;
-	       i --, value ++)
-	  {
-	    _cupsStrFree(value->string.text);
-	    value->string.text = NULL;
-	  }
-	  break;
-
-      case IPP_TAG_UNSUPPORTED_VALUE :
-      case IPP_TAG_DEFAULT :
-      case IPP_TAG_UNKNOWN :
-      case IPP_TAG_NOVALUE :
-      case IPP_TAG_NOTSETTABLE :
-      case IPP_TAG_DELETEATTR :
-      case IPP_TAG_ADMINDEFINE :
-      case IPP_TAG_INTEGER :
-      case IPP_TAG_ENUM :
-      case IPP_TAG_BOOLEAN :
-      case IPP_TAG_DATE :
-      case IPP_TAG_RESOLUTION :
-      case IPP_TAG_RANGE :
-	  break;
-
-      case IPP_TAG_BEGIN_COLLECTION :
-	  for (i = count, value = attr->values + element;
-	       i > 0;
-	       i --, value ++)
-	  {
-	    ippDelete(value->collection);
-	    value->collection = NULL;
-	  }
-	  break;
-
-      case IPP_TAG_STRING :
-      default :
-	  for (i = count, value = attr->values + element;
-	       i > 0;
-	       i --, value ++)
-	  {
-	    if (value->unknown.data)
-	    {
-	      free(value->unknown.data);
-	      value->unknown.data = NULL;
-	    }
-	  }
-	  break;
+      if (entry->attr == oldattr)
+      {
+        entry->attr = newattr;
+        break;
+      }
     }
   }
 
- /*
-  * If we are not freeing values from the end, move the remaining values up...
-  */
-
-  if ((element + count) < attr->num_values)
-    memmove(attr->values + element, attr->values + element + count,
-            (size_t)(attr->num_values - count - element) * sizeof(_ipp_value_t));
-
-  attr->num_values -= count;
-}
-
-
-/*
- * 'ipp_get_code()' - Convert a C locale/charset name into an IPP language/charset code.
- *
- * This typically converts strings of the form "ll_CC", "ll-REGION", and "CHARSET_NUMBER"
- * to "ll-cc", "ll-region", and "charset-number", respectively.
- */
-
-static char *				/* O - Language code string */
-ipp_get_code(const char *value,		/* I - Locale/charset string */
-             char       *buffer,	/* I - String buffer */
-             size_t     bufsize)	/* I - Size of string buffer */
-{
-  char	*bufptr,			/* Pointer into buffer */
-	*bufend;			/* End of buffer */
-
-
- /*
-  * Convert values to lowercase and change _ to - as needed...
-  */
-
-  for (bufptr = buffer, bufend = buffer + bufsize - 1;
-       *value && bufptr < bufend;
-       value ++)
-    if (*value == '_')
-      *bufptr++ = '-';
-    else
-      *bufptr++ = (char)_cups_tolower(*value);
-
-  *bufptr = '\0';
-
- /*
-  * Return the converted string...
-  */
-
-  return (buffer);
+  if (newattr->next && newattr->next->name && (entry = ipp_index_lookup(index, newattr->next->name, ipp_index_hash(newattr->next->name))) != NULL && entry->prev == oldattr)
+    entry->prev = newattr;
 }
 
 
@@ -6549,281 +6313,1349 @@ ipp_length(ipp_t *ipp,			/* I - IPP message or collection */
 }
 
 
-/*
- * 'ipp_read_http()' - Semi-blocking read on a HTTP connection...
- */
+/*
+ * 'ipp_new_arena()' - Allocate a new arena-backed IPP message.
+ */
+
+static ipp_t *				/* O - New IPP message */
+ipp_new_arena(size_t size)		/* I - Size of first chunk */
+{
+  ipp_t			*temp;		/* New IPP message */
+  _ipp_chunk_t		*chunk;		/* First arena chunk */
+  _cups_globals_t	*cg = _cupsGlobals();
+					/* Global data */
+
+
+  if ((chunk = calloc(1, sizeof(_ipp_chunk_t) + size)) == NULL)
+    return (NULL);
+
+  chunk->ptr = (char *)(chunk + 1);
+  chunk->end = chunk->ptr + size;
+
+ /*
+  * The message itself lives at the start of the first chunk...
+  */
+
+  temp       = (ipp_t *)chunk->ptr;
+  chunk->ptr += (sizeof(ipp_t) + 7) & ~(size_t)7;
+
+  DEBUG_printf(("4debug_alloc: %p IPP message", (void *)temp));
+
+  if (cg->server_version == 0)
+    _cupsSetDefaults();
+
+  temp->request.any.version[0] = (ipp_uchar_t)(cg->server_version / 10);
+  temp->request.any.version[1] = (ipp_uchar_t)(cg->server_version % 10);
+  temp->use                    = 1;
+  temp->arena                  = chunk;
+
+  return (temp);
+}
+
+
+/*
+ * 'ipp_read_http()' - Semi-blocking read on a HTTP connection...
+ */
+
+static ssize_t				/* O - Number of bytes read */
+ipp_read_http(http_t      *http,	/* I - Client connection */
+              ipp_uchar_t *buffer,	/* O - Buffer for data */
+	      size_t      length)	/* I - Total length */
+{
+  ssize_t	tbytes,			/* Total bytes read */
+		bytes;			/* Bytes read this pass */
+
+
+  DEBUG_printf(("7ipp_read_http(http=%p, buffer=%p, length=%d)", (void *)http, (void *)buffer, (int)length));
+
+ /*
+  * Loop until all bytes are read...
+  */
+
+  for (tbytes = 0, bytes = 0;
+       tbytes < (int)length;
+       tbytes += bytes, buffer += bytes)
+  {
+    DEBUG_printf(("9ipp_read_http: tbytes=" CUPS_LLFMT ", http->state=%d", CUPS_LLCAST tbytes, http->state));
+
+    if (http->state == HTTP_STATE_WAITING)
+      break;
+
+    if (http->used == 0 && !http->blocking)
+    {
+     /*
+      * Wait up to 10 seconds for more data on non-blocking sockets...
+      */
+
+      if (!httpWait(http, 10000))
+      {
+       /*
+	* Signal no data...
+	*/
+
+	bytes = -1;
+	break;
+      }
+    }
+    else if (http->used == 0 && http->timeout_value > 0)
+    {
+     /*
+      * Wait up to timeout seconds for more data on blocking sockets...
+      */
+
+      if (!httpWait(http, (int)(1000 * http->timeout_value)))
+      {
+       /*
+	* Signal no data...
+	*/
+
+	bytes = -1;
+	break;
+      }
+    }
+
+    if ((bytes = httpRead2(http, (char *)buffer, length - (size_t)tbytes)) < 0)
+    {
+#ifdef _WIN32
+      break;
+#else
+      if (errno != EAGAIN && errno != EINTR)
+	break;
+
+      bytes = 0;
+#endif /* _WIN32 */
+    }
+    else if (bytes == 0)
+      break;
+  }
+
+ /*
+  * Return the number of bytes read...
+  */
+
+  if (tbytes == 0 && bytes < 0)
+    tbytes = -1;
+
+  DEBUG_printf(("8ipp_read_http: Returning " CUPS_LLFMT " bytes", CUPS_LLCAST tbytes));
+
+  return (tbytes);
+}
+
+
+/*
+ * 'ipp_read_file()' - Read IPP data from a file.
+ */
+
+static ssize_t				/* O - Number of bytes read */
+ipp_read_file(int         *fd,		/* I - File descriptor */
+              ipp_uchar_t *buffer,	/* O - Read buffer */
+	      size_t      length)	/* I - Number of bytes to read */
+{
+#ifdef _WIN32
+  return ((ssize_t)read(*fd, buffer, (unsigned)length));
+#else
+  return (read(*fd, buffer, length));
+#endif /* _WIN32 */
+}
+
+
+/*
+ * 'ipp_read_ptr()' - Get a pointer to data in a zero-copy source.
+ */
+
+static ipp_uchar_t *			/* O - Pointer to data or NULL */
+ipp_read_ptr(void       *src,		/* I - Data source */
+             ipp_iocb_t cb,		/* I - Read callback function */
+             int        n)		/* I - Number of bytes */
+{
+  _ipp_zcread_t	*zc = (_ipp_zcread_t *)src;
+					/* Zero-copy read state */
+  ipp_uchar_t	*ptr;			/* Pointer to data */
+
+
+  if (cb != (ipp_iocb_t)ipp_read_zc || zc->saved_ptr || n > (zc->end - zc->ptr))
+    return (NULL);
+
+  ptr     = zc->ptr;
+  zc->ptr += n;
+
+  return (ptr);
+}
+
+
+/*
+ * 'ipp_read_string()' - Read a nul-terminated string.
+ *
+ * Strings from a zero-copy source are terminated in place by replacing the
+ * following byte, which is handed back on the next read.  Otherwise the
+ * string is read into the supplied buffer.
+ */
+
+static char *				/* O - String or NULL on error */
+ipp_read_string(void        *src,	/* I - Data source */
+                ipp_iocb_t  cb,		/* I - Read callback function */
+                ipp_uchar_t *buffer,	/* I - Buffer for string */
+                int         n)		/* I - Length of string */
+{
+  _ipp_zcread_t	*zc = (_ipp_zcread_t *)src;
+					/* Zero-copy read state */
+  ipp_uchar_t	*ptr;			/* Pointer to string */
+
+
+  if (cb == (ipp_iocb_t)ipp_read_zc && !zc->saved_ptr && n < (zc->end - zc->ptr))
+  {
+    ptr           = zc->ptr;
+    zc->ptr       += n;
+    zc->saved     = *(zc->ptr);
+    zc->saved_ptr = zc->ptr;
+    *(zc->ptr)    = '\0';
+
+    return ((char *)ptr);
+  }
+
+  if (n > 0 && (*cb)(src, buffer, (size_t)n) < n)
+    return (NULL);
+
+  buffer[n] = '\0';
+
+  return ((char *)buffer);
+}
+
+
+/*
+ * 'ipp_read_zc()' - Read IPP data from a zero-copy source.
+ */
+
+static ssize_t				/* O - Number of bytes read */
+ipp_read_zc(_ipp_zcread_t *zc,		/* I - Read state */
+            ipp_uchar_t   *buffer,	/* I - Buffer */
+            size_t        length)	/* I - Number of bytes to read */
+{
+  if (length > (size_t)(zc->end - zc->ptr))
+    length = (size_t)(zc->end - zc->ptr);
+
+  memcpy(buffer, zc->ptr, length);
+
+  if (zc->saved_ptr && zc->saved_ptr < zc->ptr + length)
+  {
+   /*
+    * Restore the byte that was replaced by a nul terminator...
+    */
+
+    buffer[zc->saved_ptr - zc->ptr] = zc->saved;
+    zc->saved_ptr                   = NULL;
+  }
+
+  zc->ptr += length;
+
+  return ((ssize_t)length);
+}
+
+
+/*
+ * 'ipp_set_error()' - Set a formatted, localized error string.
+ */
+
+static void
+ipp_set_error(ipp_status_t status,	/* I - Status code */
+              const char   *format,	/* I - Printf-style error string */
+	      ...)			/* I - Additional arguments as needed */
+{
+  va_list	ap;			/* Pointer to additional args */
+  char		buffer[2048];		/* Message buffer */
+  cups_lang_t	*lang = cupsLangDefault();
+					/* Current language */
+
+
+  va_start(ap, format);
+  vsnprintf(buffer, sizeof(buffer), _cupsLangString(lang, format), ap);
+  va_end(ap);
+
+  _cupsSetError(status, buffer, 0);
+}
+
+
+/*
+ * 'ipp_set_value()' - Get the value element from an attribute, expanding it as
+ *                     needed.
+ */
+
+static _ipp_value_t *			/* O  - IPP value element or NULL on error */
+ipp_set_value(ipp_t           *ipp,	/* IO - IPP message */
+              ipp_attribute_t **attr,	/* IO - IPP attribute */
+              int             element)	/* I  - Value number (0-based) */
+{
+  ipp_attribute_t	*temp,		/* New attribute pointer */
+			*current,	/* Current attribute in list */
+			*prev;		/* Previous attribute in list */
+  int			alloc_values,	/* Allocated values */
+			old_values;	/* Previously allocated values */
+
+
+ /*
+  * If we are setting an existing value element, return it...
+  */
+
+  temp = *attr;
+
+  if (temp->num_values <= 1)
+    alloc_values = 1;
+  else
+    alloc_values = (temp->num_values + IPP_MAX_VALUES - 1) &
+                   ~(IPP_MAX_VALUES - 1);
+
+  if (element < alloc_values)
+  {
+    if (element >= temp->num_values)
+      temp->num_values = element + 1;
+
+    return (temp->values + element);
+  }
+
+ /*
+  * Otherwise re-allocate the attribute - we allocate in groups of IPP_MAX_VALUE
+  * values when num_values > 1.
+  */
+
+  old_values = alloc_values;
+
+  if (alloc_values < IPP_MAX_VALUES)
+    alloc_values = IPP_MAX_VALUES;
+  else
+    alloc_values += IPP_MAX_VALUES;
+
+  DEBUG_printf(("4ipp_set_value: Reallocating for up to %d values.",
+                alloc_values));
+
+ /*
+  * Reallocate memory...
+  */
+
+  if (temp->arena)
+  {
+   /*
+    * Arena memory cannot be resized, copy to a new allocation...
+    */
+
+    if ((temp = ipp_alloc(ipp, sizeof(ipp_attribute_t) + (size_t)(alloc_values - 1) * sizeof(_ipp_value_t))) != NULL)
+      memcpy(temp, *attr, sizeof(ipp_attribute_t) + (size_t)(old_values - 1) * sizeof(_ipp_value_t));
+  }
+  else
+    temp = realloc(temp, sizeof(ipp_attribute_t) + (size_t)(alloc_values - 1) * sizeof(_ipp_value_t));
+
+  if (!temp)
+  {
+    _cupsSetHTTPError(HTTP_STATUS_ERROR);
+    DEBUG_puts("4ipp_set_value: Unable to resize attribute.");
+    return (NULL);
+  }
+
+ /*
+  * Zero the new memory...
+  */
+
+  memset(temp->values + temp->num_values, 0, (size_t)(alloc_values - temp->num_values) * sizeof(_ipp_value_t));
+
+  if (temp != *attr)
+  {
+   /*
+    * Reset pointers in the list...
+    */
+
+#ifndef __clang_analyzer__
+    DEBUG_printf(("4debug_free: %p %s", (void *)*attr, temp->name));
+#endif /* !__clang_analyzer__ */
+    DEBUG_printf(("4debug_alloc: %p %s %s%s (%d)", (void *)temp, temp->name, temp->num_values > 1 ? "1setOf " : "", ippTagString(temp->value_tag), temp->num_values));
+
+    if (ipp->current == *attr && ipp->prev && ipp->prev->next == *attr)
+    {
+     /*
+      * Use current "previous" pointer...
+      */
+
+      prev = ipp->prev;
+    }
+    else
+    {
+     /*
+      * Find this attribute in the linked list...
+      */
+
+      for (prev = NULL, current = ipp->attrs;
+	   current && current != *attr;
+	   prev = current, current = current->next);
+
+      if (!current)
+      {
+       /*
+	* This is a serious error!
+	*/
+
+	*attr = temp;
+	_cupsSetError(IPP_STATUS_ERROR_INTERNAL,
+	              _("IPP attribute is not a member of the message."), 1);
+	DEBUG_puts("4ipp_set_value: Unable to find attribute in message.");
+	return (NULL);
+      }
+    }
+
+    if (prev)
+      prev->next = temp;
+    else
+      ipp->attrs = temp;
+
+    ipp->current = temp;
+    ipp->prev    = prev;
+
+    if (ipp->last == *attr)
+      ipp->last = temp;
+
+    if (ipp->index)
+      ipp_index_move(ipp, *attr, temp);
+
+    *attr = temp;
+  }
+
+ /*
+  * Return the value element...
+  */
+
+  if (element >= temp->num_values)
+    temp->num_values = element + 1;
+
+  return (temp->values + element);
+}
+
+
+/*
+ * 'ipp_str_alloc()' - Allocate a string for a message.
+ *
+ * Arena messages get a private copy, others use the string pool.
+ */
+
+static char *				/* O - String or NULL */
+ipp_str_alloc(ipp_t      *ipp,		/* I - IPP message */
+              const char *s)		/* I - String */
+{
+  char		*temp;			/* New string */
+  size_t	len;			/* Length of string */
+
+
+  if (ipp_in_buffer(ipp, s))
+    return ((char *)s);			/* Already nul-terminated in the source buffer */
+
+  if (!ipp->arena || !s)
+    return (_cupsStrAlloc(s));
+
+  len = strlen(s) + 1;
+
+  if ((temp = ipp_alloc(ipp, len)) != NULL)
+    memcpy(temp, s, len);
+
+  return (temp);
+}
+
+
+/*
+ * 'ipp_str_free()' - Free a string from a message.
+ *
+ * Strings in the arena are left alone by _cupsStrFree, which only releases
+ * strings it finds in the string pool.
+ */
+
+static void
+ipp_str_free(ipp_t      *ipp,		/* I - IPP message or NULL */
+             const char *s)		/* I - String */
+{
+  if (ipp_in_buffer(ipp, s))
+    return;
+
+  _cupsStrFree(s);
+}
+
+
+/*
+ * 'ipp_write_data()' - Add a value to the write buffer.
+ *
+ * Short values are copied; the caller must make sure there is room in the
+ * copy buffer.  Large values written to a HTTP connection are queued in place.
+ */
+
+static ipp_uchar_t *			/* O - New position in copy buffer or NULL on error */
+ipp_write_data(_ipp_wbuf_t *wb,		/* I - Write buffer */
+               ipp_uchar_t *bufptr,	/* I - Current position in copy buffer */
+               const void  *data,	/* I - Value data */
+               size_t      length)	/* I - Length of value */
+{
+  if (!wb->vec || length < IPP_MIN_IOV)
+  {
+    memcpy(bufptr, data, length);
+
+    return (bufptr + length);
+  }
+
+  if (wb->num_iov > (IPP_MAX_IOV - 3) && (bufptr = ipp_write_flush(wb, bufptr)) == NULL)
+    return (NULL);
+
+  if (bufptr > wb->segment)
+  {
+    wb->iov[wb->num_iov].iov_base = wb->segment;
+    wb->iov[wb->num_iov].iov_len  = (size_t)(bufptr - wb->segment);
+    wb->num_iov ++;
+  }
+
+  wb->iov[wb->num_iov].iov_base = (void *)data;
+  wb->iov[wb->num_iov].iov_len  = length;
+  wb->num_iov ++;
+
+  wb->segment = bufptr;
+
+  return (bufptr);
+}
+
+
+/*
+ * 'ipp_write_file()' - Write IPP data to a file.
+ */
+
+static ssize_t				/* O - Number of bytes written */
+ipp_write_file(int         *fd,		/* I - File descriptor */
+               ipp_uchar_t *buffer,	/* I - Data to write */
+               size_t      length)	/* I - Number of bytes to write */
+{
+#ifdef _WIN32
+  return ((ssize_t)write(*fd, buffer, (unsigned)length));
+#else
+  return (write(*fd, buffer, length));
+#endif /* _WIN32 */
+}
+
+
+/*
+ * 'ipp_write_flush()' - Write the queued data.
+ */
+
+static ipp_uchar_t *			/* O - Start of copy buffer or NULL on error */
+ipp_write_flush(_ipp_wbuf_t *wb,	/* I - Write buffer */
+                ipp_uchar_t *bufptr)	/* I - Current position in copy buffer */
+{
+  int	i;				/* Looping var */
+
+
+  if (bufptr > wb->segment)
+  {
+    wb->iov[wb->num_iov].iov_base = wb->segment;
+    wb->iov[wb->num_iov].iov_len  = (size_t)(bufptr - wb->segment);
+    wb->num_iov ++;
+  }
+
+  DEBUG_printf(("2ipp_write_flush: Writing %d buffers.", wb->num_iov));
+
+  if (wb->vec)
+  {
+    if (wb->num_iov > 0 && _httpWritev((http_t *)wb->dst, wb->iov, wb->num_iov) < 0)
+      return (NULL);
+  }
+  else
+  {
+    for (i = 0; i < wb->num_iov; i ++)
+    {
+      if ((*wb->cb)(wb->dst, (ipp_uchar_t *)wb->iov[i].iov_base, wb->iov[i].iov_len) < 0)
+        return (NULL);
+    }
+  }
+
+  if (wb->num_iov > 0)
+    wb->flushed ++;
+
+  wb->num_iov = 0;
+  wb->segment = wb->buffer;
+
+  return (wb->buffer);
+}
+
+
+/*
+ * 'ipp_write_io()' - Write data for an IPP message or collection.
+ */
+
+static ipp_state_t			/* O - Current state */
+ipp_write_io(_ipp_wbuf_t *wb,		/* I - Write buffer */
+	     int         blocking,	/* I - Use blocking IO? */
+	     ipp_t       *parent,	/* I - Parent IPP message */
+	     ipp_t       *ipp)		/* I - IPP data */
+{
+  int			i;		/* Looping var */
+  int			n;		/* Length of data */
+  ipp_uchar_t		*buffer,	/* Data buffer */
+			*bufptr;	/* Pointer into buffer */
+  ipp_attribute_t	*attr;		/* Current attribute */
+  _ipp_value_t		*value;		/* Current value */
+
+
+  buffer = wb->buffer;
+  bufptr = wb->bufptr;
+
+  switch (ipp->state)
+  {
+    case IPP_STATE_IDLE :
+        ipp->state ++; /* Avoid common problem... */
+
+    case IPP_STATE_HEADER :
+        if (parent == NULL)
+	{
+	 /*
+	  * Send the request header:
+	  *
+	  *                 Version = 2 bytes
+	  *   Operation/Status Code = 2 bytes
+	  *              Request ID = 4 bytes
+	  *                   Total = 8 bytes
+	  */
+
+	  *bufptr++ = ipp->request.any.version[0];
+	  *bufptr++ = ipp->request.any.version[1];
+	  *bufptr++ = (ipp_uchar_t)(ipp->request.any.op_status >> 8);
+	  *bufptr++ = (ipp_uchar_t)ipp->request.any.op_status;
+	  *bufptr++ = (ipp_uchar_t)(ipp->request.any.request_id >> 24);
+	  *bufptr++ = (ipp_uchar_t)(ipp->request.any.request_id >> 16);
+	  *bufptr++ = (ipp_uchar_t)(ipp->request.any.request_id >> 8);
+	  *bufptr++ = (ipp_uchar_t)ipp->request.any.request_id;
+
+	  DEBUG_printf(("2ippWriteIO: version=%d.%d", bufptr[-8], bufptr[-7]));
+	  DEBUG_printf(("2ippWriteIO: op_status=%04x",
+			ipp->request.any.op_status));
+	  DEBUG_printf(("2ippWriteIO: request_id=%d",
+			ipp->request.any.request_id));
+	}
+
+       /*
+	* Reset the state engine to point to the first attribute
+	* in the request/response, with no current group.
+	*/
+
+        ipp->state   = IPP_STATE_ATTRIBUTE;
+	ipp->current = ipp->attrs;
+	ipp->curtag  = IPP_TAG_ZERO;
+
+	DEBUG_printf(("1ippWriteIO: ipp->current=%p", (void *)ipp->current));
+
+    case IPP_STATE_ATTRIBUTE :
+        while (ipp->current != NULL)
+	{
+	 /*
+	  * Write this attribute...
+	  */
+
+	  attr = ipp->current;
+
+	  ipp->current = ipp->current->next;
+
+          if (!parent)
+	  {
+	    if (ipp->curtag != attr->group_tag)
+	    {
+	     /*
+	      * Send a group tag byte...
+	      */
+
+	      ipp->curtag = attr->group_tag;
+
+	      if (attr->group_tag == IPP_TAG_ZERO)
+		continue;
+
+	      DEBUG_printf(("2ippWriteIO: wrote group tag=%x(%s)",
+			    attr->group_tag, ippTagString(attr->group_tag)));
+	      *bufptr++ = (ipp_uchar_t)attr->group_tag;
+	    }
+	    else if (attr->group_tag == IPP_TAG_ZERO)
+	      continue;
+	  }
+
+	  DEBUG_printf(("1ippWriteIO: %s (%s%s)", attr->name,
+	                attr->num_values > 1 ? "1setOf " : "",
+			ippTagString(attr->value_tag)));
+
+         /*
+	  * Write the attribute tag and name.
+	  *
+	  * The attribute name length does not include the trailing nul
+	  * character in the source string.
+	  *
+	  * Collection values (parent != NULL) are written differently...
+	  */
+
+          if (parent == NULL)
+	  {
+           /*
+	    * Get the length of the attribute name, and make sure it won't
+	    * overflow the buffer...
+	    */
+
+            if ((n = (int)strlen(attr->name)) > (IPP_BUF_SIZE - 9))
+	    {
+	      DEBUG_printf(("1ippWriteIO: Attribute name too long (%d)", n));
+	      return (IPP_STATE_ERROR);
+	    }
+
+            if ((int)(IPP_BUF_SIZE - (bufptr - buffer)) < (n + 9) &&
+	        (bufptr = ipp_write_flush(wb, bufptr)) == NULL)
+	    {
+	      DEBUG_puts("1ippWriteIO: Could not write IPP attribute...");
+	      return (IPP_STATE_ERROR);
+	    }
+
+           /*
+	    * Write the value tag, name length, and name string...
+	    */
+
+            DEBUG_printf(("2ippWriteIO: writing value tag=%x(%s)",
+	                  attr->value_tag, ippTagString(attr->value_tag)));
+            DEBUG_printf(("2ippWriteIO: writing name=%d,\"%s\"", n,
+	                  attr->name));
+
+            if (attr->value_tag > 0xff)
+            {
+              *bufptr++ = IPP_TAG_EXTENSION;
+	      *bufptr++ = (ipp_uchar_t)(attr->value_tag >> 24);
+	      *bufptr++ = (ipp_uchar_t)(attr->value_tag >> 16);
+	      *bufptr++ = (ipp_uchar_t)(attr->value_tag >> 8);
+	      *bufptr++ = (ipp_uchar_t)attr->value_tag;
+            }
+            else
+	      *bufptr++ = (ipp_uchar_t)attr->value_tag;
+
+	    *bufptr++ = (ipp_uchar_t)(n >> 8);
+	    *bufptr++ = (ipp_uchar_t)n;
+	    memcpy(bufptr, attr->name, (size_t)n);
+	    bufptr += n;
+          }
+	  else
+	  {
+           /*
+	    * Get the length of the attribute name, and make sure it won't
+	    * overflow the buffer...
+	    */
+
+            if ((n = (int)strlen(attr->name)) > (IPP_BUF_SIZE - 14))
+	    {
+	      DEBUG_printf(("1ippWriteIO: Attribute name too long (%d)", n));
+	      return (IPP_STATE_ERROR);
+	    }
+
+            if ((int)(IPP_BUF_SIZE - (bufptr - buffer)) < (n + 14) &&
+	        (bufptr = ipp_write_flush(wb, bufptr)) == NULL)
+	    {
+	      DEBUG_puts("1ippWriteIO: Could not write IPP attribute...");
+	      return (IPP_STATE_ERROR);
+	    }
+
+           /*
+	    * Write the member name tag, name length, name string, value tag,
+	    * and empty name for the collection member attribute...
+	    */
+
+            DEBUG_printf(("2ippWriteIO: writing value tag=%x(memberName)",
+	                  IPP_TAG_MEMBERNAME));
+            DEBUG_printf(("2ippWriteIO: writing name=%d,\"%s\"", n,
+	                  attr->name));
+            DEBUG_printf(("2ippWriteIO: writing value tag=%x(%s)",
+	                  attr->value_tag, ippTagString(attr->value_tag)));
+            DEBUG_puts("2ippWriteIO: writing name=0,\"\"");
+
+            *bufptr++ = IPP_TAG_MEMBERNAME;
+	    *bufptr++ = 0;
+	    *bufptr++ = 0;
+	    *bufptr++ = (ipp_uchar_t)(n >> 8);
+	    *bufptr++ = (ipp_uchar_t)n;
+	    memcpy(bufptr, attr->name, (size_t)n);
+	    bufptr += n;
+
+            if (attr->value_tag > 0xff)
+            {
+              *bufptr++ = IPP_TAG_EXTENSION;
+	      *bufptr++ = (ipp_uchar_t)(attr->value_tag >> 24);
+	      *bufptr++ = (ipp_uchar_t)(attr->value_tag >> 16);
+	      *bufptr++ = (ipp_uchar_t)(attr->value_tag >> 8);
+	      *bufptr++ = (ipp_uchar_t)attr->value_tag;
+            }
+            else
+	      *bufptr++ = (ipp_uchar_t)attr->value_tag;
+
+            *bufptr++ = 0;
+            *bufptr++ = 0;
+	  }
+
+         /*
+	  * Now write the attribute value(s)...
+	  */
+
+	  switch (attr->value_tag & ~IPP_TAG_CUPS_CONST)
+	  {
+	    case IPP_TAG_UNSUPPORTED_VALUE :
+	    case IPP_TAG_DEFAULT :
+	    case IPP_TAG_UNKNOWN :
+	    case IPP_TAG_NOVALUE :
+	    case IPP_TAG_NOTSETTABLE :
+	    case IPP_TAG_DELETEATTR :
+	    case IPP_TAG_ADMINDEFINE :
+		*bufptr++ = 0;
+		*bufptr++ = 0;
+	        break;
+
+	    case IPP_TAG_INTEGER :
+	    case IPP_TAG_ENUM :
+	        for (i = 0, value = attr->values;
+		     i < attr->num_values;
+		     i ++, value ++)
+		{
+                  if ((IPP_BUF_SIZE - (bufptr - buffer)) < 9 &&
+		      (bufptr = ipp_write_flush(wb, bufptr)) == NULL)
+		  {
+		    DEBUG_puts("1ippWriteIO: Could not write IPP attribute...");
+		    return (IPP_STATE_ERROR);
+		  }
+
+		  if (i)
+		  {
+		   /*
+		    * Arrays and sets are done by sending additional
+		    * values with a zero-length name...
+		    */
+
+                    *bufptr++ = (ipp_uchar_t)attr->value_tag;
+		    *bufptr++ = 0;
+		    *bufptr++ = 0;
+		  }
+
+		 /*
+	          * Integers and enumerations are both 4-byte signed
+		  * (twos-complement) values.
+		  *
+		  * Put the 2-byte length and 4-byte value into the buffer...
+		  */
+
+	          *bufptr++ = 0;
+		  *bufptr++ = 4;
+		  *bufptr++ = (ipp_uchar_t)(value->integer >> 24);
+		  *bufptr++ = (ipp_uchar_t)(value->integer >> 16);
+		  *bufptr++ = (ipp_uchar_t)(value->integer >> 8);
+		  *bufptr++ = (ipp_uchar_t)value->integer;
+		}
+		break;
+
+	    case IPP_TAG_BOOLEAN :
+	        for (i = 0, value = attr->values;
+		     i < attr->num_values;
+		     i ++, value ++)
+		{
+                  if ((IPP_BUF_SIZE - (bufptr - buffer)) < 6 &&
+		      (bufptr = ipp_write_flush(wb, bufptr)) == NULL)
+		  {
+		    DEBUG_puts("1ippWriteIO: Could not write IPP attribute...");
+		    return (IPP_STATE_ERROR);
+		  }
+
+		  if (i)
+		  {
+		   /*
+		    * Arrays and sets are done by sending additional
+		    * values with a zero-length name...
+		    */
+
+                    *bufptr++ = (ipp_uchar_t)attr->value_tag;
+		    *bufptr++ = 0;
+		    *bufptr++ = 0;
+		  }
+
+                 /*
+		  * Boolean values are 1-byte; 0 = false, 1 = true.
+		  *
+		  * Put the 2-byte length and 1-byte value into the buffer...
+		  */
+
+	          *bufptr++ = 0;
+		  *bufptr++ = 1;
+		  *bufptr++ = (ipp_uchar_t)value->boolean;
+		}
+		break;
+
+	    case IPP_TAG_TEXT :
+	    case IPP_TAG_NAME :
+	    case IPP_TAG_KEYWORD :
+	    case IPP_TAG_URI :
+	    case IPP_TAG_URISCHEME :
+	    case IPP_TAG_CHARSET :
+	    case IPP_TAG_LANGUAGE :
+	    case IPP_TAG_MIMETYPE :
+	        for (i = 0, value = attr->values;
+		     i < attr->num_values;
+		     i ++, value ++)
+		{
+		  if (i)
+		  {
+		   /*
+		    * Arrays and sets are done by sending additional
+		    * values with a zero-length name...
+		    */
+
+        	    DEBUG_printf(("2ippWriteIO: writing value tag=%x(%s)",
+		                  attr->value_tag,
+				  ippTagString(attr->value_tag)));
+        	    DEBUG_printf(("2ippWriteIO: writing name=0,\"\""));
+
+                    if ((IPP_BUF_SIZE - (bufptr - buffer)) < 3 &&
+			(bufptr = ipp_write_flush(wb, bufptr)) == NULL)
+		    {
+		      DEBUG_puts("1ippWriteIO: Could not write IPP attribute...");
+		      return (IPP_STATE_ERROR);
+		    }
+
+                    *bufptr++ = (ipp_uchar_t)attr->value_tag;
+		    *bufptr++ = 0;
+		    *bufptr++ = 0;
+		  }
+
+                  if (value->string.text != NULL)
+                    n = (int)strlen(value->string.text);
+		  else
+		    n = 0;
+
+                  if (n > (IPP_BUF_SIZE - 2))
+		  {
+		    DEBUG_printf(("1ippWriteIO: String too long (%d)", n));
+		    return (IPP_STATE_ERROR);
+		  }
+
+                  DEBUG_printf(("2ippWriteIO: writing string=%d,\"%s\"", n,
+		                value->string.text));
+
+                  if ((int)(IPP_BUF_SIZE - (bufptr - buffer)) < (n + 2) &&
+		      (bufptr = ipp_write_flush(wb, bufptr)) == NULL)
+		  {
+		    DEBUG_puts("1ippWriteIO: Could not write IPP attribute...");
+		    return (IPP_STATE_ERROR);
+		  }
+
+		 /*
+		  * All simple strings consist of the 2-byte length and
+		  * character data without the trailing nul normally found
+		  * in C strings.  Also, strings cannot be longer than IPP_MAX_LENGTH
+		  * bytes since the 2-byte length is a signed (twos-complement)
+		  * value.
+		  *
+		  * Put the 2-byte length and string characters in the buffer.
+		  */
+
+	          *bufptr++ = (ipp_uchar_t)(n >> 8);
+		  *bufptr++ = (ipp_uchar_t)n;
+
+		  if (n > 0 &&
+		      (bufptr = ipp_write_data(wb, bufptr, value->string.text,
+		                               (size_t)n)) == NULL)
+		  {
+		    DEBUG_puts("1ippWriteIO: Could not write IPP attribute...");
+		    return (IPP_STATE_ERROR);
+		  }
+		}
+		break;
 
-static ssize_t				/* O - Number of bytes read */
-ipp_read_http(http_t      *http,	/* I - Client connection */
-              ipp_uchar_t *buffer,	/* O - Buffer for data */
-	      size_t      length)	/* I - Total length */
-{
-  ssize_t	tbytes,			/* Total bytes read */
-		bytes;			/* Bytes read this pass */
+	    case IPP_TAG_DATE :
+	        for (i = 0, value = attr->values;
+		     i < attr->num_values;
+		     i ++, value ++)
+		{
+                  if ((IPP_BUF_SIZE - (bufptr - buffer)) < 16 &&
+		      (bufptr = ipp_write_flush(wb, bufptr)) == NULL)
+		  {
+		    DEBUG_puts("1ippWriteIO: Could not write IPP attribute...");
+		    return (IPP_STATE_ERROR);
+		  }
 
+		  if (i)
+		  {
+		   /*
+		    * Arrays and sets are done by sending additional
+		    * values with a zero-length name...
+		    */
 
-  DEBUG_printf(("7ipp_read_http(http=%p, buffer=%p, length=%d)", (void *)http, (void *)buffer, (int)length));
+                    *bufptr++ = (ipp_uchar_t)attr->value_tag;
+		    *bufptr++ = 0;
+		    *bufptr++ = 0;
+		  }
 
- /*
-  * Loop until all bytes are read...
-  */
+                 /*
+		  * Date values consist of a 2-byte length and an
+		  * 11-byte date/time structure defined by RFC 1903.
+		  *
+		  * Put the 2-byte length and 11-byte date/time
+		  * structure in the buffer.
+		  */
 
-  for (tbytes = 0, bytes = 0;
-       tbytes < (int)length;
-       tbytes += bytes, buffer += bytes)
-  {
-    DEBUG_printf(("9ipp_read_http: tbytes=" CUPS_LLFMT ", http->state=%d", CUPS_LLCAST tbytes, http->state));
+	          *bufptr++ = 0;
+		  *bufptr++ = 11;
+		  memcpy(bufptr, value->date, 11);
+		  bufptr += 11;
+		}
+		break;
 
-    if (http->state == HTTP_STATE_WAITING)
-      break;
+	    case IPP_TAG_RESOLUTION :
+	        for (i = 0, value = attr->values;
+		     i < attr->num_values;
+		     i ++, value ++)
+		{
+                  if ((IPP_BUF_SIZE - (bufptr - buffer)) < 14 &&
+		      (bufptr = ipp_write_flush(wb, bufptr)) == NULL)
+		  {
+		    DEBUG_puts("1ippWriteIO: Could not write IPP attribute...");
+		    return (IPP_STATE_ERROR);
+		  }
 
-    if (http->used == 0 && !http->blocking)
-    {
-     /*
-      * Wait up to 10 seconds for more data on non-blocking sockets...
-      */
+		  if (i)
+		  {
+		   /*
+		    * Arrays and sets are done by sending additional
+		    * values with a zero-length name...
+		    */
 
-      if (!httpWait(http, 10000))
-      {
-       /*
-	* Signal no data...
-	*/
+                    *bufptr++ = (ipp_uchar_t)attr->value_tag;
+		    *bufptr++ = 0;
+		    *bufptr++ = 0;
+		  }
 
-	bytes = -1;
-	break;
-      }
-    }
-    else if (http->used == 0 && http->timeout_value > 0)
-    {
-     /*
-      * Wait up to timeout seconds for more data on blocking sockets...
-      */
+                 /*
+		  * Resolution values consist of a 2-byte length,
+		  * 4-byte horizontal resolution value, 4-byte vertical
+		  * resolution value, and a 1-byte units value.
+		  *
+		  * Put the 2-byte length and resolution value data
+		  * into the buffer.
+		  */
 
-      if (!httpWait(http, (int)(1000 * http->timeout_value)))
-      {
-       /*
-	* Signal no data...
-	*/
+	          *bufptr++ = 0;
+		  *bufptr++ = 9;
+		  *bufptr++ = (ipp_uchar_t)(value->resolution.xres >> 24);
+		  *bufptr++ = (ipp_uchar_t)(value->resolution.xres >> 16);
+		  *bufptr++ = (ipp_uchar_t)(value->resolution.xres >> 8);
+		  *bufptr++ = (ipp_uchar_t)value->resolution.xres;
+		  *bufptr++ = (ipp_uchar_t)(value->resolution.yres >> 24);
+		  *bufptr++ = (ipp_uchar_t)(value->resolution.yres >> 16);
+		  *bufptr++ = (ipp_uchar_t)(value->resolution.yres >> 8);
+		  *bufptr++ = (ipp_uchar_t)value->resolution.yres;
+		  *bufptr++ = (ipp_uchar_t)value->resolution.units;
+		}
+		break;
 
-	bytes = -1;
-	break;
-      }
-    }
+	    case IPP_TAG_RANGE :
+	        for (i = 0, value = attr->values;
+		     i < attr->num_values;
+		     i ++, value ++)
+		{
+                  if ((IPP_BUF_SIZE - (bufptr - buffer)) < 13 &&
+		      (bufptr = ipp_write_flush(wb, bufptr)) == NULL)
+		  {
+		    DEBUG_puts("1ippWriteIO: Could not write IPP attribute...");
+		    return (IPP_STATE_ERROR);
+		  }
 
-    if ((bytes = httpRead2(http, (char *)buffer, length - (size_t)tbytes)) < 0)
-    {
-#ifdef _WIN32
-      break;
-#else
-      if (errno != EAGAIN && errno != EINTR)
-	break;
+		  if (i)
+		  {
+		   /*
+		    * Arrays and sets are done by sending additional
+		    * values with a zero-length name...
+		    */
 
-      bytes = 0;
-#endif /* _WIN32 */
-    }
-    else if (bytes == 0)
-      break;
-  }
+                    *bufptr++ = (ipp_uchar_t)attr->value_tag;
+		    *bufptr++ = 0;
+		    *bufptr++ = 0;
+		  }
 
- /*
-  * Return the number of bytes read...
-  */
+                 /*
+		  * Range values consist of a 2-byte length,
+		  * 4-byte lower value, and 4-byte upper value.
+		  *
+		  * Put the 2-byte length and range value data
+		  * into the buffer.
+		  */
 
-  if (tbytes == 0 && bytes < 0)
-    tbytes = -1;
+	          *bufptr++ = 0;
+		  *bufptr++ = 8;
+		  *bufptr++ = (ipp_uchar_t)(value->range.lower >> 24);
+		  *bufptr++ = (ipp_uchar_t)(value->range.lower >> 16);
+		  *bufptr++ = (ipp_uchar_t)(value->range.lower >> 8);
+		  *bufptr++ = (ipp_uchar_t)value->range.lower;
+		  *bufptr++ = (ipp_uchar_t)(value->range.upper >> 24);
+		  *bufptr++ = (ipp_uchar_t)(value->range.upper >> 16);
+		  *bufptr++ = (ipp_uchar_t)(value->range.upper >> 8);
+		  *bufptr++ = (ipp_uchar_t)value->range.upper;
+		}
+		break;
 
-  DEBUG_printf(("8ipp_read_http: Returning " CUPS_LLFMT " bytes", CUPS_LLCAST tbytes));
+	    case IPP_TAG_TEXTLANG :
+	    case IPP_TAG_NAMELANG :
+	        for (i = 0, value = attr->values;
+		     i < attr->num_values;
+		     i ++, value ++)
+		{
+		  if (i)
+		  {
+		   /*
+		    * Arrays and sets are done by sending additional
+		    * values with a zero-length name...
+		    */
 
-  return (tbytes);
-}
+                    if ((IPP_BUF_SIZE - (bufptr - buffer)) < 3 &&
+			(bufptr = ipp_write_flush(wb, bufptr)) == NULL)
+		    {
+		      DEBUG_puts("1ippWriteIO: Could not write IPP attribute...");
+		      return (IPP_STATE_ERROR);
+		    }
 
+                    *bufptr++ = (ipp_uchar_t)attr->value_tag;
+		    *bufptr++ = 0;
+		    *bufptr++ = 0;
+		  }
 
-/*
- * 'ipp_read_file()' - Read IPP data from a file.
- */
+                 /*
+		  * textWithLanguage and nameWithLanguage values consist
+		  * of a 2-byte length for both strings and their
+		  * individual lengths, a 2-byte length for the
+		  * character string, the character string without the
+		  * trailing nul, a 2-byte length for the character
+		  * set string, and the character set string without
+		  * the trailing nul.
+		  */
 
-static ssize_t				/* O - Number of bytes read */
-ipp_read_file(int         *fd,		/* I - File descriptor */
-              ipp_uchar_t *buffer,	/* O - Read buffer */
-	      size_t      length)	/* I - Number of bytes to read */
-{
-#ifdef _WIN32
-  return ((ssize_t)read(*fd, buffer, (unsigned)length));
-#else
-  return (read(*fd, buffer, length));
-#endif /* _WIN32 */
-}
+                  n = 4;
 
+		  if (value->string.language != NULL)
+                    n += (int)strlen(value->string.language);
 
-/*
- * 'ipp_set_error()' - Set a formatted, localized error string.
- */
+		  if (value->string.text != NULL)
+                    n += (int)strlen(value->string.text);
 
-static void
-ipp_set_error(ipp_status_t status,	/* I - Status code */
-              const char   *format,	/* I - Printf-style error string */
-	      ...)			/* I - Additional arguments as needed */
-{
-  va_list	ap;			/* Pointer to additional args */
-  char		buffer[2048];		/* Message buffer */
-  cups_lang_t	*lang = cupsLangDefault();
-					/* Current language */
+                  if (n > (IPP_BUF_SIZE - 2))
+		  {
+		    DEBUG_printf(("1ippWriteIO: text/nameWithLanguage value "
+		                  "too long (%d)", n));
+		    return (IPP_STATE_ERROR);
+                  }
 
+                  if ((int)(IPP_BUF_SIZE - (bufptr - buffer)) < (n + 2) &&
+		      (bufptr = ipp_write_flush(wb, bufptr)) == NULL)
+		  {
+		    DEBUG_puts("1ippWriteIO: Could not write IPP attribute...");
+		    return (IPP_STATE_ERROR);
+		  }
 
-  va_start(ap, format);
-  vsnprintf(buffer, sizeof(buffer), _cupsLangString(lang, format), ap);
-  va_end(ap);
+                 /* Length of entire value */
+	          *bufptr++ = (ipp_uchar_t)(n >> 8);
+		  *bufptr++ = (ipp_uchar_t)n;
 
-  _cupsSetError(status, buffer, 0);
-}
+                 /* Length of language */
+		  if (value->string.language != NULL)
+		    n = (int)strlen(value->string.language);
+		  else
+		    n = 0;
 
+	          *bufptr++ = (ipp_uchar_t)(n >> 8);
+		  *bufptr++ = (ipp_uchar_t)n;
 
-/*
- * 'ipp_set_value()' - Get the value element from an attribute, expanding it as
- *                     needed.
- */
+                 /* Language */
+		  if (n > 0)
+		  {
+		    memcpy(bufptr, value->string.language, (size_t)n);
+		    bufptr += n;
+		  }
 
-static _ipp_value_t *			/* O  - IPP value element or NULL on error */
-ipp_set_value(ipp_t           *ipp,	/* IO - IPP message */
-              ipp_attribute_t **attr,	/* IO - IPP attribute */
-              int             element)	/* I  - Value number (0-based) */
-{
-  ipp_attribute_t	*temp,		/* New attribute pointer */
-			*current,	/* Current attribute in list */
-			*prev;		/* Previous attribute in list */
-  int			alloc_values;	/* Allocated values */
+                 /* Length of text */
+                  if (value->string.text != NULL)
+		    n = (int)strlen(value->string.text);
+		  else
+		    n = 0;
 
+	          *bufptr++ = (ipp_uchar_t)(n >> 8);
+		  *bufptr++ = (ipp_uchar_t)n;
 
- /*
-  * If we are setting an existing value element, return it...
-  */
+                 /* Text */
+		  if (n > 0 &&
+		      (bufptr = ipp_write_data(wb, bufptr, value->string.text,
+		                               (size_t)n)) == NULL)
+		  {
+		    DEBUG_puts("1ippWriteIO: Could not write IPP attribute...");
+		    return (IPP_STATE_ERROR);
+		  }
+		}
+		break;
 
-  temp = *attr;
+            case IPP_TAG_BEGIN_COLLECTION :
+	        for (i = 0, value = attr->values;
+		     i < attr->num_values;
+		     i ++, value ++)
+		{
+		 /*
+		  * Collections are written with the begin-collection
+		  * tag first with a value of 0 length, followed by the
+		  * attributes in the collection, then the end-collection
+		  * value...
+		  */
 
-  if (temp->num_values <= 1)
-    alloc_values = 1;
-  else
-    alloc_values = (temp->num_values + IPP_MAX_VALUES - 1) &
-                   ~(IPP_MAX_VALUES - 1);
+                  if ((IPP_BUF_SIZE - (bufptr - buffer)) < 5 &&
+		      (bufptr = ipp_write_flush(wb, bufptr)) == NULL)
+		  {
+		    DEBUG_puts("1ippWriteIO: Could not write IPP attribute...");
+		    return (IPP_STATE_ERROR);
+		  }
 
-  if (element < alloc_values)
-  {
-    if (element >= temp->num_values)
-      temp->num_values = element + 1;
+		  if (i)
+		  {
+		   /*
+		    * Arrays and sets are done by sending additional
+		    * values with a zero-length name...
+		    */
 
-    return (temp->values + element);
-  }
+                    *bufptr++ = (ipp_uchar_t)attr->value_tag;
+		    *bufptr++ = 0;
+		    *bufptr++ = 0;
+		  }
 
- /*
-  * Otherwise re-allocate the attribute - we allocate in groups of IPP_MAX_VALUE
-  * values when num_values > 1.
-  */
+                 /*
+		  * Write a data length of 0...
+		  */
 
-  if (alloc_values < IPP_MAX_VALUES)
-    alloc_values = IPP_MAX_VALUES;
-  else
-    alloc_values += IPP_MAX_VALUES;
+	          *bufptr++ = 0;
+		  *bufptr++ = 0;
 
-  DEBUG_printf(("4ipp_set_value: Reallocating for up to %d values.",
-                alloc_values));
+                 /*
+		  * Then write the collection attribute...
+		  */
 
- /*
-  * Reallocate memory...
-  */
+                  value->collection->state = IPP_STATE_IDLE;
+                  wb->bufptr               = bufptr;
 
-  if ((temp = realloc(temp, sizeof(ipp_attribute_t) + (size_t)(alloc_values - 1) * sizeof(_ipp_value_t))) == NULL)
-  {
-    _cupsSetHTTPError(HTTP_STATUS_ERROR);
-    DEBUG_puts("4ipp_set_value: Unable to resize attribute.");
-    return (NULL);
-  }
+		  if (ipp_write_io(wb, 1, ipp,
+		                   value->collection) == IPP_STATE_ERROR)
+		  {
+		    DEBUG_puts("1ippWriteIO: Unable to write collection value");
+		    return (IPP_STATE_ERROR);
+		  }
 
- /*
-  * Zero the new memory...
-  */
+		  bufptr = wb->bufptr;
+		}
+		break;
 
-  memset(temp->values + temp->num_values, 0, (size_t)(alloc_values - temp->num_values) * sizeof(_ipp_value_t));
+            default :
+	        for (i = 0, value = attr->values;
+		     i < attr->num_values;
+		     i ++, value ++)
+		{
+		  if (i)
+		  {
+		   /*
+		    * Arrays and sets are done by sending additional
+		    * values with a zero-length name...
+		    */
 
-  if (temp != *attr)
-  {
-   /*
-    * Reset pointers in the list...
-    */
+                    if ((IPP_BUF_SIZE - (bufptr - buffer)) < 3 &&
+			(bufptr = ipp_write_flush(wb, bufptr)) == NULL)
+		    {
+		      DEBUG_puts("1ippWriteIO: Could not write IPP attribute...");
+		      return (IPP_STATE_ERROR);
+		    }
 
-#ifndef __clang_analyzer__
-    DEBUG_printf(("4debug_free: %p %s", (void *)*attr, temp->name));
-#endif /* !__clang_analyzer__ */
-    DEBUG_printf(("4debug_alloc: %p %s %s%s (%d)", (void *)temp, temp->name, temp->num_values > 1 ? "1setOf " : "", ippTagString(temp->value_tag), temp->num_values));
+                    *bufptr++ = (ipp_uchar_t)attr->value_tag;
+		    *bufptr++ = 0;
+		    *bufptr++ = 0;
+		  }
 
-    if (ipp->current == *attr && ipp->prev)
-    {
-     /*
-      * Use current "previous" pointer...
-      */
+                 /*
+		  * An unknown value might some new value that a
+		  * vendor has come up with. It consists of a
+		  * 2-byte length and the bytes in the unknown
+		  * value buffer.
+		  */
 
-      prev = ipp->prev;
-    }
-    else
-    {
-     /*
-      * Find this attribute in the linked list...
-      */
+                  n = value->unknown.length;
 
-      for (prev = NULL, current = ipp->attrs;
-	   current && current != *attr;
-	   prev = current, current = current->next);
+                  if (n > (IPP_BUF_SIZE - 2))
+		  {
+		    DEBUG_printf(("1ippWriteIO: Data length too long (%d)",
+		                  n));
+		    return (IPP_STATE_ERROR);
+		  }
 
-      if (!current)
-      {
-       /*
-	* This is a serious error!
-	*/
+                  if ((int)(IPP_BUF_SIZE - (bufptr - buffer)) < (n + 2) &&
+		      (bufptr = ipp_write_flush(wb, bufptr)) == NULL)
+		  {
+		    DEBUG_puts("1ippWriteIO: Could not write IPP attribute...");
+		    return (IPP_STATE_ERROR);
+		  }
 
-	*attr = temp;
-	_cupsSetError(IPP_STATUS_ERROR_INTERNAL,
-	              _("IPP attribute is not a member of the message."), 1);
-	DEBUG_puts("4ipp_set_value: Unable to find attribute in message.");
-	return (NULL);
-      }
-    }
+                 /* Length of unknown value */
+	          *bufptr++ = (ipp_uchar_t)(n >> 8);
+		  *bufptr++ = (ipp_uchar_t)n;
 
-    if (prev)
-      prev->next = temp;
-    else
-      ipp->attrs = temp;
+                 /* Value */
+		  if (n > 0 &&
+		      (bufptr = ipp_write_data(wb, bufptr, value->unknown.data,
+		                               (size_t)n)) == NULL)
+		  {
+		    DEBUG_puts("1ippWriteIO: Could not write IPP attribute...");
+		    return (IPP_STATE_ERROR);
+		  }
+		}
+		break;
+	  }
 
-    ipp->current = temp;
-    ipp->prev    = prev;
+	 /*
+          * If blocking is disabled and we aren't at the end of the attribute
+          * list, stop once a batch of data has been queued up...
+	  */
 
-    if (ipp->last == *attr)
-      ipp->last = temp;
+          if (!blocking && ipp->current &&
+              (wb->flushed || (bufptr - buffer) >= (IPP_BUF_SIZE / 2) ||
+               wb->num_iov >= (IPP_MAX_IOV / 2)))
+	    break;
+	}
 
-    *attr = temp;
-  }
+	if (ipp->current == NULL)
+	{
+         /*
+	  * Done with all of the attributes; add the end-of-attributes
+	  * tag or end-collection attribute...
+	  */
 
- /*
-  * Return the value element...
-  */
+          if ((IPP_BUF_SIZE - (bufptr - buffer)) < 5 &&
+	      (bufptr = ipp_write_flush(wb, bufptr)) == NULL)
+	  {
+	    DEBUG_puts("1ippWriteIO: Could not write IPP end-tag...");
+	    return (IPP_STATE_ERROR);
+	  }
 
-  if (element >= temp->num_values)
-    temp->num_values = element + 1;
+          if (parent == NULL)
+            *bufptr++ = IPP_TAG_END;
+	  else
+	  {
+            *bufptr++ = IPP_TAG_END_COLLECTION;
+	    *bufptr++ = 0; /* empty name */
+	    *bufptr++ = 0;
+	    *bufptr++ = 0; /* empty value */
+	    *bufptr++ = 0;
+	  }
 
-  return (temp->values + element);
-}
+	  ipp->state = IPP_STATE_DATA;
+	}
+        break;
 
+    case IPP_STATE_DATA :
+        break;
 
-/*
- * 'ipp_write_file()' - Write IPP data to a file.
- */
+    default :
+        break; /* anti-compiler-warning-code */
+  }
 
-static ssize_t				/* O - Number of bytes written */
-ipp_write_file(int         *fd,		/* I - File descriptor */
-               ipp_uchar_t *buffer,	/* I - Data to write */
-               size_t      length)	/* I - Number of bytes to write */
-{
-#ifdef _WIN32
-  return ((ssize_t)write(*fd, buffer, (unsigned)length));
-#else
-  return (write(*fd, buffer, length));
-#endif /* _WIN32 */
+  wb->bufptr = bufptr;
+
+  return (ipp->state);
 }
+
@@ -37,6 +37,9 @@ extern "C" {
  */
 
 #  define _PPD_CACHE_VERSION	10	/* Version number in cache file */
+#  define _PPD_WORKER_MAGIC	0x43555057
+					/* Filter worker job magic ("CUPW") */
+#  define _PPD_WORKER_MAX	1048576	/* Maximum size of a job message */
 
 
 /*
@@ -85,6 +88,15 @@ typedef struct _ppd_cups_uiconsts_s	/**** cupsUIConstraints ****/
   _ppd_cups_uiconst_t *constraints;	/* Constraints */
 } _ppd_cups_uiconsts_t;
 
+typedef struct _ppd_worker_hdr_s	/**** Filter worker job message ****/
+{
+  unsigned	magic;			/* Magic number */
+  int		argc,			/* Number of arguments */
+		envc;			/* Number of environment variables */
+  unsigned	fdmask;			/* Bit N set when file descriptor N is sent */
+  size_t	length;			/* Length of strings that follow */
+} _ppd_worker_hdr_t;
+
 typedef enum _pwg_print_color_mode_e	/**** PWG print-color-mode indices ****/
 {
   _PWG_PRINT_COLOR_MODE_MONOCHROME = 0,	/* print-color-mode=monochrome */
@@ -190,6 +202,8 @@ extern int		_ppdCacheWriteFile(_ppd_cache_t *pc,
 			                   const char *filename, ipp_t *attrs) _CUPS_PRIVATE;
 extern char		*_ppdCreateFromIPP(char *buffer, size_t bufsize, ipp_t *response) _CUPS_PRIVATE;
 extern char		*_ppdCreateFromIPP2(char *buffer, size_t bufsize, ipp_t *response, cups_lang_t *lang) _CUPS_PRIVATE;
+extern int		_ppdFilterWorkerSend(int sock, char *argv[], char *envp[], const int *fds) _CUPS_PRIVATE;
+extern int		_ppdFilterWorkerWait(int *argc, char ***argv, ppd_file_t **ppd) _CUPS_PRIVATE;
 extern void		_ppdFreeLanguages(cups_array_t *languages) _CUPS_PRIVATE;
 extern cups_encoding_t	_ppdGetEncoding(const char *name) _CUPS_PRIVATE;
 extern cups_array_t	*_ppdGetLanguages(ppd_file_t *ppd) _CUPS_PRIVATE;
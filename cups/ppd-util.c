@@ -21,6 +21,8 @@
 #  include <io.h>
 #else
 #  include <unistd.h>
+#  include <sys/socket.h>
+extern char **environ;
 #endif /* _WIN32 || __EMX__ */
 
 
@@ -34,6 +36,393 @@ static int	cups_get_printer_uri(http_t *http, const char *name,
 				     int depth);
 
 
+/*
+ * '_ppdFilterWorkerSend()' - Send a job to a filter worker.
+ *
+ * The arguments, environment, and file descriptors 0 to 6 are sent as a
+ * single message over the worker's control socket.  Entries in "fds" that
+ * are -1 are not sent.
+ */
+
+int					/* O - 0 on success, -1 on error */
+_ppdFilterWorkerSend(int       sock,	/* I - Control socket */
+                     char      *argv[],	/* I - Command-line arguments */
+                     char      *envp[],	/* I - Environment variables */
+                     const int *fds)	/* I - File descriptors 0 to 6 */
+{
+#if defined(_WIN32) || defined(__EMX__)
+  (void)sock;
+  (void)argv;
+  (void)envp;
+  (void)fds;
+
+  return (-1);
+
+#else
+  int			i,		/* Looping var */
+			numfds;		/* Number of file descriptors */
+  char			*strings,	/* String data */
+			*ptr;		/* Pointer into string data */
+  size_t		len;		/* Length of string */
+  ssize_t		bytes;		/* Bytes sent */
+  _ppd_worker_hdr_t	hdr;		/* Message header */
+  struct iovec		iov[2];		/* Message data */
+  struct msghdr		msg;		/* Message */
+  union
+  {
+    struct cmsghdr	cmsg;		/* Control message header */
+    char		buffer[CMSG_SPACE(7 * sizeof(int))];
+					/* Control message buffer */
+  }			control;	/* Control message */
+
+
+ /*
+  * Copy the strings...
+  */
+
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.magic = _PPD_WORKER_MAGIC;
+
+  for (i = 0; argv[i]; i ++)
+    hdr.length += strlen(argv[i]) + 1;
+
+  hdr.argc = i;
+
+  for (i = 0; envp[i]; i ++)
+    hdr.length += strlen(envp[i]) + 1;
+
+  hdr.envc = i;
+
+  if (hdr.length > _PPD_WORKER_MAX)
+  {
+    errno = E2BIG;
+    return (-1);
+  }
+
+  if ((strings = malloc(hdr.length + 1)) == NULL)
+    return (-1);
+
+  for (i = 0, ptr = strings; argv[i]; i ++, ptr += len)
+  {
+    len = strlen(argv[i]) + 1;
+    memcpy(ptr, argv[i], len);
+  }
+
+  for (i = 0; envp[i]; i ++, ptr += len)
+  {
+    len = strlen(envp[i]) + 1;
+    memcpy(ptr, envp[i], len);
+  }
+
+ /*
+  * Add the file descriptors...
+  */
+
+  memset(&control, 0, sizeof(control));
+
+  for (i = 0, numfds = 0; i < 7; i ++)
+  {
+    if (fds[i] >= 0)
+    {
+      hdr.fdmask |= 1U << i;
+      memcpy(CMSG_DATA(&control.cmsg) + (size_t)numfds * sizeof(int), fds + i,
+             sizeof(int));
+      numfds ++;
+    }
+  }
+
+  memset(&msg, 0, sizeof(msg));
+
+  iov[0].iov_base = &hdr;
+  iov[0].iov_len  = sizeof(hdr);
+  iov[1].iov_base = strings;
+  iov[1].iov_len  = hdr.length;
+  msg.msg_iov     = iov;
+  msg.msg_iovlen  = 2;
+
+  if (numfds > 0)
+  {
+    control.cmsg.cmsg_level = SOL_SOCKET;
+    control.cmsg.cmsg_type  = SCM_RIGHTS;
+    control.cmsg.cmsg_len   = CMSG_LEN((size_t)numfds * sizeof(int));
+    msg.msg_control         = control.buffer;
+    msg.msg_controllen      = CMSG_SPACE((size_t)numfds * sizeof(int));
+  }
+
+ /*
+  * Send the whole job at once - the worker is idle so its socket buffer is
+  * empty...
+  */
+
+#  ifdef MSG_NOSIGNAL
+  while ((bytes = sendmsg(sock, &msg, MSG_NOSIGNAL)) < 0 && errno == EINTR);
+#  else
+  while ((bytes = sendmsg(sock, &msg, 0)) < 0 && errno == EINTR);
+#  endif /* MSG_NOSIGNAL */
+
+  free(strings);
+
+  if (bytes < 0)
+    return (-1);
+
+  if ((size_t)bytes < sizeof(hdr) + hdr.length)
+  {
+    errno = EAGAIN;
+    return (-1);
+  }
+
+  return (0);
+#endif /* _WIN32 || __EMX__ */
+}
+
+
+/*
+ * '_ppdFilterWorkerWait()' - Wait for a job when running as a filter worker.
+ *
+ * When the "CUPS_FILTER_WORKER" environment variable is set, the scheduler
+ * started the filter ahead of time with a control socket on the standard
+ * input.  The printer's PPD file and the message catalog are loaded while
+ * waiting, and the arguments, environment, and file descriptors of the job
+ * replace the current ones when it arrives.  "ppd" is set to the loaded PPD
+ * file if it still matches the job, otherwise the filter needs to open the
+ * PPD file itself.  The process exits if the scheduler closes the socket
+ * without sending a job.
+ *
+ * Nothing is done when the filter was started normally.
+ */
+
+int					/* O  - 0 on success, -1 on error */
+_ppdFilterWorkerWait(
+    int        *argc,			/* IO - Number of command-line arguments */
+    char       ***argv,			/* IO - Command-line arguments */
+    ppd_file_t **ppd)			/* O  - PPD file or @code NULL@ */
+{
+#if defined(_WIN32) || defined(__EMX__)
+  (void)argc;
+  (void)argv;
+
+  *ppd = NULL;
+
+  return (0);
+
+#else
+  _cups_globals_t	*cg = _cupsGlobals();
+					/* Global data */
+  int			i, j,		/* Looping vars */
+			fd,		/* File descriptor */
+			numfds = 0,	/* Number of file descriptors */
+			fds[7];		/* File descriptors */
+  char			*strings = NULL,/* String data */
+			*ptr,		/* Pointer into string data */
+			*end,		/* End of string data */
+			**newargv = NULL,
+					/* New arguments */
+			**newenv = NULL;/* New environment */
+  const char		*ppdfile;	/* PPD filename */
+  char			ppdname[1024] = "";
+					/* Loaded PPD filename */
+  struct stat		ppdinfo,	/* Loaded PPD file information */
+			fileinfo;	/* Job PPD file information */
+  ppd_file_t		*warmppd = NULL;/* Loaded PPD file */
+  cups_lang_t		*warmlang;	/* Loaded language */
+  ssize_t		bytes;		/* Bytes received */
+  size_t		total;		/* Total bytes received */
+  _ppd_worker_hdr_t	hdr;		/* Message header */
+  struct iovec		iov;		/* Message data */
+  struct msghdr		msg;		/* Message */
+  struct cmsghdr	*cmsg;		/* Control message */
+  union
+  {
+    struct cmsghdr	cmsg;		/* Control message header */
+    char		buffer[CMSG_SPACE(7 * sizeof(int))];
+					/* Control message buffer */
+  }			control;	/* Control message */
+
+
+  *ppd = NULL;
+
+  if (!getenv("CUPS_FILTER_WORKER"))
+    return (0);
+
+ /*
+  * Load the PPD file and message catalog while we wait...
+  */
+
+  if ((ppdfile = getenv("PPD")) != NULL && !stat(ppdfile, &ppdinfo) &&
+      (warmppd = ppdOpenFile(ppdfile)) != NULL)
+    strlcpy(ppdname, ppdfile, sizeof(ppdname));
+
+  if (!cg->lang_default)
+    cg->lang_default = cupsLangDefault();
+
+  warmlang = cg->lang_default;
+
+ /*
+  * Wait for the job...
+  */
+
+  memset(&msg, 0, sizeof(msg));
+  memset(&control, 0, sizeof(control));
+
+  iov.iov_base       = &hdr;
+  iov.iov_len        = sizeof(hdr);
+  msg.msg_iov        = &iov;
+  msg.msg_iovlen     = 1;
+  msg.msg_control    = control.buffer;
+  msg.msg_controllen = sizeof(control.buffer);
+
+  while ((bytes = recvmsg(0, &msg, 0)) < 0 && errno == EINTR);
+
+  if (bytes == 0)
+    exit(0);
+  else if (bytes < 0)
+    goto error;
+
+  for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+  {
+    if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+      continue;
+
+    for (i = 0; i < (int)((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int)); i ++)
+    {
+      memcpy(&fd, CMSG_DATA(cmsg) + (size_t)i * sizeof(int), sizeof(int));
+
+      if (numfds < 7)
+        fds[numfds ++] = fd;
+      else
+        close(fd);
+    }
+  }
+
+  if (bytes != (ssize_t)sizeof(hdr) || (msg.msg_flags & MSG_CTRUNC) ||
+      hdr.magic != _PPD_WORKER_MAGIC || hdr.argc < 1 || hdr.argc > 100 ||
+      hdr.envc < 0 || hdr.envc > 1000 || hdr.length > _PPD_WORKER_MAX ||
+      hdr.fdmask > 0x7f)
+    goto error;
+
+  for (i = 0, j = 0; i < 7; i ++)
+    if (hdr.fdmask & (1U << i))
+      j ++;
+
+  if (j != numfds)
+    goto error;
+
+ /*
+  * Read and split up the strings...
+  */
+
+  if ((strings = malloc(hdr.length + 1)) == NULL ||
+      (newargv = calloc((size_t)hdr.argc + 1, sizeof(char *))) == NULL ||
+      (newenv = calloc((size_t)hdr.envc + 2, sizeof(char *))) == NULL)
+    goto error;
+
+  for (total = 0; total < hdr.length; total += (size_t)bytes)
+  {
+    if ((bytes = read(0, strings + total, hdr.length - total)) < 0 &&
+        errno == EINTR)
+      bytes = 0;
+    else if (bytes <= 0)
+      goto error;
+  }
+
+  for (i = 0, ptr = strings, end = strings + hdr.length;
+       i < (hdr.argc + hdr.envc);
+       i ++, ptr += strlen(ptr) + 1)
+  {
+    if (ptr >= end || !memchr(ptr, 0, (size_t)(end - ptr)))
+      goto error;
+
+    if (i < hdr.argc)
+      newargv[i] = ptr;
+    else
+      newenv[i - hdr.argc] = ptr;
+  }
+
+#  ifdef __APPLE__
+  for (i = 0; environ[i]; i ++)
+  {
+    if (!strncmp(environ[i], "CFProcessPath=", 14))
+    {
+      newenv[hdr.envc] = environ[i];
+      break;
+    }
+  }
+#  endif /* __APPLE__ */
+
+ /*
+  * Move the job's file descriptors into place, replacing the control
+  * socket...
+  */
+
+  for (i = 0; i < numfds; i ++)
+  {
+    if ((fd = fcntl(fds[i], F_DUPFD, 10)) < 0)
+      goto error;
+
+    close(fds[i]);
+    fds[i] = fd;
+  }
+
+  for (i = 0, j = 0; i < 7; i ++)
+  {
+    if (hdr.fdmask & (1U << i))
+    {
+      dup2(fds[j], i);
+      close(fds[j ++]);
+    }
+    else if (i < 3)
+    {
+      if ((fd = open("/dev/null", i ? O_WRONLY : O_RDONLY)) >= 0 && fd != i)
+      {
+        dup2(fd, i);
+        close(fd);
+      }
+    }
+    else
+      close(i);
+  }
+
+  environ = newenv;
+  *argc   = hdr.argc;
+  *argv   = newargv;
+
+ /*
+  * Use the loaded PPD file and message catalog if they still apply...
+  */
+
+  cupsLangFree(cg->lang_default);
+  cg->lang_default = cupsLangDefault();
+
+  if (warmppd && cg->lang_default == warmlang &&
+      (ppdfile = getenv("PPD")) != NULL && !strcmp(ppdfile, ppdname) &&
+      !stat(ppdfile, &fileinfo) && fileinfo.st_ino == ppdinfo.st_ino &&
+      fileinfo.st_size == ppdinfo.st_size &&
+      fileinfo.st_mtime == ppdinfo.st_mtime)
+    *ppd = warmppd;
+  else
+    ppdClose(warmppd);
+
+  return (0);
+
+ /*
+  * If we get here, the job message was bad...
+  */
+
+  error:
+
+  for (i = 0; i < numfds; i ++)
+    close(fds[i]);
+
+  free(strings);
+  free(newargv);
+  free(newenv);
+  ppdClose(warmppd);
+
+  return (-1);
+#endif /* _WIN32 || __EMX__ */
+}
+
+
 /*
  * 'cupsGetPPD()' - Get the PPD file for a printer on the default server.
  *
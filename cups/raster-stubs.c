@@ -12,6 +12,7 @@
  */
 
 #include "raster-private.h"
+#include "file-private.h"
 
 
 /*
@@ -26,7 +27,9 @@
  */
 
 static ssize_t	cups_read_fd(void *ctx, unsigned char *buf, size_t bytes);
+static ssize_t	cups_read_ring(void *ctx, unsigned char *buf, size_t bytes);
 static ssize_t	cups_write_fd(void *ctx, unsigned char *buf, size_t bytes);
+static ssize_t	cups_write_ring(void *ctx, unsigned char *buf, size_t bytes);
 
 
 
@@ -111,10 +114,23 @@ cupsRasterOpen(int         fd,		/* I - File descriptor */
 					       @code CUPS_RASTER_WRITE_COMPRESSED@,
 					       or @code CUPS_RASTER_WRITE_PWG@ */
 {
+  _cups_ring_t	*ring;			/* Shared memory ring for stdin/stdout */
+
+
   if (mode == CUPS_RASTER_READ)
-    return (_cupsRasterNew(cups_read_fd, (void *)((intptr_t)fd), mode));
+  {
+    if (fd == 0 && (ring = _cupsRingOpen(0)) != NULL)
+      return (_cupsRasterNew(cups_read_ring, ring, mode));
+    else
+      return (_cupsRasterNew(cups_read_fd, (void *)((intptr_t)fd), mode));
+  }
   else
-    return (_cupsRasterNew(cups_write_fd, (void *)((intptr_t)fd), mode));
+  {
+    if (fd == 1 && (ring = _cupsRingOpen(1)) != NULL)
+      return (_cupsRasterNew(cups_write_ring, ring, mode));
+    else
+      return (_cupsRasterNew(cups_write_fd, (void *)((intptr_t)fd), mode));
+  }
 }
 
 
@@ -329,6 +345,26 @@ cups_read_fd(void          *ctx,	/* I - File descriptor as pointer */
 }
 
 
+/*
+ * 'cups_read_ring()' - Read bytes from a shared memory ring.
+ */
+
+static ssize_t				/* O - Bytes read or -1 */
+cups_read_ring(void          *ctx,	/* I - Ring */
+               unsigned char *buf,	/* I - Buffer for read */
+	       size_t        bytes)	/* I - Maximum number of bytes to read */
+{
+  ssize_t	count;			/* Number of bytes read */
+
+
+  while ((count = _cupsRingRead((_cups_ring_t *)ctx, (char *)buf, bytes)) < 0)
+    if (errno != EINTR && errno != EAGAIN)
+      return (-1);
+
+  return (count);
+}
+
+
 /*
  * 'cups_write_fd()' - Write bytes to a file.
  */
@@ -353,3 +389,23 @@ cups_write_fd(void          *ctx,	/* I - File descriptor pointer */
 
   return (count);
 }
+
+
+/*
+ * 'cups_write_ring()' - Write bytes to a shared memory ring.
+ */
+
+static ssize_t				/* O - Bytes written or -1 */
+cups_write_ring(void          *ctx,	/* I - Ring */
+                unsigned char *buf,	/* I - Bytes to write */
+	        size_t        bytes)	/* I - Number of bytes to write */
+{
+  ssize_t	count;			/* Number of bytes written */
+
+
+  while ((count = _cupsRingWrite((_cups_ring_t *)ctx, (char *)buf, bytes)) < 0)
+    if (errno != EINTR && errno != EAGAIN)
+      return (-1);
+
+  return (count);
+}
@@ -50,12 +50,16 @@ extern "C" {
  */
 
 #  define _CUPS_STR_GUARD	0x12344321
+#  define _CUPS_SP_SHARDS	16	/* Number of string pool shards */
+#  define _CUPS_SP_BUCKETS	64	/* Initial hash buckets per shard */
 
 typedef struct _cups_sp_item_s		/**** String Pool Item ****/
 {
 #  ifdef DEBUG_GUARDS
   unsigned int	guard;			/* Guard word */
 #  endif /* DEBUG_GUARDS */
+  struct _cups_sp_item_s *next;		/* Next string in hash bucket */
+  unsigned int	hash;			/* Hash of string */
   unsigned int	ref_count;		/* Reference count */
   char		str[1];			/* String */
 } _cups_sp_item_t;
@@ -178,6 +182,7 @@ extern char	*_cupsStrAlloc(const char *s) _CUPS_PRIVATE;
 extern void	_cupsStrFlush(void) _CUPS_PRIVATE;
 extern void	_cupsStrFree(const char *s) _CUPS_PRIVATE;
 extern char	*_cupsStrRetain(const char *s) _CUPS_PRIVATE;
+extern size_t	_cupsStrShardStatistics(int shard, size_t *strings, size_t *buckets, size_t *max_chain) _CUPS_PRIVATE;
 extern size_t	_cupsStrStatistics(size_t *alloc_bytes, size_t *total_bytes) _CUPS_PRIVATE;
 
 
@@ -19,21 +19,56 @@
 #include <limits.h>
 
 
+/*
+ * Local types...
+ */
+
+typedef struct _cups_sp_shard_s		/**** String pool shard ****/
+{
+  _cups_mutex_t		mutex;		/* Mutex to control access to shard */
+  size_t		num_strings,	/* Number of strings */
+			num_buckets;	/* Number of hash buckets */
+  _cups_sp_item_t	**buckets;	/* Hash buckets */
+} _cups_sp_shard_t;
+
+
+/*
+ * Local macros...
+ *
+ * Reference counts are updated atomically when the compiler supports it so
+ * that _cupsStrRetain does not need to lock the shard.
+ */
+
+#define SP_SHARD_INIT	{ _CUPS_MUTEX_INITIALIZER, 0, 0, NULL }
+
+#ifdef __ATOMIC_RELAXED
+#  define SP_RETAIN(item)	__atomic_add_fetch(&(item)->ref_count, 1, __ATOMIC_RELAXED)
+#  define SP_RELEASE(item)	__atomic_sub_fetch(&(item)->ref_count, 1, __ATOMIC_ACQ_REL)
+#else
+#  define SP_RETAIN(item)	(++ (item)->ref_count)
+#  define SP_RELEASE(item)	(-- (item)->ref_count)
+#endif /* __ATOMIC_RELAXED */
+
+
 /*
  * Local globals...
  */
 
-static _cups_mutex_t	sp_mutex = _CUPS_MUTEX_INITIALIZER;
-					/* Mutex to control access to pool */
-static cups_array_t	*stringpool = NULL;
-					/* Global string pool */
+static _cups_sp_shard_t	sp_shards[_CUPS_SP_SHARDS] =
+{					/* String pool shards */
+  SP_SHARD_INIT, SP_SHARD_INIT, SP_SHARD_INIT, SP_SHARD_INIT,
+  SP_SHARD_INIT, SP_SHARD_INIT, SP_SHARD_INIT, SP_SHARD_INIT,
+  SP_SHARD_INIT, SP_SHARD_INIT, SP_SHARD_INIT, SP_SHARD_INIT,
+  SP_SHARD_INIT, SP_SHARD_INIT, SP_SHARD_INIT, SP_SHARD_INIT
+};
 
 
 /*
  * Local functions...
  */
 
-static int	compare_sp_items(_cups_sp_item_t *a, _cups_sp_item_t *b);
+static unsigned	sp_hash(const char *s);
+static int	sp_resize(_cups_sp_shard_t *shard);
 
 
 /*
@@ -44,8 +79,10 @@ char *					/* O - String pointer */
 _cupsStrAlloc(const char *s)		/* I - String */
 {
   size_t		slen;		/* Length of string */
-  _cups_sp_item_t	*item,		/* String pool item */
-			*key;		/* Search key */
+  unsigned		hash;		/* Hash of string */
+  _cups_sp_shard_t	*shard;		/* String pool shard */
+  _cups_sp_item_t	**bucket,	/* Hash bucket */
+			*item;		/* String pool item */
 
 
  /*
@@ -56,17 +93,17 @@ _cupsStrAlloc(const char *s)		/* I - String */
     return (NULL);
 
  /*
-  * Get the string pool...
+  * Get the string pool shard...
   */
 
-  _cupsMutexLock(&sp_mutex);
+  hash  = sp_hash(s);
+  shard = sp_shards + hash % _CUPS_SP_SHARDS;
 
-  if (!stringpool)
-    stringpool = cupsArrayNew((cups_array_func_t)compare_sp_items, NULL);
+  _cupsMutexLock(&shard->mutex);
 
-  if (!stringpool)
+  if (!shard->buckets && !sp_resize(shard))
   {
-    _cupsMutexUnlock(&sp_mutex);
+    _cupsMutexUnlock(&shard->mutex);
 
     return (NULL);
   }
@@ -75,28 +112,31 @@ _cupsStrAlloc(const char *s)		/* I - String */
   * See if the string is already in the pool...
   */
 
-  key = (_cups_sp_item_t *)(s - offsetof(_cups_sp_item_t, str));
+  bucket = shard->buckets + (hash / _CUPS_SP_SHARDS) % shard->num_buckets;
 
-  if ((item = (_cups_sp_item_t *)cupsArrayFind(stringpool, key)) != NULL)
+  for (item = *bucket; item; item = item->next)
   {
-   /*
-    * Found it, return the cached string...
-    */
+    if (item->hash == hash && !strcmp(item->str, s))
+    {
+     /*
+      * Found it, return the cached string...
+      */
 
-    item->ref_count ++;
+      SP_RETAIN(item);
 
 #ifdef DEBUG_GUARDS
-    DEBUG_printf(("5_cupsStrAlloc: Using string %p(%s) for \"%s\", guard=%08x, "
-                  "ref_count=%d", item, item->str, s, item->guard,
-		  item->ref_count));
+      DEBUG_printf(("5_cupsStrAlloc: Using string %p(%s) for \"%s\", guard=%08x, "
+		    "ref_count=%d", item, item->str, s, item->guard,
+		    item->ref_count));
 
-    if (item->guard != _CUPS_STR_GUARD)
-      abort();
+      if (item->guard != _CUPS_STR_GUARD)
+	abort();
 #endif /* DEBUG_GUARDS */
 
-    _cupsMutexUnlock(&sp_mutex);
+      _cupsMutexUnlock(&shard->mutex);
 
-    return (item->str);
+      return (item->str);
+    }
   }
 
  /*
@@ -107,11 +147,12 @@ _cupsStrAlloc(const char *s)		/* I - String */
   item = (_cups_sp_item_t *)calloc(1, sizeof(_cups_sp_item_t) + slen);
   if (!item)
   {
-    _cupsMutexUnlock(&sp_mutex);
+    _cupsMutexUnlock(&shard->mutex);
 
     return (NULL);
   }
 
+  item->hash      = hash;
   item->ref_count = 1;
   memcpy(item->str, s, slen + 1);
 
@@ -124,12 +165,19 @@ _cupsStrAlloc(const char *s)		/* I - String */
 #endif /* DEBUG_GUARDS */
 
  /*
-  * Add the string to the pool and return it...
+  * Add the string to the pool and return it, growing the hash table as
+  * needed...
   */
 
-  cupsArrayAdd(stringpool, item);
+  item->next = *bucket;
+  *bucket    = item;
+
+  shard->num_strings ++;
 
-  _cupsMutexUnlock(&sp_mutex);
+  if (shard->num_strings > 2 * shard->num_buckets)
+    sp_resize(shard);
+
+  _cupsMutexUnlock(&shard->mutex);
 
   return (item->str);
 }
@@ -175,23 +223,36 @@ _cupsStrDate(char   *buf,		/* I - Buffer */
 void
 _cupsStrFlush(void)
 {
-  _cups_sp_item_t	*item;		/* Current item */
+  int			i;		/* Looping var */
+  size_t		j;		/* Looping var */
+  _cups_sp_shard_t	*shard;		/* Current shard */
+  _cups_sp_item_t	*item,		/* Current item */
+			*next;		/* Next item */
 
 
-  DEBUG_printf(("4_cupsStrFlush: %d strings in array",
-                cupsArrayCount(stringpool)));
+  for (i = _CUPS_SP_SHARDS, shard = sp_shards; i > 0; i --, shard ++)
+  {
+    _cupsMutexLock(&shard->mutex);
 
-  _cupsMutexLock(&sp_mutex);
+    DEBUG_printf(("4_cupsStrFlush: %d strings in shard %d", (int)shard->num_strings, (int)(shard - sp_shards)));
 
-  for (item = (_cups_sp_item_t *)cupsArrayFirst(stringpool);
-       item;
-       item = (_cups_sp_item_t *)cupsArrayNext(stringpool))
-    free(item);
+    for (j = 0; j < shard->num_buckets; j ++)
+    {
+      for (item = shard->buckets[j]; item; item = next)
+      {
+        next = item->next;
+	free(item);
+      }
+    }
 
-  cupsArrayDelete(stringpool);
-  stringpool = NULL;
+    free(shard->buckets);
 
-  _cupsMutexUnlock(&sp_mutex);
+    shard->buckets     = NULL;
+    shard->num_buckets = 0;
+    shard->num_strings = 0;
+
+    _cupsMutexUnlock(&shard->mutex);
+  }
 }
 
 
@@ -282,7 +343,10 @@ _cupsStrFormatd(char         *buf,	/* I - String */
 void
 _cupsStrFree(const char *s)		/* I - String to free */
 {
-  _cups_sp_item_t	*item,		/* String pool item */
+  unsigned		hash;		/* Hash of string */
+  _cups_sp_shard_t	*shard;		/* String pool shard */
+  _cups_sp_item_t	**prev,		/* Pointer to item */
+			*item,		/* String pool item */
 			*key;		/* Search key */
 
 
@@ -294,27 +358,26 @@ _cupsStrFree(const char *s)		/* I - String to free */
     return;
 
  /*
-  * Check the string pool...
-  *
-  * We don't need to lock the mutex yet, as we only want to know if
-  * the stringpool is initialized.  The rest of the code will still
-  * work if it is initialized before we lock...
+  * See if the string is in the pool...
   */
 
-  if (!stringpool)
-    return;
+  hash  = sp_hash(s);
+  shard = sp_shards + hash % _CUPS_SP_SHARDS;
+  key   = (_cups_sp_item_t *)(s - offsetof(_cups_sp_item_t, str));
 
- /*
-  * See if the string is already in the pool...
-  */
+  _cupsMutexLock(&shard->mutex);
 
-  _cupsMutexLock(&sp_mutex);
-
-  key = (_cups_sp_item_t *)(s - offsetof(_cups_sp_item_t, str));
+  if (!shard->buckets)
+  {
+    _cupsMutexUnlock(&shard->mutex);
+    return;
+  }
 
-  if ((item = (_cups_sp_item_t *)cupsArrayFind(stringpool, key)) != NULL &&
-      item == key)
+  for (prev = shard->buckets + (hash / _CUPS_SP_SHARDS) % shard->num_buckets; (item = *prev) != NULL; prev = &item->next)
   {
+    if (item != key)
+      continue;
+
    /*
     * Found it, dereference...
     */
@@ -327,21 +390,22 @@ _cupsStrFree(const char *s)		/* I - String to free */
     }
 #endif /* DEBUG_GUARDS */
 
-    item->ref_count --;
-
-    if (!item->ref_count)
+    if (!SP_RELEASE(item))
     {
      /*
       * Remove and free...
       */
 
-      cupsArrayRemove(stringpool, item);
+      *prev = item->next;
+
+      shard->num_strings --;
 
       free(item);
     }
+    break;
   }
 
-  _cupsMutexUnlock(&sp_mutex);
+  _cupsMutexUnlock(&shard->mutex);
 }
 
 
@@ -372,11 +436,15 @@ _cupsStrRetain(const char *s)		/* I - String to retain */
     }
 #endif /* DEBUG_GUARDS */
 
-    _cupsMutexLock(&sp_mutex);
+#ifdef __ATOMIC_RELAXED
+    SP_RETAIN(item);
+#else
+    _cupsMutexLock(&sp_shards[item->hash % _CUPS_SP_SHARDS].mutex);
 
-    item->ref_count ++;
+    SP_RETAIN(item);
 
-    _cupsMutexUnlock(&sp_mutex);
+    _cupsMutexUnlock(&sp_shards[item->hash % _CUPS_SP_SHARDS].mutex);
+#endif /* __ATOMIC_RELAXED */
   }
 
   return ((char *)s);
@@ -521,6 +589,61 @@ _cupsStrScand(const char   *buf,	/* I - Pointer to number */
 }
 
 
+/*
+ * '_cupsStrShardStatistics()' - Return statistics for a string pool shard.
+ */
+
+size_t					/* O - Number of strings */
+_cupsStrShardStatistics(
+    int    shard,			/* I - Shard number (0 to _CUPS_SP_SHARDS-1) */
+    size_t *strings,			/* O - Number of unique strings */
+    size_t *buckets,			/* O - Number of hash buckets */
+    size_t *max_chain)			/* O - Longest hash chain */
+{
+  size_t		count,		/* Number of strings */
+			chain,		/* Length of current chain */
+			longest,	/* Longest chain */
+			i;		/* Looping var */
+  _cups_sp_shard_t	*sp;		/* String pool shard */
+  _cups_sp_item_t	*item;		/* Current item */
+
+
+  if (strings)
+    *strings = 0;
+  if (buckets)
+    *buckets = 0;
+  if (max_chain)
+    *max_chain = 0;
+
+  if (shard < 0 || shard >= _CUPS_SP_SHARDS)
+    return (0);
+
+  sp = sp_shards + shard;
+
+  _cupsMutexLock(&sp->mutex);
+
+  for (i = 0, count = 0, longest = 0; i < sp->num_buckets; i ++)
+  {
+    for (chain = 0, item = sp->buckets[i]; item; item = item->next, chain ++)
+      count += item->ref_count;
+
+    if (chain > longest)
+      longest = chain;
+  }
+
+  if (strings)
+    *strings = sp->num_strings;
+  if (buckets)
+    *buckets = sp->num_buckets;
+  if (max_chain)
+    *max_chain = longest;
+
+  _cupsMutexUnlock(&sp->mutex);
+
+  return (count);
+}
+
+
 /*
  * '_cupsStrStatistics()' - Return allocation statistics for string pool.
  */
@@ -529,10 +652,13 @@ size_t					/* O - Number of strings */
 _cupsStrStatistics(size_t *alloc_bytes,	/* O - Allocated bytes */
                    size_t *total_bytes)	/* O - Total string bytes */
 {
-  size_t		count,		/* Number of strings */
+  int			i;		/* Looping var */
+  size_t		j,		/* Looping var */
+			count,		/* Number of strings */
 			abytes,		/* Allocated string bytes */
 			tbytes,		/* Total string bytes */
 			len;		/* Length of string */
+  _cups_sp_shard_t	*shard;		/* Current shard */
   _cups_sp_item_t	*item;		/* Current item */
 
 
@@ -540,24 +666,27 @@ _cupsStrStatistics(size_t *alloc_bytes,	/* O - Allocated bytes */
   * Loop through strings in pool, counting everything up...
   */
 
-  _cupsMutexLock(&sp_mutex);
-
-  for (count = 0, abytes = 0, tbytes = 0,
-           item = (_cups_sp_item_t *)cupsArrayFirst(stringpool);
-       item;
-       item = (_cups_sp_item_t *)cupsArrayNext(stringpool))
+  for (i = _CUPS_SP_SHARDS, shard = sp_shards, count = 0, abytes = 0, tbytes = 0; i > 0; i --, shard ++)
   {
-   /*
-    * Count allocated memory, using a 64-bit aligned buffer as a basis.
-    */
+    _cupsMutexLock(&shard->mutex);
 
-    count  += item->ref_count;
-    len    = (strlen(item->str) + 8) & (size_t)~7;
-    abytes += sizeof(_cups_sp_item_t) + len;
-    tbytes += item->ref_count * len;
-  }
+    for (j = 0; j < shard->num_buckets; j ++)
+    {
+      for (item = shard->buckets[j]; item; item = item->next)
+      {
+       /*
+	* Count allocated memory, using a 64-bit aligned buffer as a basis.
+	*/
+
+	count  += item->ref_count;
+	len    = (strlen(item->str) + 8) & (size_t)~7;
+	abytes += sizeof(_cups_sp_item_t) + len;
+	tbytes += item->ref_count * len;
+      }
+    }
 
-  _cupsMutexUnlock(&sp_mutex);
+    _cupsMutexUnlock(&shard->mutex);
+  }
 
  /*
   * Return values...
@@ -754,12 +883,62 @@ _cups_strlcpy(char       *dst,		/* O - Destination string */
 
 
 /*
- * 'compare_sp_items()' - Compare two string pool items...
+ * 'sp_hash()' - Compute the hash of a string.
  */
 
-static int				/* O - Result of comparison */
-compare_sp_items(_cups_sp_item_t *a,	/* I - First item */
-                 _cups_sp_item_t *b)	/* I - Second item */
+static unsigned				/* O - Hash value */
+sp_hash(const char *s)			/* I - String */
 {
-  return (strcmp(a->str, b->str));
+  unsigned	hash = 2166136261U;	/* FNV-1a hash */
+
+
+  while (*s)
+  {
+    hash ^= (unsigned char)*s++;
+    hash *= 16777619U;
+  }
+
+  return (hash);
+}
+
+
+/*
+ * 'sp_resize()' - Allocate or grow the hash table for a shard.
+ *
+ * The caller must hold the shard mutex.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+sp_resize(_cups_sp_shard_t *shard)	/* I - String pool shard */
+{
+  size_t		i,		/* Looping var */
+			num_buckets;	/* New number of buckets */
+  _cups_sp_item_t	**buckets,	/* New buckets */
+			**bucket,	/* Bucket for item */
+			*item,		/* Current item */
+			*next;		/* Next item */
+
+
+  num_buckets = shard->num_buckets ? 2 * shard->num_buckets : _CUPS_SP_BUCKETS;
+
+  if ((buckets = calloc(num_buckets, sizeof(_cups_sp_item_t *))) == NULL)
+    return (0);
+
+  for (i = 0; i < shard->num_buckets; i ++)
+  {
+    for (item = shard->buckets[i]; item; item = next)
+    {
+      bucket     = buckets + (item->hash / _CUPS_SP_SHARDS) % num_buckets;
+      next       = item->next;
+      item->next = *bucket;
+      *bucket    = item;
+    }
+  }
+
+  free(shard->buckets);
+
+  shard->buckets     = buckets;
+  shard->num_buckets = num_buckets;
+
+  return (1);
 }
@@ -15,7 +15,7 @@
 
 #include "string-private.h"
 #include "debug-private.h"
-#include "file.h"
+#include "file-private.h"
 #include "dir.h"
 #include <stdlib.h>
 #include <time.h>
@@ -23,6 +23,7 @@
 #  include <io.h>
 #else
 #  include <unistd.h>
+#  include <sys/wait.h>
 #endif /* _WIN32 */
 #include <fcntl.h>
 
@@ -34,6 +35,9 @@
 static int	count_lines(cups_file_t *fp);
 static int	random_tests(void);
 static int	read_write_tests(int compression);
+#ifndef _WIN32
+static int	ring_tests(void);
+#endif /* !_WIN32 */
 
 
 /*
@@ -113,6 +117,12 @@ main(int  argc,				/* I - Number of command-line arguments */
 
       puts("PASS");
     }
+
+   /*
+    * Test shared memory rings between processes...
+    */
+
+    status += ring_tests();
 #endif /* !_WIN32 */
 
    /*
@@ -910,3 +920,128 @@ read_write_tests(int compression)	/* I - Use compression? */
 
   return (status);
 }
+
+
+#ifndef _WIN32
+/*
+ * 'ring_tests()' - Do shared memory ring tests.
+ */
+
+static int				/* O - Status */
+ring_tests(void)
+{
+  int		fds[2],			/* Pipe */
+		ringfd;			/* Ring file descriptor */
+  pid_t		reader,			/* Reader process */
+		writer;			/* Writer process */
+  int		rstatus,		/* Reader exit status */
+		wstatus;		/* Writer exit status */
+  cups_file_t	*fp;			/* File */
+  int		i;			/* Looping var */
+  char		line[1024],		/* Line buffer */
+		expected[1024];		/* Expected line */
+
+
+  fputs("\n_cupsRingCreate: ", stdout);
+
+  if (pipe(fds))
+  {
+    printf("FAIL (%s)\n", strerror(errno));
+    return (1);
+  }
+
+  if ((ringfd = _cupsRingCreate(fds[0], 65536)) < 0)
+  {
+    close(fds[0]);
+    close(fds[1]);
+
+    if (errno == ENOSYS)
+    {
+      puts("SKIP (not supported)");
+      return (0);
+    }
+
+    printf("FAIL (%s)\n", strerror(errno));
+    return (1);
+  }
+
+  puts("PASS");
+  fputs("cupsFileStdout(ring) -> cupsFileStdin(ring): ", stdout);
+  fflush(stdout);
+
+ /*
+  * The writer starts before the reader attaches so that the first lines go
+  * through the pipe...
+  */
+
+  if ((writer = fork()) == 0)
+  {
+    dup2(fds[1], 1);
+    close(fds[0]);
+    close(fds[1]);
+    if (ringfd != 6)
+    {
+      dup2(ringfd, 6);
+      close(ringfd);
+    }
+    setenv("CUPS_STDOUT_RING", "6", 1);
+
+    fp = cupsFileStdout();
+
+    for (i = 0; i < 200000; i ++)
+      cupsFilePrintf(fp, "%06d The quick brown fox jumps over the lazy dog.\n", i);
+
+    cupsFileFlush(fp);
+    _exit(0);
+  }
+
+  if ((reader = fork()) == 0)
+  {
+    dup2(fds[0], 0);
+    close(fds[0]);
+    close(fds[1]);
+    if (ringfd != 5)
+    {
+      dup2(ringfd, 5);
+      close(ringfd);
+    }
+    setenv("CUPS_STDIN_RING", "5", 1);
+
+    usleep(100000);
+
+    fp = cupsFileStdin();
+
+    for (i = 0; cupsFileGets(fp, line, sizeof(line)); i ++)
+    {
+      snprintf(expected, sizeof(expected), "%06d The quick brown fox jumps over the lazy dog.", i);
+      if (strcmp(line, expected))
+        _exit(1);
+    }
+
+    _exit(i == 200000 ? 0 : 2);
+  }
+
+  close(fds[0]);
+  close(fds[1]);
+  close(ringfd);
+
+  if (writer < 0 || reader < 0)
+  {
+    puts("FAIL (unable to fork)");
+    return (1);
+  }
+
+  waitpid(writer, &wstatus, 0);
+  waitpid(reader, &rstatus, 0);
+
+  if (wstatus || rstatus)
+  {
+    printf("FAIL (writer status %d, reader status %d)\n", wstatus, rstatus);
+    return (1);
+  }
+
+  puts("PASS");
+
+  return (0);
+}
+#endif /* !_WIN32 */
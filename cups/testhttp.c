@@ -209,6 +209,16 @@ static const char * const base64_tests[][2] =
 			};
 
 
+/*
+ * Local functions...
+ */
+
+#ifdef HAVE_SPLICE
+static http_t	*splice_accept(int lfd, int port, size_t length, http_t **client);
+static int	test_read_splice(void);
+#endif /* HAVE_SPLICE */
+
+
 /*
  * 'main()' - Main entry.
  */
@@ -548,6 +558,15 @@ main(int  argc,				/* I - Number of command-line arguments */
     else
       printf("PASS (%s)\n", buffer);
 
+#ifdef HAVE_SPLICE
+   /*
+    * _httpReadSplice()
+    */
+
+    if (!test_read_splice())
+      failures ++;
+#endif /* HAVE_SPLICE */
+
    /*
     * Show a summary and return...
     */
@@ -944,3 +963,232 @@ main(int  argc,				/* I - Number of command-line arguments */
 
   return (0);
 }
+
+
+#ifdef HAVE_SPLICE
+/*
+ * 'splice_accept()' - Connect to the test listener and read the header of a
+ *                     POST request with a Content-Length body.
+ */
+
+static http_t *				/* O - Server side of connection or NULL */
+splice_accept(int    lfd,		/* I - Listen socket */
+              int    port,		/* I - Port number */
+              size_t length,		/* I - Length of body */
+              http_t **client)		/* O - Client side of connection */
+{
+  http_t	*server;		/* Server side of connection */
+  http_status_t	status;			/* Request status */
+  char		header[1024],		/* Request header */
+		uri[1024];		/* Request URI */
+
+
+  if ((*client = httpConnect2("127.0.0.1", port, NULL, AF_INET, HTTP_ENCRYPTION_NEVER, 1, 30000, NULL)) == NULL)
+    return (NULL);
+
+  snprintf(header, sizeof(header), "POST /test HTTP/1.1\r\nHost: localhost\r\nContent-Length: " CUPS_LLFMT "\r\n\r\n", CUPS_LLCAST length);
+
+  if (write(httpGetFd(*client), header, strlen(header)) < 0 || (server = httpAcceptConnection(lfd, 1)) == NULL)
+    return (NULL);
+
+  if (httpReadRequest(server, uri, sizeof(uri)) != HTTP_STATE_POST)
+  {
+    httpClose(server);
+    return (NULL);
+  }
+
+  while ((status = httpUpdate(server)) == HTTP_STATUS_CONTINUE);
+
+  if (status != HTTP_STATUS_OK || httpGetState(server) != HTTP_STATE_POST_RECV || httpGetLength2(server) != (off_t)length)
+  {
+    httpClose(server);
+    return (NULL);
+  }
+
+  return (server);
+}
+
+
+/*
+ * 'test_read_splice()' - Test moving a request body to a file with splice().
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+test_read_splice(void)
+{
+  int		ret = 0,		/* Return value */
+		lfd,			/* Listen socket */
+		fd = -1,		/* Document file */
+		port,			/* Listen port */
+		calls = 0,		/* Number of splice calls */
+		pipefds[2] = { -1, -1 };/* Splice pipe */
+  http_addrlist_t *addrlist;		/* Loopback address */
+  http_addr_t	addr;			/* Bound address */
+  socklen_t	addrlen = sizeof(addr);	/* Length of bound address */
+  http_t	*client = NULL,		/* Client side of connection */
+		*server = NULL;		/* Server side of connection */
+  char		filename[1024],		/* Document filename */
+		buffer[8192];		/* Read buffer */
+  unsigned char	*data,			/* Body data */
+		*copy;			/* Spooled copy of body data */
+  size_t	i,			/* Looping var */
+		sent,			/* Bytes sent */
+		received;		/* Bytes received */
+  ssize_t	bytes;			/* Bytes moved */
+  const size_t	length = 262144;	/* Length of body */
+
+
+  fputs("_httpReadSplice(): ", stdout);
+
+  if ((data = malloc(2 * length)) == NULL)
+  {
+    puts("FAIL (unable to allocate memory)");
+    return (0);
+  }
+
+  copy        = data + length;
+  filename[0] = '\0';
+
+  for (i = 0; i < length; i ++)
+    data[i] = (unsigned char)(i ^ (i >> 8));
+
+  if ((addrlist = httpAddrGetList("127.0.0.1", AF_INET, "0")) == NULL ||
+      (lfd = httpAddrListen(&(addrlist->addr), 0)) < 0 ||
+      getsockname(lfd, (struct sockaddr *)&addr, &addrlen))
+  {
+    printf("FAIL (unable to listen: %s)\n", cupsLastErrorString());
+    httpAddrFreeList(addrlist);
+    free(data);
+    return (0);
+  }
+
+  port = httpAddrPort(&addr);
+
+  if (pipe(pipefds) || (fd = cupsTempFd(filename, sizeof(filename))) < 0)
+  {
+    printf("FAIL (%s)\n", strerror(errno));
+    goto done;
+  }
+
+  if ((server = splice_accept(lfd, port, length, &client)) == NULL)
+  {
+    puts("FAIL (unable to read request header)");
+    goto done;
+  }
+
+ /*
+  * Send the body in pieces and move each piece with several small splice
+  * calls, reading normally whenever splice() cannot be used...
+  */
+
+  for (sent = 0, received = 0; sent < length;)
+  {
+    if (write(httpGetFd(client), data + sent, 16384) != 16384)
+    {
+      printf("FAIL (unable to send body: %s)\n", strerror(errno));
+      goto done;
+    }
+
+    sent += 16384;
+
+    while (received < sent)
+    {
+      if (!httpWait(server, 10000))
+      {
+        printf("FAIL (timeout after " CUPS_LLFMT " bytes)\n", CUPS_LLCAST received);
+        goto done;
+      }
+
+      if ((bytes = _httpReadSplice(server, fd, pipefds, 4096)) > 0)
+      {
+        calls ++;
+      }
+      else if (bytes < 0)
+      {
+        printf("FAIL (splice error: %s)\n", strerror(httpError(server)));
+        goto done;
+      }
+      else if ((bytes = httpRead2(server, buffer, sizeof(buffer))) <= 0 ||
+               write(fd, buffer, (size_t)bytes) != bytes)
+      {
+        printf("FAIL (unable to read body after " CUPS_LLFMT " bytes)\n", CUPS_LLCAST received);
+        goto done;
+      }
+
+      received += (size_t)bytes;
+    }
+  }
+
+  if (received != length || calls < 2)
+  {
+    printf("FAIL (got " CUPS_LLFMT " bytes with %d splice calls)\n", CUPS_LLCAST received, calls);
+    goto done;
+  }
+
+  if (httpGetState(server) != HTTP_STATE_POST_SEND)
+  {
+    printf("FAIL (state %s at end of content)\n", httpStateString(httpGetState(server)));
+    goto done;
+  }
+
+  if (lseek(fd, 0, SEEK_SET) || read(fd, copy, length) != (ssize_t)length || memcmp(data, copy, length))
+  {
+    puts("FAIL (file does not match body)");
+    goto done;
+  }
+
+ /*
+  * Moving data to a file that cannot be written must fail...
+  */
+
+  httpClose(server);
+  httpClose(client);
+  close(fd);
+
+  client = NULL;
+
+  if ((fd = open(filename, O_RDONLY)) < 0 || (server = splice_accept(lfd, port, 4096, &client)) == NULL)
+  {
+    puts("FAIL (unable to read second request header)");
+    goto done;
+  }
+
+  if (write(httpGetFd(client), data, 4096) != 4096 || !httpWait(server, 10000))
+  {
+    puts("FAIL (unable to send second body)");
+    goto done;
+  }
+
+  if ((bytes = _httpReadSplice(server, fd, pipefds, 4096)) != -1 || !httpError(server))
+  {
+    printf("FAIL (got " CUPS_LLFMT " for a read-only file)\n", CUPS_LLCAST bytes);
+    goto done;
+  }
+
+  printf("PASS (%d splice calls)\n", calls);
+  ret = 1;
+
+  done:
+
+  httpClose(server);
+  httpClose(client);
+  httpAddrClose(NULL, lfd);
+  httpAddrFreeList(addrlist);
+
+  if (fd >= 0)
+    close(fd);
+
+  if (filename[0])
+    unlink(filename);
+
+  if (pipefds[0] >= 0)
+  {
+    close(pipefds[0]);
+    close(pipefds[1]);
+  }
+
+  free(data);
+
+  return (ret);
+}
+#endif /* HAVE_SPLICE */
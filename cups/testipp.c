@@ -20,6 +20,8 @@
 #else
 #  include <unistd.h>
 #  include <fcntl.h>
+#  include <sys/wait.h>
+#  include <netinet/in.h>
 #endif /* _WIN32 */
 
 
@@ -748,6 +750,473 @@ main(int  argc,			/* I - Number of command-line arguments */
 
     ippDelete(request);
 
+   /*
+    * Test the attribute name index with a large message...
+    */
+
+    for (i = 0; i < 2; i ++)
+    {
+      int		j,		/* Looping var */
+			k;		/* Lookup pass */
+      char		aname[256];	/* Attribute name */
+      ipp_attribute_t	*dup = NULL;	/* Duplicate attribute */
+      const char	*error = NULL;	/* First error, if any */
+
+      printf("ippFindAttribute(indexed%s): ", i ? ", arena" : "");
+
+      request = i ? _ippNewArena() : ippNew();
+
+      for (j = 0; j < 100; j ++)
+      {
+        snprintf(aname, sizeof(aname), "test-attr-%d", j);
+        ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER, aname, j);
+      }
+
+      ippAddSeparator(request);
+      ippAddString(request, IPP_TAG_JOB, IPP_TAG_KEYWORD, "test-attr-10", NULL, "dup");
+
+      for (k = 0; k < 2 && !error; k ++)
+      {
+        for (j = 0; j < 100 && !error; j ++)
+        {
+          snprintf(aname, sizeof(aname), "TEST-attr-%d", j);
+          if ((attr = ippFindAttribute(request, aname, IPP_TAG_INTEGER)) == NULL || ippGetInteger(attr, 0) != j)
+            error = "wrong integer attribute";
+        }
+      }
+
+      if (!error && ((dup = ippFindAttribute(request, "test-attr-10", IPP_TAG_KEYWORD)) == NULL || strcmp(ippGetString(dup, 0, NULL), "dup")))
+        error = "duplicate not found";
+      else if (!error && ((attr = ippFindAttribute(request, "test-attr-10", IPP_TAG_ZERO)) == NULL || ippGetValueTag(attr) != IPP_TAG_INTEGER || ippFindNextAttribute(request, "test-attr-10", IPP_TAG_ZERO) != dup || ippFindNextAttribute(request, "test-attr-10", IPP_TAG_ZERO)))
+        error = "wrong ippFindNextAttribute result";
+      else if (!error && ippFindAttribute(request, "test-attr-12", IPP_TAG_KEYWORD))
+        error = "found attribute with wrong type";
+
+      if (!error)
+      {
+        attr = ippFindAttribute(request, "test-attr-10", IPP_TAG_INTEGER);
+        ippDeleteAttribute(request, attr);
+        attr = ippFindAttribute(request, "test-attr-11", IPP_TAG_INTEGER);
+        ippSetInteger(request, &attr, 1, 11);
+        attr = ippFindAttribute(request, "test-attr-12", IPP_TAG_INTEGER);
+        ippSetName(request, &attr, "test-attr-renamed");
+
+        if ((attr = ippFindAttribute(request, "test-attr-10", IPP_TAG_ZERO)) != dup)
+          error = "wrong attribute after delete";
+        else if ((attr = ippFindAttribute(request, "test-attr-11", IPP_TAG_INTEGER)) == NULL || ippGetCount(attr) != 2)
+          error = "wrong attribute after resize";
+        else if (ippFindAttribute(request, "test-attr-12", IPP_TAG_ZERO) || !ippFindAttribute(request, "test-attr-renamed", IPP_TAG_INTEGER))
+          error = "wrong attribute after rename";
+      }
+
+      if (!error)
+      {
+        ipp_t	*copy = i ? _ippNewArena() : ippNew();
+					/* Copy of message */
+
+        data.rpos    = 0;
+        data.wused   = 0;
+        data.wsize   = sizeof(buffer);
+        data.wbuffer = buffer;
+
+        while ((state = ippWriteIO(&data, (ipp_iocb_t)write_cb, 1, NULL, request)) != IPP_STATE_DATA)
+          if (state == IPP_STATE_ERROR)
+	    break;
+
+        if (state == IPP_STATE_DATA)
+        {
+          while ((state = ippReadIO(&data, (ipp_iocb_t)read_cb, 1, NULL, copy)) != IPP_STATE_DATA)
+            if (state == IPP_STATE_ERROR)
+	      break;
+        }
+
+        if (state != IPP_STATE_DATA || ippLength(copy) != ippLength(request))
+          error = "wrong message after write and read";
+        else if ((attr = ippFindAttribute(copy, "test-attr-11", IPP_TAG_INTEGER)) == NULL || ippGetCount(attr) != 2 || ippGetInteger(attr, 1) != 11)
+          error = "wrong attribute after write and read";
+
+        ippDelete(copy);
+      }
+
+      for (j = 0; j < 100 && !error; j ++)
+      {
+        snprintf(aname, sizeof(aname), "test-attr-%d", j);
+        if ((attr = ippFindAttribute(request, aname, IPP_TAG_INTEGER)) != NULL)
+          ippDeleteAttribute(request, attr);
+      }
+
+      if (!error && (ippFindAttribute(request, "test-attr-99", IPP_TAG_ZERO) || ippFindAttribute(request, "test-attr-10", IPP_TAG_ZERO) != dup))
+        error = "wrong attribute after deleting all";
+
+      if (error)
+      {
+        printf("FAIL (%s)\n", error);
+        status = 1;
+      }
+      else
+        puts("PASS");
+
+      ippDelete(request);
+    }
+
+   /*
+    * Test parsing a message in place...
+    */
+
+    fputs("_ippNewFromBuffer: ", stdout);
+
+    if ((request = _ippNewFromBuffer(memcpy(malloc(sizeof(collection)), collection, sizeof(collection)), sizeof(collection))) == NULL)
+    {
+      printf("FAIL (%s)\n", cupsLastErrorString());
+      status = 1;
+    }
+    else
+    {
+      const char	*error = NULL;	/* First error, if any */
+      ipp_t		*media_size;	/* media-size collection */
+
+      if (ippLength(request) != sizeof(collection))
+        error = "wrong ippLength()";
+      else if ((attr = ippFindAttribute(request, "printer-uri", IPP_TAG_URI)) == NULL || strcmp(ippGetString(attr, 0, NULL), "ipp://localhost/printers/foo"))
+        error = "wrong printer-uri";
+      else if ((attr = ippFindAttribute(request, "media-col/media-color", IPP_TAG_KEYWORD)) == NULL || ippGetCount(attr) != 1 || strcmp(ippGetString(attr, 0, NULL), "blue"))
+        error = "wrong media-color";
+      else if ((media_col = ippFindAttribute(request, "media-col", IPP_TAG_BEGIN_COLLECTION)) == NULL || ippGetCount(media_col) != 2 || (attr = ippFindAttribute(ippGetCollection(media_col, 1), "media-size", IPP_TAG_BEGIN_COLLECTION)) == NULL || (media_size = ippGetCollection(attr, 0)) == NULL || (attr = ippFindAttribute(media_size, "y-dimension", IPP_TAG_INTEGER)) == NULL || ippGetInteger(attr, 0) != 29700)
+        error = "wrong media-col";
+
+      if (!error)
+      {
+       /*
+        * Keep a reference to a collection after the message is gone, then
+        * change and delete values that point into the buffer...
+        */
+
+        ippAddCollection(cols[0] = ippNew(), IPP_TAG_JOB, "media-size", media_size);
+
+        attr = ippFindAttribute(request, "printer-uri", IPP_TAG_URI);
+        ippSetString(request, &attr, 0, "ipp://localhost/printers/bar");
+        ippDeleteAttribute(request, ippFindAttribute(request, "attributes-natural-language", IPP_TAG_ZERO));
+
+        if ((attr = ippFindAttribute(request, "printer-uri", IPP_TAG_URI)) == NULL || strcmp(ippGetString(attr, 0, NULL), "ipp://localhost/printers/bar"))
+          error = "wrong printer-uri after ippSetString";
+
+        ippDelete(request);
+        request = NULL;
+
+        if (!error && ((attr = ippFindAttribute(cols[0], "media-size/x-dimension", IPP_TAG_INTEGER)) == NULL || ippGetInteger(attr, 0) != 21000))
+          error = "wrong media-size after ippDelete";
+
+        ippDelete(cols[0]);
+      }
+
+      if (error)
+      {
+        printf("FAIL (%s)\n", error);
+        status = 1;
+      }
+      else
+        puts("PASS");
+
+      ippDelete(request);
+    }
+
+   /*
+    * Test changing a message parsed in place over and over, like the
+    * scheduler does with the attributes of a loaded job...
+    */
+
+    fputs("_ippNewFromBuffer(set attributes): ", stdout);
+
+    request = ippNew();
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, "ipp://localhost/printers/foo");
+    ippAddString(request, IPP_TAG_JOB, IPP_TAG_NAME, "job-name", NULL, "Original Name");
+    ippAddOctetString(request, IPP_TAG_JOB, "document-password", "secret", 6);
+    ippAddInteger(request, IPP_TAG_JOB, IPP_TAG_ENUM, "job-state", IPP_JSTATE_HELD);
+
+    data.rpos    = 0;
+    data.wused   = 0;
+    data.wsize   = sizeof(buffer);
+    data.wbuffer = buffer;
+
+    while ((state = ippWriteIO(&data, (ipp_iocb_t)write_cb, 1, NULL, request)) != IPP_STATE_DATA)
+      if (state == IPP_STATE_ERROR)
+        break;
+
+    ippDelete(request);
+
+    if (state != IPP_STATE_DATA || (request = _ippNewFromBuffer(memcpy(malloc(data.wused), buffer, data.wused), data.wused)) == NULL)
+    {
+      printf("FAIL (%s)\n", cupsLastErrorString());
+      status = 1;
+    }
+    else
+    {
+      int		j;		/* Looping var */
+      char		value[256];	/* Attribute value */
+      size_t		arena = 0;	/* Bytes of arena memory */
+      _ipp_chunk_t	*chunk;		/* Current arena chunk */
+      const char	*error = NULL;	/* First error, if any */
+
+      ippDeleteAttribute(request, ippFindAttribute(request, "document-password", IPP_TAG_STRING));
+
+      for (j = 0; j < 10000; j ++)
+      {
+        snprintf(value, sizeof(value), "Job name %d, long enough to need some memory of its own", j);
+
+        attr = ippFindAttribute(request, "job-name", IPP_TAG_NAME);
+        ippSetString(request, &attr, 0, value);
+
+        ippDeleteAttribute(request, ippFindAttribute(request, "job-printer-state-message", IPP_TAG_TEXT));
+        ippAddString(request, IPP_TAG_JOB, IPP_TAG_TEXT, "job-printer-state-message", NULL, value);
+
+        attr = ippFindAttribute(request, "job-state", IPP_TAG_ENUM);
+        ippSetInteger(request, &attr, 0, j & 1 ? IPP_JSTATE_PROCESSING : IPP_JSTATE_HELD);
+      }
+
+      for (chunk = request->arena; chunk; chunk = chunk->next)
+        arena += (size_t)(chunk->end - (char *)(chunk + 1));
+
+      if ((attr = ippFindAttribute(request, "job-name", IPP_TAG_NAME)) == NULL || strcmp(ippGetString(attr, 0, NULL), value))
+        error = "wrong job-name";
+      else if ((attr = ippFindAttribute(request, "job-printer-state-message", IPP_TAG_TEXT)) == NULL || strcmp(ippGetString(attr, 0, NULL), value) || ippFindNextAttribute(request, "job-printer-state-message", IPP_TAG_TEXT))
+        error = "wrong job-printer-state-message";
+      else if ((attr = ippFindAttribute(request, "printer-uri", IPP_TAG_URI)) == NULL || strcmp(ippGetString(attr, 0, NULL), "ipp://localhost/printers/foo"))
+        error = "wrong printer-uri";
+      else if (ippFindAttribute(request, "document-password", IPP_TAG_ZERO))
+        error = "document-password not deleted";
+      else if (arena > 65536)
+        error = "replaced values were not freed";
+
+      if (error)
+      {
+        printf("FAIL (%s)\n", error);
+        status = 1;
+      }
+      else
+        puts("PASS");
+
+      ippDelete(request);
+    }
+
+   /*
+    * Test copying nameWithLanguage and textWithLanguage values...
+    */
+
+    {
+      const char	*language;	/* Language of value */
+
+      fputs("ippCopyAttribute(nameWithLanguage, textWithLanguage): ", stdout);
+
+      request = ippNew();
+      ippAddString(request, IPP_TAG_JOB, IPP_TAG_NAMELANG, "job-name", "en", "Hello");
+      ippAddString(request, IPP_TAG_JOB, IPP_TAG_TEXTLANG, "job-message-from-operator", "fr", "Bonjour");
+
+      cols[0] = ippNew();
+      for (attr = ippFirstAttribute(request); attr; attr = ippNextAttribute(request))
+        ippCopyAttribute(cols[0], attr, 0);
+
+      ippDelete(request);
+      request = NULL;
+
+      if ((attr = ippFindAttribute(cols[0], "job-name", IPP_TAG_NAMELANG)) == NULL || !ippGetString(attr, 0, &language) || strcmp(ippGetString(attr, 0, NULL), "Hello") || !language || strcmp(language, "en"))
+      {
+        puts("FAIL (wrong job-name)");
+        status = 1;
+      }
+      else if ((attr = ippFindAttribute(cols[0], "job-message-from-operator", IPP_TAG_TEXTLANG)) == NULL || !ippGetString(attr, 0, &language) || strcmp(ippGetString(attr, 0, NULL), "Bonjour") || !language || strcmp(language, "fr"))
+      {
+        puts("FAIL (wrong job-message-from-operator)");
+        status = 1;
+      }
+      else
+        puts("PASS");
+
+      ippDelete(cols[0]);
+    }
+
+#ifndef _WIN32
+   /*
+    * Test writing a large message to a HTTP connection, which queues long
+    * values in place and sends them in batches, against the copied output of
+    * a plain write callback...
+    */
+
+    for (i = 0; i < 2; i ++)
+    {
+      int		j,		/* Looping var */
+			lfd,		/* Listen socket */
+			pstatus;	/* Exit status of writer */
+      struct sockaddr_in laddr;		/* Listen address */
+      socklen_t		laddrlen;	/* Length of listen address */
+      pid_t		pid;		/* Writer process */
+      http_t		*http;		/* Server side of connection */
+      ipp_t		*col;		/* Collection value */
+      char		aname[256],	/* Attribute name */
+			value[4096],	/* Attribute value */
+			uri[1024];	/* Request URI */
+      const char	*values[3];	/* Attribute values */
+      ipp_uchar_t	*expected,	/* Expected message data */
+			*received;	/* Received message data */
+      size_t		explen,		/* Length of expected data */
+			reclen = 0;	/* Length of received data */
+      ssize_t		bytes;		/* Bytes read */
+      const char	*error = NULL;	/* First error, if any */
+
+      printf("ippWriteIO(http, %s): ", i ? "length, non-blocking" : "chunked");
+      fflush(stdout);
+
+      request = ippNewRequest(IPP_OP_PRINT_JOB);
+      values[0] = values[1] = values[2] = value;
+
+      for (j = 0; j < 400; j ++)
+      {
+        size_t vlen = (size_t)(j * 37) % (sizeof(value) - 1) + 1;
+					/* Length of value, short and long */
+
+        memset(value, 'a' + j % 26, vlen);
+        value[vlen] = '\0';
+
+        snprintf(aname, sizeof(aname), "test-attr-%d", j);
+
+        switch (j % 5)
+        {
+          case 0 :
+              ippAddString(request, IPP_TAG_JOB, IPP_TAG_TEXT, aname, NULL, value);
+              break;
+          case 1 :
+              ippAddOctetString(request, IPP_TAG_JOB, aname, value, (int)vlen);
+              break;
+          case 2 :
+              ippAddInteger(request, IPP_TAG_JOB, IPP_TAG_INTEGER, aname, j);
+              break;
+          case 3 :
+              ippAddStrings(request, IPP_TAG_JOB, IPP_TAG_NAME, aname, 3, NULL, values);
+              break;
+          default :
+              col = ippNew();
+              ippAddString(col, IPP_TAG_ZERO, IPP_TAG_KEYWORD, "short-value", NULL, "short");
+              ippAddString(col, IPP_TAG_ZERO, IPP_TAG_TEXT, "long-value", NULL, value);
+              ippAddCollection(request, IPP_TAG_JOB, aname, col);
+              ippDelete(col);
+              break;
+        }
+      }
+
+      explen   = ippLength(request);
+      expected = malloc(explen);
+      received = malloc(explen + 1);
+
+      data.rpos    = 0;
+      data.wused   = 0;
+      data.wsize   = explen;
+      data.wbuffer = expected;
+
+      while ((state = ippWriteIO(&data, (ipp_iocb_t)write_cb, 1, NULL, request)) != IPP_STATE_DATA)
+        if (state == IPP_STATE_ERROR)
+	  break;
+
+      if (state != IPP_STATE_DATA || data.wused != explen)
+        error = "unable to write message to memory";
+
+      memset(&laddr, 0, sizeof(laddr));
+      laddr.sin_family      = AF_INET;
+      laddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      laddrlen              = sizeof(laddr);
+
+      if (error)
+        lfd = -1;
+      else if ((lfd = socket(AF_INET, SOCK_STREAM, 0)) < 0 || bind(lfd, (struct sockaddr *)&laddr, sizeof(laddr)) || listen(lfd, 1) || getsockname(lfd, (struct sockaddr *)&laddr, &laddrlen))
+        error = strerror(errno);
+
+      if (!error && (pid = fork()) == 0)
+      {
+       /*
+        * Child writes the message as a POST request...
+        */
+
+        http_t	*client;		/* Client side of connection */
+
+        close(lfd);
+
+        if ((client = httpConnect2("127.0.0.1", ntohs(laddr.sin_port), NULL, AF_INET, HTTP_ENCRYPTION_NEVER, 1, 30000, NULL)) == NULL)
+          _exit(1);
+
+        httpClearFields(client);
+        httpSetField(client, HTTP_FIELD_CONTENT_TYPE, "application/ipp");
+        httpSetLength(client, i ? explen : 0);
+
+        if (httpPost(client, "/"))
+          _exit(1);
+
+        ippSetState(request, IPP_STATE_IDLE);
+
+        while ((state = ippWriteIO(client, (ipp_iocb_t)httpWrite2, i == 0, NULL, request)) != IPP_STATE_DATA)
+          if (state == IPP_STATE_ERROR)
+	    _exit(1);
+
+        if (!i && httpWrite2(client, "", 0) < 0)
+          _exit(1);
+
+        httpFlushWrite(client);
+        httpClose(client);
+        _exit(0);
+      }
+      else if (!error && pid < 0)
+        error = strerror(errno);
+
+      if (!error)
+      {
+       /*
+        * Parent reads the request body and compares it...
+        */
+
+        http_status_t	hstatus;	/* HTTP status */
+
+        if ((http = httpAcceptConnection(lfd, 1)) == NULL)
+          error = "unable to accept connection";
+        else if (httpReadRequest(http, uri, sizeof(uri)) != HTTP_STATE_POST)
+          error = "bad request";
+        else
+        {
+          while ((hstatus = httpUpdate(http)) == HTTP_STATUS_CONTINUE);
+
+          if (hstatus != HTTP_STATUS_OK)
+            error = "bad request fields";
+
+          while (!error && (bytes = httpRead2(http, (char *)received + reclen, explen + 1 - reclen)) > 0)
+            reclen += (size_t)bytes;
+
+          if (!error && reclen != explen)
+            error = "wrong length";
+          else if (!error && memcmp(received, expected, explen))
+            error = "wrong data";
+        }
+
+        httpClose(http);
+
+        while (waitpid(pid, &pstatus, 0) < 0 && errno == EINTR);
+
+        if (!error && pstatus)
+          error = "writer failed";
+      }
+
+      if (lfd >= 0)
+        close(lfd);
+
+      if (error)
+      {
+        printf("FAIL (%s)\n", error);
+        status = 1;
+      }
+      else
+        puts("PASS");
+
+      free(expected);
+      free(received);
+      ippDelete(request);
+    }
+#endif /* !_WIN32 */
+
 #ifdef DEBUG
    /*
     * Test that private option array is sorted...
@@ -776,6 +1245,64 @@ main(int  argc,			/* I - Number of command-line arguments */
       status = 1;
     }
 
+   /*
+    * Test _ippCreateRequestedSet() private API against ippCreateRequestedArray()...
+    */
+
+    fputs("_ippCreateRequestedSet: ", stdout);
+
+    {
+      static const char * const requested[] =
+      {					/* requested-attributes values */
+        "job-template",
+        "printer-description",
+        "printer-defaults"
+      };
+      cups_array_t	*ra;		/* Requested attributes array */
+      _ipp_rset_t	*rs;		/* Requested attributes set */
+      const char	*rname,		/* Requested attribute name */
+			*error = NULL;	/* First error, if any */
+
+      request = ippNewRequest(IPP_OP_GET_PRINTER_ATTRIBUTES);
+      ippAddStrings(request, IPP_TAG_OPERATION, IPP_CONST_TAG(IPP_TAG_KEYWORD), "requested-attributes", (int)(sizeof(requested) / sizeof(requested[0])), NULL, requested);
+
+      ra = ippCreateRequestedArray(request);
+      rs = _ippCreateRequestedSet(request);
+
+      if (!ra || !rs)
+        error = "unable to create array or set";
+
+      for (rname = (const char *)cupsArrayFirst(ra); rname && !error; rname = (const char *)cupsArrayNext(ra))
+        if (!_ippRSetFind(rs, rname))
+          error = rname;
+
+      if (!error && (_ippRSetFind(rs, "job-id") || _ippRSetFind(rs, "not-an-attribute")))
+        error = "unrequested attribute found";
+
+      if (!error)
+      {
+        _ippRSetRemove(rs, "printer-defaults");
+        _ippRSetRemove(rs, "copies-supported");
+        _ippRSetAdd(rs, "not-an-attribute");
+
+        if (_ippRSetFind(rs, "printer-defaults") || _ippRSetFind(rs, "copies-supported") || !_ippRSetFind(rs, "not-an-attribute") || !_ippRSetFind(rs, "copies-default"))
+          error = "wrong results after add/remove";
+      }
+
+      if (error)
+      {
+        printf("FAIL (%s)\n", error);
+        status = 1;
+      }
+      else
+        puts("PASS");
+
+      cupsArrayDelete(ra);
+      _ippRSetDelete(rs);
+      ippDelete(request);
+      request = NULL;
+    }
+
    /*
     * Summarize...
     */
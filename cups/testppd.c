@@ -22,6 +22,8 @@
 #else
 #  include <unistd.h>
 #  include <fcntl.h>
+#  include <sys/socket.h>
+#  include <sys/wait.h>
 #endif /* _WIN32 */
 #include <math.h>
 
@@ -32,7 +34,13 @@
 
 static int	do_ppd_tests(const char *filename, int num_options, cups_option_t *options);
 static int	do_ps_tests(void);
+#ifndef _WIN32
+static int	do_worker_tests(void);
+#endif /* !_WIN32 */
 static void	print_changes(cups_page_header2_t *header, cups_page_header2_t *expected);
+#ifndef _WIN32
+static pid_t	start_worker(int *sock, int check);
+#endif /* !_WIN32 */
 
 
 /*
@@ -1035,6 +1043,10 @@ main(int  argc,				/* I - Number of command-line arguments */
     }
 
     status += do_ps_tests();
+
+#ifndef _WIN32
+    status += do_worker_tests();
+#endif /* !_WIN32 */
   }
   else if (!strcmp(argv[1], "--raster"))
   {
@@ -1565,6 +1577,226 @@ do_ps_tests(void)
 
 
 
+#ifndef _WIN32
+/*
+ * 'do_worker_tests()' - Test sending jobs to filter workers.
+ */
+
+static int				/* O - Number of errors */
+do_worker_tests(void)
+{
+  int			i,		/* Looping var */
+			errors = 0,	/* Number of errors */
+			sock,		/* Control socket */
+			wstatus,	/* Worker exit status */
+			inpipe[2],	/* Document pipe */
+			outpipe[2],	/* Result pipe */
+			sidepipe[2],	/* Side channel pipe */
+			fds[7];		/* Job file descriptors */
+  pid_t			pid;		/* Worker process ID */
+  ssize_t		bytes;		/* Bytes read */
+  char			result[1024],	/* Result from worker */
+			side[256];	/* Side channel data */
+  _ppd_worker_hdr_t	hdr;		/* Job message header */
+  static char		*argv[] =	/* Job arguments */
+  {
+    "Test1",
+    "42",
+    "user",
+    "title",
+    "2",
+    "media=letter",
+    NULL
+  };
+  static char		*envp[] =	/* Job environment */
+  {
+    "CUPS_WORKER_TEST=1",
+    "LANG=C",
+    "PPD=test.ppd",
+    NULL
+  };
+  static const struct
+  {
+    const char	*name;			/* Test name */
+    int		argc,			/* Number of arguments */
+		envc;			/* Number of environment variables */
+    size_t	length,			/* Length in header */
+		sent;			/* Bytes of strings sent */
+    const char	*strings;		/* String data */
+  }			bad[] =		/* Bad job messages */
+  {
+    { "short header", 1, 0, 0, 0, NULL },
+    { "short strings", 2, 0, 64, 6, "Test1" },
+    { "unterminated strings", 1, 0, 5, 5, "Test1" },
+    { "missing strings", 2, 1, 6, 6, "Test1" }
+  };
+
+
+ /*
+  * Send a job with the document on file descriptor 0, the results on 1, and
+  * the side channel on 6...
+  */
+
+  fputs("_ppdFilterWorkerSend/Wait(job): ", stdout);
+
+  if (pipe(inpipe))
+  {
+    printf("FAIL (%s)\n", strerror(errno));
+    return (1);
+  }
+
+  if (pipe(outpipe))
+  {
+    printf("FAIL (%s)\n", strerror(errno));
+    close(inpipe[0]);
+    close(inpipe[1]);
+    return (1);
+  }
+
+  if (pipe(sidepipe))
+  {
+    printf("FAIL (%s)\n", strerror(errno));
+    close(inpipe[0]);
+    close(inpipe[1]);
+    close(outpipe[0]);
+    close(outpipe[1]);
+    return (1);
+  }
+
+  if ((pid = start_worker(&sock, 1)) < 0)
+  {
+    printf("FAIL (%s)\n", strerror(errno));
+    close(inpipe[0]);
+    close(inpipe[1]);
+    close(outpipe[0]);
+    close(outpipe[1]);
+    close(sidepipe[0]);
+    close(sidepipe[1]);
+    return (1);
+  }
+
+  if (write(inpipe[1], "document", 8) != 8)
+    errors ++;
+
+  close(inpipe[1]);
+
+  fds[0] = inpipe[0];
+  fds[1] = outpipe[1];
+  fds[2] = -1;
+  fds[3] = -1;
+  fds[4] = -1;
+  fds[5] = -1;
+  fds[6] = sidepipe[1];
+
+  if (!errors && _ppdFilterWorkerSend(sock, argv, envp, fds))
+    errors ++;
+
+  close(sock);
+  close(inpipe[0]);
+  close(outpipe[1]);
+  close(sidepipe[1]);
+
+  if ((bytes = read(outpipe[0], result, sizeof(result) - 1)) < 0)
+    bytes = 0;
+  result[bytes] = '\0';
+
+  if ((bytes = read(sidepipe[0], side, sizeof(side) - 1)) < 0)
+    bytes = 0;
+  side[bytes] = '\0';
+
+  close(outpipe[0]);
+  close(sidepipe[0]);
+
+  while (waitpid(pid, &wstatus, 0) < 0 && errno == EINTR);
+
+  if (errors)
+    printf("FAIL (unable to send job: %s)\n", strerror(errno));
+  else if (!WIFEXITED(wstatus) || WEXITSTATUS(wstatus) || strcmp(result, "OK"))
+  {
+    printf("FAIL (%s, exit status %d)\n", result[0] ? result : "no result", wstatus);
+    errors ++;
+  }
+  else if (strcmp(side, "side"))
+  {
+    printf("FAIL (got \"%s\" on the side channel)\n", side);
+    errors ++;
+  }
+  else
+    puts("PASS");
+
+ /*
+  * Send bad job messages, which the worker must reject...
+  */
+
+  for (i = 0; i < (int)(sizeof(bad) / sizeof(bad[0])); i ++)
+  {
+    printf("_ppdFilterWorkerWait(%s): ", bad[i].name);
+
+    if ((pid = start_worker(&sock, 0)) < 0)
+    {
+      printf("FAIL (%s)\n", strerror(errno));
+      errors ++;
+      continue;
+    }
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic  = _PPD_WORKER_MAGIC;
+    hdr.argc   = bad[i].argc;
+    hdr.envc   = bad[i].envc;
+    hdr.length = bad[i].length;
+
+    if (!bad[i].strings)
+      bytes = write(sock, &hdr, sizeof(hdr) / 2);
+    else if ((bytes = write(sock, &hdr, sizeof(hdr))) > 0)
+      bytes = write(sock, bad[i].strings, bad[i].sent);
+
+    close(sock);
+
+    while (waitpid(pid, &wstatus, 0) < 0 && errno == EINTR);
+
+    if (bytes <= 0)
+    {
+      printf("FAIL (unable to send job: %s)\n", strerror(errno));
+      errors ++;
+    }
+    else if (!WIFEXITED(wstatus) || WEXITSTATUS(wstatus) != 2)
+    {
+      printf("FAIL (exit status %d, expected 2)\n", wstatus);
+      errors ++;
+    }
+    else
+      puts("PASS");
+  }
+
+ /*
+  * Close the control socket without sending a job...
+  */
+
+  fputs("_ppdFilterWorkerWait(EOF): ", stdout);
+
+  if ((pid = start_worker(&sock, 0)) < 0)
+  {
+    printf("FAIL (%s)\n", strerror(errno));
+    return (errors + 1);
+  }
+
+  close(sock);
+
+  while (waitpid(pid, &wstatus, 0) < 0 && errno == EINTR);
+
+  if (!WIFEXITED(wstatus) || WEXITSTATUS(wstatus))
+  {
+    printf("FAIL (exit status %d, expected 0)\n", wstatus);
+    errors ++;
+  }
+  else
+    puts("PASS");
+
+  return (errors);
+}
+#endif /* !_WIN32 */
+
+
 /*
  * 'print_changes()' - Print differences in the page header.
  */
@@ -1801,3 +2033,93 @@ print_changes(
            header->cupsPageSizeName,
            expected->cupsPageSizeName);
 }
+
+#ifndef _WIN32
+/*
+ * 'start_worker()' - Start a process that waits for a job like a filter
+ *                    worker.
+ *
+ * The process exits with status 2 if _ppdFilterWorkerWait fails.  When
+ * "check" is 0 it exits with status 3 once it has a job, otherwise it checks
+ * the job and writes "OK" or the problem to the job's standard output.
+ */
+
+static pid_t				/* O - Process ID or -1 on error */
+start_worker(int *sock,			/* O - Control socket */
+             int check)			/* I - Check the job? */
+{
+  int		fds[2],			/* Control socket pair */
+		argc;			/* Number of job arguments */
+  char		**argv,			/* Job arguments */
+		buffer[256];		/* Document data */
+  const char	*problem = NULL;	/* Problem with the job */
+  ppd_file_t	*ppd;			/* Loaded PPD file */
+  pid_t		pid;			/* Process ID */
+
+
+  if (socketpair(AF_LOCAL, SOCK_STREAM, 0, fds))
+    return (-1);
+
+  fflush(stdout);
+
+  if ((pid = fork()) < 0)
+  {
+    close(fds[0]);
+    close(fds[1]);
+    return (-1);
+  }
+  else if (pid > 0)
+  {
+    close(fds[1]);
+    *sock = fds[0];
+    return (pid);
+  }
+
+ /*
+  * Child comes here; set things up like the scheduler does and wait for the
+  * job...
+  */
+
+  close(fds[0]);
+  dup2(fds[1], 0);
+  close(fds[1]);
+
+  setenv("CUPS_FILTER_WORKER", "1", 1);
+  setenv("LANG", "C", 1);
+  setenv("PPD", "test.ppd", 1);
+  unsetenv("LC_ALL");
+  unsetenv("LC_CTYPE");
+  unsetenv("LC_MESSAGES");
+
+  _cupsGlobals()->lang_default = NULL;
+
+  if (_ppdFilterWorkerWait(&argc, &argv, &ppd))
+    _exit(2);
+
+  if (!check)
+    _exit(3);
+
+  if (argc != 6 || strcmp(argv[0], "Test1") || strcmp(argv[5], "media=letter") || argv[6])
+    problem = "bad arguments";
+  else if (!getenv("CUPS_WORKER_TEST") || getenv("CUPS_FILTER_WORKER"))
+    problem = "bad environment";
+  else if (!ppd)
+    problem = "PPD file not loaded";
+  else if (read(0, buffer, sizeof(buffer)) != 8 || memcmp(buffer, "document", 8))
+    problem = "bad document data";
+  else if (fcntl(2, F_GETFD) < 0)
+    problem = "no standard error";
+  else if (fcntl(3, F_GETFD) >= 0)
+    problem = "file descriptor 3 not closed";
+  else if (write(6, "side", 4) != 4)
+    problem = "bad side channel";
+
+  if (!problem)
+    problem = "OK";
+
+  if (write(1, problem, strlen(problem)) < 0)
+    _exit(1);
+
+  _exit(strcmp(problem, "OK") != 0);
+}
+#endif /* !_WIN32 */
@@ -0,0 +1,266 @@
+/*
+ * String pool test program for CUPS.
+ *
+ * Copyright © 2022 by OpenPrinting.
+ *
+ * Licensed under Apache License v2.0.  See the file "LICENSE" for more
+ * information.
+ */
+
+/*
+ * Include necessary headers...
+ */
+
+#include "string-private.h"
+#include "thread-private.h"
+
+
+/*
+ * Local globals...
+ */
+
+static char	*words[1000];		/* Shared test strings */
+
+
+/*
+ * Local functions...
+ */
+
+static size_t	count_strings(size_t *strings, size_t *max_chain);
+static void	*run_thread(void *data);
+
+
+/*
+ * 'main()' - Main entry.
+ */
+
+int					/* O - Exit status */
+main(void)
+{
+  int		i;			/* Looping var */
+  int		status = 0;		/* Exit status */
+  char		*s,			/* Pooled string */
+		*s2,			/* Same pooled string */
+		temp[256],		/* Temporary string */
+		*temps[10000];		/* Pooled temporary strings */
+  size_t	count,			/* Initial reference count */
+		strings,		/* Initial number of strings */
+		new_count,		/* Current reference count */
+		new_strings,		/* Current number of strings */
+		max_chain;		/* Longest hash chain */
+  _cups_thread_t threads[4];		/* Test threads */
+
+
+  count = count_strings(&strings, NULL);
+
+ /*
+  * _cupsStrAlloc() and _cupsStrRetain()
+  */
+
+  fputs("_cupsStrAlloc: ", stdout);
+
+  s  = _cupsStrAlloc("teststring-unique-value");
+  s2 = _cupsStrAlloc("teststring-unique-value");
+
+  if (!s || s != s2 || strcmp(s, "teststring-unique-value"))
+  {
+    puts("FAIL (strings not shared)");
+    status ++;
+  }
+  else if ((new_count = count_strings(&new_strings, NULL)) != count + 2 || new_strings != strings + 1)
+  {
+    printf("FAIL (%u references to %u strings, expected %u and %u)\n", (unsigned)new_count, (unsigned)new_strings, (unsigned)count + 2, (unsigned)strings + 1);
+    status ++;
+  }
+  else
+    puts("PASS");
+
+  fputs("_cupsStrRetain: ", stdout);
+
+  if (_cupsStrRetain(s) != s)
+  {
+    puts("FAIL (wrong string)");
+    status ++;
+  }
+  else if ((new_count = count_strings(&new_strings, NULL)) != count + 3 || new_strings != strings + 1)
+  {
+    printf("FAIL (%u references to %u strings, expected %u and %u)\n", (unsigned)new_count, (unsigned)new_strings, (unsigned)count + 3, (unsigned)strings + 1);
+    status ++;
+  }
+  else
+    puts("PASS");
+
+ /*
+  * _cupsStrFree()
+  */
+
+  fputs("_cupsStrFree: ", stdout);
+
+  _cupsStrFree(s);
+  _cupsStrFree(s2);
+
+  if ((new_count = count_strings(&new_strings, NULL)) != count + 1 || new_strings != strings + 1)
+  {
+    printf("FAIL (%u references to %u strings after 2 frees, expected %u and %u)\n", (unsigned)new_count, (unsigned)new_strings, (unsigned)count + 1, (unsigned)strings + 1);
+    status ++;
+  }
+  else
+  {
+   /*
+    * Strings that are not in the pool are ignored...
+    */
+
+    strlcpy(temp, s, sizeof(temp));
+    _cupsStrFree(temp);
+    _cupsStrFree(s);
+
+    if ((new_count = count_strings(&new_strings, NULL)) != count || new_strings != strings)
+    {
+      printf("FAIL (%u references to %u strings after last free, expected %u and %u)\n", (unsigned)new_count, (unsigned)new_strings, (unsigned)count, (unsigned)strings);
+      status ++;
+    }
+    else
+      puts("PASS");
+  }
+
+ /*
+  * _cupsStrShardStatistics() with enough strings to grow the hash tables...
+  */
+
+  fputs("_cupsStrShardStatistics: ", stdout);
+
+  for (i = 0; i < (int)(sizeof(temps) / sizeof(temps[0])); i ++)
+  {
+    snprintf(temp, sizeof(temp), "teststring-%d", i);
+    temps[i] = _cupsStrAlloc(temp);
+  }
+
+  new_count = count_strings(&new_strings, &max_chain);
+
+  if (new_count != count + sizeof(temps) / sizeof(temps[0]) || new_strings != strings + sizeof(temps) / sizeof(temps[0]))
+  {
+    printf("FAIL (%u references to %u strings, expected %u and %u)\n", (unsigned)new_count, (unsigned)new_strings, (unsigned)(count + sizeof(temps) / sizeof(temps[0])), (unsigned)(strings + sizeof(temps) / sizeof(temps[0])));
+    status ++;
+  }
+  else if (new_count != _cupsStrStatistics(NULL, NULL))
+  {
+    printf("FAIL (%u references, _cupsStrStatistics reports %u)\n", (unsigned)new_count, (unsigned)_cupsStrStatistics(NULL, NULL));
+    status ++;
+  }
+  else if (max_chain > 32)
+  {
+    printf("FAIL (longest hash chain is %u)\n", (unsigned)max_chain);
+    status ++;
+  }
+  else
+    puts("PASS");
+
+  for (i = 0; i < (int)(sizeof(temps) / sizeof(temps[0])); i ++)
+    _cupsStrFree(temps[i]);
+
+ /*
+  * Share strings between threads...
+  */
+
+  fputs("_cupsStrAlloc(threads): ", stdout);
+
+  for (i = 0; i < (int)(sizeof(words) / sizeof(words[0])); i ++)
+  {
+    snprintf(temp, sizeof(temp), "teststring-word-%d", i);
+    words[i] = _cupsStrAlloc(temp);
+  }
+
+  for (i = 0; i < (int)(sizeof(threads) / sizeof(threads[0])); i ++)
+    threads[i] = _cupsThreadCreate(run_thread, NULL);
+
+  for (i = 0; i < (int)(sizeof(threads) / sizeof(threads[0])); i ++)
+    if (_cupsThreadWait(threads[i]))
+      status ++;
+
+  new_count = count_strings(&new_strings, NULL);
+
+  for (i = 0; i < (int)(sizeof(words) / sizeof(words[0])); i ++)
+    _cupsStrFree(words[i]);
+
+  if (new_count != count + sizeof(words) / sizeof(words[0]) || new_strings != strings + sizeof(words) / sizeof(words[0]))
+  {
+    printf("FAIL (%u references to %u strings, expected %u and %u)\n", (unsigned)new_count, (unsigned)new_strings, (unsigned)(count + sizeof(words) / sizeof(words[0])), (unsigned)(strings + sizeof(words) / sizeof(words[0])));
+    status ++;
+  }
+  else if ((new_count = count_strings(&new_strings, NULL)) != count || new_strings != strings)
+  {
+    printf("FAIL (%u references to %u strings after free, expected %u and %u)\n", (unsigned)new_count, (unsigned)new_strings, (unsigned)count, (unsigned)strings);
+    status ++;
+  }
+  else
+    puts("PASS");
+
+ /*
+  * Summarize the results and return...
+  */
+
+  if (!status)
+    puts("\nALL TESTS PASSED!");
+  else
+    printf("\n%d TEST(S) FAILED!\n", status);
+
+  return (status);
+}
+
+
+/*
+ * 'count_strings()' - Add up the statistics for all string pool shards.
+ */
+
+static size_t				/* O - Number of references */
+count_strings(size_t *strings,		/* O - Number of unique strings */
+              size_t *max_chain)	/* O - Longest hash chain or NULL */
+{
+  int		shard;			/* Current shard */
+  size_t	count,			/* Number of references */
+		sstrings,		/* Strings in shard */
+		schain;			/* Longest chain in shard */
+
+
+  for (shard = 0, count = 0, *strings = 0; shard < _CUPS_SP_SHARDS; shard ++)
+  {
+    count    += _cupsStrShardStatistics(shard, &sstrings, NULL, &schain);
+    *strings += sstrings;
+
+    if (max_chain && (shard == 0 || schain > *max_chain))
+      *max_chain = schain;
+  }
+
+  return (count);
+}
+
+
+/*
+ * 'run_thread()' - Allocate, retain, and free the shared strings.
+ */
+
+static void *				/* O - NULL on success, non-NULL on error */
+run_thread(void *data)			/* I - Unused */
+{
+  int		i,			/* Looping var */
+		j,			/* Word */
+		errors = 0;		/* Number of errors */
+  char		*s;			/* Pooled string */
+
+
+  (void)data;
+
+  for (i = 0; i < 100000; i ++)
+  {
+    j = i % (int)(sizeof(words) / sizeof(words[0]));
+
+    if ((s = _cupsStrAlloc(words[j])) != words[j])
+      errors ++;
+
+    _cupsStrRetain(s);
+    _cupsStrFree(s);
+    _cupsStrFree(s);
+  }
+
+  return (errors ? (void *)"error" : NULL);
+}
@@ -12,7 +12,7 @@
  */
 
 #include <cups/cups.h>
-#include <cups/ppd.h>
+#include <cups/ppd-private.h>
 #include <cups/string-private.h>
 #include <cups/language-private.h>
 #include <cups/raster.h>
@@ -653,6 +653,13 @@ main(int  argc,				/* I - Number of command-line arguments */
 
   setbuf(stderr, NULL);
 
+ /*
+  * Wait for a job if the scheduler started us ahead of time...
+  */
+
+  if (_ppdFilterWorkerWait(&argc, &argv, &ppd))
+    return (1);
+
  /*
   * Check command-line...
   */
@@ -711,8 +718,7 @@ main(int  argc,				/* I - Number of command-line arguments */
   * Initialize the print device...
   */
 
-  ppd = ppdOpenFile(getenv("PPD"));
-  if (!ppd)
+  if (!ppd && (ppd = ppdOpenFile(getenv("PPD"))) == NULL)
   {
     ppd_status_t	status;		/* PPD error */
     int			linenum;	/* Line number */
@@ -13,7 +13,7 @@
  */
 
 #include <cups/cups.h>
-#include <cups/ppd.h>
+#include <cups/ppd-private.h>
 #include <cups/string-private.h>
 #include <cups/language-private.h>
 #include <cups/raster.h>
@@ -1106,6 +1106,13 @@ main(int  argc,				/* I - Number of command-line arguments */
 
   setbuf(stderr, NULL);
 
+ /*
+  * Wait for a job if the scheduler started us ahead of time...
+  */
+
+  if (_ppdFilterWorkerWait(&argc, &argv, &ppd))
+    return (1);
+
  /*
   * Check command-line...
   */
@@ -1166,8 +1173,7 @@ main(int  argc,				/* I - Number of command-line arguments */
 
   num_options = cupsParseOptions(argv[5], 0, &options);
 
-  ppd = ppdOpenFile(getenv("PPD"));
-  if (!ppd)
+  if (!ppd && (ppd = ppdOpenFile(getenv("PPD"))) == NULL)
   {
     ppd_status_t	status;		/* PPD error */
     int			linenum;	/* Line number */
@@ -28,12 +28,25 @@
 #endif /* HAVE_TCPD_H */
 
 
+#ifdef HAVE_SPLICE
+/*
+ * Local globals...
+ */
+
+static int		splice_pipe[2] = { -1, -1 };
+					/* Pipe for splicing request data */
+static size_t		splice_size = 0;/* Capacity of splice pipe */
+#endif /* HAVE_SPLICE */
+
+
 /*
  * Local functions...
  */
 
+static int		accept_client(cupsd_listener_t *lis);
 static int		check_if_modified(cupsd_client_t *con,
 			                  struct stat *filestats);
+static void		clear_request(cupsd_client_t *con);
 static int		compare_clients(cupsd_client_t *a, cupsd_client_t *b,
 			                void *data);
 #ifdef HAVE_TLS
@@ -47,6 +60,10 @@ static int		is_cgi(cupsd_client_t *con, const char *filename,
 static int		is_path_absolute(const char *path);
 static int		pipe_command(cupsd_client_t *con, int infile, int *outfile,
 			             char *command, char *options, int root);
+#ifdef HAVE_SPLICE
+static int		splice_request_data(cupsd_client_t *con);
+#endif /* HAVE_SPLICE */
+static void		timeout_client(cupsd_client_t *con);
 static int		valid_host(cupsd_client_t *con);
 static int		write_file(cupsd_client_t *con, http_status_t code,
 		        	   char *filename, char *type,
@@ -55,455 +72,160 @@ static void		write_pipe(cupsd_client_t *con);
 
 
 /*
- * 'cupsdAcceptClient()' - Accept a new client.
+ * 'cupsdAcceptClient()' - Accept new clients.
+ *
+ * Listening sockets are non-blocking, so we accept up to CUPSD_ACCEPT_MAX
+ * pending connections for each wakeup instead of returning to the main loop
+ * for every connection.
  */
 
 void
 cupsdAcceptClient(cupsd_listener_t *lis)/* I - Listener socket */
 {
-  const char		*hostname;	/* Hostname of client */
-  char			name[256];	/* Hostname of client */
-  int			count;		/* Count of connections on a host */
-  cupsd_client_t	*con,		/* New client pointer */
-			*tempcon;	/* Temporary client pointer */
-  socklen_t		addrlen;	/* Length of address */
-  http_addr_t		temp;		/* Temporary address variable */
-  static time_t		last_dos = 0;	/* Time of last DoS attack */
-#ifdef HAVE_TCPD_H
-  struct request_info	wrap_req;	/* TCP wrappers request information */
-#endif /* HAVE_TCPD_H */
-
-
-  cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdAcceptClient(lis=%p(%d)) Clients=%d", lis, lis->fd, cupsArrayCount(Clients));
-
- /*
-  * Make sure we don't have a full set of clients already...
-  */
+  int	i;				/* Looping var */
 
-  if (cupsArrayCount(Clients) == MaxClients)
-    return;
 
-  cupsdSetBusyState(1);
+  for (i = 0; i < CUPSD_ACCEPT_MAX; i ++)
+    if (!accept_client(lis))
+      break;
+}
 
- /*
-  * Get a pointer to the next available client...
-  */
 
-  if (!Clients)
-    Clients = cupsArrayNew(NULL, NULL);
+/*
+ * 'cupsdCloseAllClients()' - Close all remote clients immediately.
+ */
 
-  if (!Clients)
-  {
-    cupsdLogMessage(CUPSD_LOG_ERROR,
-                    "Unable to allocate memory for clients array!");
-    cupsdPauseListening();
-    return;
-  }
+void
+cupsdCloseAllClients(void)
+{
+  cupsd_client_t	*con;		/* Current client */
 
-  if (!ActiveClients)
-    ActiveClients = cupsArrayNew((cups_array_func_t)compare_clients, NULL);
 
-  if (!ActiveClients)
-  {
-    cupsdLogMessage(CUPSD_LOG_ERROR,
-                    "Unable to allocate memory for active clients array!");
-    cupsdPauseListening();
-    return;
-  }
+  cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdCloseAllClients() Clients=%d", cupsArrayCount(Clients));
 
-  if ((con = calloc(1, sizeof(cupsd_client_t))) == NULL)
-  {
-    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to allocate memory for client!");
-    cupsdPauseListening();
-    return;
-  }
+  for (con = (cupsd_client_t *)cupsArrayFirst(Clients);
+       con;
+       con = (cupsd_client_t *)cupsArrayNext(Clients))
+    if (cupsdCloseClient(con))
+      cupsdCloseClient(con);
+}
 
- /*
-  * Accept the client and get the remote address...
-  */
 
-  con->number = ++ LastClientNumber;
-  con->file   = -1;
+/*
+ * 'cupsdCloseClient()' - Close a remote client.
+ */
 
-  if ((con->http = httpAcceptConnection(lis->fd, 0)) == NULL)
-  {
-    if (errno == ENFILE || errno == EMFILE)
-      cupsdPauseListening();
+int					/* O - 1 if partial close, 0 if fully closed */
+cupsdCloseClient(cupsd_client_t *con)	/* I - Client to close */
+{
+  int		partial;		/* Do partial close for SSL? */
 
-    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to accept client connection - %s.",
-                    strerror(errno));
-    free(con);
 
-    return;
-  }
+  cupsdLogClient(con, CUPSD_LOG_DEBUG, "Closing connection.");
 
  /*
-  * Save the connected address and port number...
+  * Flush pending writes before closing...
   */
 
-  addrlen = sizeof(con->clientaddr);
-
-  if (getsockname(httpGetFd(con->http), (struct sockaddr *)&con->clientaddr, &addrlen) || addrlen == 0)
-    con->clientaddr = lis->address;
-
-  cupsdLogClient(con, CUPSD_LOG_DEBUG, "Server address is \"%s\".", httpAddrString(&con->clientaddr, name, sizeof(name)));
-
- /*
-  * Check the number of clients on the same address...
-  */
+  httpFlushWrite(con->http);
 
-  for (count = 0, tempcon = (cupsd_client_t *)cupsArrayFirst(Clients);
-       tempcon;
-       tempcon = (cupsd_client_t *)cupsArrayNext(Clients))
-    if (httpAddrEqual(httpGetAddress(tempcon->http), httpGetAddress(con->http)))
-    {
-      count ++;
-      if (count >= MaxClientsPerHost)
-	break;
-    }
+  partial = 0;
 
-  if (count >= MaxClientsPerHost)
+  if (con->work)
   {
-    if ((time(NULL) - last_dos) >= 60)
-    {
-      last_dos = time(NULL);
-      cupsdLogMessage(CUPSD_LOG_WARN,
-                      "Possible DoS attack - more than %d clients connecting "
-		      "from %s.",
-	              MaxClientsPerHost,
-		      httpGetHostname(con->http, name, sizeof(name)));
-    }
+   /*
+    * Drop any response a worker thread is completing...
+    */
 
-    httpClose(con->http);
-    free(con);
-    return;
+    cupsdCancelIPPWork(con);
   }
 
- /*
-  * Get the hostname or format the IP address as needed...
-  */
-
-  if (HostNameLookups)
-    hostname = httpResolveHostname(con->http, NULL, 0);
-  else
-    hostname = httpGetHostname(con->http, NULL, 0);
-
-  if (hostname == NULL && HostNameLookups == 2)
+  if (con->pipe_pid != 0)
   {
    /*
-    * Can't have an unresolved IP address with double-lookups enabled...
+    * Stop any CGI process...
     */
 
-    httpClose(con->http);
+    cupsdEndProcess(con->pipe_pid, 1);
+    con->pipe_pid = 0;
+  }
 
-    cupsdLogClient(con, CUPSD_LOG_WARN,
-                    "Name lookup failed - connection from %s closed!",
-                    httpGetHostname(con->http, NULL, 0));
+  if (con->file >= 0)
+  {
+    cupsdRemoveSelect(con->file);
 
-    free(con);
-    return;
+    close(con->file);
+    con->file = -1;
   }
 
-  if (HostNameLookups == 2)
+ /*
+  * Close the socket and clear the file from the input set for select()...
+  */
+
+  if (httpGetFd(con->http) >= 0)
   {
+    cupsArrayRemove(ActiveClients, con);
+    cupsdSetBusyState(0);
+
+#ifdef HAVE_TLS
    /*
-    * Do double lookups as needed...
+    * Shutdown encryption as needed...
     */
 
-    http_addrlist_t	*addrlist,	/* List of addresses */
-			*addr;		/* Current address */
+    if (httpIsEncrypted(con->http))
+      partial = 1;
+#endif /* HAVE_TLS */
 
-    if ((addrlist = httpAddrGetList(hostname, AF_UNSPEC, NULL)) != NULL)
+    if (partial)
     {
      /*
-      * See if the hostname maps to the same IP address...
+      * Only do a partial close so that the encrypted client gets everything.
       */
 
-      for (addr = addrlist; addr; addr = addr->next)
-        if (httpAddrEqual(httpGetAddress(con->http), &(addr->addr)))
-          break;
+      httpShutdown(con->http);
+      cupsdAddSelect(httpGetFd(con->http), (cupsd_selfunc_t)cupsdReadClient,
+                     NULL, con);
+
+      cupsdLogClient(con, CUPSD_LOG_DEBUG, "Waiting for socket close.");
     }
     else
-      addr = NULL;
-
-    httpAddrFreeList(addrlist);
-
-    if (!addr)
     {
      /*
-      * Can't have a hostname that doesn't resolve to the same IP address
-      * with double-lookups enabled...
+      * Shut the socket down fully...
       */
 
+      cupsdRemoveSelect(httpGetFd(con->http));
       httpClose(con->http);
-
-      cupsdLogClient(con, CUPSD_LOG_WARN,
-                      "IP lookup failed - connection from %s closed!",
-                      httpGetHostname(con->http, NULL, 0));
-      free(con);
-      return;
+      con->http = NULL;
     }
   }
 
-#ifdef HAVE_TCPD_H
- /*
-  * See if the connection is denied by TCP wrappers...
-  */
+  if (!partial)
+  {
+   /*
+    * Free memory...
+    */
 
-  request_init(&wrap_req, RQ_DAEMON, "cupsd", RQ_FILE, httpGetFd(con->http),
-               NULL);
-  fromhost(&wrap_req);
+    cupsdRemoveSelect(httpGetFd(con->http));
 
-  if (!hosts_access(&wrap_req))
-  {
     httpClose(con->http);
 
-    cupsdLogClient(con, CUPSD_LOG_WARN,
-                    "Connection from %s refused by /etc/hosts.allow and "
-		    "/etc/hosts.deny rules.", httpGetHostname(con->http, NULL, 0));
-    free(con);
-    return;
-  }
-#endif /* HAVE_TCPD_H */
+    if (con->filename)
+    {
+      unlink(con->filename);
+      cupsdClearString(&con->filename);
+    }
 
-#ifdef AF_LOCAL
-  if (httpAddrFamily(httpGetAddress(con->http)) == AF_LOCAL)
-  {
-#  ifdef __APPLE__
-    socklen_t	peersize;		/* Size of peer credentials */
-    pid_t	peerpid;		/* Peer process ID */
-    char	peername[256];		/* Name of process */
+    cupsdClearString(&con->command);
+    cupsdClearString(&con->options);
+    cupsdClearString(&con->query_string);
 
-    peersize = sizeof(peerpid);
-    if (!getsockopt(httpGetFd(con->http), SOL_LOCAL, LOCAL_PEERPID, &peerpid,
-                    &peersize))
+    clear_request(con);
+
+    if (con->response)
     {
-      if (!proc_name((int)peerpid, peername, sizeof(peername)))
-	cupsdLogClient(con, CUPSD_LOG_DEBUG,
-	               "Accepted from %s (Domain ???[%d])",
-                       httpGetHostname(con->http, NULL, 0), (int)peerpid);
-      else
-	cupsdLogClient(con, CUPSD_LOG_DEBUG,
-                       "Accepted from %s (Domain %s[%d])",
-                       httpGetHostname(con->http, NULL, 0), peername, (int)peerpid);
-    }
-    else
-#  endif /* __APPLE__ */
-
-    cupsdLogClient(con, CUPSD_LOG_DEBUG, "Accepted from %s (Domain)",
-                   httpGetHostname(con->http, NULL, 0));
-  }
-  else
-#endif /* AF_LOCAL */
-  cupsdLogClient(con, CUPSD_LOG_DEBUG, "Accepted from %s:%d (IPv%d)",
-                 httpGetHostname(con->http, NULL, 0),
-		 httpAddrPort(httpGetAddress(con->http)),
-		 httpAddrFamily(httpGetAddress(con->http)) == AF_INET ? 4 : 6);
-
- /*
-  * Get the local address the client connected to...
-  */
-
-  addrlen = sizeof(temp);
-  if (getsockname(httpGetFd(con->http), (struct sockaddr *)&temp, &addrlen))
-  {
-    cupsdLogClient(con, CUPSD_LOG_ERROR, "Unable to get local address - %s",
-                   strerror(errno));
-
-    strlcpy(con->servername, "localhost", sizeof(con->servername));
-    con->serverport = LocalPort;
-  }
-#ifdef AF_LOCAL
-  else if (httpAddrFamily(&temp) == AF_LOCAL)
-  {
-    strlcpy(con->servername, "localhost", sizeof(con->servername));
-    con->serverport = LocalPort;
-  }
-#endif /* AF_LOCAL */
-  else
-  {
-    if (httpAddrLocalhost(&temp))
-      strlcpy(con->servername, "localhost", sizeof(con->servername));
-    else if (HostNameLookups)
-      httpAddrLookup(&temp, con->servername, sizeof(con->servername));
-    else
-      httpAddrString(&temp, con->servername, sizeof(con->servername));
-
-    con->serverport = httpAddrPort(&(lis->address));
-  }
-
- /*
-  * Add the connection to the array of active clients...
-  */
-
-  cupsArrayAdd(Clients, con);
-
- /*
-  * Add the socket to the server select.
-  */
-
-  cupsdAddSelect(httpGetFd(con->http), (cupsd_selfunc_t)cupsdReadClient, NULL,
-                 con);
-
-  cupsdLogClient(con, CUPSD_LOG_DEBUG, "Waiting for request.");
-
- /*
-  * Temporarily suspend accept()'s until we lose a client...
-  */
-
-  if (cupsArrayCount(Clients) == MaxClients)
-    cupsdPauseListening();
-
-#ifdef HAVE_TLS
- /*
-  * See if we are connecting on a secure port...
-  */
-
-  if (lis->encryption == HTTP_ENCRYPTION_ALWAYS)
-  {
-   /*
-    * https connection; go secure...
-    */
-
-    if (cupsd_start_tls(con, HTTP_ENCRYPTION_ALWAYS))
-      cupsdCloseClient(con);
-  }
-  else
-    con->auto_ssl = 1;
-#endif /* HAVE_TLS */
-}
-
-
-/*
- * 'cupsdCloseAllClients()' - Close all remote clients immediately.
- */
-
-void
-cupsdCloseAllClients(void)
-{
-  cupsd_client_t	*con;		/* Current client */
-
-
-  cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdCloseAllClients() Clients=%d", cupsArrayCount(Clients));
-
-  for (con = (cupsd_client_t *)cupsArrayFirst(Clients);
-       con;
-       con = (cupsd_client_t *)cupsArrayNext(Clients))
-    if (cupsdCloseClient(con))
-      cupsdCloseClient(con);
-}
-
-
-/*
- * 'cupsdCloseClient()' - Close a remote client.
- */
-
-int					/* O - 1 if partial close, 0 if fully closed */
-cupsdCloseClient(cupsd_client_t *con)	/* I - Client to close */
-{
-  int		partial;		/* Do partial close for SSL? */
-
-
-  cupsdLogClient(con, CUPSD_LOG_DEBUG, "Closing connection.");
-
- /*
-  * Flush pending writes before closing...
-  */
-
-  httpFlushWrite(con->http);
-
-  partial = 0;
-
-  if (con->pipe_pid != 0)
-  {
-   /*
-    * Stop any CGI process...
-    */
-
-    cupsdEndProcess(con->pipe_pid, 1);
-    con->pipe_pid = 0;
-  }
-
-  if (con->file >= 0)
-  {
-    cupsdRemoveSelect(con->file);
-
-    close(con->file);
-    con->file = -1;
-  }
-
- /*
-  * Close the socket and clear the file from the input set for select()...
-  */
-
-  if (httpGetFd(con->http) >= 0)
-  {
-    cupsArrayRemove(ActiveClients, con);
-    cupsdSetBusyState(0);
-
-#ifdef HAVE_TLS
-   /*
-    * Shutdown encryption as needed...
-    */
-
-    if (httpIsEncrypted(con->http))
-      partial = 1;
-#endif /* HAVE_TLS */
-
-    if (partial)
-    {
-     /*
-      * Only do a partial close so that the encrypted client gets everything.
-      */
-
-      httpShutdown(con->http);
-      cupsdAddSelect(httpGetFd(con->http), (cupsd_selfunc_t)cupsdReadClient,
-                     NULL, con);
-
-      cupsdLogClient(con, CUPSD_LOG_DEBUG, "Waiting for socket close.");
-    }
-    else
-    {
-     /*
-      * Shut the socket down fully...
-      */
-
-      cupsdRemoveSelect(httpGetFd(con->http));
-      httpClose(con->http);
-      con->http = NULL;
-    }
-  }
-
-  if (!partial)
-  {
-   /*
-    * Free memory...
-    */
-
-    cupsdRemoveSelect(httpGetFd(con->http));
-
-    httpClose(con->http);
-
-    if (con->filename)
-    {
-      unlink(con->filename);
-      cupsdClearString(&con->filename);
-    }
-
-    cupsdClearString(&con->command);
-    cupsdClearString(&con->options);
-    cupsdClearString(&con->query_string);
-
-    if (con->request)
-    {
-      ippDelete(con->request);
-      con->request = NULL;
-    }
-
-    if (con->response)
-    {
-      ippDelete(con->response);
-      con->response = NULL;
+      ippDelete(con->response);
+      con->response = NULL;
     }
 
     if (con->language)
@@ -534,6 +256,8 @@ cupsdCloseClient(cupsd_client_t *con)	/* I - Client to close */
 
     cupsArrayRemove(Clients, con);
 
+    cupsdClearTimer(&con->timer);
+
     free(con);
   }
 
@@ -663,11 +387,7 @@ cupsdReadClient(cupsd_client_t *con)	/* I - Client to read from */
 	cupsdClearString(&con->options);
 	cupsdClearString(&con->query_string);
 
-	if (con->request)
-	{
-	  ippDelete(con->request);
-	  con->request = NULL;
-	}
+	clear_request(con);
 
 	if (con->response)
 	{
@@ -1225,7 +945,7 @@ cupsdReadClient(cupsd_client_t *con)	/* I - Client to read from */
 
 	    if (!strcmp(httpGetField(con->http, HTTP_FIELD_CONTENT_TYPE), "application/ipp"))
 	    {
-              con->request = ippNew();
+              con->request = _ippNewArena();
               break;
             }
             else if (!WebInterface)
@@ -1628,7 +1348,20 @@ cupsdReadClient(cupsd_client_t *con)	/* I - Client to read from */
 	      cupsdCloseClient(con);
 	      return;
 	    }
-	    else if (ipp_state != IPP_STATE_DATA)
+
+	    if (con->request->request.op.operation_id == IPP_OP_SEND_DOCUMENT &&
+	        !con->send_document)
+	    {
+	     /*
+	      * Track Send-Document requests so that we don't time out jobs that
+	      * are still receiving documents...
+	      */
+
+	      con->send_document = 1;
+	      SendDocumentClients ++;
+	    }
+
+	    if (ipp_state != IPP_STATE_DATA)
 	    {
               if (httpGetState(con->http) == HTTP_STATE_POST_SEND)
 	      {
@@ -1678,13 +1411,49 @@ cupsdReadClient(cupsd_client_t *con)	/* I - Client to read from */
 	    fchmod(con->file, 0640);
 	    fchown(con->file, RunUser, Group);
             fcntl(con->file, F_SETFD, fcntl(con->file, F_GETFD) | FD_CLOEXEC);
+
+	    if (httpGetState(con->http) == HTTP_STATE_POST_RECV)
+	      cupsdStartIPPStream(con);
 	  }
 
 	  if (httpGetState(con->http) != HTTP_STATE_POST_SEND)
 	  {
+	    int	spliced = 0;		/* Data spliced to file? */
+
 	    if (!httpWait(con->http, 0))
 	      return;
-            else if ((bytes = httpRead2(con->http, line, sizeof(line))) < 0)
+
+#ifdef HAVE_SPLICE
+	    if (con->file >= 0 && (bytes = splice_request_data(con)) != 0)
+	      spliced = 1;
+	    else
+#endif /* HAVE_SPLICE */
+	    bytes = (int)httpRead2(con->http, line, sizeof(line));
+
+	    if (bytes < 0 && spliced)
+	    {
+	      cupsdLogClient(con, CUPSD_LOG_ERROR,
+			     "Unable to write request data to \"%s\": %s",
+			     con->filename ? con->filename : "job file",
+			     strerror(httpError(con->http)));
+
+	      if (con->streaming > 0)
+	        cupsdFinishIPPStream(con, 0);
+
+	      close(con->file);
+	      con->file = -1;
+	      if (con->filename)
+		unlink(con->filename);
+	      cupsdClearString(&con->filename);
+
+	      if (!cupsdSendError(con, HTTP_STATUS_REQUEST_TOO_LARGE,
+				  CUPSD_AUTH_NONE))
+	      {
+		cupsdCloseClient(con);
+		return;
+	      }
+	    }
+	    else if (bytes < 0)
 	    {
 	      if (httpError(con->http) && httpError(con->http) != EPIPE)
 		cupsdLogClient(con, CUPSD_LOG_DEBUG,
@@ -1703,9 +1472,13 @@ cupsdReadClient(cupsd_client_t *con)	/* I - Client to read from */
 
               if (MaxRequestSize > 0 && con->bytes > MaxRequestSize)
               {
+	        if (con->streaming > 0)
+	          cupsdFinishIPPStream(con, 0);
+
                 close(con->file);
                 con->file = -1;
-                unlink(con->filename);
+                if (con->filename)
+                  unlink(con->filename);
                 cupsdClearString(&con->filename);
 
                 if (!cupsdSendError(con, HTTP_STATUS_REQUEST_TOO_LARGE, CUPSD_AUTH_NONE))
@@ -1715,15 +1488,20 @@ cupsdReadClient(cupsd_client_t *con)	/* I - Client to read from */
                 }
               }
 
-              if (write(con->file, line, (size_t)bytes) < bytes)
+              if (!spliced && write(con->file, line, (size_t)bytes) < bytes)
 	      {
         	cupsdLogClient(con, CUPSD_LOG_ERROR,
 	                       "Unable to write %d bytes to \"%s\": %s",
-                               bytes, con->filename, strerror(errno));
+                               bytes, con->filename ? con->filename : "job file",
+			       strerror(errno));
+
+	        if (con->streaming > 0)
+	          cupsdFinishIPPStream(con, 0);
 
 		close(con->file);
 		con->file = -1;
-		unlink(con->filename);
+		if (con->filename)
+		  unlink(con->filename);
 		cupsdClearString(&con->filename);
 
         	if (!cupsdSendError(con, HTTP_STATUS_REQUEST_TOO_LARGE,
@@ -1733,6 +1511,8 @@ cupsdReadClient(cupsd_client_t *con)	/* I - Client to read from */
 		  return;
 		}
 	      }
+	      else if (con->stream_job)
+	        cupsdUpdateJobStream(cupsdFindJob(con->stream_job));
 	    }
 	    else if (httpGetState(con->http) == HTTP_STATE_POST_RECV)
               return;
@@ -1750,6 +1530,21 @@ cupsdReadClient(cupsd_client_t *con)	/* I - Client to read from */
 
 	if (httpGetState(con->http) == HTTP_STATE_POST_SEND)
 	{
+	  if (con->streaming > 0)
+	  {
+	   /*
+	    * The request was already processed, finish the streamed job and
+	    * send the response...
+	    */
+
+	    close(con->file);
+	    con->file = -1;
+
+	    if (!cupsdFinishIPPStream(con, 1))
+	      cupsdCloseClient(con);
+	    return;
+	  }
+
 	  if (con->file >= 0)
 	  {
 	    if (fstat(con->file, &filestats))
@@ -1768,15 +1563,11 @@ cupsdReadClient(cupsd_client_t *con)	/* I - Client to read from */
 	      unlink(con->filename);
 	      cupsdClearString(&con->filename);
 
-	      if (con->request)
-	      {
-	       /*
-	        * Delete any IPP request data...
-		*/
+	     /*
+	      * Delete any IPP request data...
+	      */
 
-	        ippDelete(con->request);
-		con->request = NULL;
-              }
+	      clear_request(con);
 
               if (!cupsdSendError(con, HTTP_STATUS_REQUEST_TOO_LARGE, CUPSD_AUTH_NONE))
 	      {
@@ -2321,7 +2112,8 @@ cupsdWriteClient(cupsd_client_t *con)	/* I - Client connection */
     do
     {
      /*
-      * Write a single attribute or the IPP message header...
+      * Write the next batch of attributes; large batches are sent with a
+      * single vectored write...
       */
 
       ipp_state = ippWrite(con->http, con->response);
@@ -2471,113 +2263,456 @@ cupsdWriteClient(cupsd_client_t *con)	/* I - Client connection */
 	  field_col ++;
       }
 
-      if (!con->got_fields)
-        return;
+      if (!con->got_fields)
+        return;
+    }
+
+    if (con->header_used > 0)
+    {
+      if (httpWrite2(con->http, con->header, (size_t)con->header_used) < 0)
+      {
+	cupsdLogClient(con, CUPSD_LOG_DEBUG, "Closing for error %d (%s)",
+		       httpError(con->http), strerror(httpError(con->http)));
+	cupsdCloseClient(con);
+	return;
+      }
+
+      if (httpIsChunked(con->http))
+        httpFlushWrite(con->http);
+
+      con->bytes += con->header_used;
+
+      if (httpGetState(con->http) == HTTP_STATE_WAITING)
+	bytes = 0;
+      else
+        bytes = con->header_used;
+
+      con->header_used = 0;
+    }
+  }
+
+  if (bytes <= 0 ||
+      (httpGetState(con->http) != HTTP_STATE_GET_SEND &&
+       httpGetState(con->http) != HTTP_STATE_POST_SEND))
+  {
+    if (!con->sent_header && con->pipe_pid)
+      cupsdSendError(con, HTTP_STATUS_SERVER_ERROR, CUPSD_AUTH_NONE);
+    else
+    {
+      cupsdLogRequest(con, HTTP_STATUS_OK);
+
+      if (httpIsChunked(con->http) && (!con->pipe_pid || con->sent_header > 0))
+      {
+        cupsdLogClient(con, CUPSD_LOG_DEBUG, "Sending 0-length chunk.");
+
+	if (httpWrite2(con->http, "", 0) < 0)
+	{
+	  cupsdLogClient(con, CUPSD_LOG_DEBUG, "Closing for error %d (%s)",
+			 httpError(con->http), strerror(httpError(con->http)));
+	  cupsdCloseClient(con);
+	  return;
+	}
+      }
+
+      cupsdLogClient(con, CUPSD_LOG_DEBUG, "Flushing write buffer.");
+      httpFlushWrite(con->http);
+      cupsdLogClient(con, CUPSD_LOG_DEBUG, "New state is %s", httpStateString(httpGetState(con->http)));
+    }
+
+    cupsdAddSelect(httpGetFd(con->http), (cupsd_selfunc_t)cupsdReadClient, NULL, con);
+
+    cupsdLogClient(con, CUPSD_LOG_DEBUG, "Waiting for request.");
+
+    if (con->file >= 0)
+    {
+      cupsdRemoveSelect(con->file);
+
+      if (con->pipe_pid)
+	cupsdEndProcess(con->pipe_pid, 0);
+
+      close(con->file);
+      con->file     = -1;
+      con->pipe_pid = 0;
+    }
+
+    if (con->filename)
+    {
+      unlink(con->filename);
+      cupsdClearString(&con->filename);
+    }
+
+    clear_request(con);
+
+    if (con->response)
+    {
+      ippDelete(con->response);
+      con->response = NULL;
+    }
+
+    cupsdClearString(&con->command);
+    cupsdClearString(&con->options);
+    cupsdClearString(&con->query_string);
+
+    if (!httpGetKeepAlive(con->http))
+    {
+      cupsdLogClient(con, CUPSD_LOG_DEBUG,
+		     "Closing because Keep-Alive is disabled.");
+      cupsdCloseClient(con);
+      return;
+    }
+    else
+    {
+      cupsArrayRemove(ActiveClients, con);
+      cupsdSetBusyState(0);
+    }
+  }
+}
+
+
+/*
+ * 'accept_client()' - Accept a new client.
+ */
+
+static int				/* O - 1 to accept more clients, 0 to stop */
+accept_client(cupsd_listener_t *lis)	/* I - Listener socket */
+{
+  const char		*hostname;	/* Hostname of client */
+  char			name[256];	/* Hostname of client */
+  int			count;		/* Count of connections on a host */
+  cupsd_client_t	*con,		/* New client pointer */
+			*tempcon;	/* Temporary client pointer */
+  socklen_t		addrlen;	/* Length of address */
+  http_addr_t		temp;		/* Temporary address variable */
+  static time_t		last_dos = 0;	/* Time of last DoS attack */
+#ifdef HAVE_TCPD_H
+  struct request_info	wrap_req;	/* TCP wrappers request information */
+#endif /* HAVE_TCPD_H */
+
+
+  cupsdLogMessage(CUPSD_LOG_DEBUG2, "accept_client(lis=%p(%d)) Clients=%d", lis, lis->fd, cupsArrayCount(Clients));
+
+ /*
+  * Make sure we don't have a full set of clients already...
+  */
+
+  if (cupsArrayCount(Clients) == MaxClients)
+    return (0);
+
+  cupsdSetBusyState(1);
+
+ /*
+  * Get a pointer to the next available client...
+  */
+
+  if (!Clients)
+    Clients = cupsArrayNew(NULL, NULL);
+
+  if (!Clients)
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR,
+                    "Unable to allocate memory for clients array!");
+    cupsdPauseListening();
+    return (0);
+  }
+
+  if (!ActiveClients)
+    ActiveClients = cupsArrayNew((cups_array_func_t)compare_clients, NULL);
+
+  if (!ActiveClients)
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR,
+                    "Unable to allocate memory for active clients array!");
+    cupsdPauseListening();
+    return (0);
+  }
+
+  if ((con = calloc(1, sizeof(cupsd_client_t))) == NULL)
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to allocate memory for client!");
+    cupsdPauseListening();
+    return (0);
+  }
+
+ /*
+  * Accept the client and get the remote address...
+  */
+
+  if ((con->http = httpAcceptConnection(lis->fd, 0)) == NULL)
+  {
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+    {
+     /*
+      * No more pending connections...
+      */
+
+      free(con);
+
+      return (0);
+    }
+
+    if (errno == ENFILE || errno == EMFILE)
+      cupsdPauseListening();
+
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to accept client connection - %s.",
+                    strerror(errno));
+    free(con);
+
+    return (0);
+  }
+
+  con->number = ++ LastClientNumber;
+  con->file   = -1;
+
+#ifndef __linux
+ /*
+  * Accepted sockets inherit O_NONBLOCK from the listening socket on BSD...
+  */
+
+  fcntl(httpGetFd(con->http), F_SETFL, fcntl(httpGetFd(con->http), F_GETFL) & ~O_NONBLOCK);
+#endif /* !__linux */
+
+ /*
+  * Save the connected address and port number...
+  */
+
+  addrlen = sizeof(con->clientaddr);
+
+  if (getsockname(httpGetFd(con->http), (struct sockaddr *)&con->clientaddr, &addrlen) || addrlen == 0)
+    con->clientaddr = lis->address;
+
+  cupsdLogClient(con, CUPSD_LOG_DEBUG, "Server address is \"%s\".", httpAddrString(&con->clientaddr, name, sizeof(name)));
+
+ /*
+  * Check the number of clients on the same address...
+  */
+
+  for (count = 0, tempcon = (cupsd_client_t *)cupsArrayFirst(Clients);
+       tempcon;
+       tempcon = (cupsd_client_t *)cupsArrayNext(Clients))
+    if (httpAddrEqual(httpGetAddress(tempcon->http), httpGetAddress(con->http)))
+    {
+      count ++;
+      if (count >= MaxClientsPerHost)
+	break;
+    }
+
+  if (count >= MaxClientsPerHost)
+  {
+    if ((time(NULL) - last_dos) >= 60)
+    {
+      last_dos = time(NULL);
+      cupsdLogMessage(CUPSD_LOG_WARN,
+                      "Possible DoS attack - more than %d clients connecting "
+		      "from %s.",
+	              MaxClientsPerHost,
+		      httpGetHostname(con->http, name, sizeof(name)));
+    }
+
+    httpClose(con->http);
+    free(con);
+    return (1);
+  }
+
+ /*
+  * Get the hostname or format the IP address as needed...
+  */
+
+  if (HostNameLookups)
+    hostname = httpResolveHostname(con->http, NULL, 0);
+  else
+    hostname = httpGetHostname(con->http, NULL, 0);
+
+  if (hostname == NULL && HostNameLookups == 2)
+  {
+   /*
+    * Can't have an unresolved IP address with double-lookups enabled...
+    */
+
+    httpClose(con->http);
+
+    cupsdLogClient(con, CUPSD_LOG_WARN,
+                    "Name lookup failed - connection from %s closed!",
+                    httpGetHostname(con->http, NULL, 0));
+
+    free(con);
+    return (1);
+  }
+
+  if (HostNameLookups == 2)
+  {
+   /*
+    * Do double lookups as needed...
+    */
+
+    http_addrlist_t	*addrlist,	/* List of addresses */
+			*addr;		/* Current address */
+
+    if ((addrlist = httpAddrGetList(hostname, AF_UNSPEC, NULL)) != NULL)
+    {
+     /*
+      * See if the hostname maps to the same IP address...
+      */
+
+      for (addr = addrlist; addr; addr = addr->next)
+        if (httpAddrEqual(httpGetAddress(con->http), &(addr->addr)))
+          break;
+    }
+    else
+      addr = NULL;
+
+    httpAddrFreeList(addrlist);
+
+    if (!addr)
+    {
+     /*
+      * Can't have a hostname that doesn't resolve to the same IP address
+      * with double-lookups enabled...
+      */
+
+      httpClose(con->http);
+
+      cupsdLogClient(con, CUPSD_LOG_WARN,
+                      "IP lookup failed - connection from %s closed!",
+                      httpGetHostname(con->http, NULL, 0));
+      free(con);
+      return (1);
     }
+  }
 
-    if (con->header_used > 0)
-    {
-      if (httpWrite2(con->http, con->header, (size_t)con->header_used) < 0)
-      {
-	cupsdLogClient(con, CUPSD_LOG_DEBUG, "Closing for error %d (%s)",
-		       httpError(con->http), strerror(httpError(con->http)));
-	cupsdCloseClient(con);
-	return;
-      }
+#ifdef HAVE_TCPD_H
+ /*
+  * See if the connection is denied by TCP wrappers...
+  */
 
-      if (httpIsChunked(con->http))
-        httpFlushWrite(con->http);
+  request_init(&wrap_req, RQ_DAEMON, "cupsd", RQ_FILE, httpGetFd(con->http),
+               NULL);
+  fromhost(&wrap_req);
 
-      con->bytes += con->header_used;
+  if (!hosts_access(&wrap_req))
+  {
+    httpClose(con->http);
 
-      if (httpGetState(con->http) == HTTP_STATE_WAITING)
-	bytes = 0;
-      else
-        bytes = con->header_used;
+    cupsdLogClient(con, CUPSD_LOG_WARN,
+                    "Connection from %s refused by /etc/hosts.allow and "
+		    "/etc/hosts.deny rules.", httpGetHostname(con->http, NULL, 0));
+    free(con);
+    return (1);
+  }
+#endif /* HAVE_TCPD_H */
 
-      con->header_used = 0;
+#ifdef AF_LOCAL
+  if (httpAddrFamily(httpGetAddress(con->http)) == AF_LOCAL)
+  {
+#  ifdef __APPLE__
+    socklen_t	peersize;		/* Size of peer credentials */
+    pid_t	peerpid;		/* Peer process ID */
+    char	peername[256];		/* Name of process */
+
+    peersize = sizeof(peerpid);
+    if (!getsockopt(httpGetFd(con->http), SOL_LOCAL, LOCAL_PEERPID, &peerpid,
+                    &peersize))
+    {
+      if (!proc_name((int)peerpid, peername, sizeof(peername)))
+	cupsdLogClient(con, CUPSD_LOG_DEBUG,
+	               "Accepted from %s (Domain ???[%d])",
+                       httpGetHostname(con->http, NULL, 0), (int)peerpid);
+      else
+	cupsdLogClient(con, CUPSD_LOG_DEBUG,
+                       "Accepted from %s (Domain %s[%d])",
+                       httpGetHostname(con->http, NULL, 0), peername, (int)peerpid);
     }
+    else
+#  endif /* __APPLE__ */
+
+    cupsdLogClient(con, CUPSD_LOG_DEBUG, "Accepted from %s (Domain)",
+                   httpGetHostname(con->http, NULL, 0));
   }
+  else
+#endif /* AF_LOCAL */
+  cupsdLogClient(con, CUPSD_LOG_DEBUG, "Accepted from %s:%d (IPv%d)",
+                 httpGetHostname(con->http, NULL, 0),
+		 httpAddrPort(httpGetAddress(con->http)),
+		 httpAddrFamily(httpGetAddress(con->http)) == AF_INET ? 4 : 6);
 
-  if (bytes <= 0 ||
-      (httpGetState(con->http) != HTTP_STATE_GET_SEND &&
-       httpGetState(con->http) != HTTP_STATE_POST_SEND))
+ /*
+  * Get the local address the client connected to...
+  */
+
+  addrlen = sizeof(temp);
+  if (getsockname(httpGetFd(con->http), (struct sockaddr *)&temp, &addrlen))
   {
-    if (!con->sent_header && con->pipe_pid)
-      cupsdSendError(con, HTTP_STATUS_SERVER_ERROR, CUPSD_AUTH_NONE);
+    cupsdLogClient(con, CUPSD_LOG_ERROR, "Unable to get local address - %s",
+                   strerror(errno));
+
+    strlcpy(con->servername, "localhost", sizeof(con->servername));
+    con->serverport = LocalPort;
+  }
+#ifdef AF_LOCAL
+  else if (httpAddrFamily(&temp) == AF_LOCAL)
+  {
+    strlcpy(con->servername, "localhost", sizeof(con->servername));
+    con->serverport = LocalPort;
+  }
+#endif /* AF_LOCAL */
+  else
+  {
+    if (httpAddrLocalhost(&temp))
+      strlcpy(con->servername, "localhost", sizeof(con->servername));
+    else if (HostNameLookups)
+      httpAddrLookup(&temp, con->servername, sizeof(con->servername));
     else
-    {
-      cupsdLogRequest(con, HTTP_STATUS_OK);
+      httpAddrString(&temp, con->servername, sizeof(con->servername));
 
-      if (httpIsChunked(con->http) && (!con->pipe_pid || con->sent_header > 0))
-      {
-        cupsdLogClient(con, CUPSD_LOG_DEBUG, "Sending 0-length chunk.");
+    con->serverport = httpAddrPort(&(lis->address));
+  }
 
-	if (httpWrite2(con->http, "", 0) < 0)
-	{
-	  cupsdLogClient(con, CUPSD_LOG_DEBUG, "Closing for error %d (%s)",
-			 httpError(con->http), strerror(httpError(con->http)));
-	  cupsdCloseClient(con);
-	  return;
-	}
-      }
+ /*
+  * Add the connection to the array of active clients...
+  */
 
-      cupsdLogClient(con, CUPSD_LOG_DEBUG, "Flushing write buffer.");
-      httpFlushWrite(con->http);
-      cupsdLogClient(con, CUPSD_LOG_DEBUG, "New state is %s", httpStateString(httpGetState(con->http)));
-    }
+  cupsArrayAdd(Clients, con);
 
-    cupsdAddSelect(httpGetFd(con->http), (cupsd_selfunc_t)cupsdReadClient, NULL, con);
+ /*
+  * Close the connection if it stays inactive for too long...
+  */
 
-    cupsdLogClient(con, CUPSD_LOG_DEBUG, "Waiting for request.");
+  cupsdSetTimer(&con->timer, httpGetActivity(con->http) + Timeout + 1, (cupsd_timerfunc_t)timeout_client, con, "timeout a client connection");
 
-    if (con->file >= 0)
-    {
-      cupsdRemoveSelect(con->file);
+ /*
+  * Add the socket to the server select.
+  */
 
-      if (con->pipe_pid)
-	cupsdEndProcess(con->pipe_pid, 0);
+  cupsdAddSelect(httpGetFd(con->http), (cupsd_selfunc_t)cupsdReadClient, NULL,
+                 con);
 
-      close(con->file);
-      con->file     = -1;
-      con->pipe_pid = 0;
-    }
+  cupsdLogClient(con, CUPSD_LOG_DEBUG, "Waiting for request.");
 
-    if (con->filename)
-    {
-      unlink(con->filename);
-      cupsdClearString(&con->filename);
-    }
+ /*
+  * Temporarily suspend accept()'s until we lose a client...
+  */
 
-    if (con->request)
-    {
-      ippDelete(con->request);
-      con->request = NULL;
-    }
+  if (cupsArrayCount(Clients) == MaxClients)
+    cupsdPauseListening();
 
-    if (con->response)
-    {
-      ippDelete(con->response);
-      con->response = NULL;
-    }
+#ifdef HAVE_TLS
+ /*
+  * See if we are connecting on a secure port...
+  */
 
-    cupsdClearString(&con->command);
-    cupsdClearString(&con->options);
-    cupsdClearString(&con->query_string);
+  if (lis->encryption == HTTP_ENCRYPTION_ALWAYS)
+  {
+   /*
+    * https connection; go secure...
+    */
 
-    if (!httpGetKeepAlive(con->http))
-    {
-      cupsdLogClient(con, CUPSD_LOG_DEBUG,
-		     "Closing because Keep-Alive is disabled.");
+    if (cupsd_start_tls(con, HTTP_ENCRYPTION_ALWAYS))
       cupsdCloseClient(con);
-      return;
-    }
-    else
-    {
-      cupsArrayRemove(ActiveClients, con);
-      cupsdSetBusyState(0);
-    }
   }
+  else
+    con->auto_ssl = 1;
+#endif /* HAVE_TLS */
+
+  return (1);
 }
 
 
@@ -2633,6 +2768,29 @@ check_if_modified(
 }
 
 
+/*
+ * 'clear_request()' - Free the IPP request for a client.
+ */
+
+static void
+clear_request(cupsd_client_t *con)	/* I - Client connection */
+{
+  if (con->send_document)
+  {
+    con->send_document = 0;
+    SendDocumentClients --;
+  }
+
+  if (con->streaming > 0)
+    cupsdFinishIPPStream(con, 0);
+
+  con->streaming = 0;
+
+  ippDelete(con->request);
+  con->request = NULL;
+}
+
+
 /*
  * 'compare_clients()' - Compare two client connections.
  */
@@ -3515,7 +3673,7 @@ pipe_command(cupsd_client_t *con,	/* I - Client connection */
   */
 
   if (cupsdStartProcess(command, argv, envp, infile, fds[1], CGIPipes[1],
-			-1, -1, root, DefaultProfile, NULL, &pid) < 0)
+			-1, -1, -1, -1, root, DefaultProfile, NULL, &pid) < 0)
   {
    /*
     * Error - can't fork!
@@ -3546,6 +3704,87 @@ pipe_command(cupsd_client_t *con,	/* I - Client connection */
 }
 
 
+#ifdef HAVE_SPLICE
+/*
+ * 'splice_request_data()' - Move request data from the client to its file.
+ *
+ * The data is moved through a pipe with splice(), so it is never copied
+ * into the scheduler's memory.
+ */
+
+static int				/* O - Number of bytes moved, 0 to read normally, or -1 on error */
+splice_request_data(
+    cupsd_client_t *con)		/* I - Client connection */
+{
+  ssize_t	bytes;			/* Bytes moved */
+
+
+  if (splice_pipe[0] < 0)
+  {
+    if (cupsdOpenPipe(splice_pipe))
+    {
+      cupsdLogMessage(CUPSD_LOG_DEBUG, "Unable to create splice pipe: %s", strerror(errno));
+      return (0);
+    }
+
+#  ifdef F_SETPIPE_SZ
+    fcntl(splice_pipe[1], F_SETPIPE_SZ, 1048576);
+#  endif /* F_SETPIPE_SZ */
+#  ifdef F_GETPIPE_SZ
+    if ((bytes = fcntl(splice_pipe[1], F_GETPIPE_SZ)) > 0)
+      splice_size = (size_t)bytes;
+    else
+#  endif /* F_GETPIPE_SZ */
+    splice_size = 65536;
+  }
+
+  if ((bytes = _httpReadSplice(con->http, con->file, splice_pipe, splice_size)) < 0)
+  {
+   /*
+    * The pipe may still hold data, so don't reuse it...
+    */
+
+    cupsdClosePipe(splice_pipe);
+  }
+
+  return ((int)bytes);
+}
+#endif /* HAVE_SPLICE */
+
+
+/*
+ * 'timeout_client()' - Close a client connection after too much inactivity.
+ */
+
+static void
+timeout_client(cupsd_client_t *con)	/* I - Client connection */
+{
+  time_t	curtime = time(NULL),	/* Current time */
+		deadline;		/* Inactivity deadline */
+
+
+  deadline = httpGetActivity(con->http) + Timeout;
+
+  if (deadline < curtime && !con->pipe_pid)
+  {
+    cupsdLogMessage(CUPSD_LOG_DEBUG, "Closing client %d after %d seconds of inactivity.", con->number, Timeout);
+
+    if (cupsdCloseClient(con))
+      cupsdSetTimer(&con->timer, curtime + 1, (cupsd_timerfunc_t)timeout_client, con, "timeout a client connection");
+    return;
+  }
+
+ /*
+  * Still active (or running a CGI program), check again later...
+  */
+
+  if (deadline < curtime)
+    deadline = curtime;
+
+  cupsdSetTimer(&con->timer, deadline + 1, (cupsd_timerfunc_t)timeout_client, con, "timeout a client connection");
+}
+
+
 /*
  * 'valid_host()' - Is the Host: field valid?
  */
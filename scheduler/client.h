@@ -64,6 +64,13 @@ struct cupsd_client_s
 #ifdef HAVE_AUTHORIZATION_H
   AuthorizationRef	authref;	/* Authorization ref */
 #endif /* HAVE_AUTHORIZATION_H */
+  cupsd_timer_t		timer;		/* Inactivity timer */
+  int			send_document;	/* Counted in SendDocumentClients? */
+  int			streaming,	/* Request processed before its document
+					 * was received? (-1 = not possible) */
+			stream_job;	/* Job receiving the document, if any */
+  struct cupsd_ippwork_s *work;		/* Response being completed by a
+					 * worker thread, if any */
 };
 
 #define HTTP(con) ((con)->http)
@@ -73,6 +80,8 @@ struct cupsd_client_s
  * HTTP listener structure...
  */
 
+#define CUPSD_ACCEPT_MAX	64	/* Max connections accepted per wakeup */
+
 typedef struct
 {
   int			fd;		/* File descriptor for this server */
@@ -104,6 +113,8 @@ VAR cups_array_t	*Clients	VALUE(NULL),
 					/* HTTP clients */
 			*ActiveClients	VALUE(NULL);
 					/* Active HTTP clients */
+VAR int			SendDocumentClients VALUE(0);
+					/* Clients with a Send-Document request */
 VAR char		*ServerHeader	VALUE(NULL);
 					/* Server header in requests */
 VAR int			CGIPipes[2]	VALUE2(-1,-1);
@@ -117,9 +128,11 @@ VAR cupsd_statbuf_t	*CGIStatusBuffer VALUE(NULL);
  */
 
 extern void	cupsdAcceptClient(cupsd_listener_t *lis);
+extern void	cupsdCancelIPPWork(cupsd_client_t *con);
 extern void	cupsdCloseAllClients(void);
 extern int	cupsdCloseClient(cupsd_client_t *con);
 extern void	cupsdDeleteAllListeners(void);
+extern int	cupsdFinishIPPStream(cupsd_client_t *con, int complete);
 extern void	cupsdPauseListening(void);
 extern int	cupsdProcessIPPRequest(cupsd_client_t *con);
 extern void	cupsdReadClient(cupsd_client_t *con);
@@ -131,6 +144,7 @@ extern int	cupsdSendError(cupsd_client_t *con, http_status_t code,
 extern int	cupsdSendHeader(cupsd_client_t *con, http_status_t code,
 		                char *type, int auth_type);
 extern void	cupsdShutdownClient(cupsd_client_t *con);
+extern int	cupsdStartIPPStream(cupsd_client_t *con);
 extern void	cupsdStartListening(void);
 extern void	cupsdStopListening(void);
 extern void	cupsdUpdateCGI(void);
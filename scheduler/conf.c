@@ -85,14 +85,18 @@ static const cupsd_var_t	cupsd_vars[] =
   { "DNSSDHostName",		&DNSSDHostName,		CUPSD_VARTYPE_STRING },
 #endif /* HAVE_DNSSD */
   { "ErrorPolicy",		&ErrorPolicy,		CUPSD_VARTYPE_STRING },
+  { "FilterAhead",		&FilterAhead,		CUPSD_VARTYPE_INTEGER },
   { "FilterLimit",		&FilterLimit,		CUPSD_VARTYPE_INTEGER },
   { "FilterNice",		&FilterNice,		CUPSD_VARTYPE_INTEGER },
+  { "FilterRingSize",		&FilterRingSize,	CUPSD_VARTYPE_INTEGER },
+  { "FilterWorkers",		&FilterWorkers,		CUPSD_VARTYPE_STRING },
 #ifdef HAVE_GSSAPI
   { "GSSServiceName",		&GSSServiceName,	CUPSD_VARTYPE_STRING },
 #endif /* HAVE_GSSAPI */
 #ifdef HAVE_ONDEMAND
   { "IdleExitTimeout",		&IdleExitTimeout,	CUPSD_VARTYPE_TIME },
 #endif /* HAVE_ONDEMAND */
+  { "IPPWorkers",		&IPPWorkers,		CUPSD_VARTYPE_INTEGER },
   { "JobKillDelay",		&JobKillDelay,		CUPSD_VARTYPE_TIME },
   { "JobRetryLimit",		&JobRetryLimit,		CUPSD_VARTYPE_INTEGER },
   { "JobRetryInterval",		&JobRetryInterval,	CUPSD_VARTYPE_TIME },
@@ -108,6 +112,7 @@ static const cupsd_var_t	cupsd_vars[] =
   { "MaxCopies",		&MaxCopies,		CUPSD_VARTYPE_INTEGER },
   { "MaxEvents",		&MaxEvents,		CUPSD_VARTYPE_INTEGER },
   { "MaxHoldTime",		&MaxHoldTime,		CUPSD_VARTYPE_TIME },
+  { "MaxJobHistoryMemory",	&MaxJobHistoryMemory,	CUPSD_VARTYPE_INTEGER },
   { "MaxJobs",			&MaxJobs,		CUPSD_VARTYPE_INTEGER },
   { "MaxJobsPerPrinter",	&MaxJobsPerPrinter,	CUPSD_VARTYPE_INTEGER },
   { "MaxJobsPerUser",		&MaxJobsPerUser,	CUPSD_VARTYPE_INTEGER },
@@ -127,6 +132,7 @@ static const cupsd_var_t	cupsd_vars[] =
   { "RootCertDuration",		&RootCertDuration,	CUPSD_VARTYPE_TIME },
   { "ServerAdmin",		&ServerAdmin,		CUPSD_VARTYPE_STRING },
   { "ServerName",		&ServerName,		CUPSD_VARTYPE_STRING },
+  { "StreamingPrint",		&StreamingPrint,	CUPSD_VARTYPE_BOOLEAN },
   { "StrictConformance",	&StrictConformance,	CUPSD_VARTYPE_BOOLEAN },
   { "Timeout",			&Timeout,		CUPSD_VARTYPE_TIME },
   { "WebInterface",		&WebInterface,		CUPSD_VARTYPE_BOOLEAN }
@@ -622,6 +628,8 @@ cupsdReadConfiguration(void)
     cupsdSetString(&DefaultLanguage, language->language);
 
   cupsdClearString(&DefaultPaperSize);
+  cupsdStopFilterWorkers(NULL);
+  cupsdClearString(&FilterWorkers);
   cupsArrayDelete(ReadyPaperSizes);
   ReadyPaperSizes = NULL;
 
@@ -708,10 +716,13 @@ cupsdReadConfiguration(void)
   JobRetryLimit            = 5;
   JobRetryInterval         = 300;
   FileDevice               = FALSE;
+  FilterAhead              = 0;
   FilterLevel              = 0;
   FilterLimit              = 0;
   FilterNice               = 0;
+  FilterRingSize           = 0;
   HostNameLookups          = FALSE;
+  IPPWorkers               = 0;
   KeepAlive                = TRUE;
   LogDebugHistory          = 200;
   LogFilePerm              = CUPS_DEFAULT_LOG_FILE_PERM;
@@ -727,6 +738,7 @@ cupsdReadConfiguration(void)
   ReloadTimeout	           = DEFAULT_KEEPALIVE;
   RootCertDuration         = 300;
   Sandboxing               = CUPSD_SANDBOXING_STRICT;
+  StreamingPrint           = FALSE;
   StrictConformance        = FALSE;
 #ifdef CUPS_DEFAULT_SYNC_ON_CLOSE
   SyncOnClose              = TRUE;
@@ -753,6 +765,7 @@ cupsdReadConfiguration(void)
   JobAutoPurge        = 0;
   MaxHoldTime         = 0;
   MaxJobs             = 500;
+  MaxJobHistoryMemory = 4 * 1024 * 1024;
   MaxActiveJobs       = 0;
   MaxJobsPerUser      = 0;
   MaxJobsPerPrinter   = 0;
@@ -1693,6 +1706,12 @@ cupsdReadConfiguration(void)
     cupsdLogMessage(CUPSD_LOG_INFO, "Partial reload complete.");
   }
 
+ /*
+  * Start any filters that run ahead of time...
+  */
+
+  cupsdStartFilterWorkers(NULL);
+
  /*
   * Reset the reload state...
   */
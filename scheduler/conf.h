@@ -140,6 +140,8 @@ VAR char		*AccessLog		VALUE(NULL),
 					/* Default paper size */
 			*ErrorPolicy		VALUE(NULL),
 					/* Default printer-error-policy */
+			*FilterWorkers		VALUE(NULL),
+					/* Filters to start ahead of time */
 			*TempDir		VALUE(NULL),
 					/* Temporary directory */
 			*Printcap		VALUE(NULL),
@@ -166,6 +168,8 @@ VAR int			ClassifyOverride	VALUE(0),
 					/* Which errors are fatal? */
 			StrictConformance	VALUE(FALSE),
 					/* Require strict IPP conformance? */
+			StreamingPrint		VALUE(FALSE),
+					/* Start jobs while receiving documents? */
 			SyncOnClose		VALUE(FALSE);
 					/* Call fsync() when closing files? */
 VAR mode_t		ConfigFilePerm		VALUE(0640U),
@@ -202,12 +206,18 @@ VAR int			MaxClients		VALUE(100),
 					/* Support the Keep-Alive option? */
 			FileDevice		VALUE(FALSE),
 					/* Allow file: devices? */
+			FilterAhead		VALUE(0),
+					/* Documents to filter ahead of printing */
 			FilterLimit		VALUE(0),
 					/* Max filter cost at any time */
 			FilterLevel		VALUE(0),
 					/* Current filter level */
 			FilterNice		VALUE(0),
 					/* Nice value for filters */
+			FilterRingSize		VALUE(0),
+					/* Size of shared memory between filters */
+			IPPWorkers		VALUE(0),
+					/* Threads for copying printer attributes */
 			ReloadTimeout		VALUE(DEFAULT_KEEPALIVE),
 					/* Timeout before reload from SIGHUP */
 			RootCertDuration	VALUE(300),
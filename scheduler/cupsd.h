@@ -99,6 +99,23 @@ extern const char *cups_hstrerror(int);
 #endif /* _MAIN_C */
 
 
+/*
+ * Deadline timer types (see select.c)...
+ */
+
+typedef void (*cupsd_timerfunc_t)(void *data);
+
+typedef struct cupsd_timer_s		/**** Deadline timer ****/
+{
+  time_t		when;		/* Deadline or 0 if not scheduled */
+  int			index,		/* Index in timer heap */
+			serial;		/* Run serial number when scheduled */
+  cupsd_timerfunc_t	cb;		/* Expiration callback */
+  void			*data;		/* Data pointer for callback */
+  const char		*why;		/* Debugging aid */
+} cupsd_timer_t;
+
+
 /*
  * Other stuff for the scheduler...
  */
@@ -199,21 +216,29 @@ extern void		cupsdSetStringf(char **s, const char *f, ...)
 extern void		*cupsdCreateProfile(int job_id, int allow_networking);
 extern void		cupsdDestroyProfile(void *profile);
 extern int		cupsdEndProcess(int pid, int force);
-extern const char	*cupsdFinishProcess(int pid, char *name, size_t namelen, int *job_id);
+extern const char	*cupsdFinishProcess(int pid, char *name, size_t namelen, int *job_id, struct timeval *start);
+extern void		cupsdSetProcessJob(int pid, cupsd_job_t *job);
 extern int		cupsdStartProcess(const char *command, char *argv[],
 					  char *envp[], int infd, int outfd,
 					  int errfd, int backfd, int sidefd,
+					  int inringfd, int outringfd,
 					  int root, void *profile,
 					  cupsd_job_t *job, int *pid);
 
 /* select.c */
 extern int		cupsdAddSelect(int fd, cupsd_selfunc_t read_cb,
 			               cupsd_selfunc_t write_cb, void *data);
+extern void		cupsdClearTimer(cupsd_timer_t *timer);
 extern int		cupsdDoSelect(long timeout);
 #ifdef CUPSD_IS_SELECTING
 extern int		cupsdIsSelecting(int fd);
 #endif /* CUPSD_IS_SELECTING */
+extern time_t		cupsdNextTimer(const char **why);
 extern void		cupsdRemoveSelect(int fd);
+extern int		cupsdRunTimers(time_t curtime);
+extern void		cupsdSetTimer(cupsd_timer_t *timer, time_t when,
+			              cupsd_timerfunc_t cb, void *data,
+				      const char *why);
 extern void		cupsdStartSelect(void);
 extern void		cupsdStopSelect(void);
 
@@ -12,7 +12,7 @@
  */
 
 #include <cups/string-private.h>
-#include "mime.h"
+#include "mime-private.h"
 
 
 /*
@@ -27,22 +27,39 @@
  * Local types...
  */
 
-typedef struct _mime_typelist_s		/**** List of source types ****/
+typedef struct _mime_chain_s		/**** Cached filter chain ****/
 {
-  struct _mime_typelist_s *next;	/* Next source type */
-  mime_type_t		*src;		/* Source type */
-} _mime_typelist_t;
+  mime_type_t		*src,		/* Source type */
+			*dst;		/* Destination type */
+  size_t		limit;		/* Smallest maxsize >= srcsize or 0 */
+  cups_array_t		*filters;	/* Filters to run or NULL */
+  int			cost;		/* Cost of filters */
+} _mime_chain_t;
+
+typedef struct _mime_node_s		/**** Type in filter search ****/
+{
+  mime_type_t		*type;		/* Type */
+  mime_filter_t		*filter;	/* Last filter to get to this type */
+  int			cost,		/* Cost to get to this type */
+			done;		/* Is the cost final? */
+} _mime_node_t;
 
 
 /*
  * Local functions...
  */
 
+static int		mime_compare_chains(_mime_chain_t *c0,
+			                    _mime_chain_t *c1);
 static int		mime_compare_filters(mime_filter_t *, mime_filter_t *);
+static int		mime_compare_nodes(_mime_node_t *n0, _mime_node_t *n1);
+static int		mime_compare_sizes(const size_t *s0, const size_t *s1);
 static int		mime_compare_srcs(mime_filter_t *, mime_filter_t *);
 static cups_array_t	*mime_find_filters(mime_t *mime, mime_type_t *src,
 				      size_t srcsize, mime_type_t *dst,
-				      int *cost, _mime_typelist_t *visited);
+				      int *cost);
+static size_t		mime_find_limit(mime_t *mime, size_t srcsize);
+static void		mime_load_sizes(mime_t *mime);
 
 
 /*
@@ -93,6 +110,8 @@ mimeAddFilter(mime_t      *mime,	/* I - MIME database */
                     temp->filter, temp->cost));
       temp->cost = cost;
       strlcpy(temp->filter, filter, sizeof(temp->filter));
+
+      _mimeFlushChains(mime);
     }
   }
   else
@@ -122,6 +141,8 @@ mimeAddFilter(mime_t      *mime,	/* I - MIME database */
     DEBUG_puts("1mimeAddFilter: Adding new filter.");
     cupsArrayAdd(mime->filters, temp);
     cupsArrayAdd(mime->srcs, temp);
+
+    _mimeFlushChains(mime);
   }
 
  /*
@@ -136,6 +157,8 @@ mimeAddFilter(mime_t      *mime,	/* I - MIME database */
 
 /*
  * 'mimeFilter()' - Find the fastest way to convert from one type to another.
+ *
+ * The cheapest filter chain is returned whether or not "cost" is NULL.
  */
 
 cups_array_t *				/* O - Array of filters to run */
@@ -157,6 +180,8 @@ mimeFilter(mime_t      *mime,		/* I - MIME database */
 /*
  * 'mimeFilter2()' - Find the fastest way to convert from one type to another,
  *                   including file size.
+ *
+ * The cheapest filter chain is returned whether or not "cost" is NULL.
  */
 
 cups_array_t *				/* O - Array of filters to run */
@@ -167,6 +192,8 @@ mimeFilter2(mime_t      *mime,		/* I - MIME database */
 	    int         *cost)		/* O - Cost of filters */
 {
   cups_array_t	*filters;		/* Array of filters to run */
+  _mime_chain_t	key,			/* Search key */
+		*chain;			/* Cached filter chain */
 
 
  /*
@@ -203,10 +230,42 @@ mimeFilter2(mime_t      *mime,		/* I - MIME database */
   }
 
  /*
-  * Find the filters...
+  * Only the maxsize values of the filters matter for the file size, so look
+  * for a cached chain using the smallest maxsize that allows this file...
   */
 
-  filters = mime_find_filters(mime, src, srcsize, dst, cost, NULL);
+  if (!mime->chains)
+  {
+    mime->chains = cupsArrayNew((cups_array_func_t)mime_compare_chains, NULL);
+
+    mime_load_sizes(mime);
+  }
+
+  key.src   = src;
+  key.dst   = dst;
+  key.limit = mime_find_limit(mime, srcsize);
+
+  if ((chain = (_mime_chain_t *)cupsArrayFind(mime->chains, &key)) == NULL)
+  {
+   /*
+    * Find the filters and cache the result, even if there are none...
+    */
+
+    if ((chain = calloc(1, sizeof(_mime_chain_t))) == NULL)
+      return (NULL);
+
+    chain->src     = src;
+    chain->dst     = dst;
+    chain->limit   = key.limit;
+    chain->filters = mime_find_filters(mime, src, srcsize, dst, &chain->cost);
+
+    cupsArrayAdd(mime->chains, chain);
+  }
+
+  if (cost && chain->filters)
+    *cost = chain->cost;
+
+  filters = cupsArrayDup(chain->filters);
 
   DEBUG_printf(("1mimeFilter2: Returning %d filter(s), cost %d:",
                 cupsArrayCount(filters), cost ? *cost : -1));
@@ -254,6 +313,57 @@ mimeFilterLookup(mime_t      *mime,	/* I - MIME database */
 }
 
 
+/*
+ * '_mimeFlushChains()' - Free the cached filter chains.
+ */
+
+void
+_mimeFlushChains(mime_t *mime)		/* I - MIME database */
+{
+  _mime_chain_t	*chain;			/* Current filter chain */
+
+
+  if (!mime->chains)
+    return;
+
+  DEBUG_puts("2_mimeFlushChains: Deleting filter chain cache.");
+
+  for (chain = (_mime_chain_t *)cupsArrayFirst(mime->chains);
+       chain;
+       chain = (_mime_chain_t *)cupsArrayNext(mime->chains))
+  {
+    cupsArrayDelete(chain->filters);
+    free(chain);
+  }
+
+  cupsArrayDelete(mime->chains);
+  mime->chains = NULL;
+
+  free(mime->maxsizes);
+  mime->maxsizes     = NULL;
+  mime->num_maxsizes = 0;
+}
+
+
+/*
+ * 'mime_compare_chains()' - Compare two cached filter chains.
+ */
+
+static int				/* O - Comparison result */
+mime_compare_chains(_mime_chain_t *c0,	/* I - First chain */
+                    _mime_chain_t *c1)	/* I - Second chain */
+{
+  if (c0->src != c1->src)
+    return (c0->src < c1->src ? -1 : 1);
+  else if (c0->dst != c1->dst)
+    return (c0->dst < c1->dst ? -1 : 1);
+  else if (c0->limit != c1->limit)
+    return (c0->limit < c1->limit ? -1 : 1);
+  else
+    return (0);
+}
+
+
 /*
  * 'mime_compare_filters()' - Compare two filters.
  */
@@ -274,6 +384,36 @@ mime_compare_filters(mime_filter_t *f0,	/* I - First filter */
 }
 
 
+/*
+ * 'mime_compare_nodes()' - Compare two filter search nodes.
+ */
+
+static int				/* O - Comparison result */
+mime_compare_nodes(_mime_node_t *n0,	/* I - First node */
+                   _mime_node_t *n1)	/* I - Second node */
+{
+  if (n0->type < n1->type)
+    return (-1);
+  else
+    return (n0->type > n1->type);
+}
+
+
+/*
+ * 'mime_compare_sizes()' - Compare two filter maxsize values.
+ */
+
+static int				/* O - Comparison result */
+mime_compare_sizes(const size_t *s0,	/* I - First size */
+                   const size_t *s1)	/* I - Second size */
+{
+  if (*s0 < *s1)
+    return (-1);
+  else
+    return (*s0 > *s1);
+}
+
+
 /*
  * 'mime_compare_srcs()' - Compare two filter source types.
  */
@@ -294,6 +434,9 @@ mime_compare_srcs(mime_filter_t *f0,	/* I - First filter */
 
 /*
  * 'mime_find_filters()' - Find the filters to convert from one type to another.
+ *
+ * This is Dijkstra's shortest path search over the types, with the filters as
+ * the edges and the filter costs as the distances.
  */
 
 static cups_array_t *			/* O - Array of filters to run */
@@ -302,186 +445,215 @@ mime_find_filters(
     mime_type_t      *src,		/* I - Source file type */
     size_t           srcsize,		/* I - Size of source file */
     mime_type_t      *dst,		/* I - Destination file type */
-    int              *cost,		/* O - Cost of filters */
-    _mime_typelist_t *list)		/* I - Source types we've used */
+    int              *cost)		/* O - Cost of filters */
 {
-  int			tempcost,	/* Temporary cost */
-			mincost;	/* Current minimum */
-  cups_array_t		*temp,		/* Temporary filter */
-			*mintemp;	/* Current minimum */
+  cups_array_t		*nodes,		/* Types that have been reached */
+			*filters;	/* Filters to run */
+  _mime_node_t		*node,		/* Current node */
+			*next,		/* Next node */
+			key;		/* Search key */
   mime_filter_t		*current,	/* Current filter */
 			srckey;		/* Source type key */
-  _mime_typelist_t	listnode,	/* New list node */
-			*listptr;	/* Pointer in list */
+  mime_type_t		*type;		/* Current source type */
+  int			tempcost;	/* Cost via the current filter */
 
 
   DEBUG_printf(("2mime_find_filters(mime=%p, src=%p(%s/%s), srcsize=" CUPS_LLFMT
-                ", dst=%p(%s/%s), cost=%p, list=%p)", mime, src, src->super,
-		src->type, CUPS_LLCAST srcsize, dst, dst->super, dst->type,
-		cost, list));
+                ", dst=%p(%s/%s), cost=%p)", mime, src, src->super, src->type,
+		CUPS_LLCAST srcsize, dst, dst->super, dst->type, cost));
+
+  if ((nodes = cupsArrayNew((cups_array_func_t)mime_compare_nodes, NULL)) == NULL)
+  {
+    DEBUG_puts("3mime_find_filters: Returning NULL (out of memory).");
+    return (NULL);
+  }
 
  /*
-  * See if there is a filter that can convert the files directly...
+  * Starting with the source type, look at the filters from the closest type
+  * that hasn't been done yet until we get to the destination type.  The
+  * source type only gets a node if a filter converts back to it, which allows
+  * src == dst to find a chain...
   */
 
-  if ((current = mimeFilterLookup(mime, src, dst)) != NULL &&
-      (current->maxsize == 0 || srcsize <= current->maxsize))
+  for (type = src, next = NULL; type;)
   {
-   /*
-    * Got a direct filter!
-    */
+    srckey.src = type;
 
-    DEBUG_puts("3mime_find_filters: Direct filter found.");
-
-    if ((mintemp = cupsArrayNew(NULL, NULL)) == NULL)
+    for (current = (mime_filter_t *)cupsArrayFind(mime->srcs, &srckey);
+	 current && current->src == type;
+	 current = (mime_filter_t *)cupsArrayNext(mime->srcs))
     {
-      DEBUG_puts("3mime_find_filters: Returning NULL (out of memory).");
-      return (NULL);
+      if (current->maxsize > 0 && srcsize > current->maxsize)
+	continue;
+
+      tempcost = (next ? next->cost : 0) + current->cost;
+      key.type = current->dst;
+
+      if ((node = (_mime_node_t *)cupsArrayFind(nodes, &key)) == NULL)
+      {
+        if ((node = calloc(1, sizeof(_mime_node_t))) == NULL)
+	  break;
+
+        node->type   = current->dst;
+	node->filter = current;
+	node->cost   = tempcost;
+
+	cupsArrayAdd(nodes, node);
+      }
+      else if (!node->done && tempcost < node->cost)
+      {
+	node->filter = current;
+	node->cost   = tempcost;
+      }
     }
 
-    cupsArrayAdd(mintemp, current);
-
-    mincost = current->cost;
-
-    if (!cost)
-    {
-      DEBUG_printf(("3mime_find_filters: Returning 1 filter, cost %d:",
-                    mincost));
-      DEBUG_printf(("3mime_find_filters: %s/%s %s/%s %d %s",
-                    current->src->super, current->src->type,
-                    current->dst->super, current->dst->type,
-		    current->cost, current->filter));
-      return (mintemp);
-    }
-  }
-  else
-  {
    /*
-    * No direct filter...
+    * Pick the closest type that is not done...
     */
 
-    mintemp = NULL;
-    mincost = 9999999;
-  }
+    for (next = NULL, node = (_mime_node_t *)cupsArrayFirst(nodes);
+         node;
+	 node = (_mime_node_t *)cupsArrayNext(nodes))
+      if (!node->done && (!next || node->cost < next->cost))
+        next = node;
 
- /*
-  * Initialize this node in the type list...
-  */
+    if (!next)
+      break;
 
-  listnode.next = list;
+    next->done = 1;
+
+    if (next->type == dst)
+      break;
+
+    type = next->type;
+  }
 
  /*
-  * OK, now look for filters from the source type to any other type...
+  * Collect the filters from the destination back to the source...
   */
 
-  srckey.src = src;
+  key.type = dst;
+  filters  = NULL;
 
-  for (current = (mime_filter_t *)cupsArrayFind(mime->srcs, &srckey);
-       current && current->src == src;
-       current = (mime_filter_t *)cupsArrayNext(mime->srcs))
+  if ((node = (_mime_node_t *)cupsArrayFind(nodes, &key)) != NULL && node->done)
   {
-   /*
-    * See if we have already tried the destination type as a source
-    * type (this avoids extra filter looping...)
-    */
-
-    mime_type_t *current_dst;		/* Current destination type */
-
-    if (current->maxsize > 0 && srcsize > current->maxsize)
-      continue;
-
-    for (listptr = list, current_dst = current->dst;
-	 listptr;
-	 listptr = listptr->next)
-      if (current_dst == listptr->src)
-	break;
-
-    if (listptr)
-      continue;
+    if (cost)
+      *cost = node->cost;
 
-   /*
-    * See if we have any filters that can convert from the destination type
-    * of this filter to the final type...
-    */
+    if ((filters = cupsArrayNew(NULL, NULL)) != NULL)
+    {
+      for (current = node->filter; current; current = node->filter)
+      {
+        cupsArrayInsert(filters, current);
 
-    listnode.src = current->src;
+	if (current->src == src)
+	  break;
 
-    cupsArraySave(mime->srcs);
-    temp = mime_find_filters(mime, current->dst, srcsize, dst, &tempcost,
-                             &listnode);
-    cupsArrayRestore(mime->srcs);
+	key.type = current->src;
+	if ((node = (_mime_node_t *)cupsArrayFind(nodes, &key)) == NULL)
+	  break;
+      }
+    }
+  }
 
-    if (!temp)
-      continue;
+  for (node = (_mime_node_t *)cupsArrayFirst(nodes);
+       node;
+       node = (_mime_node_t *)cupsArrayNext(nodes))
+    free(node);
 
-    if (!cost)
-    {
-      DEBUG_printf(("3mime_find_filters: Returning %d filter(s), cost %d:",
-		    cupsArrayCount(temp), tempcost));
+  cupsArrayDelete(nodes);
 
 #ifdef DEBUG
-      for (current = (mime_filter_t *)cupsArrayFirst(temp);
-	   current;
-	   current = (mime_filter_t *)cupsArrayNext(temp))
-	DEBUG_printf(("3mime_find_filters: %s/%s %s/%s %d %s",
-		      current->src->super, current->src->type,
-		      current->dst->super, current->dst->type,
-		      current->cost, current->filter));
+  if (filters)
+  {
+    DEBUG_printf(("3mime_find_filters: Returning %d filter(s), cost %d:",
+		  cupsArrayCount(filters), cost ? *cost : -1));
+
+    for (current = (mime_filter_t *)cupsArrayFirst(filters);
+         current;
+	 current = (mime_filter_t *)cupsArrayNext(filters))
+      DEBUG_printf(("3mime_find_filters: %s/%s %s/%s %d %s",
+                    current->src->super, current->src->type,
+                    current->dst->super, current->dst->type,
+		    current->cost, current->filter));
+  }
+  else
+    DEBUG_puts("3mime_find_filters: Returning NULL (no matches).");
 #endif /* DEBUG */
 
-      return (temp);
-    }
+  return (filters);
+}
 
-   /*
-    * Found a match; see if this one is less costly than the last (if
-    * any...)
-    */
 
-    tempcost += current->cost;
+/*
+ * 'mime_find_limit()' - Find the smallest filter maxsize that allows a file
+ *                       size, or 0 if there is none.
+ */
 
-    if (tempcost < mincost)
-    {
-      cupsArrayDelete(mintemp);
+static size_t				/* O - Smallest maxsize >= srcsize */
+mime_find_limit(mime_t *mime,		/* I - MIME database */
+                size_t srcsize)		/* I - Size of source file */
+{
+  int	left,				/* Left side of search */
+	right,				/* Right side of search */
+	middle;				/* Middle of search */
 
-     /*
-      * Hey, we got a match!  Add the current filter to the beginning of the
-      * filter list...
-      */
 
-      mintemp = temp;
-      mincost = tempcost;
-      cupsArrayInsert(mintemp, current);
-    }
+  for (left = 0, right = mime->num_maxsizes; left < right;)
+  {
+    middle = (left + right) / 2;
+
+    if (mime->maxsizes[middle] < srcsize)
+      left = middle + 1;
     else
-      cupsArrayDelete(temp);
+      right = middle;
   }
 
-  if (mintemp)
-  {
-   /*
-    * Hey, we got a match!
-    */
+  return (left < mime->num_maxsizes ? mime->maxsizes[left] : 0);
+}
 
-    DEBUG_printf(("3mime_find_filters: Returning %d filter(s), cost %d:",
-                  cupsArrayCount(mintemp), mincost));
 
-#ifdef DEBUG
-    for (current = (mime_filter_t *)cupsArrayFirst(mintemp);
-         current;
-	 current = (mime_filter_t *)cupsArrayNext(mintemp))
-      DEBUG_printf(("3mime_find_filters: %s/%s %s/%s %d %s",
-                    current->src->super, current->src->type,
-                    current->dst->super, current->dst->type,
-		    current->cost, current->filter));
-#endif /* DEBUG */
+/*
+ * 'mime_load_sizes()' - Collect the distinct filter maxsize values.
+ *
+ * Only the maxsize values of the filters matter for the file size, so the
+ * chain cache uses the smallest one that allows a file as part of its key.
+ */
 
-    if (cost)
-      *cost = mincost;
+static void
+mime_load_sizes(mime_t *mime)		/* I - MIME database */
+{
+  int		i,			/* Looping var */
+		count;			/* Number of filters */
+  mime_filter_t	*current;		/* Current filter */
 
-    return (mintemp);
-  }
 
-  DEBUG_puts("3mime_find_filters: Returning NULL (no matches).");
+  free(mime->maxsizes);
+  mime->maxsizes     = NULL;
+  mime->num_maxsizes = 0;
+
+ /*
+  * Use indices so we don't disturb the caller's mimeFirstFilter/
+  * mimeNextFilter loop...
+  */
+
+  for (i = 0, count = 0; i < cupsArrayCount(mime->filters); i ++)
+    if (((mime_filter_t *)cupsArrayIndex(mime->filters, i))->maxsize > 0)
+      count ++;
+
+  if (!count || (mime->maxsizes = calloc((size_t)count, sizeof(size_t))) == NULL)
+    return;
+
+  for (i = 0; i < cupsArrayCount(mime->filters); i ++)
+    if ((current = (mime_filter_t *)cupsArrayIndex(mime->filters, i))->maxsize > 0)
+      mime->maxsizes[mime->num_maxsizes ++] = current->maxsize;
+
+  qsort(mime->maxsizes, (size_t)mime->num_maxsizes, sizeof(size_t),
+        (int (*)(const void *, const void *))mime_compare_sizes);
+
+  for (i = 1, count = 1; i < mime->num_maxsizes; i ++)
+    if (mime->maxsizes[i] != mime->maxsizes[count - 1])
+      mime->maxsizes[count ++] = mime->maxsizes[i];
 
-  return (NULL);
+  mime->num_maxsizes = count;
 }
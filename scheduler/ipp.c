@@ -29,6 +29,44 @@ extern int mbr_check_membership_by_id(uuid_t user, gid_t group, int* ismember);
 #endif /* __APPLE__ */
 
 
+/*
+ * Local types...
+ */
+
+typedef enum cupsd_workstate_e		/**** State of a worker thread response ****/
+{
+  CUPSD_WORK_QUEUED,			/* Waiting for a worker thread */
+  CUPSD_WORK_COPYING,			/* Being copied by a worker thread */
+  CUPSD_WORK_DONE			/* Ready to send */
+} cupsd_workstate_t;
+
+typedef struct cupsd_ippwork_s		/**** Response completed by a worker thread ****/
+{
+  cupsd_workstate_t	state;		/* State, protected by work_mutex */
+  cupsd_client_t	*con;		/* Client connection, NULL if closed */
+  cupsd_printer_t	*printer;	/* Printer, NULL if deleted */
+  ipp_t			*block,		/* Static printer attributes */
+			*response;	/* Response being completed */
+} cupsd_ippwork_t;
+
+
+/*
+ * Local globals...
+ */
+
+static cups_array_t	*work_items = NULL;
+					/* Responses handed to worker threads */
+static _cups_mutex_t	work_mutex = _CUPS_MUTEX_INITIALIZER;
+					/* Mutex for responses and threads */
+static _cups_cond_t	work_cond = _CUPS_COND_INITIALIZER;
+					/* Condition for queued responses */
+static int		work_idle = 0,	/* Number of idle worker threads */
+			work_pipe[2] = { -1, -1 },
+					/* Pipe for completed responses */
+			work_threads = 0;
+					/* Number of worker threads */
+
+
 /*
  * Local functions...
  */
@@ -42,6 +80,8 @@ static cupsd_job_t *add_job(cupsd_client_t *con, cupsd_printer_t *printer,
 static void	add_job_subscriptions(cupsd_client_t *con, cupsd_job_t *job);
 static void	add_job_uuid(cupsd_job_t *job);
 static void	add_printer(cupsd_client_t *con, ipp_attribute_t *uri);
+static void	add_printer_filter_stats(cupsd_client_t *con,
+		                         cupsd_printer_t *p);
 static void	add_printer_state_reasons(cupsd_client_t *con,
 		                          cupsd_printer_t *p);
 static void	add_queued_job_count(cupsd_client_t *con, cupsd_printer_t *p);
@@ -54,7 +94,7 @@ static void	cancel_subscription(cupsd_client_t *con, int id);
 static int	check_rss_recipient(const char *recipient);
 static int	check_quotas(cupsd_client_t *con, cupsd_printer_t *p);
 static void	close_job(cupsd_client_t *con, ipp_attribute_t *uri);
-static void	copy_attrs(ipp_t *to, ipp_t *from, cups_array_t *ra,
+static void	copy_attrs(ipp_t *to, ipp_t *from, _ipp_rset_t *ra,
 		           ipp_tag_t group, int quickcopy,
 			   cups_array_t *exclude);
 static int	copy_banner(cupsd_client_t *con, cupsd_job_t *job,
@@ -64,20 +104,27 @@ static int	copy_model(cupsd_client_t *con, const char *from,
 		           const char *to);
 static void	copy_job_attrs(cupsd_client_t *con,
 		               cupsd_job_t *job,
-			       cups_array_t *ra, cups_array_t *exclude);
+			       _ipp_rset_t *ra, cups_array_t *exclude);
 static void	copy_printer_attrs(cupsd_client_t *con,
 		                   cupsd_printer_t *printer,
-				   cups_array_t *ra);
+				   _ipp_rset_t *ra, ipp_t **static_attrs);
+static ipp_t	*copy_request(ipp_t *request);
 static void	copy_subscription_attrs(cupsd_client_t *con,
 		                        cupsd_subscription_t *sub,
-					cups_array_t *ra,
+					_ipp_rset_t *ra,
 					cups_array_t *exclude);
+static int	copy_unshared(ipp_t *to, ipp_t *from);
 static void	create_job(cupsd_client_t *con, ipp_attribute_t *uri);
 static void	*create_local_bg_thread(cupsd_printer_t *printer);
 static void	create_local_printer(cupsd_client_t *con);
-static cups_array_t *create_requested_array(ipp_t *request);
+static ipp_t	*create_printer_block(cupsd_client_t *con,
+		                      cupsd_printer_t *printer,
+				      _ipp_rset_t *ra);
+static char	*create_printer_key(cupsd_client_t *con, _ipp_rset_t *ra);
+static _ipp_rset_t *create_requested_array(ipp_t *request);
 static void	create_subscriptions(cupsd_client_t *con, ipp_attribute_t *uri);
 static void	delete_printer(cupsd_client_t *con, ipp_attribute_t *uri);
+static void	finish_printer_attrs(void *data);
 static void	get_default(cupsd_client_t *con);
 static void	get_devices(cupsd_client_t *con);
 static void	get_document(cupsd_client_t *con, ipp_attribute_t *uri);
@@ -98,11 +145,15 @@ static void	move_job(cupsd_client_t *con, ipp_attribute_t *uri);
 static int	ppd_parse_line(const char *line, char *option, int olen,
 		               char *choice, int clen);
 static void	print_job(cupsd_client_t *con, ipp_attribute_t *uri);
+static void	*printer_attrs_thread(void *data);
+static void	queue_printer_attrs(cupsd_client_t *con,
+		                    cupsd_printer_t *printer, ipp_t *block);
 static void	read_job_ticket(cupsd_client_t *con);
 static void	reject_jobs(cupsd_client_t *con, ipp_attribute_t *uri);
 static void	release_held_new_jobs(cupsd_client_t *con,
 		                      ipp_attribute_t *uri);
 static void	release_job(cupsd_client_t *con, ipp_attribute_t *uri);
+static void	release_printer_block(cupsd_printer_t *printer, ipp_t *block);
 static void	renew_subscription(cupsd_client_t *con, int sub_id);
 static void	restart_job(cupsd_client_t *con, ipp_attribute_t *uri);
 static void	save_auth_info(cupsd_client_t *con, cupsd_job_t *job,
@@ -111,6 +162,7 @@ static void	send_document(cupsd_client_t *con, ipp_attribute_t *uri);
 static void	send_http_error(cupsd_client_t *con, http_status_t status,
 		                cupsd_printer_t *printer);
 static void	send_ipp_status(cupsd_client_t *con, ipp_status_t status, const char *message, ...) _CUPS_FORMAT(3, 4);
+static int	send_response(cupsd_client_t *con, ipp_attribute_t *uri);
 static void	set_default(cupsd_client_t *con, ipp_attribute_t *uri);
 static void	set_job_attrs(cupsd_client_t *con, ipp_attribute_t *uri);
 static void	set_printer_attrs(cupsd_client_t *con, ipp_attribute_t *uri);
@@ -125,6 +177,160 @@ static int	validate_name(const char *name);
 static int	validate_user(cupsd_job_t *job, cupsd_client_t *con, const char *owner, char *username, size_t userlen);
 
 
+/*
+ * 'cupsdCancelIPPWork()' - Forget the response a worker thread is completing
+ *                          for a client that is being closed.
+ *
+ * The response is freed when the worker thread is done with it.
+ */
+
+void
+cupsdCancelIPPWork(cupsd_client_t *con)	/* I - Client connection */
+{
+  if (con->work)
+  {
+    con->work->con = NULL;
+    con->work      = NULL;
+  }
+}
+
+
+/*
+ * 'cupsdClearIPPWork()' - Forget a printer that is being deleted.
+ *
+ * Static attributes handed to worker threads are then freed without the
+ * printer's cache lock.
+ */
+
+void
+cupsdClearIPPWork(cupsd_printer_t *p)	/* I - Printer */
+{
+  int			i,		/* Looping var */
+			count;		/* Number of responses */
+  cupsd_ippwork_t	*work;		/* Current response */
+
+
+  _cupsMutexLock(&work_mutex);
+
+  for (i = 0, count = cupsArrayCount(work_items); i < count; i ++)
+  {
+    work = (cupsd_ippwork_t *)cupsArrayIndex(work_items, i);
+
+    if (work->printer == p)
+      work->printer = NULL;
+  }
+
+  _cupsMutexUnlock(&work_mutex);
+}
+
+
+/*
+ * 'cupsdFinishIPPStream()' - Finish a request whose document was streamed
+ *                            to a job.
+ *
+ * When the document is complete, the job's quota and size are updated and
+ * the response is sent.  An empty document is rejected with the same error
+ * as a request that was not streamed.  Otherwise the job is aborted and the
+ * response is discarded.
+ *
+ * The caller closes the connection when the response cannot be sent.
+ */
+
+int					/* O - 1 on success, 0 on failure */
+cupsdFinishIPPStream(
+    cupsd_client_t *con,		/* I - Client connection */
+    int            complete)		/* I - 1 if the document is complete */
+{
+  cupsd_job_t	*job;			/* Job */
+  char		filename[1024];		/* Document filename */
+  struct stat	fileinfo;		/* Document information */
+  int		kbytes;			/* Size of document */
+  ipp_attribute_t *attr;		/* job-k-octets attribute */
+
+
+  if ((job = cupsdFindJob(con->stream_job)) != NULL && job->streaming)
+  {
+    if (complete)
+    {
+      snprintf(filename, sizeof(filename), "%s/d%05d-%03d", RequestRoot,
+               job->id, job->streaming);
+
+      if (stat(filename, &fileinfo) || fileinfo.st_size == 0)
+      {
+       /*
+        * Don't allow empty documents, just like cupsdReadClient() does for
+	* requests that are not streamed - a new job is removed and an
+	* existing job is aborted...
+	*/
+
+	job->streaming = 0;
+
+	cupsdSetJobState(job, IPP_JOB_ABORTED,
+	                 con->request->request.op.operation_id == IPP_OP_PRINT_JOB ? CUPSD_JOB_PURGE : CUPSD_JOB_DEFAULT,
+			 "Job aborted because the document was empty.");
+
+	ippDelete(con->response);
+
+	con->response = _ippNewArena();
+
+	con->response->request.status.version[0] = con->request->request.op.version[0];
+	con->response->request.status.version[1] = con->request->request.op.version[1];
+	con->response->request.status.request_id = con->request->request.op.request_id;
+
+	send_ipp_status(con, IPP_BAD_REQUEST, _("No file in print request."));
+      }
+      else
+      {
+	kbytes = (int)((fileinfo.st_size + 1023) / 1024);
+
+	cupsdUpdateQuota(job->printer ? job->printer : cupsdFindDest(job->dest),
+                         job->username, 0, kbytes);
+
+	job->koctets += kbytes;
+
+	if ((attr = ippFindAttribute(job->attrs, "job-k-octets", IPP_TAG_INTEGER)) != NULL)
+	  attr->values[0].integer += kbytes;
+
+	job->streaming = 0;
+	job->dirty     = 1;
+
+	cupsdMarkDirty(CUPSD_DIRTY_JOBS);
+	cupsdUpdateJobStream(job);
+
+	cupsdLogJob(job, CUPSD_LOG_DEBUG,
+		    "Received %d kbytes of streamed document data.", kbytes);
+      }
+    }
+    else
+    {
+      job->streaming = 0;
+
+      cupsdSetJobState(job, IPP_JOB_ABORTED, CUPSD_JOB_DEFAULT,
+                       "Job aborted because the document was not received.");
+    }
+  }
+
+  if (complete)
+  {
+    con->streaming  = 0;
+    con->stream_job = 0;
+
+    return (send_response(con, ippFindAttribute(con->request, "printer-uri",
+                                               IPP_TAG_URI)));
+  }
+  else
+  {
+    con->streaming  = -1;
+    con->stream_job = 0;
+
+    ippDelete(con->response);
+    con->response = NULL;
+
+    return (1);
+  }
+}
+
+
 /*
  * 'cupsdProcessIPPRequest()' - Process an incoming IPP request.
  */
@@ -172,7 +378,7 @@ cupsdProcessIPPRequest(
   * First build an empty response message for this request...
   */
 
-  con->response = ippNew();
+  con->response = _ippNewArena();
 
   con->response->request.status.version[0] = con->request->request.op.version[0];
   con->response->request.status.version[1] = con->request->request.op.version[1];
@@ -615,78 +821,114 @@ cupsdProcessIPPRequest(
     }
   }
 
-  if (con->response)
+  if (con->streaming > 0)
   {
    /*
-    * Sending data from the scheduler...
+    * Hold the response until the document has been received...
     */
 
-    cupsdLogClient(con, con->response->request.status.status_code >= IPP_STATUS_ERROR_BAD_REQUEST && con->response->request.status.status_code != IPP_STATUS_ERROR_NOT_FOUND ? CUPSD_LOG_ERROR : CUPSD_LOG_DEBUG, "Returning IPP %s for %s (%s) from %s.",  ippErrorString(con->response->request.status.status_code), ippOpString(con->request->request.op.operation_id), uri ? uri->values[0].string.text : "no URI", con->http->hostname);
-
-    httpClearFields(con->http);
+    return (1);
+  }
 
-#ifdef CUPSD_USE_CHUNKING
+  if (con->work)
+  {
    /*
-    * Because older versions of CUPS (1.1.17 and older) and some IPP
-    * clients do not implement chunking properly, we cannot use
-    * chunking by default.  This may become the default in future
-    * CUPS releases, or we might add a configuration directive for
-    * it.
+    * Hold the response until a worker thread has copied the printer
+    * attributes...
     */
 
-    if (con->http->version == HTTP_1_1)
-    {
-      cupsdLogClient(con, CUPSD_LOG_DEBUG, "Transfer-Encoding: chunked");
-      cupsdSetLength(con->http, 0);
-    }
-    else
-#endif /* CUPSD_USE_CHUNKING */
-    {
-      size_t	length;			/* Length of response */
+    return (1);
+  }
 
+  return (send_response(con, uri));
+}
 
-      length = ippLength(con->response);
 
-      if (con->file >= 0 && !con->pipe_pid)
-      {
-	struct stat	fileinfo;	/* File information */
+/*
+ * 'cupsdStartIPPStream()' - Process a Print-Job or Send-Document request
+ *                           before its document has been received.
+ *
+ * This is only done when "StreamingPrint" is enabled and the request names an
+ * explicit, uncompressed document format, so that the document does not need
+ * to be auto-typed.  If no job gets the document, the original request is
+ * restored and processed again once the document has been received.  The
+ * response is held until @link cupsdFinishIPPStream@ is called.
+ */
 
-	if (!fstat(con->file, &fileinfo))
-	  length += (size_t)fileinfo.st_size;
-      }
+int					/* O - 1 if streaming, 0 otherwise */
+cupsdStartIPPStream(
+    cupsd_client_t *con)		/* I - Client connection */
+{
+  ipp_attribute_t *uri,			/* printer-uri attribute */
+		*attr;			/* Other attribute */
+  cupsd_printer_t *printer;		/* Printer */
+  ipp_t		*request;		/* Copy of original request */
 
-      cupsdLogClient(con, CUPSD_LOG_DEBUG, "Content-Length: " CUPS_LLFMT, CUPS_LLCAST length);
-      httpSetLength(con->http, length);
-    }
 
-    if (cupsdSendHeader(con, HTTP_OK, "application/ipp", CUPSD_AUTH_NONE))
-    {
-     /*
-      * Tell the caller the response header was sent successfully...
-      */
+  if (!StreamingPrint || con->streaming || !con->request || con->file < 0 ||
+      (con->request->request.op.operation_id != IPP_OP_PRINT_JOB &&
+       con->request->request.op.operation_id != IPP_OP_SEND_DOCUMENT))
+    return (0);
 
-      cupsdAddSelect(httpGetFd(con->http), (cupsd_selfunc_t)cupsdReadClient, (cupsd_selfunc_t)cupsdWriteClient, con);
+  if (con->request->request.op.operation_id == IPP_OP_PRINT_JOB &&
+      ((uri = ippFindAttribute(con->request, "printer-uri",
+                               IPP_TAG_URI)) == NULL ||
+       !cupsdValidateDest(uri->values[0].string.text, NULL, &printer) ||
+       !printer->accepting ||
+       cupsdCheckPolicy(printer->op_policy_ptr, con, NULL) != HTTP_OK))
+    return (0);
 
-      return (1);
-    }
-    else
-    {
-     /*
-      * Tell the caller the response header could not be sent...
-      */
+ /*
+  * PostScript and PDF documents may contain job ticket comments that need to
+  * be read before the job is created, so don't stream them...
+  */
 
-      return (0);
-    }
-  }
-  else
+  if ((attr = ippFindAttribute(con->request, "document-format",
+                               IPP_TAG_MIMETYPE)) == NULL ||
+      !strcmp(attr->values[0].string.text, "application/octet-stream") ||
+      !strcmp(attr->values[0].string.text, "application/pdf") ||
+      !strcmp(attr->values[0].string.text, "application/postscript"))
+    return (0);
+
+  if ((attr = ippFindAttribute(con->request, "compression",
+                               IPP_TAG_KEYWORD)) != NULL &&
+      strcmp(attr->values[0].string.text, "none"))
+    return (0);
+
+ /*
+  * Process the request now, keeping a copy in case the job cannot be
+  * created and the request has to be processed again after the document is
+  * received...
+  */
+
+  if ((request = ippNew()) == NULL)
+    return (0);
+
+  request->request = con->request->request;
+  ippCopyAttributes(request, con->request, 1, NULL, NULL);
+
+  con->streaming = 1;
+
+  cupsdProcessIPPRequest(con);
+
+  if (con->stream_job)
   {
-   /*
-    * Sending data from a subprocess like cups-deviced; tell the caller
-    * everything is A-OK so far...
-    */
+    ippDelete(request);
 
+    cupsdLogClient(con, CUPSD_LOG_DEBUG, "Streaming document data to job %d.",
+                   con->stream_job);
     return (1);
   }
+
+  ippDelete(con->request);
+  con->request = request;
+
+  ippDelete(con->response);
+  con->response = NULL;
+
+  con->streaming = -1;
+
+  return (0);
 }
 
 
@@ -1579,9 +1821,20 @@ add_job(cupsd_client_t  *con,		/* I - Client connection */
   }
 
   job->dtype   = printer->type & (CUPS_PRINTER_CLASS | CUPS_PRINTER_REMOTE);
-  job->attrs   = con->request;
+  job->attrs   = copy_request(con->request);
   job->dirty   = 1;
-  con->request = ippNewRequest(job->attrs->request.op.operation_id);
+
+  if (!job->attrs)
+  {
+    send_ipp_status(con, IPP_INTERNAL_ERROR,
+                    _("Unable to add job for destination \"%s\"."),
+		    printer->name);
+    cupsdDeleteJob(job, CUPSD_JOB_PURGE);
+    return (NULL);
+  }
+
+  attr      = ippFindAttribute(job->attrs, "requesting-user-name", IPP_TAG_NAME);
+  auth_info = ippFindAttribute(job->attrs, "auth-info", IPP_TAG_TEXT);
 
   cupsdMarkDirty(CUPSD_DIRTY_JOBS);
 
@@ -1606,6 +1859,8 @@ add_job(cupsd_client_t  *con,		/* I - Client connection */
   else
     cupsdSetString(&job->username, "anonymous");
 
+  cupsdUpdateJobCounts(job);
+
   if (!attr)
     ippAddString(job->attrs, IPP_TAG_JOB, IPP_TAG_NAME,
                  "job-originating-user-name", NULL, job->username);
@@ -1747,6 +2002,9 @@ add_job(cupsd_client_t  *con,		/* I - Client connection */
     ippSetString(job->attrs, &job->reasons, 0, "none");
   }
 
+  cupsdUpdateJobTimer(job);
+  cupsdUpdateJobQueue(job);
+
   if (!(printer->type & CUPS_PRINTER_REMOTE) || Classification)
   {
    /*
@@ -1952,8 +2210,7 @@ add_job_subscriptions(
     cupsd_job_t    *job)		/* I - Newly created job */
 {
   int			i;		/* Looping var */
-  ipp_attribute_t	*prev,		/* Previous attribute */
-			*next,		/* Next attribute */
+  ipp_attribute_t	*next,		/* Next attribute */
 			*attr;		/* Current attribute */
   cupsd_subscription_t	*sub;		/* Subscription object */
   const char		*recipient,	/* notify-recipient-uri */
@@ -2148,7 +2405,7 @@ add_job_subscriptions(
   * end of the request...
   */
 
-  for (attr = job->attrs->attrs, prev = NULL; attr; attr = next)
+  for (attr = job->attrs->attrs; attr; attr = next)
   {
     next = attr->next;
 
@@ -2159,19 +2416,9 @@ add_job_subscriptions(
       * Free and remove this attribute...
       */
 
-      ippDeleteAttribute(NULL, attr);
-
-      if (prev)
-        prev->next = next;
-      else
-        job->attrs->attrs = next;
+      ippDeleteAttribute(job->attrs, attr);
     }
-    else
-      prev = attr;
   }
-
-  job->attrs->last    = prev;
-  job->attrs->current = prev;
 }
 
 
@@ -2759,6 +3006,12 @@ add_printer(cupsd_client_t  *con,	/* I - Client connection */
 
     cupsdSetPrinterReasons(printer, "none");
 
+   /*
+    * Stop any filters that were started with the old PPD file...
+    */
+
+    cupsdStopFilterWorkers(printer);
+
    /*
     * (Re)register color profiles...
     */
@@ -2823,6 +3076,7 @@ add_printer(cupsd_client_t  *con,	/* I - Client connection */
   }
 
   cupsdSetPrinterAttrs(printer);
+  cupsdStartFilterWorkers(printer);
 
   if (need_restart_job && printer->job)
   {
@@ -2859,6 +3113,67 @@ add_printer(cupsd_client_t  *con,	/* I - Client connection */
 }
 
 
+/*
+ * 'add_printer_filter_stats()' - Add the "printer-filter-stats" attribute
+ *                                for the filters and backends run so far.
+ */
+
+static void
+add_printer_filter_stats(
+    cupsd_client_t  *con,		/* I - Client connection */
+    cupsd_printer_t *p)			/* I - Printer info */
+{
+  cupsd_filterstats_t	*stats;		/* Current statistics */
+  ipp_t			*col;		/* Statistics collection */
+  ipp_attribute_t	*attr = NULL;	/* printer-filter-stats attribute */
+
+
+  cupsdLogMessage(CUPSD_LOG_DEBUG2,
+                  "add_printer_filter_stats(%p[%d], %p[%s])",
+                  con, con->number, p, p->name);
+
+  if (cupsArrayCount(p->filter_stats) == 0)
+  {
+    ippAddOutOfBand(con->response, IPP_TAG_PRINTER, IPP_TAG_NOVALUE,
+                    "printer-filter-stats");
+    return;
+  }
+
+  for (stats = (cupsd_filterstats_t *)cupsArrayFirst(p->filter_stats);
+       stats;
+       stats = (cupsd_filterstats_t *)cupsArrayNext(p->filter_stats))
+  {
+    col = ippNew();
+
+    ippAddString(col, IPP_TAG_ZERO, IPP_TAG_NAME, "filter-name", NULL,
+                 stats->name);
+    ippAddInteger(col, IPP_TAG_ZERO, IPP_TAG_INTEGER, "process-count",
+                  stats->count);
+    ippAddInteger(col, IPP_TAG_ZERO, IPP_TAG_INTEGER, "user-cpu-time",
+                  stats->user_time > INT_MAX ? INT_MAX :
+                                               (int)stats->user_time);
+    ippAddInteger(col, IPP_TAG_ZERO, IPP_TAG_INTEGER, "system-cpu-time",
+                  stats->system_time > INT_MAX ? INT_MAX :
+                                                 (int)stats->system_time);
+    ippAddInteger(col, IPP_TAG_ZERO, IPP_TAG_INTEGER, "wall-time",
+                  stats->wall_time > INT_MAX ? INT_MAX :
+                                               (int)stats->wall_time);
+    ippAddInteger(col, IPP_TAG_ZERO, IPP_TAG_INTEGER, "max-rss",
+                  (int)stats->max_rss);
+    ippAddIntegers(col, IPP_TAG_ZERO, IPP_TAG_INTEGER, "wall-time-histogram",
+                   CUPSD_FILTERSTATS_BUCKETS, stats->wall_times);
+
+    if (attr)
+      ippSetCollection(con->response, &attr, ippGetCount(attr), col);
+    else
+      attr = ippAddCollection(con->response, IPP_TAG_PRINTER,
+                              "printer-filter-stats", col);
+
+    ippDelete(col);
+  }
+}
+
+
 /*
  * 'add_printer_state_reasons()' - Add the "printer-state-reasons" attribute
  *                                 based upon the printer state...
@@ -3999,6 +4314,8 @@ close_job(cupsd_client_t  *con,		/* I - Client connection */
     }
   }
 
+  cupsdUpdateJobQueue(job);
+
   job->dirty = 1;
   cupsdMarkDirty(CUPSD_DIRTY_JOBS);
 
@@ -4032,7 +4349,7 @@ close_job(cupsd_client_t  *con,		/* I - Client connection */
 static void
 copy_attrs(ipp_t        *to,		/* I - Destination request */
            ipp_t        *from,		/* I - Source request */
-           cups_array_t *ra,		/* I - Requested attributes */
+           _ipp_rset_t  *ra,		/* I - Requested attributes */
 	   ipp_tag_t    group,		/* I - Group to copy */
 	   int          quickcopy,	/* I - Do a quick copy? */
 	   cups_array_t *exclude)	/* I - Attributes to exclude? */
@@ -4082,7 +4399,7 @@ copy_attrs(ipp_t        *to,		/* I - Destination request */
         continue;
     }
 
-    if (!ra || cupsArrayFind(ra, fromattr->name))
+    if (!ra || _ippRSetFind(ra, fromattr->name))
     {
      /*
       * Don't send collection attributes by default to IPP/1.x clients
@@ -4500,7 +4817,7 @@ copy_model(cupsd_client_t *con,		/* I - Client connection */
                   "copy_model: Running \"cups-driverd cat %s\"...", from);
 
   if (!cupsdStartProcess(buffer, argv, envp, -1, temppipe[1], CGIPipes[1],
-                         -1, -1, 0, DefaultProfile, NULL, &temppid))
+                         -1, -1, -1, -1, 0, DefaultProfile, NULL, &temppid))
   {
     send_ipp_status(con, IPP_INTERNAL_ERROR, _("Unable to run cups-driverd: %s"), strerror(errno));
     close(tempfd);
@@ -4749,7 +5066,7 @@ copy_model(cupsd_client_t *con,		/* I - Client connection */
 static void
 copy_job_attrs(cupsd_client_t *con,	/* I - Client connection */
 	       cupsd_job_t    *job,	/* I - Job */
-	       cups_array_t   *ra,	/* I - Requested attributes array */
+	       _ipp_rset_t    *ra,	/* I - Requested attributes set */
 	       cups_array_t   *exclude)	/* I - Private attributes array */
 {
   char	job_uri[HTTP_MAX_URI];		/* Job URI */
@@ -4762,17 +5079,17 @@ copy_job_attrs(cupsd_client_t *con,	/* I - Client connection */
   if (!cupsArrayFind(exclude, "all"))
   {
     if ((!exclude || !cupsArrayFind(exclude, "number-of-documents")) &&
-        (!ra || cupsArrayFind(ra, "number-of-documents")))
+        (!ra || _ippRSetFind(ra, "number-of-documents")))
       ippAddInteger(con->response, IPP_TAG_JOB, IPP_TAG_INTEGER,
 		    "number-of-documents", job->num_files);
 
     if ((!exclude || !cupsArrayFind(exclude, "job-media-progress")) &&
-        (!ra || cupsArrayFind(ra, "job-media-progress")))
+        (!ra || _ippRSetFind(ra, "job-media-progress")))
       ippAddInteger(con->response, IPP_TAG_JOB, IPP_TAG_INTEGER,
 		    "job-media-progress", job->progress);
 
     if ((!exclude || !cupsArrayFind(exclude, "job-more-info")) &&
-        (!ra || cupsArrayFind(ra, "job-more-info")))
+        (!ra || _ippRSetFind(ra, "job-more-info")))
     {
       httpAssembleURIf(HTTP_URI_CODING_ALL, job_uri, sizeof(job_uri), "http",
                        NULL, con->clientname, con->clientport, "/jobs/%d",
@@ -4783,17 +5100,17 @@ copy_job_attrs(cupsd_client_t *con,	/* I - Client connection */
 
     if (job->state_value > IPP_JOB_PROCESSING &&
 	(!exclude || !cupsArrayFind(exclude, "job-preserved")) &&
-        (!ra || cupsArrayFind(ra, "job-preserved")))
+        (!ra || _ippRSetFind(ra, "job-preserved")))
       ippAddBoolean(con->response, IPP_TAG_JOB, "job-preserved",
 		    job->num_files > 0);
 
     if ((!exclude || !cupsArrayFind(exclude, "job-printer-up-time")) &&
-        (!ra || cupsArrayFind(ra, "job-printer-up-time")))
+        (!ra || _ippRSetFind(ra, "job-printer-up-time")))
       ippAddInteger(con->response, IPP_TAG_JOB, IPP_TAG_INTEGER,
 		    "job-printer-up-time", time(NULL));
   }
 
-  if (!ra || cupsArrayFind(ra, "job-printer-uri"))
+  if (!ra || _ippRSetFind(ra, "job-printer-uri"))
   {
     httpAssembleURIf(HTTP_URI_CODING_ALL, job_uri, sizeof(job_uri), "ipp", NULL,
 		     con->clientname, con->clientport,
@@ -4804,7 +5121,7 @@ copy_job_attrs(cupsd_client_t *con,	/* I - Client connection */
         	 "job-printer-uri", NULL, job_uri);
   }
 
-  if (!ra || cupsArrayFind(ra, "job-uri"))
+  if (!ra || _ippRSetFind(ra, "job-uri"))
   {
     httpAssembleURIf(HTTP_URI_CODING_ALL, job_uri, sizeof(job_uri), "ipp", NULL,
 		     con->clientname, con->clientport, "/jobs/%d",
@@ -4823,28 +5140,28 @@ copy_job_attrs(cupsd_client_t *con,	/* I - Client connection */
     * Generate attributes from the job structure...
     */
 
-    if (job->completed_time && (!ra || cupsArrayFind(ra, "date-time-at-completed")))
+    if (job->completed_time && (!ra || _ippRSetFind(ra, "date-time-at-completed")))
       ippAddDate(con->response, IPP_TAG_JOB, "date-time-at-completed", ippTimeToDate(job->completed_time));
 
-    if (job->creation_time && (!ra || cupsArrayFind(ra, "date-time-at-creation")))
+    if (job->creation_time && (!ra || _ippRSetFind(ra, "date-time-at-creation")))
       ippAddDate(con->response, IPP_TAG_JOB, "date-time-at-creation", ippTimeToDate(job->creation_time));
 
-    if (!ra || cupsArrayFind(ra, "job-id"))
+    if (!ra || _ippRSetFind(ra, "job-id"))
       ippAddInteger(con->response, IPP_TAG_JOB, IPP_TAG_INTEGER, "job-id", job->id);
 
-    if (!ra || cupsArrayFind(ra, "job-k-octets"))
+    if (!ra || _ippRSetFind(ra, "job-k-octets"))
       ippAddInteger(con->response, IPP_TAG_JOB, IPP_TAG_INTEGER, "job-k-octets", job->koctets);
 
-    if (job->name && (!ra || cupsArrayFind(ra, "job-name")))
+    if (job->name && (!ra || _ippRSetFind(ra, "job-name")))
       ippAddString(con->response, IPP_TAG_JOB, IPP_TAG_NAME, "job-name", NULL, job->name);
 
-    if (job->username && (!ra || cupsArrayFind(ra, "job-originating-user-name")))
+    if (job->username && (!ra || _ippRSetFind(ra, "job-originating-user-name")))
       ippAddString(con->response, IPP_TAG_JOB, IPP_TAG_NAME, "job-originating-user-name", NULL, job->username);
 
-    if (!ra || cupsArrayFind(ra, "job-state"))
+    if (!ra || _ippRSetFind(ra, "job-state"))
       ippAddInteger(con->response, IPP_TAG_JOB, IPP_TAG_ENUM, "job-state", (int)job->state_value);
 
-    if (!ra || cupsArrayFind(ra, "job-state-reasons"))
+    if (!ra || _ippRSetFind(ra, "job-state-reasons"))
     {
       switch (job->state_value)
       {
@@ -4862,10 +5179,10 @@ copy_job_attrs(cupsd_client_t *con,	/* I - Client connection */
       }
     }
 
-    if (job->completed_time && (!ra || cupsArrayFind(ra, "time-at-completed")))
+    if (job->completed_time && (!ra || _ippRSetFind(ra, "time-at-completed")))
       ippAddInteger(con->response, IPP_TAG_JOB, IPP_TAG_INTEGER, "time-at-completed", (int)job->completed_time);
 
-    if (job->creation_time && (!ra || cupsArrayFind(ra, "time-at-creation")))
+    if (job->creation_time && (!ra || _ippRSetFind(ra, "time-at-creation")))
       ippAddInteger(con->response, IPP_TAG_JOB, IPP_TAG_INTEGER, "time-at-creation", (int)job->creation_time);
   }
 }
@@ -4873,76 +5190,59 @@ copy_job_attrs(cupsd_client_t *con,	/* I - Client connection */
 
 /*
  * 'copy_printer_attrs()' - Copy printer attributes.
+ *
+ * When "static_attrs" is not NULL, the static attributes are not copied but
+ * returned with a reference that is released with
+ * @link release_printer_block@.
  */
 
 static void
 copy_printer_attrs(
     cupsd_client_t  *con,		/* I - Client connection */
     cupsd_printer_t *printer,		/* I - Printer */
-    cups_array_t    *ra)		/* I - Requested attributes array */
+    _ipp_rset_t     *ra,		/* I - Requested attributes set */
+    ipp_t           **static_attrs)	/* O - Static attributes or NULL to copy them now */
 {
-  char		uri[HTTP_MAX_URI];	/* URI value */
   time_t	curtime;		/* Current time */
-  int		i;			/* Looping var */
-  int		is_encrypted = httpIsEncrypted(con->http);
-					/* Is the connection encrypted? */
+  char		*key;			/* Cache key */
+  cupsd_attrcache_t *cache;		/* Cache entry */
+  ipp_t		*block;			/* Static attributes */
+  ipp_attribute_t *attr;		/* Current static attribute */
 
 
  /*
   * Copy the printer attributes to the response using requested-attributes
   * and document-format attributes that may be provided by the client.
+  *
+  * Attributes that change with the printer state are added for every
+  * request, the rest come from a per-printer cache that is cleared whenever
+  * the printer attributes are updated.
   */
 
   _cupsRWLockRead(&printer->lock);
 
   curtime = time(NULL);
 
-  if (!ra || cupsArrayFind(ra, "marker-change-time"))
+  if (!ra || _ippRSetFind(ra, "marker-change-time"))
     ippAddInteger(con->response, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "marker-change-time", printer->marker_time);
 
-  if (printer->num_printers > 0 && (!ra || cupsArrayFind(ra, "member-uris")))
-  {
-    ipp_attribute_t	*member_uris;	/* member-uris attribute */
-    cupsd_printer_t	*p2;		/* Printer in class */
-    ipp_attribute_t	*p2_uri;	/* printer-uri-supported for class printer */
-
-
-    if ((member_uris = ippAddStrings(con->response, IPP_TAG_PRINTER, IPP_TAG_URI, "member-uris", printer->num_printers, NULL, NULL)) != NULL)
-    {
-      for (i = 0; i < printer->num_printers; i ++)
-      {
-        p2 = printer->printers[i];
-
-        if ((p2_uri = ippFindAttribute(p2->attrs, "printer-uri-supported", IPP_TAG_URI)) != NULL)
-        {
-          member_uris->values[i].string.text = _cupsStrAlloc(p2_uri->values[0].string.text);
-        }
-        else
-	{
-	  httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), is_encrypted ? "ipps" : "ipp", NULL, con->clientname, con->clientport, (p2->type & CUPS_PRINTER_CLASS) ? "/classes/%s" : "/printers/%s", p2->name);
-	  member_uris->values[i].string.text = _cupsStrAlloc(uri);
-        }
-      }
-    }
-  }
-
-  if (printer->alert && (!ra || cupsArrayFind(ra, "printer-alert")))
+  if (printer->alert && (!ra || _ippRSetFind(ra, "printer-alert")))
     ippAddOctetString(con->response, IPP_TAG_PRINTER, "printer-alert", printer->alert, (int)strlen(printer->alert));
 
-  if (printer->alert_description && (!ra || cupsArrayFind(ra, "printer-alert-description")))
+  if (printer->alert_description && (!ra || _ippRSetFind(ra, "printer-alert-description")))
     ippAddString(con->response, IPP_TAG_PRINTER, IPP_TAG_TEXT, "printer-alert-description", NULL, printer->alert_description);
 
-  if (!ra || cupsArrayFind(ra, "printer-config-change-date-time"))
+  if (!ra || _ippRSetFind(ra, "printer-config-change-date-time"))
     ippAddDate(con->response, IPP_TAG_PRINTER, "printer-config-change-date-time", ippTimeToDate(printer->config_time));
 
-  if (!ra || cupsArrayFind(ra, "printer-config-change-time"))
+  if (!ra || _ippRSetFind(ra, "printer-config-change-time"))
     ippAddInteger(con->response, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "printer-config-change-time", printer->config_time);
 
-  if (!ra || cupsArrayFind(ra, "printer-current-time"))
+  if (!ra || _ippRSetFind(ra, "printer-current-time"))
     ippAddDate(con->response, IPP_TAG_PRINTER, "printer-current-time", ippTimeToDate(curtime));
 
 #ifdef HAVE_DNSSD
-  if (!ra || cupsArrayFind(ra, "printer-dns-sd-name"))
+  if (!ra || _ippRSetFind(ra, "printer-dns-sd-name"))
   {
     if (printer->reg_name)
       ippAddString(con->response, IPP_TAG_PRINTER, IPP_TAG_NAME, "printer-dns-sd-name", NULL, printer->reg_name);
@@ -4951,73 +5251,40 @@ copy_printer_attrs(
   }
 #endif /* HAVE_DNSSD */
 
-  if (!ra || cupsArrayFind(ra, "printer-error-policy"))
+  if (!ra || _ippRSetFind(ra, "printer-error-policy"))
     ippAddString(con->response, IPP_TAG_PRINTER, IPP_TAG_NAME, "printer-error-policy", NULL, printer->error_policy);
 
-  if (!ra || cupsArrayFind(ra, "printer-error-policy-supported"))
-  {
-    static const char * const errors[] =/* printer-error-policy-supported values */
-    {
-      "abort-job",
-      "retry-current-job",
-      "retry-job",
-      "stop-printer"
-    };
-
-    if (printer->type & CUPS_PRINTER_CLASS)
-      ippAddString(con->response, IPP_TAG_PRINTER, IPP_CONST_TAG(IPP_TAG_NAME), "printer-error-policy-supported", NULL, "retry-current-job");
-    else
-      ippAddStrings(con->response, IPP_TAG_PRINTER, IPP_CONST_TAG(IPP_TAG_NAME), "printer-error-policy-supported", sizeof(errors) / sizeof(errors[0]), NULL, errors);
-  }
-
-  if (!ra || cupsArrayFind(ra, "printer-icons"))
-  {
-    httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), is_encrypted ? "https" : "http", NULL, con->clientname, con->clientport, "/icons/%s.png", printer->name);
-    ippAddString(con->response, IPP_TAG_PRINTER, IPP_TAG_URI, "printer-icons", NULL, uri);
-    cupsdLogMessage(CUPSD_LOG_DEBUG2, "printer-icons=\"%s\"", uri);
-  }
+  if (ra && _ippRSetFind(ra, "printer-filter-stats"))
+    add_printer_filter_stats(con, printer);
 
-  if (!ra || cupsArrayFind(ra, "printer-is-accepting-jobs"))
+  if (!ra || _ippRSetFind(ra, "printer-is-accepting-jobs"))
     ippAddBoolean(con->response, IPP_TAG_PRINTER, "printer-is-accepting-jobs", (char)printer->accepting);
 
-  if (!ra || cupsArrayFind(ra, "printer-is-shared"))
+  if (!ra || _ippRSetFind(ra, "printer-is-shared"))
     ippAddBoolean(con->response, IPP_TAG_PRINTER, "printer-is-shared", (char)printer->shared);
 
-  if (!ra || cupsArrayFind(ra, "printer-is-temporary"))
+  if (!ra || _ippRSetFind(ra, "printer-is-temporary"))
     ippAddBoolean(con->response, IPP_TAG_PRINTER, "printer-is-temporary", (char)printer->temporary);
 
-  if (!ra || cupsArrayFind(ra, "printer-more-info"))
-  {
-    httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), is_encrypted ? "https" : "http", NULL, con->clientname, con->clientport, (printer->type & CUPS_PRINTER_CLASS) ? "/classes/%s" : "/printers/%s", printer->name);
-    ippAddString(con->response, IPP_TAG_PRINTER, IPP_TAG_URI, "printer-more-info", NULL, uri);
-  }
-
-  if (!ra || cupsArrayFind(ra, "printer-op-policy"))
+  if (!ra || _ippRSetFind(ra, "printer-op-policy"))
     ippAddString(con->response, IPP_TAG_PRINTER, IPP_TAG_NAME, "printer-op-policy", NULL, printer->op_policy);
 
-  if (!ra || cupsArrayFind(ra, "printer-state"))
+  if (!ra || _ippRSetFind(ra, "printer-state"))
     ippAddInteger(con->response, IPP_TAG_PRINTER, IPP_TAG_ENUM, "printer-state", (int)printer->state);
 
-  if (!ra || cupsArrayFind(ra, "printer-state-change-date-time"))
+  if (!ra || _ippRSetFind(ra, "printer-state-change-date-time"))
     ippAddDate(con->response, IPP_TAG_PRINTER, "printer-state-change-date-time", ippTimeToDate(printer->state_time));
 
-  if (!ra || cupsArrayFind(ra, "printer-state-change-time"))
+  if (!ra || _ippRSetFind(ra, "printer-state-change-time"))
     ippAddInteger(con->response, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "printer-state-change-time", printer->state_time);
 
-  if (!ra || cupsArrayFind(ra, "printer-state-message"))
+  if (!ra || _ippRSetFind(ra, "printer-state-message"))
     ippAddString(con->response, IPP_TAG_PRINTER, IPP_TAG_TEXT, "printer-state-message", NULL, printer->state_message);
 
-  if (!ra || cupsArrayFind(ra, "printer-state-reasons"))
+  if (!ra || _ippRSetFind(ra, "printer-state-reasons"))
     add_printer_state_reasons(con, printer);
 
-  if (!ra || cupsArrayFind(ra, "printer-strings-uri"))
-  {
-    httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), is_encrypted ? "https" : "http", NULL, con->clientname, con->clientport, "/strings/%s.strings", printer->name);
-    ippAddString(con->response, IPP_TAG_PRINTER, IPP_TAG_URI, "printer-strings-uri", NULL, uri);
-    cupsdLogMessage(CUPSD_LOG_DEBUG2, "printer-strings-uri=\"%s\"", uri);
-  }
-
-  if (!ra || cupsArrayFind(ra, "printer-type"))
+  if (!ra || _ippRSetFind(ra, "printer-type"))
   {
     cups_ptype_t type;			/* printer-type value */
 
@@ -5039,31 +5306,121 @@ copy_printer_attrs(
     ippAddInteger(con->response, IPP_TAG_PRINTER, IPP_TAG_ENUM, "printer-type", (int)type);
   }
 
-  if (!ra || cupsArrayFind(ra, "printer-up-time"))
+  if (!ra || _ippRSetFind(ra, "printer-up-time"))
     ippAddInteger(con->response, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "printer-up-time", curtime);
 
-  if (!ra || cupsArrayFind(ra, "printer-uri-supported"))
+  if (!ra || _ippRSetFind(ra, "queued-job-count"))
+    add_queued_job_count(con, printer);
+
+  key = create_printer_key(con, ra);
+
+  _cupsMutexLock(&printer->cache_lock);
+
+  for (cache = (cupsd_attrcache_t *)cupsArrayFirst(printer->attr_cache);
+       cache;
+       cache = (cupsd_attrcache_t *)cupsArrayNext(printer->attr_cache))
+    if (key && !strcmp(cache->key, key))
+      break;
+
+  if (cache)
   {
-    httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), is_encrypted ? "ipps" : "ipp", NULL, con->clientname, con->clientport, (printer->type & CUPS_PRINTER_CLASS) ? "/classes/%s" : "/printers/%s", printer->name);
-    ippAddString(con->response, IPP_TAG_PRINTER, IPP_TAG_URI, "printer-uri-supported", NULL, uri);
-    cupsdLogMessage(CUPSD_LOG_DEBUG2, "printer-uri-supported=\"%s\"", uri);
+   /*
+    * Move the entry to the front of the list...
+    */
+
+    if (cache != (cupsd_attrcache_t *)cupsArrayFirst(printer->attr_cache))
+    {
+      cupsArrayRemove(printer->attr_cache, cache);
+      cupsArrayInsert(printer->attr_cache, cache);
+    }
+
+    block = cache->attrs;
   }
+  else
+  {
+    block = create_printer_block(con, printer, ra);
 
-  if (!ra || cupsArrayFind(ra, "queued-job-count"))
-    add_queued_job_count(con, printer);
+    if (key && (cache = calloc(1, sizeof(cupsd_attrcache_t))) != NULL)
+    {
+      if (!printer->attr_cache)
+        printer->attr_cache = cupsArrayNew(NULL, NULL);
 
-  if (!ra || cupsArrayFind(ra, "uri-security-supported"))
-    ippAddString(con->response, IPP_TAG_PRINTER, IPP_TAG_KEYWORD, "uri-security-supported", NULL, is_encrypted ? "tls" : "none");
+      while (cupsArrayCount(printer->attr_cache) >= CUPSD_ATTRCACHE_MAX)
+      {
+        cupsd_attrcache_t *last = (cupsd_attrcache_t *)cupsArrayIndex(printer->attr_cache, cupsArrayCount(printer->attr_cache) - 1);
+					/* Least recently used entry */
 
-  copy_attrs(con->response, printer->attrs, ra, IPP_TAG_ZERO, 0, NULL);
-  if (printer->ppd_attrs)
-    copy_attrs(con->response, printer->ppd_attrs, ra, IPP_TAG_ZERO, 0, NULL);
-  copy_attrs(con->response, CommonData, ra, IPP_TAG_ZERO, IPP_TAG_COPY, NULL);
+        cupsArrayRemove(printer->attr_cache, last);
+        free(last->key);
+        ippDelete(last->attrs);
+        free(last);
+      }
+
+      cache->key   = key;
+      cache->attrs = block;
+      key          = NULL;
+
+      cupsArrayInsert(printer->attr_cache, cache);
+    }
+  }
+
+  if (static_attrs)
+  {
+   /*
+    * Keep the block around until the caller has copied it...
+    */
+
+    if (cache)
+      block->use ++;
+
+    *static_attrs = block;
+  }
+  else
+  {
+    for (attr = block->attrs; attr; attr = attr->next)
+      ippCopyAttribute(con->response, attr, 0);
+
+    if (!cache)
+      ippDelete(block);
+  }
+
+  _cupsMutexUnlock(&printer->cache_lock);
+
+  free(key);
 
   _cupsRWUnlock(&printer->lock);
 }
 
 
+/*
+ * 'copy_request()' - Copy a request into a message that can be kept.
+ *
+ * Requests are read into arena messages, which never give back the memory of
+ * replaced or deleted attributes, so long-lived copies such as job attributes
+ * are made with ippNew, including any collection values.
+ */
+
+static ipp_t *				/* O - Copy of request or NULL on error */
+copy_request(ipp_t *request)		/* I - Request */
+{
+  ipp_t			*copy;		/* Copy of request */
+
+
+  if ((copy = ippNew()) == NULL)
+    return (NULL);
+
+  copy->request = request->request;
+
+  if (!copy_unshared(copy, request))
+  {
+    ippDelete(copy);
+    return (NULL);
+  }
+
+  return (copy);
+}
+
+
 /*
  * 'copy_subscription_attrs()' - Copy subscription attributes.
  */
@@ -5072,7 +5429,7 @@ static void
 copy_subscription_attrs(
     cupsd_client_t       *con,		/* I - Client connection */
     cupsd_subscription_t *sub,		/* I - Subscription */
-    cups_array_t         *ra,		/* I - Requested attributes array */
+    _ipp_rset_t          *ra,		/* I - Requested attributes set */
     cups_array_t         *exclude)	/* I - Private attributes array */
 {
   ipp_attribute_t	*attr;		/* Current attribute */
@@ -5095,7 +5452,7 @@ copy_subscription_attrs(
   if (!exclude || !cupsArrayFind(exclude, "all"))
   {
     if ((!exclude || !cupsArrayFind(exclude, "notify-events")) &&
-        (!ra || cupsArrayFind(ra, "notify-events")))
+        (!ra || _ippRSetFind(ra, "notify-events")))
     {
       cupsdLogMessage(CUPSD_LOG_DEBUG2, "copy_subscription_attrs: notify-events");
 
@@ -5130,41 +5487,41 @@ copy_subscription_attrs(
     }
 
     if ((!exclude || !cupsArrayFind(exclude, "notify-lease-duration")) &&
-        (!sub->job && (!ra || cupsArrayFind(ra, "notify-lease-duration"))))
+        (!sub->job && (!ra || _ippRSetFind(ra, "notify-lease-duration"))))
       ippAddInteger(con->response, IPP_TAG_SUBSCRIPTION, IPP_TAG_INTEGER,
 		    "notify-lease-duration", sub->lease);
 
     if ((!exclude || !cupsArrayFind(exclude, "notify-recipient-uri")) &&
-        (sub->recipient && (!ra || cupsArrayFind(ra, "notify-recipient-uri"))))
+        (sub->recipient && (!ra || _ippRSetFind(ra, "notify-recipient-uri"))))
       ippAddString(con->response, IPP_TAG_SUBSCRIPTION, IPP_TAG_URI,
 		   "notify-recipient-uri", NULL, sub->recipient);
     else if ((!exclude || !cupsArrayFind(exclude, "notify-pull-method")) &&
-             (!ra || cupsArrayFind(ra, "notify-pull-method")))
+             (!ra || _ippRSetFind(ra, "notify-pull-method")))
       ippAddString(con->response, IPP_TAG_SUBSCRIPTION, IPP_TAG_KEYWORD,
 		   "notify-pull-method", NULL, "ippget");
 
     if ((!exclude || !cupsArrayFind(exclude, "notify-subscriber-user-name")) &&
-        (!ra || cupsArrayFind(ra, "notify-subscriber-user-name")))
+        (!ra || _ippRSetFind(ra, "notify-subscriber-user-name")))
       ippAddString(con->response, IPP_TAG_SUBSCRIPTION, IPP_TAG_NAME,
 		   "notify-subscriber-user-name", NULL, sub->owner);
 
     if ((!exclude || !cupsArrayFind(exclude, "notify-time-interval")) &&
-        (!ra || cupsArrayFind(ra, "notify-time-interval")))
+        (!ra || _ippRSetFind(ra, "notify-time-interval")))
       ippAddInteger(con->response, IPP_TAG_SUBSCRIPTION, IPP_TAG_INTEGER,
 		    "notify-time-interval", sub->interval);
 
     if (sub->user_data_len > 0 &&
 	(!exclude || !cupsArrayFind(exclude, "notify-user-data")) &&
-        (!ra || cupsArrayFind(ra, "notify-user-data")))
+        (!ra || _ippRSetFind(ra, "notify-user-data")))
       ippAddOctetString(con->response, IPP_TAG_SUBSCRIPTION, "notify-user-data",
 			sub->user_data, sub->user_data_len);
   }
 
-  if (sub->job && (!ra || cupsArrayFind(ra, "notify-job-id")))
+  if (sub->job && (!ra || _ippRSetFind(ra, "notify-job-id")))
     ippAddInteger(con->response, IPP_TAG_SUBSCRIPTION, IPP_TAG_INTEGER,
                   "notify-job-id", sub->job->id);
 
-  if (sub->dest && (!ra || cupsArrayFind(ra, "notify-printer-uri")))
+  if (sub->dest && (!ra || _ippRSetFind(ra, "notify-printer-uri")))
   {
     httpAssembleURIf(HTTP_URI_CODING_ALL, printer_uri, sizeof(printer_uri),
                      "ipp", NULL, con->clientname, con->clientport,
@@ -5173,12 +5530,51 @@ copy_subscription_attrs(
         	 "notify-printer-uri", NULL, printer_uri);
   }
 
-  if (!ra || cupsArrayFind(ra, "notify-subscription-id"))
+  if (!ra || _ippRSetFind(ra, "notify-subscription-id"))
     ippAddInteger(con->response, IPP_TAG_SUBSCRIPTION, IPP_TAG_INTEGER,
                   "notify-subscription-id", sub->id);
 }
 
 
+/*
+ * 'copy_unshared()' - Copy attributes without sharing collection values.
+ *
+ * Collection values are copied with @link copy_request@ rather than
+ * referenced, so the copy can be made and freed while other threads use the
+ * source.
+ */
+
+static int				/* O - 1 on success, 0 on error */
+copy_unshared(ipp_t *to,		/* I - Destination message */
+              ipp_t *from)		/* I - Source message */
+{
+  ipp_attribute_t	*srcattr,	/* Source attribute */
+			*dstattr;	/* Destination attribute */
+  int			i;		/* Looping var */
+
+
+  for (srcattr = from->attrs; srcattr; srcattr = srcattr->next)
+  {
+    if (srcattr->value_tag == IPP_TAG_BEGIN_COLLECTION)
+    {
+      if ((dstattr = ippAddCollections(to, srcattr->group_tag, srcattr->name, srcattr->num_values, NULL)) == NULL)
+        return (0);
+
+      for (i = 0; i < srcattr->num_values; i ++)
+        if ((dstattr->values[i].collection = copy_request(srcattr->values[i].collection)) == NULL)
+        {
+          ippDeleteAttribute(to, dstattr);
+          return (0);
+        }
+    }
+    else if (!ippCopyAttribute(to, srcattr, 0))
+      return (0);
+  }
+
+  return (1);
+}
+
+
 /*
  * 'create_job()' - Print a file to a printer or class.
  */
@@ -5638,26 +6034,191 @@ create_local_printer(
 
 
 /*
- * 'create_requested_array()' - Create an array for the requested-attributes.
+ * 'create_printer_block()' - Create the static printer attributes for a client.
+ *
+ * The returned attributes only depend on the printer attributes, the client
+ * host and port, encryption, IPP version, and requested attributes, so they
+ * can be cached until the printer attributes change.
  */
 
-static cups_array_t *			/* O - Array of attributes or NULL */
+static ipp_t *				/* O - Static attributes */
+create_printer_block(
+    cupsd_client_t  *con,		/* I - Client connection */
+    cupsd_printer_t *printer,		/* I - Printer */
+    _ipp_rset_t     *ra)		/* I - Requested attributes set */
+{
+  ipp_t		*block;			/* Static attributes */
+  char		uri[HTTP_MAX_URI];	/* URI value */
+  int		i;			/* Looping var */
+  int		is_encrypted = httpIsEncrypted(con->http);
+					/* Is the connection encrypted? */
+
+
+  block = ippNew();
+  block->request.status.version[0] = con->response->request.status.version[0];
+  block->request.status.version[1] = con->response->request.status.version[1];
+
+  if (printer->num_printers > 0 && (!ra || _ippRSetFind(ra, "member-uris")))
+  {
+    ipp_attribute_t	*member_uris;	/* member-uris attribute */
+    cupsd_printer_t	*p2;		/* Printer in class */
+    ipp_attribute_t	*p2_uri;	/* printer-uri-supported for class printer */
+
+
+    if ((member_uris = ippAddStrings(block, IPP_TAG_PRINTER, IPP_TAG_URI, "member-uris", printer->num_printers, NULL, NULL)) != NULL)
+    {
+      for (i = 0; i < printer->num_printers; i ++)
+      {
+        p2 = printer->printers[i];
+
+        if ((p2_uri = ippFindAttribute(p2->attrs, "printer-uri-supported", IPP_TAG_URI)) != NULL)
+        {
+          member_uris->values[i].string.text = _cupsStrAlloc(p2_uri->values[0].string.text);
+        }
+        else
+	{
+	  httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), is_encrypted ? "ipps" : "ipp", NULL, con->clientname, con->clientport, (p2->type & CUPS_PRINTER_CLASS) ? "/classes/%s" : "/printers/%s", p2->name);
+	  member_uris->values[i].string.text = _cupsStrAlloc(uri);
+        }
+      }
+    }
+  }
+
+  if (!ra || _ippRSetFind(ra, "printer-error-policy-supported"))
+  {
+    static const char * const errors[] =/* printer-error-policy-supported values */
+    {
+      "abort-job",
+      "retry-current-job",
+      "retry-job",
+      "stop-printer"
+    };
+
+    if (printer->type & CUPS_PRINTER_CLASS)
+      ippAddString(block, IPP_TAG_PRINTER, IPP_CONST_TAG(IPP_TAG_NAME), "printer-error-policy-supported", NULL, "retry-current-job");
+    else
+      ippAddStrings(block, IPP_TAG_PRINTER, IPP_CONST_TAG(IPP_TAG_NAME), "printer-error-policy-supported", sizeof(errors) / sizeof(errors[0]), NULL, errors);
+  }
+
+  if (!ra || _ippRSetFind(ra, "printer-icons"))
+  {
+    httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), is_encrypted ? "https" : "http", NULL, con->clientname, con->clientport, "/icons/%s.png", printer->name);
+    ippAddString(block, IPP_TAG_PRINTER, IPP_TAG_URI, "printer-icons", NULL, uri);
+    cupsdLogMessage(CUPSD_LOG_DEBUG2, "printer-icons=\"%s\"", uri);
+  }
+
+  if (!ra || _ippRSetFind(ra, "printer-more-info"))
+  {
+    httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), is_encrypted ? "https" : "http", NULL, con->clientname, con->clientport, (printer->type & CUPS_PRINTER_CLASS) ? "/classes/%s" : "/printers/%s", printer->name);
+    ippAddString(block, IPP_TAG_PRINTER, IPP_TAG_URI, "printer-more-info", NULL, uri);
+  }
+
+  if (!ra || _ippRSetFind(ra, "printer-strings-uri"))
+  {
+    httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), is_encrypted ? "https" : "http", NULL, con->clientname, con->clientport, "/strings/%s.strings", printer->name);
+    ippAddString(block, IPP_TAG_PRINTER, IPP_TAG_URI, "printer-strings-uri", NULL, uri);
+    cupsdLogMessage(CUPSD_LOG_DEBUG2, "printer-strings-uri=\"%s\"", uri);
+  }
+
+  if (!ra || _ippRSetFind(ra, "printer-uri-supported"))
+  {
+    httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), is_encrypted ? "ipps" : "ipp", NULL, con->clientname, con->clientport, (printer->type & CUPS_PRINTER_CLASS) ? "/classes/%s" : "/printers/%s", printer->name);
+    ippAddString(block, IPP_TAG_PRINTER, IPP_TAG_URI, "printer-uri-supported", NULL, uri);
+    cupsdLogMessage(CUPSD_LOG_DEBUG2, "printer-uri-supported=\"%s\"", uri);
+  }
+
+  if (!ra || _ippRSetFind(ra, "uri-security-supported"))
+    ippAddString(block, IPP_TAG_PRINTER, IPP_TAG_KEYWORD, "uri-security-supported", NULL, is_encrypted ? "tls" : "none");
+
+  copy_attrs(block, printer->attrs, ra, IPP_TAG_ZERO, 0, NULL);
+  if (printer->ppd_attrs)
+    copy_attrs(block, printer->ppd_attrs, ra, IPP_TAG_ZERO, 0, NULL);
+  copy_attrs(block, CommonData, ra, IPP_TAG_ZERO, 0, NULL);
+
+  return (block);
+}
+
+
+/*
+ * 'create_printer_key()' - Create the attribute cache key for a request.
+ */
+
+static char *				/* O - Cache key or NULL on error */
+create_printer_key(
+    cupsd_client_t *con,		/* I - Client connection */
+    _ipp_rset_t    *ra)			/* I - Requested attributes set */
+{
+  char		*key,			/* Cache key */
+		*keyptr;		/* Pointer into key */
+  const char	*name;			/* Requested attribute name */
+  size_t	keysize;		/* Size of key */
+  int		i;			/* Looping var */
+
+
+  keysize = strlen(con->clientname) + 32;
+
+  if (ra)
+  {
+    keysize += sizeof(ra->bits) / sizeof(ra->bits[0]) * 14;
+
+    for (name = (const char *)cupsArrayFirst(ra->names); name; name = (const char *)cupsArrayNext(ra->names))
+      keysize += strlen(name) + 1;
+  }
+
+  if ((key = malloc(keysize)) == NULL)
+    return (NULL);
+
+  snprintf(key, keysize, "%s %s %d %d", httpIsEncrypted(con->http) ? "ipps" : "ipp", con->clientname, con->clientport, con->response->request.status.version[0]);
+  keyptr = key + strlen(key);
+
+  if (!ra)
+  {
+    strlcpy(keyptr, " *", keysize - (size_t)(keyptr - key));
+  }
+  else
+  {
+    for (i = 0; i < (int)(sizeof(ra->bits) / sizeof(ra->bits[0])); i ++)
+    {
+      if (ra->bits[i])
+      {
+        snprintf(keyptr, keysize - (size_t)(keyptr - key), " %d:%x", i, ra->bits[i]);
+	keyptr += strlen(keyptr);
+      }
+    }
+
+    for (name = (const char *)cupsArrayFirst(ra->names); name; name = (const char *)cupsArrayNext(ra->names))
+    {
+      *keyptr++ = ' ';
+      strlcpy(keyptr, name, keysize - (size_t)(keyptr - key));
+      keyptr += strlen(keyptr);
+    }
+  }
+
+  return (key);
+}
+
+
+/*
+ * 'create_requested_array()' - Create a set for the requested-attributes.
+ */
+
+static _ipp_rset_t *			/* O - Set of attributes or NULL */
 create_requested_array(ipp_t *request)	/* I - IPP request */
 {
-  cups_array_t		*ra;		/* Requested attributes array */
+  _ipp_rset_t		*ra;		/* Requested attributes set */
 
 
  /*
-  * Create the array for standard attributes...
+  * Create the set for standard attributes...
   */
 
-  ra = ippCreateRequestedArray(request);
+  ra = _ippCreateRequestedSet(request);
 
  /*
   * Add CUPS defaults as needed...
   */
 
-  if (cupsArrayFind(ra, "printer-defaults"))
+  if (_ippRSetFind(ra, "printer-defaults"))
   {
    /*
     * Include user-set defaults...
@@ -5665,13 +6226,12 @@ create_requested_array(ipp_t *request)	/* I - IPP request */
 
     char	*name;			/* Option name */
 
-    cupsArrayRemove(ra, "printer-defaults");
+    _ippRSetRemove(ra, "printer-defaults");
 
     for (name = (char *)cupsArrayFirst(CommonDefaults);
 	 name;
 	 name = (char *)cupsArrayNext(CommonDefaults))
-      if (!cupsArrayFind(ra, name))
-        cupsArrayAdd(ra, name);
+      _ippRSetAdd(ra, name);
   }
 
   return (ra);
@@ -6181,6 +6741,74 @@ delete_printer(cupsd_client_t  *con,	/* I - Client connection */
 }
 
 
+/*
+ * 'finish_printer_attrs()' - Send the responses completed by worker threads.
+ */
+
+static void
+finish_printer_attrs(void *data)	/* I - Callback data (unused) */
+{
+  char			buffer[256];	/* Wakeup bytes */
+  int			i,		/* Looping var */
+			count;		/* Number of responses */
+  cupsd_ippwork_t	*work;		/* Current response */
+  cupsd_client_t	*con;		/* Client connection */
+
+
+  (void)data;
+
+  if (read(work_pipe[0], buffer, sizeof(buffer)) < 0 && errno != EAGAIN && errno != EINTR)
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to read from worker thread pipe: %s", strerror(errno));
+
+  for (;;)
+  {
+   /*
+    * Take the next completed response off the list, releasing the static
+    * attributes while the printer cannot be deleted...
+    */
+
+    _cupsMutexLock(&work_mutex);
+
+    for (i = 0, count = cupsArrayCount(work_items), work = NULL; i < count; i ++)
+    {
+      work = (cupsd_ippwork_t *)cupsArrayIndex(work_items, i);
+
+      if (work->state == CUPSD_WORK_DONE)
+        break;
+    }
+
+    if (i >= count)
+    {
+      _cupsMutexUnlock(&work_mutex);
+      break;
+    }
+
+    cupsArrayRemove(work_items, work);
+
+    release_printer_block(work->printer, work->block);
+
+    _cupsMutexUnlock(&work_mutex);
+
+   /*
+    * Send the response if the client is still connected...
+    */
+
+    if ((con = work->con) != NULL)
+    {
+      con->work     = NULL;
+      con->response = work->response;
+
+      if (!send_response(con, ippFindAttribute(con->request, "printer-uri", IPP_TAG_URI)))
+        cupsdCloseClient(con);
+    }
+    else
+      ippDelete(work->response);
+
+    free(work);
+  }
+}
+
+
 /*
  * 'get_default()' - Get the default destination.
  */
@@ -6189,7 +6817,8 @@ static void
 get_default(cupsd_client_t *con)	/* I - Client connection */
 {
   http_status_t	status;			/* Policy status */
-  cups_array_t	*ra;			/* Requested attributes array */
+  _ipp_rset_t	*ra;			/* Requested attributes set */
+  ipp_t		*block = NULL;		/* Static attributes to copy */
 
 
   cupsdLogMessage(CUPSD_LOG_DEBUG2, "get_default(%p[%d])", con, con->number);
@@ -6208,11 +6837,14 @@ get_default(cupsd_client_t *con)	/* I - Client connection */
   {
     ra = create_requested_array(con->request);
 
-    copy_printer_attrs(con, DefaultPrinter, ra);
+    copy_printer_attrs(con, DefaultPrinter, ra, IPPWorkers > 0 ? &block : NULL);
 
-    cupsArrayDelete(ra);
+    _ippRSetDelete(ra);
 
     con->response->request.status.status_code = IPP_OK;
+
+    if (block)
+      queue_printer_attrs(con, DefaultPrinter, block);
   }
   else
     send_ipp_status(con, IPP_NOT_FOUND, _("No default printer."));
@@ -6478,8 +7110,8 @@ get_job_attrs(cupsd_client_t  *con,	/* I - Client connection */
 		host[HTTP_MAX_URI],	/* Host portion of URI */
 		resource[HTTP_MAX_URI];	/* Resource portion of URI */
   int		port;			/* Port portion of URI */
-  cups_array_t	*ra,			/* Requested attributes array */
-		*exclude;		/* Private attributes array */
+  _ipp_rset_t	*ra;			/* Requested attributes set */
+  cups_array_t	*exclude;		/* Private attributes array */
 
 
   cupsdLogMessage(CUPSD_LOG_DEBUG2, "get_job_attrs(%p[%d], %s)", con,
@@ -6571,7 +7203,7 @@ get_job_attrs(cupsd_client_t  *con,	/* I - Client connection */
 
   ra = create_requested_array(con->request);
   copy_job_attrs(con, job, ra, exclude);
-  cupsArrayDelete(ra);
+  _ippRSetDelete(ra);
 
   con->response->request.status.status_code = IPP_OK;
 }
@@ -6608,9 +7240,12 @@ get_jobs(cupsd_client_t  *con,		/* I - Client connection */
   cupsd_printer_t *printer;		/* Printer */
   cups_array_t	*list;			/* Which job list... */
   int		delete_list = 0;	/* Delete the list afterwards? */
-  cups_array_t	*ra,			/* Requested attributes array */
-		*exclude;		/* Private attributes array */
+  _ipp_rset_t	*ra;			/* Requested attributes set */
+  cups_array_t	*exclude;		/* Private attributes array */
   cupsd_policy_t *policy;		/* Current policy */
+  int		i;			/* Looping var */
+  static _ipp_rset_t *cached_attrs = NULL;
+					/* Attributes that don't need the job loaded */
 
 
   cupsdLogMessage(CUPSD_LOG_DEBUG2, "get_jobs(%p[%d], %s)", con, con->number,
@@ -6822,27 +7457,53 @@ get_jobs(cupsd_client_t  *con,		/* I - Client connection */
   else
     username[0] = '\0';
 
-  ra = create_requested_array(con->request);
-  for (job_attr = (char *)cupsArrayFirst(ra); job_attr; job_attr = (char *)cupsArrayNext(ra))
-    if (strcmp(job_attr, "job-id") &&
-	strcmp(job_attr, "job-k-octets") &&
-	strcmp(job_attr, "job-media-progress") &&
-	strcmp(job_attr, "job-more-info") &&
-	strcmp(job_attr, "job-name") &&
-	strcmp(job_attr, "job-originating-user-name") &&
-	strcmp(job_attr, "job-preserved") &&
-	strcmp(job_attr, "job-printer-up-time") &&
-        strcmp(job_attr, "job-printer-uri") &&
-	strcmp(job_attr, "job-state") &&
-	strcmp(job_attr, "job-state-reasons") &&
-	strcmp(job_attr, "job-uri") &&
-	strcmp(job_attr, "time-at-completed") &&
-	strcmp(job_attr, "time-at-creation") &&
-	strcmp(job_attr, "number-of-documents"))
-    {
-      need_load_job = 1;
-      break;
+  if (!cached_attrs)
+  {
+   /*
+    * Build the set of attributes that are available without loading the
+    * job...
+    */
+
+    static const char * const cached[] =/* Cached job attributes */
+    {
+      "job-id",
+      "job-k-octets",
+      "job-media-progress",
+      "job-more-info",
+      "job-name",
+      "job-originating-user-name",
+      "job-preserved",
+      "job-printer-up-time",
+      "job-printer-uri",
+      "job-state",
+      "job-state-reasons",
+      "job-uri",
+      "time-at-completed",
+      "time-at-creation",
+      "number-of-documents"
+    };
+
+    if ((cached_attrs = _ippRSetNew()) != NULL)
+    {
+      for (i = 0; i < (int)(sizeof(cached) / sizeof(cached[0])); i ++)
+        _ippRSetAdd(cached_attrs, cached[i]);
     }
+  }
+
+  ra = create_requested_array(con->request);
+
+  if (ra && cached_attrs)
+  {
+    for (i = 0; i < (int)(sizeof(ra->bits) / sizeof(ra->bits[0])); i ++)
+      if (ra->bits[i] & ~cached_attrs->bits[i])
+        need_load_job = 1;
+
+    for (job_attr = (char *)cupsArrayFirst(ra->names); job_attr; job_attr = (char *)cupsArrayNext(ra->names))
+      if (!_ippRSetFind(cached_attrs, job_attr))
+        need_load_job = 1;
+  }
+  else if (ra)
+    need_load_job = 1;
 
   if (need_load_job && (limit == 0 || limit > 500) && (list == Jobs || delete_list))
   {
@@ -6866,8 +7527,6 @@ get_jobs(cupsd_client_t  *con,		/* I - Client connection */
 
   if (job_ids)
   {
-    int	i;				/* Looping var */
-
     for (i = 0; i < job_ids->num_values; i ++)
     {
       if (!cupsdFindJob(job_ids->values[i].integer))
@@ -6878,7 +7537,7 @@ get_jobs(cupsd_client_t  *con,		/* I - Client connection */
     {
       send_ipp_status(con, IPP_NOT_FOUND, _("Job #%d does not exist."),
                       job_ids->values[i].integer);
-      cupsArrayDelete(ra);
+      _ippRSetDelete(ra);
       return;
     }
 
@@ -6977,7 +7636,7 @@ get_jobs(cupsd_client_t  *con,		/* I - Client connection */
     cupsdLogMessage(CUPSD_LOG_DEBUG2, "get_jobs: count=%d", count);
   }
 
-  cupsArrayDelete(ra);
+  _ippRSetDelete(ra);
 
   if (delete_list)
     cupsArrayDelete(list);
@@ -7450,7 +8109,8 @@ get_printer_attrs(cupsd_client_t  *con,	/* I - Client connection */
   http_status_t		status;		/* Policy status */
   cups_ptype_t		dtype;		/* Destination type (printer/class) */
   cupsd_printer_t	*printer;	/* Printer/class */
-  cups_array_t		*ra;		/* Requested attributes array */
+  _ipp_rset_t		*ra;		/* Requested attributes set */
+  ipp_t			*block = NULL;	/* Static attributes to copy */
 
 
   cupsdLogMessage(CUPSD_LOG_DEBUG2, "get_printer_attrs(%p[%d], %s)", con,
@@ -7487,11 +8147,14 @@ get_printer_attrs(cupsd_client_t  *con,	/* I - Client connection */
 
   ra = create_requested_array(con->request);
 
-  copy_printer_attrs(con, printer, ra);
+  copy_printer_attrs(con, printer, ra, IPPWorkers > 0 ? &block : NULL);
 
-  cupsArrayDelete(ra);
+  _ippRSetDelete(ra);
 
   con->response->request.status.status_code = IPP_OK;
+
+  if (block)
+    queue_printer_attrs(con, printer, block);
 }
 
 
@@ -7575,7 +8238,7 @@ get_printers(cupsd_client_t *con,	/* I - Client connection */
   char		*location;		/* Location string */
   const char	*username;		/* Current user */
   char		*first_printer_name;	/* first-printer-name attribute */
-  cups_array_t	*ra;			/* Requested attributes array */
+  _ipp_rset_t	*ra;			/* Requested attributes set */
   int		local;			/* Local connection? */
 
 
@@ -7712,11 +8375,11 @@ get_printers(cupsd_client_t *con,	/* I - Client connection */
       * Send the attributes...
       */
 
-      copy_printer_attrs(con, printer, ra);
+      copy_printer_attrs(con, printer, ra, NULL);
     }
   }
 
-  cupsArrayDelete(ra);
+  _ippRSetDelete(ra);
 
   con->response->request.status.status_code = IPP_OK;
 }
@@ -7734,8 +8397,8 @@ get_subscription_attrs(
   http_status_t		status;		/* Policy status */
   cupsd_subscription_t	*sub;		/* Subscription */
   cupsd_policy_t	*policy;	/* Current security policy */
-  cups_array_t		*ra,		/* Requested attributes array */
-			*exclude;	/* Private attributes array */
+  _ipp_rset_t		*ra;		/* Requested attributes set */
+  cups_array_t		*exclude;	/* Private attributes array */
 
 
   cupsdLogMessage(CUPSD_LOG_DEBUG2,
@@ -7789,7 +8452,7 @@ get_subscription_attrs(
 
   copy_subscription_attrs(con, sub, ra, exclude);
 
-  cupsArrayDelete(ra);
+  _ippRSetDelete(ra);
 
   con->response->request.status.status_code = IPP_OK;
 }
@@ -7807,7 +8470,7 @@ get_subscriptions(cupsd_client_t  *con,	/* I - Client connection */
   int			count;		/* Number of subscriptions */
   int			limit;		/* Limit */
   cupsd_subscription_t	*sub;		/* Subscription */
-  cups_array_t		*ra;		/* Requested attributes array */
+  _ipp_rset_t		*ra;		/* Requested attributes set */
   ipp_attribute_t	*attr;		/* Attribute */
   cups_ptype_t		dtype;		/* Destination type (printer/class) */
   char			scheme[HTTP_MAX_URI],
@@ -7946,7 +8609,7 @@ get_subscriptions(cupsd_client_t  *con,	/* I - Client connection */
         break;
     }
 
-  cupsArrayDelete(ra);
+  _ippRSetDelete(ra);
 
   if (count)
     con->response->request.status.status_code = IPP_OK;
@@ -8750,6 +9413,16 @@ print_job(cupsd_client_t  *con,		/* I - Client connection */
 
   cupsdClearString(&con->filename);
 
+  if (con->streaming > 0)
+  {
+   /*
+    * The rest of the document is still being received...
+    */
+
+    job->streaming  = job->num_files;
+    con->stream_job = job->id;
+  }
+
  /*
   * See if we need to add the ending sheet...
   */
@@ -8776,6 +9449,139 @@ print_job(cupsd_client_t  *con,		/* I - Client connection */
 }
 
 
+/*
+ * 'printer_attrs_thread()' - Copy static printer attributes into responses.
+ *
+ * The static attributes are only read, and the response is not touched by
+ * the main thread until the work is marked done.
+ */
+
+static void *				/* O - Exit status (never returns) */
+printer_attrs_thread(void *data)	/* I - Thread data (unused) */
+{
+  int			i,		/* Looping var */
+			count;		/* Number of responses */
+  cupsd_ippwork_t	*work;		/* Current response */
+
+
+  (void)data;
+
+  _cupsMutexLock(&work_mutex);
+
+  for (;;)
+  {
+    for (i = 0, count = cupsArrayCount(work_items), work = NULL; i < count; i ++)
+    {
+      work = (cupsd_ippwork_t *)cupsArrayIndex(work_items, i);
+
+      if (work->state == CUPSD_WORK_QUEUED)
+        break;
+    }
+
+    if (i >= count)
+    {
+      work_idle ++;
+      _cupsCondWait(&work_cond, &work_mutex, 0.0);
+      work_idle --;
+      continue;
+    }
+
+    work->state = CUPSD_WORK_COPYING;
+
+    _cupsMutexUnlock(&work_mutex);
+
+    if (!copy_unshared(work->response, work->block))
+      work->response->request.status.status_code = IPP_STATUS_ERROR_INTERNAL;
+
+    _cupsMutexLock(&work_mutex);
+
+    work->state = CUPSD_WORK_DONE;
+
+   /*
+    * Wake up the main loop; the pipe does not block, and a full pipe already
+    * has a wakeup pending...
+    */
+
+    if (write(work_pipe[1], "", 1) < 0 && errno != EAGAIN)
+      cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to write to worker thread pipe: %s", strerror(errno));
+  }
+
+  return (NULL);
+}
+
+
+/*
+ * 'queue_printer_attrs()' - Hand the static printer attributes of a response
+ *                           to a worker thread.
+ *
+ * The response is taken from the client and sent by
+ * @link finish_printer_attrs@.  If no worker thread can be started, the
+ * attributes are copied right away.
+ */
+
+static void
+queue_printer_attrs(
+    cupsd_client_t  *con,		/* I - Client connection */
+    cupsd_printer_t *printer,		/* I - Printer */
+    ipp_t           *block)		/* I - Static attributes */
+{
+  cupsd_ippwork_t	*work;		/* New response */
+
+
+  if (work_pipe[0] < 0)
+  {
+    if (cupsdOpenPipe(work_pipe))
+    {
+      cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to create worker thread pipe: %s", strerror(errno));
+    }
+    else
+    {
+      fcntl(work_pipe[0], F_SETFL, O_NONBLOCK);
+      fcntl(work_pipe[1], F_SETFL, O_NONBLOCK);
+
+      cupsdAddSelect(work_pipe[0], (cupsd_selfunc_t)finish_printer_attrs, NULL, NULL);
+    }
+  }
+
+  _cupsMutexLock(&work_mutex);
+
+  if (work_pipe[0] >= 0 && !work_idle && work_threads < IPPWorkers)
+  {
+    if (_cupsThreadCreate((_cups_thread_func_t)printer_attrs_thread, NULL))
+      work_threads ++;
+    else
+      cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to start worker thread.");
+  }
+
+  if (!work_items)
+    work_items = cupsArrayNew(NULL, NULL);
+
+  if (!work_threads || !work_items || (work = calloc(1, sizeof(cupsd_ippwork_t))) == NULL)
+  {
+    _cupsMutexUnlock(&work_mutex);
+
+    copy_unshared(con->response, block);
+    release_printer_block(printer, block);
+    return;
+  }
+
+  work->state    = CUPSD_WORK_QUEUED;
+  work->con      = con;
+  work->printer  = printer;
+  work->block    = block;
+  work->response = con->response;
+
+  con->response = NULL;
+  con->work     = work;
+
+  cupsArrayAdd(work_items, work);
+
+  _cupsCondBroadcast(&work_cond);
+
+  _cupsMutexUnlock(&work_mutex);
+}
+
+
 /*
  * 'read_job_ticket()' - Read a job ticket embedded in a print file.
  *
@@ -8818,8 +9624,7 @@ read_job_ticket(cupsd_client_t *con)	/* I - Client connection */
   cups_option_t		*options;	/* Options */
   ipp_t			*ticket;	/* New attributes */
   ipp_attribute_t	*attr,		/* Current attribute */
-			*attr2,		/* Job attribute */
-			*prev2;		/* Previous job attribute */
+			*attr2;		/* Job attribute */
 
 
  /*
@@ -8927,25 +9732,7 @@ read_job_ticket(cupsd_client_t *con)	/* I - Client connection */
       * Some other value; first free the old value...
       */
 
-      if (con->request->attrs == attr2)
-      {
-	con->request->attrs = attr2->next;
-	prev2               = NULL;
-      }
-      else
-      {
-	for (prev2 = con->request->attrs; prev2; prev2 = prev2->next)
-	  if (prev2->next == attr2)
-	  {
-	    prev2->next = attr2->next;
-	    break;
-	  }
-      }
-
-      if (con->request->last == attr2)
-        con->request->last = prev2;
-
-      ippDeleteAttribute(NULL, attr2);
+      ippDeleteAttribute(con->request, attr2);
     }
 
    /*
@@ -9254,6 +10041,31 @@ release_job(cupsd_client_t  *con,	/* I - Client connection */
 }
 
 
+/*
+ * 'release_printer_block()' - Release static printer attributes returned by
+ *                             @link copy_printer_attrs@.
+ */
+
+static void
+release_printer_block(
+    cupsd_printer_t *printer,		/* I - Printer or NULL if deleted */
+    ipp_t           *block)		/* I - Static attributes */
+{
+  if (printer)
+  {
+   /*
+    * The block may still be in the printer's cache...
+    */
+
+    _cupsMutexLock(&printer->cache_lock);
+    ippDelete(block);
+    _cupsMutexUnlock(&printer->cache_lock);
+  }
+  else
+    ippDelete(block);
+}
+
+
 /*
  * 'renew_subscription()' - Renew an existing subscription...
  */
@@ -9992,6 +10804,16 @@ send_document(cupsd_client_t  *con,	/* I - Client connection */
 
   cupsdClearString(&con->filename);
 
+  if (con->streaming > 0)
+  {
+   /*
+    * The rest of the document is still being received...
+    */
+
+    job->streaming  = job->num_files;
+    con->stream_job = job->id;
+  }
+
   cupsdLogJob(job, CUPSD_LOG_INFO, "File of type %s/%s queued by \"%s\".",
 	      filetype->super, filetype->type, job->username);
 
@@ -10036,6 +10858,8 @@ send_document(cupsd_client_t  *con,	/* I - Client connection */
 	ippSetString(job->attrs, &job->reasons, 0, "job-hold-until-specified");
     }
 
+    cupsdUpdateJobQueue(job);
+
     job->dirty = 1;
     cupsdMarkDirty(CUPSD_DIRTY_JOBS);
 
@@ -10053,6 +10877,9 @@ send_document(cupsd_client_t  *con,	/* I - Client connection */
       job->state_value              = IPP_JOB_HELD;
       job->hold_until               = time(NULL) + MultipleOperationTimeout;
 
+      cupsdUpdateJobTimer(job);
+      cupsdUpdateJobQueue(job);
+
       ippSetString(job->attrs, &job->reasons, 0, "job-incoming");
 
       job->dirty = 1;
@@ -10098,6 +10925,16 @@ send_http_error(
   ipp_attribute_t	*uri;		/* Request URI, if any */
 
 
+  if (con->streaming > 0)
+  {
+   /*
+    * Don't respond to a request that is processed before its document is
+    * received; it will be processed again once the document is complete...
+    */
+
+    return;
+  }
+
   if ((uri = ippFindAttribute(con->request, "printer-uri",
                               IPP_TAG_URI)) == NULL)
     uri = ippFindAttribute(con->request, "job-uri", IPP_TAG_URI);
@@ -10215,6 +11052,89 @@ send_ipp_status(cupsd_client_t *con,	/* I - Client connection */
 }
 
 
+/*
+ * 'send_response()' - Send the IPP response for a request.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+send_response(cupsd_client_t  *con,	/* I - Client connection */
+              ipp_attribute_t *uri)	/* I - Printer or job URI */
+{
+  if (con->response)
+  {
+   /*
+    * Sending data from the scheduler...
+    */
+
+    cupsdLogClient(con, con->response->request.status.status_code >= IPP_STATUS_ERROR_BAD_REQUEST && con->response->request.status.status_code != IPP_STATUS_ERROR_NOT_FOUND ? CUPSD_LOG_ERROR : CUPSD_LOG_DEBUG, "Returning IPP %s for %s (%s) from %s.",  ippErrorString(con->response->request.status.status_code), ippOpString(con->request->request.op.operation_id), uri ? uri->values[0].string.text : "no URI", con->http->hostname);
+
+    httpClearFields(con->http);
+
+#ifdef CUPSD_USE_CHUNKING
+   /*
+    * Because older versions of CUPS (1.1.17 and older) and some IPP
+    * clients do not implement chunking properly, we cannot use
+    * chunking by default.  This may become the default in future
+    * CUPS releases, or we might add a configuration directive for
+    * it.
+    */
+
+    if (con->http->version == HTTP_1_1)
+    {
+      cupsdLogClient(con, CUPSD_LOG_DEBUG, "Transfer-Encoding: chunked");
+      cupsdSetLength(con->http, 0);
+    }
+    else
+#endif /* CUPSD_USE_CHUNKING */
+    {
+      size_t	length;			/* Length of response */
+
+
+      length = ippLength(con->response);
+
+      if (con->file >= 0 && !con->pipe_pid)
+      {
+	struct stat	fileinfo;	/* File information */
+
+	if (!fstat(con->file, &fileinfo))
+	  length += (size_t)fileinfo.st_size;
+      }
+
+      cupsdLogClient(con, CUPSD_LOG_DEBUG, "Content-Length: " CUPS_LLFMT, CUPS_LLCAST length);
+      httpSetLength(con->http, length);
+    }
+
+    if (cupsdSendHeader(con, HTTP_OK, "application/ipp", CUPSD_AUTH_NONE))
+    {
+     /*
+      * Tell the caller the response header was sent successfully...
+      */
+
+      cupsdAddSelect(httpGetFd(con->http), (cupsd_selfunc_t)cupsdReadClient, (cupsd_selfunc_t)cupsdWriteClient, con);
+
+      return (1);
+    }
+    else
+    {
+     /*
+      * Tell the caller the response header could not be sent...
+      */
+
+      return (0);
+    }
+  }
+  else
+  {
+   /*
+    * Sending data from a subprocess like cups-deviced; tell the caller
+    * everything is A-OK so far...
+    */
+
+    return (1);
+  }
+}
+
+
 /*
  * 'set_default()' - Set the default destination...
  */
@@ -10592,15 +11512,7 @@ set_job_attrs(cupsd_client_t  *con,	/* I - Client connection */
       * Some other value; first free the old value...
       */
 
-      if (job->attrs->prev)
-        job->attrs->prev->next = attr2->next;
-      else
-        job->attrs->attrs = attr2->next;
-
-      if (job->attrs->last == attr2)
-        job->attrs->last = job->attrs->prev;
-
-      ippDeleteAttribute(NULL, attr2);
+      ippDeleteAttribute(job->attrs, attr2);
 
      /*
       * Then copy the attribute...
@@ -10617,15 +11529,7 @@ set_job_attrs(cupsd_client_t  *con,	/* I - Client connection */
       if ((attr2 = ippFindAttribute(job->attrs, attr->name,
                                     IPP_TAG_ZERO)) != NULL)
       {
-        if (job->attrs->prev)
-	  job->attrs->prev->next = attr2->next;
-	else
-	  job->attrs->attrs = attr2->next;
-
-        if (attr2 == job->attrs->last)
-	  job->attrs->last = job->attrs->prev;
-
-        ippDeleteAttribute(NULL, attr2);
+        ippDeleteAttribute(job->attrs, attr2);
 
         event |= CUPSD_EVENT_JOB_CONFIG_CHANGED;
       }
@@ -49,6 +49,15 @@
  *     memory consumption.  We don't unload jobs where job->state_value <
  *     IPP_JOB_STOPPED, job->printer != NULL, or job->access_time is recent.
  *
+ *     Loaded stopped and completed jobs are kept in a least recently used
+ *     list along with the size of their attributes, and cupsdLoadJob moves a
+ *     job to the front of the list every time it is used.  Only the jobs in
+ *     this list are checked, and jobs are unloaded from the end of the list
+ *     only while the total size is larger than MaxJobHistoryMemory, so
+ *     frequently requested job history stays loaded.  The size of a job is
+ *     updated every time it is saved, and stopped and completed jobs are
+ *     saved as soon as they leave the printer.
+ *
  * STARTING OF JOBS (start_job)
  *
  *     When a job is started, a status buffer, several pipes, a security
@@ -88,12 +97,83 @@
  *
  *     Then we close the pipes and free the status buffers and profiles.
  *
+ * JOB DEADLINES (cupsdUpdateJobTimer)
+ *
+ *     Each job has a deadline timer for the earliest of its cancel_time,
+ *     kill_time, and (for held jobs) hold_until values.  Code that changes
+ *     one of these values calls cupsdUpdateJobTimer to reschedule it.  When a
+ *     job timer expires, only that job is killed, canceled, or released and a
+ *     single cupsdCheckJobs run is scheduled to start any pending jobs.
+ *
+ * PENDING QUEUES (cupsdUpdateJobQueue)
+ *
+ *     Jobs that are pending and not assigned to a printer are kept in a queue
+ *     for their destination, sorted like ActiveJobs.  Code that changes the
+ *     state, destination, or printer of a job calls cupsdUpdateJobQueue to
+ *     move it to the right queue.  cupsdCheckJobs only looks at the queues
+ *     whose destination can start a job right now, so busy printers with
+ *     long queues cost nothing.  Jobs waiting on the FilterLimit are tracked
+ *     in a separate list.
+ *
+ * JOB COUNTS (cupsdUpdateJobCounts)
+ *
+ *     The number of active jobs for each destination and user is kept in
+ *     hashed counter arrays so that the MaxJobsPerPrinter and MaxJobsPerUser
+ *     limits can be checked without scanning ActiveJobs.  Code that adds or
+ *     removes an active job, or changes its destination or username, calls
+ *     cupsdUpdateJobCounts to move the job to the right counters.
+ *
+ * JOB CACHE (cupsdSaveAllJobs)
+ *
+ *     The job.cache file holds a summary of every job so that we don't need
+ *     to read all of the job history files at startup.  Rather than rewriting
+ *     it every time a job changes, the changed jobs and deleted job IDs are
+ *     appended to the job.journal file - state changes right away and other
+ *     changes when the job control file is saved.  Once the journal holds more
+ *     records than there are jobs, job.cache is rewritten and a new journal is
+ *     started.  Both files start with the same "Generation" number so that a
+ *     journal left over from an older job.cache is ignored at startup, when
+ *     the journal is replayed on top of job.cache.
+ *
  * JOB FILE COMPLETION (process_children in main.c)
  *
  *     For multiple-file jobs, process_children (in main.c) sees that all
  *     filters have exited and calls in to print the next file if there are
  *     more files in the job, otherwise it waits for the backend to exit and
  *     update_job to do the cleanup.
+ *
+ * FILTERING AHEAD (FilterAhead)
+ *
+ *     Each time a document of a multiple-file job starts printing,
+ *     filter_ahead starts filtering up to FilterAhead of the following
+ *     documents into temporary files, within the FilterLimit.  Their
+ *     processes are tracked in job->conversions rather than job->filters,
+ *     and process_children passes their exit status to
+ *     cupsdFinishJobConversion.  When a filtered document's turn comes,
+ *     cupsdContinueJob copies the temporary file to the backend with the
+ *     gziptoany filter (and port monitor, if any), waiting for the filters
+ *     to finish if needed.  If filtering ahead failed, the document is
+ *     filtered again normally.
+ *
+ * RESOURCE ACCOUNTING (cupsdAddJobStats)
+ *
+ *     When a filter or backend exits, process_children collects its CPU
+ *     time, maximum resident set size, and (on Linux) the number of octets
+ *     it read and wrote, and passes them here along with the wall clock
+ *     time since it started.  Each run is appended to the job's
+ *     "job-filter-stats" attribute and added to the printer's totals, which
+ *     are reported by the "printer-filter-stats" attribute.
+ *
+ * FILTER WORKERS (FilterWorkers)
+ *
+ *     Filters listed in the FilterWorkers directive are started ahead of
+ *     time, one per printer, so that the program is loaded and the PPD file
+ *     and message catalog are parsed before the next job arrives.  When a
+ *     job runs the filter, the waiting process receives the job's
+ *     arguments, environment, and file descriptors over a socket and the
+ *     job continues with it exactly as if it had just been started; a new
+ *     one is then started for the following job.  Filters that support this
+ *     call _ppdFilterWorkerWait at startup.
  */
 
 
@@ -108,33 +188,88 @@ static mime_filter_t	gziptoany_filter =
 			  0,		/* Cost */
 			  "gziptoany"	/* Filter program to run */
 			};
+static cupsd_timer_t	check_timer = { 0 };
+					/* Timer for cupsdCheckJobs */
+static cups_array_t	*dest_counts = NULL;
+					/* Active jobs for each destination */
+static cups_array_t	*filter_jobs = NULL;
+					/* Jobs waiting on the FilterLimit */
+static cups_array_t	*filter_workers = NULL;
+					/* Filters started ahead of time */
+static cupsd_job_t	*lru_first = NULL,
+					/* Most recently used loaded job */
+			*lru_last = NULL;
+					/* Least recently used loaded job */
+static size_t		lru_size = 0;	/* Size of loaded jobs in LRU */
+static cups_file_t	*job_journal = NULL;
+					/* job.journal file */
+static int		job_journal_gen = 0,
+					/* job.cache generation */
+			job_journal_records = 0;
+					/* Number of job.journal records */
+static cups_array_t	*pending_queues = NULL;
+					/* Pending jobs for each destination */
+static cups_array_t	*user_counts = NULL;
+					/* Active jobs for each user */
 
 
 /*
  * Local functions...
  */
 
+static void	check_jobs_timer(void *data);
 static int	compare_active_jobs(void *first, void *second, void *data);
 static int	compare_completed_jobs(void *first, void *second, void *data);
+static int	compare_counts(cupsd_jobcount_t *first,
+		               cupsd_jobcount_t *second);
+static int	compare_filter_stats(cupsd_filterstats_t *first,
+		                     cupsd_filterstats_t *second);
 static int	compare_jobs(void *first, void *second, void *data);
+static int	compare_queues(void *first, void *second, void *data);
+static int	compare_workers(cupsd_worker_t *first,
+		                cupsd_worker_t *second);
 static void	dump_job_history(cupsd_job_t *job);
+static void	expire_job_timer(cupsd_job_t *job);
+static void	filter_ahead(cupsd_job_t *job, char *argv[], char *envp[]);
 static void	finalize_job(cupsd_job_t *job, int set_job_state);
+static cupsd_jobconv_t *find_conversion(cupsd_job_t *job, int doc);
+static void	free_conversion(cupsd_job_t *job, cupsd_jobconv_t *conv);
 static void	free_job_history(cupsd_job_t *job);
+static int	get_filters(cupsd_job_t *job, int file, cups_array_t **list,
+		            int *cost, char *final_content_type,
+			    size_t fctsize);
+static int	hash_count(cupsd_jobcount_t *count);
 static char	*get_options(cupsd_job_t *job, int banner_page, char *copies,
 		             size_t copies_size, char *title,
 			     size_t title_size);
 static size_t	ipp_length(ipp_t *ipp);
+static int	is_worker_filter(const char *filter);
+static void	journal_job(cupsd_job_t *job, int flush);
 static void	load_job_cache(const char *filename);
 static void	load_next_job_id(const char *filename);
 static void	load_request_root(void);
+static void	read_job_cache(cups_file_t *fp, const char *filename,
+		               int journal);
 static void	remove_job_files(cupsd_job_t *job);
 static void	remove_job_history(cupsd_job_t *job);
+static int	run_worker(cupsd_job_t *job, const char *command,
+		           char *argv[], char *envp[], int *fds);
+static void	save_job_cache(int start_journal);
+static void	set_job_count(cups_array_t **counts, cupsd_jobcount_t **count,
+		              const char *name);
 static void	set_time(cupsd_job_t *job, const char *name);
+static void	start_conversion(cupsd_job_t *job, int doc,
+		                 cups_array_t *filters, int cost, char *argv[],
+				 char *envp[]);
 static void	start_job(cupsd_job_t *job, cupsd_printer_t *printer);
+static void	start_worker(cupsd_printer_t *p, const char *command);
+static void	stop_conversions(cupsd_job_t *job, int force);
 static void	stop_job(cupsd_job_t *job, cupsd_jobaction_t action);
+static void	touch_job(cupsd_job_t *job);
 static void	unload_job(cupsd_job_t *job);
 static void	update_job(cupsd_job_t *job);
 static void	update_job_attrs(cupsd_job_t *job, int do_message);
+static void	write_job_cache(cups_file_t *fp, cupsd_job_t *job);
 
 
 /*
@@ -161,6 +296,8 @@ cupsdAddJob(int        priority,	/* I - Job priority */
   job->side_pipes[1]   = -1;
   job->status_pipes[0] = -1;
   job->status_pipes[1] = -1;
+  job->stream_fds[0]   = -1;
+  job->stream_fds[1]   = -1;
 
   cupsdSetString(&job->dest, dest);
 
@@ -171,10 +308,117 @@ cupsdAddJob(int        priority,	/* I - Job priority */
   cupsArrayAdd(Jobs, job);
   cupsArrayAdd(ActiveJobs, job);
 
+  cupsdUpdateJobCounts(job);
+
   return (job);
 }
 
 
+/*
+ * 'cupsdAddJobStats()' - Record the resource usage of a filter or backend.
+ */
+
+void
+cupsdAddJobStats(
+    cupsd_job_t            *job,	/* I - Job */
+    const cupsd_jobstats_t *stats)	/* I - Resource usage */
+{
+  const char		*name;		/* Program name */
+  ipp_t			*col;		/* Statistics collection */
+  ipp_attribute_t	*attr;		/* job-filter-stats attribute */
+  cupsd_filterstats_t	key,		/* Search key */
+			*pstats;	/* Printer statistics */
+  int			i;		/* Histogram bucket */
+
+
+  if ((name = strrchr(stats->name, '/')) != NULL)
+    name ++;
+  else
+    name = stats->name;
+
+  cupsdLogJob(job, CUPSD_LOG_DEBUG, "%s used %ld.%03ld seconds user CPU, %ld.%03ld seconds system CPU, %ld.%03ld seconds wall time, and %ldk RSS.", name, stats->user_time / 1000, stats->user_time % 1000, stats->system_time / 1000, stats->system_time % 1000, stats->wall_time / 1000, stats->wall_time % 1000, stats->max_rss);
+
+ /*
+  * Add a collection to the job-filter-stats attribute...
+  */
+
+  if (!job->attrs)
+    cupsdLoadJob(job);
+
+  if (job->attrs)
+  {
+    col = ippNew();
+
+    ippAddString(col, IPP_TAG_ZERO, IPP_TAG_NAME, "filter-name", NULL, name);
+    ippAddString(col, IPP_TAG_ZERO, IPP_CONST_TAG(IPP_TAG_KEYWORD),
+                 "filter-type", NULL, stats->backend ? "backend" : "filter");
+    ippAddInteger(col, IPP_TAG_ZERO, IPP_TAG_INTEGER, "document-number",
+                  stats->doc);
+    ippAddInteger(col, IPP_TAG_ZERO, IPP_TAG_INTEGER, "user-cpu-time",
+                  (int)stats->user_time);
+    ippAddInteger(col, IPP_TAG_ZERO, IPP_TAG_INTEGER, "system-cpu-time",
+                  (int)stats->system_time);
+    ippAddInteger(col, IPP_TAG_ZERO, IPP_TAG_INTEGER, "wall-time",
+                  (int)stats->wall_time);
+    ippAddInteger(col, IPP_TAG_ZERO, IPP_TAG_INTEGER, "max-rss",
+                  (int)stats->max_rss);
+    if (stats->bytes_read >= 0)
+      ippAddInteger(col, IPP_TAG_ZERO, IPP_TAG_INTEGER, "k-octets-read",
+                    (int)((stats->bytes_read + 1023) / 1024));
+    if (stats->bytes_written >= 0)
+      ippAddInteger(col, IPP_TAG_ZERO, IPP_TAG_INTEGER, "k-octets-written",
+                    (int)((stats->bytes_written + 1023) / 1024));
+
+    if ((attr = ippFindAttribute(job->attrs, "job-filter-stats",
+                                 IPP_TAG_BEGIN_COLLECTION)) != NULL)
+      ippSetCollection(job->attrs, &attr, ippGetCount(attr), col);
+    else
+      ippAddCollection(job->attrs, IPP_TAG_JOB, "job-filter-stats", col);
+
+    ippDelete(col);
+
+    job->dirty = 1;
+    cupsdMarkDirty(CUPSD_DIRTY_JOBS);
+  }
+
+ /*
+  * Then update the totals for the printer...
+  */
+
+  if (!job->printer)
+    return;
+
+  if (!job->printer->filter_stats)
+    job->printer->filter_stats =
+        cupsArrayNew((cups_array_func_t)compare_filter_stats, NULL);
+
+  strlcpy(key.name, name, sizeof(key.name));
+
+  if ((pstats = (cupsd_filterstats_t *)cupsArrayFind(job->printer->filter_stats,
+                                                      &key)) == NULL)
+  {
+    if ((pstats = calloc(1, sizeof(cupsd_filterstats_t))) == NULL)
+      return;
+
+    strlcpy(pstats->name, name, sizeof(pstats->name));
+    cupsArrayAdd(job->printer->filter_stats, pstats);
+  }
+
+  pstats->count ++;
+  pstats->user_time   += stats->user_time;
+  pstats->system_time += stats->system_time;
+  pstats->wall_time   += stats->wall_time;
+
+  if (stats->max_rss > pstats->max_rss)
+    pstats->max_rss = stats->max_rss;
+
+  for (i = 0; i < (CUPSD_FILTERSTATS_BUCKETS - 1) &&
+              stats->wall_time >= (1L << i); i ++);
+
+  pstats->wall_times[i] ++;
+}
+
+
 /*
  * 'cupsdCancelJobs()' - Cancel all jobs for the given destination/user.
  */
@@ -221,105 +465,103 @@ void
 cupsdCheckJobs(void)
 {
   cupsd_job_t		*job;		/* Current job in queue */
+  cupsd_jobq_t		*queue;		/* Current pending queue */
+  cups_array_t		*ready;		/* Jobs that might be started */
   cupsd_printer_t	*printer,	/* Printer destination */
 			*pclass;	/* Printer class destination */
   ipp_attribute_t	*attr;		/* Job attribute */
   time_t		curtime;	/* Current time */
   const char		*reasons;	/* job-state-reasons value */
+  int			count,		/* Number of jobs that can start */
+			pending = 0;	/* Any jobs still pending? */
 
 
   curtime = time(NULL);
 
-  cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdCheckJobs: %d active jobs, sleeping=%d, ac-power=%d, reload=%d, curtime=%ld", cupsArrayCount(ActiveJobs), Sleeping, ACPower, NeedReload, (long)curtime);
-
-  for (job = (cupsd_job_t *)cupsArrayFirst(ActiveJobs);
-       job;
-       job = (cupsd_job_t *)cupsArrayNext(ActiveJobs))
-  {
-    cupsdLogMessage(CUPSD_LOG_DEBUG2,
-                    "cupsdCheckJobs: Job %d - dest=\"%s\", printer=%p, "
-                    "state=%d, cancel_time=%ld, hold_until=%ld, kill_time=%ld, "
-                    "pending_cost=%d, pending_timeout=%ld", job->id, job->dest,
-                    job->printer, job->state_value, (long)job->cancel_time,
-                    (long)job->hold_until, (long)job->kill_time,
-                    job->pending_cost, (long)job->pending_timeout);
+  cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdCheckJobs: %d active jobs, %d pending queues, %d filter waits, sleeping=%d, ac-power=%d, reload=%d, curtime=%ld", cupsArrayCount(ActiveJobs), cupsArrayCount(pending_queues), cupsArrayCount(filter_jobs), Sleeping, ACPower, NeedReload, (long)curtime);
 
-   /*
-    * Kill jobs if they are unresponsive...
-    */
+ /*
+  * Continue jobs that are waiting on the FilterLimit...
+  */
 
-    if (job->kill_time && job->kill_time <= curtime)
-    {
-      if (!job->completed)
-        cupsdLogJob(job, CUPSD_LOG_ERROR, "Stopping unresponsive job.");
+  for (job = (cupsd_job_t *)cupsArrayFirst(filter_jobs);
+       job;
+       job = (cupsd_job_t *)cupsArrayNext(filter_jobs))
+    if ((FilterLevel + job->pending_cost) < FilterLimit || FilterLevel == 0)
+      cupsdContinueJob(job);
 
-      stop_job(job, CUPSD_JOB_FORCE);
-      continue;
-    }
+ /*
+  * Collect the pending jobs whose destination can start a job now...
+  */
 
-   /*
-    * Cancel stuck jobs...
-    */
+  ready = cupsArrayNew(compare_active_jobs, NULL);
 
-    if (job->cancel_time && job->cancel_time <= curtime)
+  for (queue = (cupsd_jobq_t *)cupsArrayFirst(pending_queues);
+       queue;
+       queue = (cupsd_jobq_t *)cupsArrayNext(pending_queues))
+  {
+    if (cupsArrayCount(queue->jobs) == 0)
     {
-      int cancel_after;			/* job-cancel-after value */
-
-      attr         = ippFindAttribute(job->attrs, "job-cancel-after", IPP_TAG_INTEGER);
-      cancel_after = attr ? ippGetInteger(attr, 0) : MaxJobTime;
+     /*
+      * No jobs reference an empty queue, so free it...
+      */
 
-      if (job->completed)
-	cupsdSetJobState(job, IPP_JOB_CANCELED, CUPSD_JOB_FORCE, "Marking stuck job as completed after %d seconds.", cancel_after);
-      else
-	cupsdSetJobState(job, IPP_JOB_CANCELED, CUPSD_JOB_DEFAULT, "Canceling stuck job after %d seconds.", cancel_after);
+      cupsArrayRemove(pending_queues, queue);
+      cupsArrayDelete(queue->jobs);
+      cupsdClearString(&queue->dest);
+      free(queue);
       continue;
     }
 
-   /*
-    * Start held jobs if they are ready...
-    */
+    pending = 1;
 
-    if (job->state_value == IPP_JOB_HELD &&
-        job->hold_until &&
-	job->hold_until < curtime)
-    {
-      if (job->pending_timeout)
-      {
-       /*
-        * This job is pending; check that we don't have an active Send-Document
-	* operation in progress on any of the client connections, then timeout
-	* the job so we can start printing...
-	*/
+    if (NeedReload || (Sleeping && !ACPower) || DoingShutdown)
+      continue;
 
-        cupsd_client_t	*con;		/* Current client connection */
+    if ((printer = cupsdFindDest(queue->dest)) == NULL)
+      count = cupsArrayCount(queue->jobs);	/* Abort them all */
+    else if (!(printer->type & CUPS_PRINTER_CLASS) ||
+             (printer->type & CUPS_PRINTER_REMOTE))
+      count = !printer->job && printer->state == IPP_PRINTER_IDLE;
+    else if (printer->state == IPP_PRINTER_STOPPED)
+      count = 0;
+    else
+      count = cupsArrayCount(queue->jobs);
 
-	for (con = (cupsd_client_t *)cupsArrayFirst(Clients);
-	     con;
-	     con = (cupsd_client_t *)cupsArrayNext(Clients))
-	  if (con->request &&
-	      con->request->request.op.operation_id == IPP_SEND_DOCUMENT)
-	    break;
+    cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdCheckJobs: %s has %d pending jobs, %d can start.", queue->dest, cupsArrayCount(queue->jobs), count);
 
-        if (con)
-	  continue;
+    for (job = (cupsd_job_t *)cupsArrayFirst(queue->jobs);
+         job && count > 0;
+	 job = (cupsd_job_t *)cupsArrayNext(queue->jobs))
+    {
+      cupsArrayAdd(ready, job);
 
-        if (cupsdTimeoutJob(job))
-	  continue;
+     /*
+      * Jobs that are held-on-create don't use up the destination...
+      */
 
-	cupsdSetJobState(job, IPP_JOB_PENDING, CUPSD_JOB_DEFAULT, "Job submission timed out.");
-	cupsdLogJob(job, CUPSD_LOG_ERROR, "Job submission timed out.");
-      }
-      else
-	cupsdSetJobState(job, IPP_JOB_PENDING, CUPSD_JOB_DEFAULT, "Job hold expired.");
+      reasons = ippGetString(job->reasons, 0, NULL);
+      if (!printer || !printer->holding_new_jobs || !reasons ||
+          strcmp(reasons, "job-held-on-create"))
+        count --;
     }
+  }
 
-   /*
-    * Continue jobs that are waiting on the FilterLimit...
-    */
+ /*
+  * Start pending jobs if the destination is available...
+  */
 
-    if (job->pending_cost > 0 &&
-	((FilterLevel + job->pending_cost) < FilterLimit || FilterLevel == 0))
-      cupsdContinueJob(job);
+  for (job = (cupsd_job_t *)cupsArrayFirst(ready);
+       job;
+       job = (cupsd_job_t *)cupsArrayNext(ready))
+  {
+    cupsdLogMessage(CUPSD_LOG_DEBUG2,
+                    "cupsdCheckJobs: Job %d - dest=\"%s\", printer=%p, "
+                    "state=%d, pending_timeout=%ld", job->id, job->dest,
+                    job->printer, job->state_value, (long)job->pending_timeout);
+
+    if (job->state_value != IPP_JOB_PENDING || job->printer)
+      continue;
 
    /*
     * Skip jobs that where held-on-create
@@ -334,85 +576,86 @@ cupsdCheckJobs(void)
 
       printer = cupsdFindDest(job->dest);
 
-      if (printer->holding_new_jobs)
+      if (printer && printer->holding_new_jobs)
         continue;
 
       ippSetString(job->attrs, &job->reasons, 0, "none");
     }
 
-   /*
-    * Start pending jobs if the destination is available...
-    */
+    printer = cupsdFindDest(job->dest);
+    pclass  = NULL;
 
-    if (job->state_value == IPP_JOB_PENDING && !NeedReload &&
-        (!Sleeping || ACPower) && !DoingShutdown && !job->printer)
+    while (printer && (printer->type & CUPS_PRINTER_CLASS))
     {
-      printer = cupsdFindDest(job->dest);
-      pclass  = NULL;
+     /*
+      * If the class is remote, just pass it to the remote server...
+      */
 
-      while (printer && (printer->type & CUPS_PRINTER_CLASS))
-      {
-       /*
-        * If the class is remote, just pass it to the remote server...
-	*/
+      pclass = printer;
 
-        pclass = printer;
+      if (pclass->state == IPP_PRINTER_STOPPED)
+	printer = NULL;
+      else if (pclass->type & CUPS_PRINTER_REMOTE)
+	break;
+      else
+	printer = cupsdFindAvailablePrinter(printer->name);
+    }
 
-        if (pclass->state == IPP_PRINTER_STOPPED)
-	  printer = NULL;
-        else if (pclass->type & CUPS_PRINTER_REMOTE)
-	  break;
-	else
-	  printer = cupsdFindAvailablePrinter(printer->name);
-      }
+    if (!printer && !pclass)
+    {
+     /*
+      * Whoa, the printer and/or class for this destination went away;
+      * cancel the job...
+      */
+
+      cupsdSetJobState(job, IPP_JOB_ABORTED, CUPSD_JOB_PURGE,
+		       "Job aborted because the destination printer/class "
+		       "has gone away.");
+    }
+    else if (printer)
+    {
+     /*
+      * See if the printer is available or remote and not printing a job;
+      * if so, start the job...
+      */
 
-      if (!printer && !pclass)
+      if (pclass)
       {
        /*
-        * Whoa, the printer and/or class for this destination went away;
-	* cancel the job...
+	* Add/update a job-printer-uri-actual attribute for this job
+	* so that we know which printer actually printed the job...
 	*/
 
-        cupsdSetJobState(job, IPP_JOB_ABORTED, CUPSD_JOB_PURGE,
-	                 "Job aborted because the destination printer/class "
-			 "has gone away.");
+	if ((attr = ippFindAttribute(job->attrs, "job-printer-uri-actual", IPP_TAG_URI)) != NULL)
+	  ippSetString(job->attrs, &attr, 0, printer->uri);
+	else
+	  ippAddString(job->attrs, IPP_TAG_JOB, IPP_TAG_URI, "job-printer-uri-actual", NULL, printer->uri);
+
+	job->dirty = 1;
+	cupsdMarkDirty(CUPSD_DIRTY_JOBS);
       }
-      else if (printer)
+
+      if (!printer->job && printer->state == IPP_PRINTER_IDLE)
       {
        /*
-        * See if the printer is available or remote and not printing a job;
-	* if so, start the job...
+	* Start the job...
 	*/
 
-        if (pclass)
-	{
-	 /*
-	  * Add/update a job-printer-uri-actual attribute for this job
-	  * so that we know which printer actually printed the job...
-	  */
-
-          if ((attr = ippFindAttribute(job->attrs, "job-printer-uri-actual", IPP_TAG_URI)) != NULL)
-            ippSetString(job->attrs, &attr, 0, printer->uri);
-	  else
-	    ippAddString(job->attrs, IPP_TAG_JOB, IPP_TAG_URI, "job-printer-uri-actual", NULL, printer->uri);
-
-          job->dirty = 1;
-          cupsdMarkDirty(CUPSD_DIRTY_JOBS);
-	}
-
-        if (!printer->job && printer->state == IPP_PRINTER_IDLE)
-        {
-	 /*
-	  * Start the job...
-	  */
-
-	  cupsArraySave(ActiveJobs);
-	  start_job(job, printer);
-	  cupsArrayRestore(ActiveJobs);
-	}
+	cupsArraySave(ActiveJobs);
+	start_job(job, printer);
+	cupsArrayRestore(ActiveJobs);
       }
     }
   }
+
+  cupsArrayDelete(ready);
+
+ /*
+  * Check again in 10 seconds if jobs are still waiting...
+  */
+
+  if (pending && (!check_timer.when || check_timer.when > (curtime + 10)))
+    cupsdSetTimer(&check_timer, curtime + 10, check_jobs_timer, NULL, "start pending jobs");
 }
 
 
@@ -424,6 +667,7 @@ void
 cupsdCleanJobs(void)
 {
   cupsd_job_t	*job;			/* Current job */
+  cupsd_printer_t *p;			/* Job destination */
   time_t	curtime;		/* Current time */
 
 
@@ -431,7 +675,8 @@ cupsdCleanJobs(void)
                   "cupsdCleanJobs: MaxJobs=%d, JobHistory=%d, JobFiles=%d",
                   MaxJobs, JobHistory, JobFiles);
 
-  if (MaxJobs <= 0 && JobHistory == INT_MAX && JobFiles == INT_MAX)
+  if (MaxJobs <= 0 && JobHistory == INT_MAX && JobFiles == INT_MAX &&
+      !JobAutoPurge)
     return;
 
   curtime          = time(NULL);
@@ -463,6 +708,18 @@ cupsdCleanJobs(void)
         cupsdLogJob(job, CUPSD_LOG_DEBUG, "Removing from history.");
 	cupsdDeleteJob(job, CUPSD_JOB_PURGE);
       }
+      else if (JobAutoPurge && job->completed_time &&
+               (p = cupsdFindDest(job->dest)) != NULL &&
+	       (p->k_limit || p->page_limit) && p->quota_period > 0 &&
+	       job->completed_time < (curtime - p->quota_period))
+      {
+       /*
+        * The job is too old to count towards the quota...
+	*/
+
+        cupsdLogJob(job, CUPSD_LOG_DEBUG, "Removing from history.");
+	cupsdDeleteJob(job, CUPSD_JOB_PURGE);
+      }
       else if (job->file_time && job->file_time <= curtime && job->num_files > 0)
       {
         cupsdLogJob(job, CUPSD_LOG_DEBUG, "Removing document files.");
@@ -487,11 +744,10 @@ cupsdContinueJob(cupsd_job_t *job)	/* I - Job */
 {
   int			i;		/* Looping var */
   int			slot;		/* Pipe slot */
-  cups_array_t		*filters = NULL,/* Filters for job */
-			*prefilters;	/* Filters with prefilters */
+  cups_array_t		*filters = NULL;/* Filters for job */
   mime_filter_t		*filter,	/* Current filter */
-			*prefilter,	/* Prefilter */
 			port_monitor;	/* Port monitor filter */
+  cupsd_jobconv_t	*conv;		/* Document filtered ahead of time */
   char			scheme[255];	/* Device URI scheme */
   ipp_attribute_t	*attr;		/* Current attribute */
   const char		*ptr,		/* Pointer into value */
@@ -505,8 +761,10 @@ cupsdContinueJob(cupsd_job_t *job)	/* I - Job */
   int			raw_file;       /* 1 if file type is vnd.cups-raw */
   int			filterfds[2][2] = { { -1, -1 }, { -1, -1 } };
 					/* Pipes used between filters */
-  int			envc;		/* Number of environment variables */
-  struct stat		fileinfo;	/* Job file information */
+  int			ringfds[2] = { -1, -1 };
+					/* Shared memory rings between filters */
+  int			envc,		/* Number of environment variables */
+			ringenvc;	/* Number with ring variables */
   int			argc = 0;	/* Number of arguments */
   char			**argv = NULL,	/* Filter command-line arguments */
 			filename[1024],	/* Job filename */
@@ -516,7 +774,7 @@ cupsdContinueJob(cupsd_job_t *job)	/* I - Job */
 					/* Job title string */
 			copies[255],	/* # copies string */
 			*options,	/* Options string */
-			*envp[MAX_ENV + 21],
+			*envp[MAX_ENV + 23],
 					/* Environment variables */
 			charset[255],	/* CHARSET env variable */
 			class_name[255],/* CLASS env variable */
@@ -560,8 +818,38 @@ cupsdContinueJob(cupsd_job_t *job)	/* I - Job */
   job->cost         = 0;
   job->pending_cost = 0;
 
+  cupsArrayRemove(filter_jobs, job);
+
   memset(job->filters, 0, sizeof(job->filters));
 
+ /*
+  * See if the next document has been filtered ahead of time...
+  */
+
+  if ((conv = find_conversion(job, job->current_file + 1)) != NULL)
+  {
+    for (i = 0; conv->filters[i] < 0; i ++);
+
+    if (conv->filters[i])
+    {
+     /*
+      * Still filtering, cupsdFinishJobConversion will call us again...
+      */
+
+      cupsdLogJob(job, CUPSD_LOG_DEBUG,
+                  "Waiting for document %d to be filtered.", conv->doc);
+      return;
+    }
+    else if (conv->status)
+    {
+      cupsdLogJob(job, CUPSD_LOG_DEBUG,
+                  "Filtering document %d again since filtering it ahead of "
+		  "time failed.", conv->doc);
+      free_conversion(job, conv);
+      conv = NULL;
+    }
+  }
+
   if (job->printer->raw)
   {
    /*
@@ -571,45 +859,26 @@ cupsdContinueJob(cupsd_job_t *job)	/* I - Job */
 
     cupsdLogJob(job, CUPSD_LOG_DEBUG, "Sending job to queue tagged as raw...");
   }
-  else
+  else if (conv)
   {
    /*
-    * Local jobs get filtered...
+    * The document was filtered ahead of time, just copy it...
     */
 
-    mime_type_t	*dst = job->printer->filetype;
-					/* Destination file type */
-
-    snprintf(filename, sizeof(filename), "%s/d%05d-%03d", RequestRoot,
-             job->id, job->current_file + 1);
-    if (stat(filename, &fileinfo))
-      fileinfo.st_size = 0;
-
-    if (job->retry_as_raster)
-    {
-     /*
-      * Need to figure out whether the printer supports image/pwg-raster or
-      * image/urf, and use the corresponding type...
-      */
-
-      char	type[MIME_MAX_TYPE];	/* MIME media type for printer */
-
-      snprintf(type, sizeof(type), "%s/image/urf", job->printer->name);
-      if ((dst = mimeType(MimeDatabase, "printer", type)) == NULL)
-      {
-	snprintf(type, sizeof(type), "%s/image/pwg-raster", job->printer->name);
-	dst = mimeType(MimeDatabase, "printer", type);
-      }
-
-      if (dst)
-        cupsdLogJob(job, CUPSD_LOG_DEBUG, "Retrying job as \"%s\".", strchr(dst->type, '/') + 1);
-      else
-        cupsdLogJob(job, CUPSD_LOG_ERROR, "Unable to retry job using a supported raster format.");
-    }
+    cupsdLogJob(job, CUPSD_LOG_DEBUG, "Document %d was filtered ahead of time.",
+                conv->doc);
 
-    filters = mimeFilter2(MimeDatabase, job->filetypes[job->current_file], (size_t)fileinfo.st_size, dst, &(job->cost));
+    strlcpy(final_content_type, conv->final_content_type,
+            sizeof(final_content_type));
+  }
+  else
+  {
+   /*
+    * Local jobs get filtered...
+    */
 
-    if (!filters)
+    if (!get_filters(job, job->current_file, &filters, &(job->cost),
+                     final_content_type, sizeof(final_content_type)))
     {
       cupsdLogJob(job, CUPSD_LOG_ERROR,
 		  "Unable to convert file %d to printable format.",
@@ -621,90 +890,6 @@ cupsdContinueJob(cupsd_job_t *job)	/* I - Job */
       ippSetString(job->attrs, &job->reasons, 0, "document-unprintable-error");
       goto abort_job;
     }
-
-   /*
-    * Figure out the final content type...
-    */
-
-    cupsdLogJob(job, CUPSD_LOG_DEBUG, "%d filters for job:",
-                cupsArrayCount(filters));
-    for (filter = (mime_filter_t *)cupsArrayFirst(filters);
-         filter;
-         filter = (mime_filter_t *)cupsArrayNext(filters))
-      cupsdLogJob(job, CUPSD_LOG_DEBUG, "%s (%s/%s to %s/%s, cost %d)",
-		  filter->filter,
-		  filter->src ? filter->src->super : "???",
-		  filter->src ? filter->src->type : "???",
-		  filter->dst ? filter->dst->super : "???",
-		  filter->dst ? filter->dst->type : "???",
-		  filter->cost);
-
-    if (!job->printer->remote)
-    {
-      for (filter = (mime_filter_t *)cupsArrayLast(filters);
-           filter && filter->dst;
-           filter = (mime_filter_t *)cupsArrayPrev(filters))
-        if (strcmp(filter->dst->super, "printer") ||
-            strcmp(filter->dst->type, job->printer->name))
-          break;
-
-      if (filter && filter->dst)
-      {
-	if ((ptr = strchr(filter->dst->type, '/')) != NULL)
-	  snprintf(final_content_type, sizeof(final_content_type),
-		   "FINAL_CONTENT_TYPE=%s", ptr + 1);
-	else
-	  snprintf(final_content_type, sizeof(final_content_type),
-		   "FINAL_CONTENT_TYPE=%s/%s", filter->dst->super,
-		   filter->dst->type);
-      }
-      else
-        snprintf(final_content_type, sizeof(final_content_type),
-                 "FINAL_CONTENT_TYPE=printer/%s", job->printer->name);
-    }
-
-   /*
-    * Remove NULL ("-") filters...
-    */
-
-    for (filter = (mime_filter_t *)cupsArrayFirst(filters);
-         filter;
-	 filter = (mime_filter_t *)cupsArrayNext(filters))
-      if (!strcmp(filter->filter, "-"))
-        cupsArrayRemove(filters, filter);
-
-    if (cupsArrayCount(filters) == 0)
-    {
-      cupsArrayDelete(filters);
-      filters = NULL;
-    }
-
-   /*
-    * If this printer has any pre-filters, insert the required pre-filter
-    * in the filters array...
-    */
-
-    if (job->printer->prefiltertype && filters)
-    {
-      prefilters = cupsArrayNew(NULL, NULL);
-
-      for (filter = (mime_filter_t *)cupsArrayFirst(filters);
-	   filter;
-	   filter = (mime_filter_t *)cupsArrayNext(filters))
-      {
-	if ((prefilter = mimeFilterLookup(MimeDatabase, filter->src,
-					  job->printer->prefiltertype)))
-	{
-	  cupsArrayAdd(prefilters, prefilter);
-	  job->cost += prefilter->cost;
-	}
-
-	cupsArrayAdd(prefilters, filter);
-      }
-
-      cupsArrayDelete(filters);
-      filters = prefilters;
-    }
   }
 
  /*
@@ -737,6 +922,11 @@ cupsdContinueJob(cupsd_job_t *job)	/* I - Job */
 
     job->pending_cost = job->cost;
     job->cost         = 0;
+
+    if (!filter_jobs)
+      filter_jobs = cupsArrayNew(compare_active_jobs, NULL);
+
+    cupsArrayAdd(filter_jobs, job);
     return;
   }
 
@@ -749,7 +939,8 @@ cupsdContinueJob(cupsd_job_t *job)	/* I - Job */
   raw_file = !strcmp(job->filetypes[job->current_file]->super, "application") &&
     !strcmp(job->filetypes[job->current_file]->type, "vnd.cups-raw");
 
-  if ((job->compressions[job->current_file] && (!job->printer->remote || job->num_files == 1)) ||
+  if (conv ||
+      (job->compressions[job->current_file] && (!job->printer->remote || job->num_files == 1)) ||
       (!job->printer->remote && (job->printer->raw || raw_file) && job->num_files > 1))
   {
    /*
@@ -918,15 +1109,71 @@ cupsdContinueJob(cupsd_job_t *job)	/* I - Job */
   {
     snprintf(filename, sizeof(filename), "%s/d%05d-%03d", RequestRoot,
              job->id, job->current_file + 1);
-    argv[6] = strdup(filename);
-  }
 
-  for (i = 0; argv[i]; i ++)
-    cupsdLogJob(job, CUPSD_LOG_DEBUG, "argv[%d]=\"%s\"", i, argv[i]);
+    if (job->streaming == job->current_file + 1)
+    {
+     /*
+      * The document is still being received, so feed it to the first filter
+      * (or the backend) through a pipe as it arrives...
+      */
 
- /*
-  * Create environment variable strings for the filters...
-  */
+      if (cupsdOpenPipe(filterfds[1]) ||
+          (job->stream_fds[0] = open(filename, O_RDONLY)) < 0)
+      {
+        cupsdLogJob(job, CUPSD_LOG_ERROR, "Unable to stream \"%s\": %s",
+	            filename, strerror(errno));
+
+        abort_message = "Stopping job because the scheduler could not create "
+	                "the filter pipes.";
+
+        goto abort_job;
+      }
+
+      fcntl(job->stream_fds[0], F_SETFD,
+            fcntl(job->stream_fds[0], F_GETFD) | FD_CLOEXEC);
+
+      job->stream_fds[1] = filterfds[1][1];
+      filterfds[1][1]    = -1;
+
+      fcntl(job->stream_fds[1], F_SETFL,
+            fcntl(job->stream_fds[1], F_GETFL) | O_NONBLOCK);
+
+      cupsdLogJob(job, CUPSD_LOG_DEBUG, "Streaming document %d.",
+                  job->streaming);
+    }
+    else if (conv)
+    {
+     /*
+      * Copy the filtered document to the backend...
+      */
+
+      if ((filterfds[1][0] = open(conv->filename, O_RDONLY)) < 0)
+      {
+        cupsdLogJob(job, CUPSD_LOG_ERROR, "Unable to open \"%s\": %s",
+	            conv->filename, strerror(errno));
+
+        abort_message = "Stopping job because the scheduler could not open "
+	                "the filtered document.";
+
+        goto abort_job;
+      }
+
+      fcntl(filterfds[1][0], F_SETFD,
+            fcntl(filterfds[1][0], F_GETFD) | FD_CLOEXEC);
+
+      free_conversion(job, conv);
+      conv = NULL;
+    }
+    else
+      argv[6] = strdup(filename);
+  }
+
+  for (i = 0; argv[i]; i ++)
+    cupsdLogJob(job, CUPSD_LOG_DEBUG, "argv[%d]=\"%s\"", i, argv[i]);
+
+ /*
+  * Create environment variable strings for the filters...
+  */
 
   attr = ippFindAttribute(job->attrs, "attributes-natural-language",
                           IPP_TAG_LANGUAGE);
@@ -1139,6 +1386,18 @@ cupsdContinueJob(cupsd_job_t *job)	/* I - Job */
 
         goto abort_job;
       }
+
+     /*
+      * Filters that use the CUPS library can pass data through shared
+      * memory instead of the pipe...
+      */
+
+      if (FilterRingSize > 0 &&
+          (ringfds[slot] = _cupsRingCreate(filterfds[slot][0],
+	                                   (size_t)FilterRingSize)) < 0)
+        cupsdLogJob(job, CUPSD_LOG_DEBUG,
+	            "Unable to create shared memory for filters: %s",
+		    strerror(errno));
     }
     else
     {
@@ -1194,13 +1453,48 @@ cupsdContinueJob(cupsd_job_t *job)	/* I - Job */
       filterfds[slot][1] = job->print_pipes[1];
     }
 
-    pid = cupsdStartProcess(command, argv, envp, filterfds[!slot][0],
-                            filterfds[slot][1], job->status_pipes[1],
-		            job->back_pipes[0], job->side_pipes[0], 0,
-			    job->profile, job, job->filters + i);
+    ringenvc = envc;
+
+    if (ringfds[!slot] >= 0)
+      envp[ringenvc ++] = "CUPS_STDIN_RING=5";
+
+    if (ringfds[slot] >= 0)
+      envp[ringenvc ++] = "CUPS_STDOUT_RING=6";
+
+    envp[ringenvc] = NULL;
+
+    if (is_worker_filter(filter->filter))
+    {
+      int	fds[7];			/* Filter file descriptors */
+
+      fds[0] = filterfds[!slot][0];
+      fds[1] = filterfds[slot][1];
+      fds[2] = job->status_pipes[1];
+      fds[3] = job->back_pipes[0];
+      fds[4] = job->side_pipes[0];
+      fds[5] = ringfds[!slot];
+      fds[6] = ringfds[slot];
+
+      pid = job->filters[i] = run_worker(job, command, argv, envp, fds);
+    }
+    else
+      pid = 0;
+
+    if (!pid)
+      pid = cupsdStartProcess(command, argv, envp, filterfds[!slot][0],
+                              filterfds[slot][1], job->status_pipes[1],
+		              job->back_pipes[0], job->side_pipes[0],
+			      ringfds[!slot], ringfds[slot], 0, job->profile,
+			      job, job->filters + i);
 
     cupsdClosePipe(filterfds[!slot]);
 
+    if (ringfds[!slot] >= 0)
+    {
+      close(ringfds[!slot]);
+      ringfds[!slot] = -1;
+    }
+
     if (pid == 0)
     {
       cupsdLogJob(job, CUPSD_LOG_ERROR, "Unable to start filter \"%s\" - %s.",
@@ -1227,6 +1521,8 @@ cupsdContinueJob(cupsd_job_t *job)	/* I - Job */
   cupsArrayDelete(filters);
   filters = NULL;
 
+  envp[envc] = NULL;
+
  /*
   * Finally, pipe the final output into a backend process if needed...
   */
@@ -1257,7 +1553,7 @@ cupsdContinueJob(cupsd_job_t *job)	/* I - Job */
 
       pid = cupsdStartProcess(command, argv, envp, filterfds[!slot][0],
 			      filterfds[slot][1], job->status_pipes[1],
-			      job->back_pipes[1], job->side_pipes[1],
+			      job->back_pipes[1], job->side_pipes[1], -1, -1,
 			      backroot, job->bprofile, job, &(job->backend));
 
       if (pid == 0)
@@ -1305,6 +1601,21 @@ cupsdContinueJob(cupsd_job_t *job)	/* I - Job */
 
   cupsdClosePipe(filterfds[slot]);
 
+  if (i == 0)
+  {
+   /*
+    * No filters, so the backend got the streaming pipe...
+    */
+
+    cupsdClosePipe(filterfds[1]);
+  }
+
+ /*
+  * Start filtering the following documents if we can...
+  */
+
+  filter_ahead(job, argv, envp);
+
   for (i = 6; i < argc; i ++)
     free(argv[i]);
   free(argv);
@@ -1315,6 +1626,9 @@ cupsdContinueJob(cupsd_job_t *job)	/* I - Job */
   cupsdAddSelect(job->status_buffer->fd, (cupsd_selfunc_t)update_job, NULL,
                  job);
 
+  if (job->stream_fds[1] >= 0)
+    cupsdUpdateJobStream(job);
+
   cupsdAddEvent(CUPSD_EVENT_JOB_STATE, job->printer, job, "Job #%d started.",
                 job->id);
 
@@ -1334,6 +1648,8 @@ cupsdContinueJob(cupsd_job_t *job)	/* I - Job */
   for (slot = 0; slot < 2; slot ++)
     cupsdClosePipe(filterfds[slot]);
 
+  cupsdClosePipe(ringfds);
+
   cupsArrayDelete(filters);
 
   if (argv)
@@ -1351,6 +1667,9 @@ cupsdContinueJob(cupsd_job_t *job)	/* I - Job */
   cupsdClosePipe(job->back_pipes);
   cupsdClosePipe(job->side_pipes);
 
+  cupsdRemoveSelect(job->stream_fds[1]);
+  cupsdClosePipe(job->stream_fds);
+
   cupsdRemoveSelect(job->status_pipes[0]);
   cupsdClosePipe(job->status_pipes);
   cupsdStatBufDelete(job->status_buffer);
@@ -1375,6 +1694,8 @@ cupsdContinueJob(cupsd_job_t *job)	/* I - Job */
 
   job->printer->job = NULL;
   job->printer      = NULL;
+
+  cupsdUpdateJobQueue(job);
 }
 
 
@@ -1421,6 +1742,19 @@ cupsdDeleteJob(cupsd_job_t       *job,	/* I - Job */
   cupsArrayRemove(Jobs, job);
   cupsArrayRemove(ActiveJobs, job);
   cupsArrayRemove(PrintingJobs, job);
+  cupsArrayRemove(filter_jobs, job);
+
+  if (job->queue)
+    cupsArrayRemove(job->queue->jobs, job);
+
+  cupsdUpdateJobCounts(job);
+  cupsdClearTimer(&job->timer);
+
+  if (job_journal)
+  {
+    cupsFilePrintf(job_journal, "DeleteJob %d\n", job->id);
+    job_journal_records ++;
+  }
 
   free(job);
 }
@@ -1434,6 +1768,7 @@ void
 cupsdFreeAllJobs(void)
 {
   cupsd_job_t	*job;			/* Current job */
+  cupsd_jobq_t	*queue;			/* Current pending queue */
 
 
   if (!Jobs)
@@ -1442,13 +1777,40 @@ cupsdFreeAllJobs(void)
   cupsdHoldSignals();
 
   cupsdStopAllJobs(CUPSD_JOB_FORCE, 0);
-  cupsdSaveAllJobs();
+
+ /*
+  * Write a full job.cache file and stop journaling since the jobs are being
+  * freed, not deleted...
+  */
+
+  if (job_journal)
+  {
+    cupsFileClose(job_journal);
+    job_journal = NULL;
+  }
+
+  save_job_cache(0);
 
   for (job = (cupsd_job_t *)cupsArrayFirst(Jobs);
        job;
        job = (cupsd_job_t *)cupsArrayNext(Jobs))
     cupsdDeleteJob(job, CUPSD_JOB_DEFAULT);
 
+  for (queue = (cupsd_jobq_t *)cupsArrayFirst(pending_queues);
+       queue;
+       queue = (cupsd_jobq_t *)cupsArrayNext(pending_queues))
+  {
+    cupsArrayDelete(queue->jobs);
+    cupsdClearString(&queue->dest);
+    free(queue);
+  }
+
+  cupsArrayDelete(pending_queues);
+  pending_queues = NULL;
+
+  cupsArrayDelete(filter_jobs);
+  filter_jobs = NULL;
+
   cupsdReleaseSignals();
 }
 
@@ -1469,6 +1831,92 @@ cupsdFindJob(int id)			/* I - Job ID */
 }
 
 
+/*
+ * 'cupsdFinishJobConversion()' - Note the exit of a filter for a document
+ *                                that is being filtered ahead of time.
+ */
+
+int					/* O - 1 if the process was found, 0 otherwise */
+cupsdFinishJobConversion(
+    cupsd_job_t            *job,	/* I - Job */
+    int                    pid,		/* I - Process ID */
+    int                    status,	/* I - Exit status */
+    const cupsd_jobstats_t *stats)	/* I - Resource usage or NULL */
+{
+  int			i;		/* Looping var */
+  cupsd_jobconv_t	*conv;		/* Current conversion */
+  cupsd_jobstats_t	docstats;	/* Resource usage for document */
+
+
+  for (conv = (cupsd_jobconv_t *)cupsArrayFirst(job->conversions);
+       conv;
+       conv = (cupsd_jobconv_t *)cupsArrayNext(job->conversions))
+  {
+    for (i = 0; conv->filters[i]; i ++)
+      if (conv->filters[i] == pid)
+        break;
+
+    if (conv->filters[i])
+      break;
+  }
+
+  if (!conv)
+    return (0);
+
+  conv->filters[i] = -pid;
+
+  if (status && !conv->status)
+    conv->status = status;
+
+  if (stats)
+  {
+    docstats     = *stats;
+    docstats.doc = conv->doc;
+
+    cupsdAddJobStats(job, &docstats);
+  }
+
+  for (i = 0; conv->filters[i] < 0; i ++);
+
+  if (conv->filters[i])
+    return (1);
+
+  FilterLevel -= conv->cost;
+  conv->cost  = 0;
+
+  if (conv->status)
+    cupsdLogJob(job, CUPSD_LOG_DEBUG,
+                "Unable to filter document %d ahead of time.", conv->doc);
+  else
+    cupsdLogJob(job, CUPSD_LOG_DEBUG,
+                "Finished filtering document %d ahead of time.", conv->doc);
+
+ /*
+  * Continue printing if the job was waiting for this document...
+  */
+
+  if (job->state_value == IPP_JOB_PROCESSING && job->printer &&
+      job->current_file + 1 == conv->doc)
+  {
+    for (i = 0; job->filters[i] < 0; i ++);
+
+    if (!job->filters[i] &&
+        (!job->printer->pc || !job->printer->pc->single_file ||
+	 job->backend <= 0))
+      cupsdContinueJob(job);
+  }
+
+ /*
+  * Then see if any jobs were waiting on the FilterLimit...
+  */
+
+  if (cupsArrayCount(filter_jobs) > 0)
+    cupsdCheckJobs();
+
+  return (1);
+}
+
+
 /*
  * 'cupsdGetCompletedJobs()'- Generate a completed jobs list.
  */
@@ -1502,17 +1950,14 @@ int					/* O - Job count */
 cupsdGetPrinterJobCount(
     const char *dest)			/* I - Printer or class name */
 {
-  int		count;			/* Job count */
-  cupsd_job_t	*job;			/* Current job */
+  cupsd_jobcount_t	key,		/* Search key */
+			*count;		/* Job count */
 
 
-  for (job = (cupsd_job_t *)cupsArrayFirst(ActiveJobs), count = 0;
-       job;
-       job = (cupsd_job_t *)cupsArrayNext(ActiveJobs))
-    if (job->dest && !_cups_strcasecmp(job->dest, dest))
-      count ++;
+  key.name = (char *)dest;
+  count    = (cupsd_jobcount_t *)cupsArrayFind(dest_counts, &key);
 
-  return (count);
+  return (count ? count->count : 0);
 }
 
 
@@ -1525,17 +1970,14 @@ int					/* O - Job count */
 cupsdGetUserJobCount(
     const char *username)		/* I - Username */
 {
-  int		count;			/* Job count */
-  cupsd_job_t	*job;			/* Current job */
+  cupsd_jobcount_t	key,		/* Search key */
+			*count;		/* Job count */
 
 
-  for (job = (cupsd_job_t *)cupsArrayFirst(ActiveJobs), count = 0;
-       job;
-       job = (cupsd_job_t *)cupsArrayNext(ActiveJobs))
-    if (!_cups_strcasecmp(job->username, username))
-      count ++;
+  key.name = (char *)username;
+  count    = (cupsd_jobcount_t *)cupsArrayFind(user_counts, &key);
 
-  return (count);
+  return (count ? count->count : 0);
 }
 
 
@@ -1546,11 +1988,14 @@ cupsdGetUserJobCount(
 void
 cupsdLoadAllJobs(void)
 {
-  char		filename[1024];		/* Full filename of job.cache file */
-  struct stat	fileinfo;		/* Information on job.cache file */
+  char		filename[1024],		/* Full filename of job.cache file */
+		journal[1024];		/* Full filename of job.journal file */
+  struct stat	fileinfo,		/* Information on job.cache file */
+		journalinfo;		/* Information on job.journal file */
   cups_dir_t	*dir;			/* RequestRoot dir */
   cups_dentry_t	*dent;			/* Entry in RequestRoot */
   int		load_cache = 1;		/* Load the job.cache file? */
+  cupsd_job_t	*job;			/* Current job */
 
 
  /*
@@ -1571,6 +2016,7 @@ cupsdLoadAllJobs(void)
   */
 
   snprintf(filename, sizeof(filename), "%s/job.cache", CacheDir);
+  snprintf(journal, sizeof(journal), "%s/job.journal", CacheDir);
 
   if (stat(filename, &fileinfo))
   {
@@ -1595,6 +2041,14 @@ cupsdLoadAllJobs(void)
   }
   else
   {
+   /*
+    * Changes since the job.cache file was written are in the job.journal
+    * file...
+    */
+
+    if (!stat(journal, &journalinfo) && journalinfo.st_mtime > fileinfo.st_mtime)
+      fileinfo.st_mtime = journalinfo.st_mtime;
+
     while ((dent = cupsDirRead(dir)) != NULL)
     {
       if (strlen(dent->filename) >= 6 && dent->filename[0] == 'c' && dent->fileinfo.st_mtime > fileinfo.st_mtime)
@@ -1634,6 +2088,20 @@ cupsdLoadAllJobs(void)
     load_next_job_id(filename);
   }
 
+ /*
+  * Schedule the deadlines, queue the pending jobs, and count the active
+  * jobs...
+  */
+
+  for (job = (cupsd_job_t *)cupsArrayFirst(ActiveJobs);
+       job;
+       job = (cupsd_job_t *)cupsArrayNext(ActiveJobs))
+  {
+    cupsdUpdateJobTimer(job);
+    cupsdUpdateJobQueue(job);
+    cupsdUpdateJobCounts(job);
+  }
+
  /*
   * Clean out old jobs as needed...
   */
@@ -1659,24 +2127,26 @@ cupsdLoadJob(cupsd_job_t *job)		/* I - Job */
   cupsd_printer_t	*destptr;	/* Pointer to destination */
   mime_type_t		**filetypes;	/* New filetypes array */
   int			*compressions;	/* New compressions array */
+  ipp_uchar_t		*data;		/* Control file data */
+  size_t		datasize,	/* Size of data buffer */
+			datalen;	/* Length of control file data */
+  ssize_t		bytes;		/* Bytes read */
 
 
   if (job->attrs)
   {
     if (job->state_value > IPP_JOB_STOPPED)
+    {
       job->access_time = time(NULL);
+      touch_job(job);
+    }
 
     return (1);
   }
 
-  if ((job->attrs = ippNew()) == NULL)
-  {
-    cupsdLogJob(job, CUPSD_LOG_ERROR, "Ran out of memory for job attributes.");
-    return (0);
-  }
-
  /*
-  * Load job attributes...
+  * Load job attributes...  The control file is read into memory and parsed
+  * in place so that the attribute strings point into the file data...
   */
 
   cupsdLogJob(job, CUPSD_LOG_DEBUG, "Loading attributes...");
@@ -1685,16 +2155,51 @@ cupsdLoadJob(cupsd_job_t *job)		/* I - Job */
   if ((fp = cupsdOpenConfFile(jobfile)) == NULL)
     goto error;
 
-  if (ippReadIO(fp, (ipp_iocb_t)cupsFileRead, 1, NULL, job->attrs) != IPP_DATA)
+  datasize = 0;
+  datalen  = 0;
+  data     = NULL;
+
+  for (;;)
+  {
+    if (datalen >= datasize)
+    {
+      ipp_uchar_t *temp;		/* New buffer */
+
+      datasize = datasize ? 2 * datasize : 8192;
+
+      if ((temp = realloc(data, datasize)) == NULL)
+      {
+	cupsdLogJob(job, CUPSD_LOG_ERROR,
+		    "Ran out of memory for job attributes.");
+	free(data);
+	cupsFileClose(fp);
+	goto error;
+      }
+
+      data = temp;
+    }
+
+    if ((bytes = cupsFileRead(fp, (char *)data + datalen, datasize - datalen)) <= 0)
+      break;
+
+    datalen += (size_t)bytes;
+  }
+
+  if (bytes < 0 && cupsFileEOF(fp))
+    bytes = 0;				/* cupsFileRead returns -1 at EOF */
+
+  cupsFileClose(fp);
+
+  if (bytes < 0 || (job->attrs = _ippNewFromBuffer(data, datalen)) == NULL)
   {
+    if (bytes < 0)
+      free(data);
+
     cupsdLogJob(job, CUPSD_LOG_ERROR,
 		"Unable to read job control file \"%s\".", jobfile);
-    cupsFileClose(fp);
     goto error;
   }
 
-  cupsFileClose(fp);
-
  /*
   * Copy attribute data to the job object...
   */
@@ -2053,6 +2558,8 @@ cupsdLoadJob(cupsd_job_t *job)		/* I - Job */
   }
 
   job->access_time = time(NULL);
+  touch_job(job);
+
   return (1);
 
  /*
@@ -2117,6 +2624,9 @@ cupsdMoveJob(cupsd_job_t     *job,	/* I - Job */
   cupsdSetString(&job->dest, p->name);
   job->dtype = p->type & (CUPS_PRINTER_CLASS | CUPS_PRINTER_REMOTE);
 
+  cupsdUpdateJobQueue(job);
+  cupsdUpdateJobCounts(job);
+
   if ((attr = ippFindAttribute(job->attrs, "job-printer-uri",
                                IPP_TAG_URI)) != NULL)
     ippSetString(job->attrs, &attr, 0, p->uri);
@@ -2173,70 +2683,58 @@ cupsdRestartJob(cupsd_job_t *job)	/* I - Job */
 
 /*
  * 'cupsdSaveAllJobs()' - Save a summary of all jobs to disk.
+ *
+ * Changed jobs are appended to the job.journal file.  Once the journal holds
+ * more records than there are jobs, the full job.cache file is rewritten and
+ * a new, empty journal is started.
  */
 
 void
 cupsdSaveAllJobs(void)
 {
-  int		i;			/* Looping var */
-  cups_file_t	*fp;			/* job.cache file */
-  char		filename[1024];		/* job.cache filename */
+  char		journal[1024];		/* job.journal filename */
   cupsd_job_t	*job;			/* Current job */
 
 
-  snprintf(filename, sizeof(filename), "%s/job.cache", CacheDir);
-  if ((fp = cupsdCreateConfFile(filename, ConfigFilePerm)) == NULL)
-    return;
-
-  cupsdLogMessage(CUPSD_LOG_INFO, "Saving job.cache...");
+  snprintf(journal, sizeof(journal), "%s/job.journal", CacheDir);
 
- /*
-  * Write a small header to the file...
-  */
+  if (job_journal && job_journal_records <= (cupsArrayCount(Jobs) + 100))
+  {
+   /*
+    * Saved jobs and state changes are already in the journal, so just append
+    * any jobs that are still waiting to be saved and flush it...
+    */
 
-  cupsFilePuts(fp, "# Job cache file for " CUPS_SVERSION "\n");
-  cupsFilePrintf(fp, "# Written by cupsd\n");
-  cupsFilePrintf(fp, "NextJobId %d\n", NextJobId);
+    cupsdLogMessage(CUPSD_LOG_DEBUG, "Appending to job.journal...");
 
- /*
-  * Write each job known to the system...
-  */
+    cupsFilePrintf(job_journal, "NextJobId %d\n", NextJobId);
 
-  for (job = (cupsd_job_t *)cupsArrayFirst(Jobs);
-       job;
-       job = (cupsd_job_t *)cupsArrayNext(Jobs))
-  {
-    if (job->printer && job->printer->temporary)
+    for (job = (cupsd_job_t *)cupsArrayFirst(Jobs);
+	 job;
+	 job = (cupsd_job_t *)cupsArrayNext(Jobs))
     {
-     /*
-      * Don't save jobs on temporary printers...
-      */
+      if (!job->dirty || (job->printer && job->printer->temporary))
+        continue;
 
-      continue;
+      write_job_cache(job_journal, job);
+      job_journal_records ++;
     }
 
-    cupsFilePrintf(fp, "<Job %d>\n", job->id);
-    cupsFilePrintf(fp, "State %d\n", job->state_value);
-    cupsFilePrintf(fp, "Created %ld\n", (long)job->creation_time);
-    if (job->completed_time)
-      cupsFilePrintf(fp, "Completed %ld\n", (long)job->completed_time);
-    cupsFilePrintf(fp, "Priority %d\n", job->priority);
-    if (job->hold_until)
-      cupsFilePrintf(fp, "HoldUntil %ld\n", (long)job->hold_until);
-    cupsFilePrintf(fp, "Username %s\n", job->username);
-    if (job->name)
-      cupsFilePutConf(fp, "Name", job->name);
-    cupsFilePrintf(fp, "Destination %s\n", job->dest);
-    cupsFilePrintf(fp, "DestType %d\n", job->dtype);
-    cupsFilePrintf(fp, "KOctets %d\n", job->koctets);
-    cupsFilePrintf(fp, "NumFiles %d\n", job->num_files);
-    for (i = 0; i < job->num_files; i ++)
-      cupsFilePrintf(fp, "File %d %s/%s %d\n", i + 1, job->filetypes[i]->super,
-                     job->filetypes[i]->type, job->compressions[i]);
-    cupsFilePuts(fp, "</Job>\n");
+    if (!cupsFileFlush(job_journal) &&
+        (!SyncOnClose || !fsync(cupsFileNumber(job_journal))))
+      return;
+
+   /*
+    * Unable to write the journal, fall back to a full job.cache...
+    */
+
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to write changes to \"%s\": %s", journal, strerror(errno));
+
+    cupsFileClose(job_journal);
+    job_journal = NULL;
   }
 
-  cupsdCloseCreatedConfFile(fp, filename);
+  save_job_cache(1);
 }
 
 
@@ -2254,6 +2752,18 @@ cupsdSaveJob(cupsd_job_t *job)		/* I - Job */
   cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdSaveJob(job=%p(%d)): job->attrs=%p",
                   job, job->id, job->attrs);
 
+ /*
+  * Update the job's share of the LRU memory budget since its attributes may
+  * have changed...
+  */
+
+  if (job->lru_size)
+  {
+    lru_size      -= job->lru_size;
+    job->lru_size = ippLength(job->attrs);
+    lru_size      += job->lru_size;
+  }
+
   if (job->printer && job->printer->temporary)
   {
    /*
@@ -2291,6 +2801,8 @@ cupsdSaveJob(cupsd_job_t *job)		/* I - Job */
     unlink(filename);
 
     job->dirty = 0;
+
+    journal_job(job, 0);
   }
 }
 
@@ -2472,6 +2984,8 @@ cupsdSetJobHoldUntil(cupsd_job_t *job,	/* I - Job */
 
   cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdSetJobHoldUntil: hold_until=%d",
                   (int)job->hold_until);
+
+  cupsdUpdateJobTimer(job);
 }
 
 
@@ -2501,6 +3015,9 @@ cupsdSetJobPriority(
 
   cupsArrayRemove(ActiveJobs, job);
 
+  if (job->queue)
+    cupsArrayRemove(job->queue->jobs, job);
+
   job->priority = priority;
 
   if ((attr = ippFindAttribute(job->attrs, "job-priority",
@@ -2512,6 +3029,9 @@ cupsdSetJobPriority(
 
   cupsArrayAdd(ActiveJobs, job);
 
+  if (job->queue)
+    cupsArrayAdd(job->queue->jobs, job);
+
   job->dirty = 1;
   cupsdMarkDirty(CUPSD_DIRTY_JOBS);
 }
@@ -2625,6 +3145,14 @@ cupsdSetJobState(
       cupsdLogJob(job, CUPSD_LOG_INFO, "%s", buffer);
   }
 
+ /*
+  * Record the new state in the journal right away so that it survives a
+  * crash even if the job control file is saved before the next
+  * cupsdSaveAllJobs...
+  */
+
+  journal_job(job, 1);
+
  /*
   * Handle post-state-change actions...
   */
@@ -2756,6 +3284,26 @@ cupsdSetJobState(
   if (action >= CUPSD_JOB_FORCE && job && job->printer)
     finalize_job(job, 0);
 
+ /*
+  * Update the job deadlines, pending queue, counts, and LRU list...
+  */
+
+  if (job)
+  {
+    cupsdUpdateJobTimer(job);
+    cupsdUpdateJobQueue(job);
+    cupsdUpdateJobCounts(job);
+    touch_job(job);
+
+   /*
+    * Save stopped and completed jobs that are no longer printing right away
+    * rather than waiting for the dirty files timer...
+    */
+
+    if (job->dirty && !job->printer && job->state_value >= IPP_JOB_STOPPED)
+      cupsdSaveJob(job);
+  }
+
  /*
   * Update the server "busy" state...
   */
@@ -2765,24 +3313,94 @@ cupsdSetJobState(
 
 
 /*
- * 'cupsdStopAllJobs()' - Stop all print jobs.
+ * 'cupsdStartFilterWorkers()' - Start the FilterWorkers filters for a printer.
+ *
+ * This is done when the printer is loaded so that the first job does not
+ * wait for the filters to start.  Classes, raw queues, and queues without a
+ * PPD file are skipped.
  */
 
 void
-cupsdStopAllJobs(
-    cupsd_jobaction_t action,		/* I - Action */
-    int               kill_delay)	/* I - Number of seconds before we kill */
+cupsdStartFilterWorkers(
+    cupsd_printer_t *p)			/* I - Printer or NULL for all */
 {
-  cupsd_job_t	*job;			/* Current job */
+  int			i,		/* Looping var */
+			count;		/* Number of printers */
+  const char		*start,		/* Start of listed name */
+			*end;		/* End of listed name */
+  char			command[1024],	/* Full path to filter */
+			ppd[1024];	/* PPD filename */
+  cupsd_worker_t	key;		/* Search key */
 
 
-  for (job = (cupsd_job_t *)cupsArrayFirst(PrintingJobs);
-       job;
-       job = (cupsd_job_t *)cupsArrayNext(PrintingJobs))
+  if (!FilterWorkers)
+    return;
+
+  if (!p)
   {
-    if (job->completed)
-    {
-      cupsdSetJobState(job, IPP_JOB_COMPLETED, CUPSD_JOB_FORCE, NULL);
+    for (i = 0, count = cupsArrayCount(Printers); i < count; i ++)
+      cupsdStartFilterWorkers((cupsd_printer_t *)cupsArrayIndex(Printers, i));
+
+    return;
+  }
+
+  if ((p->type & (CUPS_PRINTER_CLASS | CUPS_PRINTER_REMOTE)) || p->raw)
+    return;
+
+  snprintf(ppd, sizeof(ppd), "%s/ppd/%s.ppd", ServerRoot, p->name);
+  if (access(ppd, 0))
+    return;
+
+  for (start = FilterWorkers; *start; start = end)
+  {
+    while (_cups_isspace(*start) || *start == ',')
+      start ++;
+
+    for (end = start; *end && !_cups_isspace(*end) && *end != ','; end ++);
+
+    if (end == start)
+      continue;
+
+    snprintf(command, sizeof(command), "%s/filter/%.*s", ServerBin,
+             (int)(end - start), start);
+
+    key.printer = p->name;
+    key.command = command;
+
+    if (cupsArrayFind(filter_workers, &key))
+      continue;
+
+    if (access(command, X_OK))
+    {
+      cupsdLogMessage(CUPSD_LOG_DEBUG, "Not starting filter worker %s for "
+                      "printer %s: %s", command, p->name, strerror(errno));
+      continue;
+    }
+
+    start_worker(p, command);
+  }
+}
+
+
+/*
+ * 'cupsdStopAllJobs()' - Stop all print jobs.
+ */
+
+void
+cupsdStopAllJobs(
+    cupsd_jobaction_t action,		/* I - Action */
+    int               kill_delay)	/* I - Number of seconds before we kill */
+{
+  cupsd_job_t	*job;			/* Current job */
+
+
+  for (job = (cupsd_job_t *)cupsArrayFirst(PrintingJobs);
+       job;
+       job = (cupsd_job_t *)cupsArrayNext(PrintingJobs))
+  {
+    if (job->completed)
+    {
+      cupsdSetJobState(job, IPP_JOB_COMPLETED, CUPSD_JOB_FORCE, NULL);
     }
     else
     {
@@ -2795,6 +3413,40 @@ cupsdStopAllJobs(
 }
 
 
+/*
+ * 'cupsdStopFilterWorkers()' - Stop filters that were started ahead of time.
+ *
+ * The filters exit when their control socket is closed.
+ */
+
+void
+cupsdStopFilterWorkers(
+    cupsd_printer_t *p)			/* I - Printer or NULL for all */
+{
+  cupsd_worker_t	*worker;	/* Current worker */
+
+
+  for (worker = (cupsd_worker_t *)cupsArrayFirst(filter_workers);
+       worker;
+       worker = (cupsd_worker_t *)cupsArrayNext(filter_workers))
+  {
+    if (p && strcmp(worker->printer, p->name))
+      continue;
+
+    cupsdLogMessage(CUPSD_LOG_DEBUG, "Stopping filter worker %s (PID %d) for "
+                    "printer %s.", worker->command, worker->pid,
+		    worker->printer);
+
+    cupsArrayRemove(filter_workers, worker);
+
+    close(worker->fd);
+    cupsdClearString(&worker->printer);
+    cupsdClearString(&worker->command);
+    free(worker);
+  }
+}
+
+
 /*
  * 'cupsdUnloadCompletedJobs()' - Flush completed job history from memory.
  */
@@ -2802,24 +3454,173 @@ cupsdStopAllJobs(
 void
 cupsdUnloadCompletedJobs(void)
 {
-  cupsd_job_t	*job;			/* Current job */
+  cupsd_job_t	*job,			/* Current job */
+		*prev;			/* Previous (more recently used) job */
   time_t	expire;			/* Expiration time */
 
 
   expire = time(NULL) - 60;
 
-  for (job = (cupsd_job_t *)cupsArrayFirst(Jobs);
-       job;
-       job = (cupsd_job_t *)cupsArrayNext(Jobs))
-    if (job->attrs && job->state_value >= IPP_JOB_STOPPED && !job->printer &&
-        job->access_time < expire)
+  for (job = lru_last; job && lru_size > (size_t)MaxJobHistoryMemory; job = prev)
+  {
+    prev = job->lru_prev;
+
+    if (job->printer || job->access_time >= expire)
+      continue;
+
+    if (job->dirty)
+      cupsdSaveJob(job);
+
+    if (!job->dirty)
+      unload_job(job);
+  }
+}
+
+
+/*
+ * 'cupsdUpdateJobCounts()' - Update the destination and user job counts for a
+ *                            job.
+ */
+
+void
+cupsdUpdateJobCounts(cupsd_job_t *job)	/* I - Job */
+{
+  int	active;				/* Is the job active? */
+
+
+  cupsArraySave(ActiveJobs);
+  active = cupsArrayFind(ActiveJobs, job) != NULL;
+  cupsArrayRestore(ActiveJobs);
+
+  set_job_count(&dest_counts, &job->dest_count, active ? job->dest : NULL);
+  set_job_count(&user_counts, &job->user_count, active ? job->username : NULL);
+}
+
+
+/*
+ * 'cupsdUpdateJobQueue()' - Move a job to the pending queue for its destination.
+ *
+ * Jobs that are pending and not assigned to a printer are added to the queue
+ * for their destination; all other jobs are removed from their queue.
+ */
+
+void
+cupsdUpdateJobQueue(cupsd_job_t *job)	/* I - Job */
+{
+  cupsd_jobq_t	*queue = NULL,		/* New queue */
+		key;			/* Search key */
+
+
+  if (job->state_value == IPP_JOB_PENDING && !job->printer && job->dest)
+  {
+    if (job->queue && !_cups_strcasecmp(job->queue->dest, job->dest))
+      return;
+
+    if (!pending_queues)
+      pending_queues = cupsArrayNew(compare_queues, NULL);
+
+    key.dest = job->dest;
+
+    if ((queue = (cupsd_jobq_t *)cupsArrayFind(pending_queues, &key)) == NULL)
+    {
+     /*
+      * Create a new queue for this destination...
+      */
+
+      if ((queue = calloc(1, sizeof(cupsd_jobq_t))) == NULL)
+      {
+        cupsdLogMessage(CUPSD_LOG_EMERG, "Unable to allocate memory for the pending queue of \"%s\".", job->dest);
+        return;
+      }
+
+      cupsdSetString(&queue->dest, job->dest);
+      queue->jobs = cupsArrayNew(compare_active_jobs, NULL);
+
+      cupsArrayAdd(pending_queues, queue);
+    }
+  }
+
+  if (queue == job->queue)
+    return;
+
+  if (job->queue)
+    cupsArrayRemove(job->queue->jobs, job);
+
+  if ((job->queue = queue) != NULL)
+    cupsArrayAdd(queue->jobs, job);
+}
+
+
+/*
+ * 'cupsdUpdateJobStream()' - Feed newly received document data to a job.
+ *
+ * Data is copied from the document file to the pipe as long as the pipe
+ * accepts it.  The pipe is closed once the whole document has been received
+ * and written.
+ */
+
+void
+cupsdUpdateJobStream(cupsd_job_t *job)	/* I - Job */
+{
+  ssize_t	bytes,			/* Bytes read */
+		written;		/* Bytes written */
+  char		buffer[32768];		/* Copy buffer */
+
+
+  if (!job || job->stream_fds[1] < 0)
+    return;
+
+  while ((bytes = read(job->stream_fds[0], buffer, sizeof(buffer))) > 0)
+  {
+    if ((written = write(job->stream_fds[1], buffer, (size_t)bytes)) < bytes)
     {
-      if (job->dirty)
-        cupsdSaveJob(job);
+      if (written < 0 && errno != EAGAIN && errno != EINTR)
+      {
+       /*
+        * The filter is gone; the job will be stopped when it is reaped...
+        */
+
+        cupsdLogJob(job, CUPSD_LOG_DEBUG, "Unable to stream document data: %s",
+	            strerror(errno));
+
+	cupsdRemoveSelect(job->stream_fds[1]);
+	cupsdClosePipe(job->stream_fds);
+	return;
+      }
+
+     /*
+      * Pipe is full, wait until the filter catches up...
+      */
 
-      if (!job->dirty)
-        unload_job(job);
+      if (written < 0)
+        written = 0;
+
+      lseek(job->stream_fds[0], (off_t)(written - bytes), SEEK_CUR);
+
+      cupsdAddSelect(job->stream_fds[1], NULL,
+                     (cupsd_selfunc_t)cupsdUpdateJobStream, job);
+      return;
     }
+  }
+
+  if (bytes == 0 && job->streaming)
+  {
+   /*
+    * Wait for more data from the client...
+    */
+
+    cupsdRemoveSelect(job->stream_fds[1]);
+    return;
+  }
+
+  if (bytes < 0)
+    cupsdLogJob(job, CUPSD_LOG_ERROR, "Unable to read document data: %s",
+                strerror(errno));
+  else
+    cupsdLogJob(job, CUPSD_LOG_DEBUG, "Finished streaming document data.");
+
+  cupsdRemoveSelect(job->stream_fds[1]);
+  cupsdClosePipe(job->stream_fds);
 }
 
 
@@ -2883,6 +3684,61 @@ cupsdUpdateJobs(void)
 }
 
 
+/*
+ * 'cupsdUpdateJobTimer()' - Reschedule the deadline timer for a job.
+ */
+
+void
+cupsdUpdateJobTimer(cupsd_job_t *job)	/* I - Job */
+{
+  time_t	when = 0;		/* Earliest deadline */
+  const char	*why = NULL;		/* Debugging aid */
+
+
+  if (job->kill_time)
+  {
+    when = job->kill_time;
+    why  = "kill unresponsive jobs";
+  }
+
+  if (job->cancel_time && (!when || job->cancel_time < when))
+  {
+    when = job->cancel_time;
+    why  = "cancel stuck jobs";
+  }
+
+  if (job->state_value == IPP_JOB_HELD && job->hold_until &&
+      (!when || job->hold_until < when))
+  {
+    when = job->hold_until;
+    why  = "release held jobs";
+  }
+
+ /*
+  * cupsdCheckJobs acts on deadlines that have passed, so wake up one second
+  * after the deadline...
+  */
+
+  if (when)
+    cupsdSetTimer(&job->timer, when + 1, (cupsd_timerfunc_t)expire_job_timer, job, why);
+  else
+    cupsdClearTimer(&job->timer);
+}
+
+
+/*
+ * 'check_jobs_timer()' - Check jobs from a timer.
+ */
+
+static void
+check_jobs_timer(void *data)		/* I - Callback data (unused) */
+{
+  (void)data;
+
+  cupsdCheckJobs();
+}
+
+
 /*
  * 'compare_active_jobs()' - Compare the job IDs and priorities of two jobs.
  */
@@ -2927,6 +3783,31 @@ compare_completed_jobs(void *first,	/* I - First job */
 }
 
 
+/*
+ * 'compare_counts()' - Compare the names of two job counters.
+ */
+
+static int				/* O - Result of comparison */
+compare_counts(cupsd_jobcount_t *first,	/* I - First counter */
+               cupsd_jobcount_t *second)/* I - Second counter */
+{
+  return (_cups_strcasecmp(first->name, second->name));
+}
+
+
+/*
+ * 'compare_filter_stats()' - Compare the names of two filter statistics.
+ */
+
+static int				/* O - Difference */
+compare_filter_stats(
+    cupsd_filterstats_t *first,		/* I - First statistics */
+    cupsd_filterstats_t *second)	/* I - Second statistics */
+{
+  return (strcmp(first->name, second->name));
+}
+
+
 /*
  * 'compare_jobs()' - Compare the job IDs of two jobs.
  */
@@ -2942,6 +3823,40 @@ compare_jobs(void *first,		/* I - First job */
 }
 
 
+/*
+ * 'compare_queues()' - Compare the destinations of two pending queues.
+ */
+
+static int				/* O - Difference */
+compare_queues(void *first,		/* I - First queue */
+               void *second,		/* I - Second queue */
+	       void *data)		/* I - App data (not used) */
+{
+  (void)data;
+
+  return (_cups_strcasecmp(((cupsd_jobq_t *)first)->dest,
+                           ((cupsd_jobq_t *)second)->dest));
+}
+
+
+/*
+ * 'compare_workers()' - Compare the printers and programs of two workers.
+ */
+
+static int				/* O - Difference */
+compare_workers(cupsd_worker_t *first,	/* I - First worker */
+                cupsd_worker_t *second)	/* I - Second worker */
+{
+  int	diff;				/* Difference */
+
+
+  if ((diff = strcmp(first->printer, second->printer)) != 0)
+    return (diff);
+  else
+    return (strcmp(first->command, second->command));
+}
+
+
 /*
  * 'dump_job_history()' - Dump any debug messages for a job.
  */
@@ -3054,43 +3969,293 @@ dump_job_history(cupsd_job_t *job)	/* I - Job */
 
 
 /*
- * 'free_job_history()' - Free any log history.
+ * 'expire_job_timer()' - Kill, cancel, or release a job after a deadline.
  */
 
 static void
-free_job_history(cupsd_job_t *job)	/* I - Job */
+expire_job_timer(cupsd_job_t *job)	/* I - Job */
 {
-  char	*message;			/* Current message */
-
+  ipp_attribute_t	*attr;		/* Job attribute */
+  time_t		curtime = time(NULL);
+					/* Current time */
 
-  if (!job->history)
-    return;
 
-  for (message = (char *)cupsArrayFirst(job->history);
-       message;
-       message = (char *)cupsArrayNext(job->history))
-    free(message);
+  cupsdLogJob(job, CUPSD_LOG_DEBUG2, "Deadline expired: state=%d, cancel_time=%ld, hold_until=%ld, kill_time=%ld, pending_timeout=%ld", job->state_value, (long)job->cancel_time, (long)job->hold_until, (long)job->kill_time, (long)job->pending_timeout);
 
-  cupsArrayDelete(job->history);
-  job->history = NULL;
-}
+  if (job->kill_time && job->kill_time <= curtime)
+  {
+   /*
+    * Kill jobs if they are unresponsive...
+    */
 
+    if (!job->completed)
+      cupsdLogJob(job, CUPSD_LOG_ERROR, "Stopping unresponsive job.");
 
-/*
- * 'finalize_job()' - Cleanup after job filter processes and support data.
- */
+    stop_job(job, CUPSD_JOB_FORCE);
+  }
+  else if (job->cancel_time && job->cancel_time <= curtime)
+  {
+   /*
+    * Cancel stuck jobs...
+    */
 
-static void
-finalize_job(cupsd_job_t *job,		/* I - Job */
-             int         set_job_state)	/* I - 1 = set the job state */
-{
-  ipp_pstate_t		printer_state;	/* New printer state value */
-  ipp_jstate_t		job_state;	/* New job state value */
-  const char		*message;	/* Message for job state */
-  char			buffer[1024];	/* Buffer for formatted messages */
+    int cancel_after;			/* job-cancel-after value */
 
+    attr         = ippFindAttribute(job->attrs, "job-cancel-after", IPP_TAG_INTEGER);
+    cancel_after = attr ? ippGetInteger(attr, 0) : MaxJobTime;
 
-  cupsdLogMessage(CUPSD_LOG_DEBUG2, "finalize_job(job=%p(%d))", job, job->id);
+    if (job->completed)
+      cupsdSetJobState(job, IPP_JOB_CANCELED, CUPSD_JOB_FORCE, "Marking stuck job as completed after %d seconds.", cancel_after);
+    else
+      cupsdSetJobState(job, IPP_JOB_CANCELED, CUPSD_JOB_DEFAULT, "Canceling stuck job after %d seconds.", cancel_after);
+  }
+  else if (job->state_value == IPP_JOB_HELD && job->hold_until &&
+	   job->hold_until < curtime)
+  {
+   /*
+    * Start held jobs if they are ready...
+    */
+
+    if (job->pending_timeout)
+    {
+     /*
+      * This job is pending; check that we don't have an active Send-Document
+      * operation in progress on any of the client connections, then timeout
+      * the job so we can start printing...
+      */
+
+      if (SendDocumentClients > 0 || cupsdTimeoutJob(job))
+      {
+       /*
+	* Check again later...
+	*/
+
+	cupsdSetTimer(&job->timer, curtime + 1, (cupsd_timerfunc_t)expire_job_timer, job, "release held jobs");
+	return;
+      }
+
+      cupsdSetJobState(job, IPP_JOB_PENDING, CUPSD_JOB_DEFAULT, "Job submission timed out.");
+      cupsdLogJob(job, CUPSD_LOG_ERROR, "Job submission timed out.");
+    }
+    else
+      cupsdSetJobState(job, IPP_JOB_PENDING, CUPSD_JOB_DEFAULT, "Job hold expired.");
+  }
+  else
+  {
+   /*
+    * Nothing has expired yet, reschedule...
+    */
+
+    cupsdUpdateJobTimer(job);
+    return;
+  }
+
+ /*
+  * Coalesce all expired jobs into a single cupsdCheckJobs run...
+  */
+
+  if (!check_timer.when || check_timer.when > curtime)
+    cupsdSetTimer(&check_timer, curtime, check_jobs_timer, NULL, "check expired jobs");
+}
+
+
+/*
+ * 'filter_ahead()' - Start filtering the following documents of a job.
+ *
+ * Up to FilterAhead documents are filtered into temporary files while the
+ * current document prints, as long as FilterLimit allows it and no other
+ * jobs are waiting on the limit.
+ */
+
+static void
+filter_ahead(cupsd_job_t *job,		/* I - Job */
+             char        *argv[],	/* I - Filter arguments */
+             char        *envp[])	/* I - Filter environment */
+{
+  int		i,			/* Looping var */
+		doc,			/* Document number */
+		cost,			/* Filtering cost */
+		envc;			/* Number of environment variables */
+  cups_array_t	*filters;		/* Filters for document */
+  char		*docargv[8],		/* Filter arguments */
+		*docenvp[MAX_ENV + 23],	/* Filter environment */
+		filename[1024],		/* Document filename */
+		title[IPP_MAX_NAME],	/* Job title string */
+		copies[255],		/* # copies string */
+		content_type[1024],	/* CONTENT_TYPE env variable */
+		final_content_type[1024];
+					/* FINAL_CONTENT_TYPE env variable */
+
+
+  if (FilterAhead <= 0 || job->printer->raw || job->printer->remote ||
+      job->retry_as_raster || cupsArrayCount(filter_jobs) > 0)
+    return;
+
+ /*
+  * Use the current arguments and environment with the document-specific
+  * values replaced...
+  */
+
+  docargv[0] = job->printer->name;
+  docargv[1] = argv[1];
+  docargv[2] = job->username;
+  docargv[3] = title;
+  docargv[4] = copies;
+  docargv[7] = NULL;
+
+  if ((docargv[5] = get_options(job, 0, copies, sizeof(copies), title,
+                                sizeof(title))) == NULL)
+    return;
+
+  for (i = 0, envc = 0; envp[i] && envc < (MAX_ENV + 17); i ++)
+    if (strncmp(envp[i], "CONTENT_TYPE=", 13) &&
+        strncmp(envp[i], "FINAL_CONTENT_TYPE=", 19) &&
+        strncmp(envp[i], "CUPS_FILETYPE=", 14))
+      docenvp[envc ++] = envp[i];
+
+  docenvp[envc ++] = content_type;
+  docenvp[envc ++] = final_content_type;
+  docenvp[envc ++] = "CUPS_FILETYPE=document";
+
+  for (doc = job->current_file + 1;
+       doc <= job->num_files &&
+           cupsArrayCount(job->conversions) < FilterAhead;
+       doc ++)
+  {
+    if (doc == job->streaming)
+      break;				/* Still being received */
+
+    if (find_conversion(job, doc))
+      continue;				/* Already filtered */
+
+    if (doc == job->num_files && job->job_sheets &&
+        job->job_sheets->num_values > 1 &&
+        _cups_strcasecmp(job->job_sheets->values[1].string.text, "none"))
+      break;				/* Trailing banner page */
+
+    if (!strcmp(job->filetypes[doc - 1]->super, "application") &&
+        !strcmp(job->filetypes[doc - 1]->type, "vnd.cups-raw"))
+      continue;				/* Raw file */
+
+    cost                  = 0;
+    final_content_type[0] = '\0';
+
+    if (!get_filters(job, doc - 1, &filters, &cost, final_content_type,
+                     sizeof(final_content_type)) || !filters)
+      continue;				/* Nothing to filter ahead */
+
+    if (cost < 100)
+      cost = 100;
+
+    if (FilterLimit > 0 && (FilterLevel + cost) > FilterLimit)
+    {
+      cupsArrayDelete(filters);
+      break;
+    }
+
+    if (job->compressions[doc - 1])
+      cupsArrayInsert(filters, &gziptoany_filter);
+
+    if (cupsArrayCount(filters) <= MAX_FILTERS)
+    {
+      snprintf(filename, sizeof(filename), "%s/d%05d-%03d", RequestRoot,
+               job->id, doc);
+      snprintf(content_type, sizeof(content_type), "CONTENT_TYPE=%s/%s",
+               job->filetypes[doc - 1]->super, job->filetypes[doc - 1]->type);
+
+      docargv[6]    = filename;
+      docenvp[envc] = NULL;
+
+      start_conversion(job, doc, filters, cost, docargv, docenvp);
+    }
+
+    cupsArrayDelete(filters);
+  }
+}
+
+
+/*
+ * 'find_conversion()' - Find the document being filtered ahead of time.
+ */
+
+static cupsd_jobconv_t *		/* O - Conversion or NULL */
+find_conversion(cupsd_job_t *job,	/* I - Job */
+                int         doc)	/* I - Document number */
+{
+  cupsd_jobconv_t	*conv;		/* Current conversion */
+
+
+  for (conv = (cupsd_jobconv_t *)cupsArrayFirst(job->conversions);
+       conv;
+       conv = (cupsd_jobconv_t *)cupsArrayNext(job->conversions))
+    if (conv->doc == doc)
+      break;
+
+  return (conv);
+}
+
+
+/*
+ * 'free_conversion()' - Free a document that was filtered ahead of time.
+ */
+
+static void
+free_conversion(cupsd_job_t     *job,	/* I - Job */
+                cupsd_jobconv_t *conv)	/* I - Conversion */
+{
+  FilterLevel -= conv->cost;
+
+  unlink(conv->filename);
+
+  cupsArrayRemove(job->conversions, conv);
+  free(conv);
+
+  if (cupsArrayCount(job->conversions) == 0)
+  {
+    cupsArrayDelete(job->conversions);
+    job->conversions = NULL;
+  }
+}
+
+
+/*
+ * 'free_job_history()' - Free any log history.
+ */
+
+static void
+free_job_history(cupsd_job_t *job)	/* I - Job */
+{
+  char	*message;			/* Current message */
+
+
+  if (!job->history)
+    return;
+
+  for (message = (char *)cupsArrayFirst(job->history);
+       message;
+       message = (char *)cupsArrayNext(job->history))
+    free(message);
+
+  cupsArrayDelete(job->history);
+  job->history = NULL;
+}
+
+
+/*
+ * 'finalize_job()' - Cleanup after job filter processes and support data.
+ */
+
+static void
+finalize_job(cupsd_job_t *job,		/* I - Job */
+             int         set_job_state)	/* I - 1 = set the job state */
+{
+  ipp_pstate_t		printer_state;	/* New printer state value */
+  ipp_jstate_t		job_state;	/* New job state value */
+  const char		*message;	/* Message for job state */
+  char			buffer[1024];	/* Buffer for formatted messages */
+
+
+  cupsdLogMessage(CUPSD_LOG_DEBUG2, "finalize_job(job=%p(%d))", job, job->id);
 
  /*
   * Clear the "connecting-to-device" and "cups-waiting-for-job-completed"
@@ -3132,6 +4297,20 @@ finalize_job(cupsd_job_t *job,		/* I - Job */
   job->cancel_time = 0;
   job->kill_time   = 0;
 
+  cupsdUpdateJobTimer(job);
+
+ /*
+  * Stop waiting on the FilterLimit...
+  */
+
+  cupsArrayRemove(filter_jobs, job);
+
+ /*
+  * Remove any documents that were filtered ahead of time...
+  */
+
+  stop_conversions(job, 0);
+
  /*
   * Close pipes and status buffer...
   */
@@ -3140,6 +4319,9 @@ finalize_job(cupsd_job_t *job,		/* I - Job */
   cupsdClosePipe(job->back_pipes);
   cupsdClosePipe(job->side_pipes);
 
+  cupsdRemoveSelect(job->stream_fds[1]);
+  cupsdClosePipe(job->stream_fds);
+
   cupsdRemoveSelect(job->status_pipes[0]);
   cupsdClosePipe(job->status_pipes);
   cupsdStatBufDelete(job->status_buffer);
@@ -3614,6 +4796,159 @@ finalize_job(cupsd_job_t *job,		/* I - Job */
 
   job->printer->job = NULL;
   job->printer      = NULL;
+
+  cupsdUpdateJobQueue(job);
+
+  if (job->dirty && job->state_value >= IPP_JOB_STOPPED)
+    cupsdSaveJob(job);
+}
+
+
+/*
+ * 'get_filters()' - Get the filters needed to print a document.
+ */
+
+static int				/* O - 1 on success, 0 if unprintable */
+get_filters(
+    cupsd_job_t  *job,			/* I - Job */
+    int          file,			/* I - Document index */
+    cups_array_t **list,		/* O - Filters or NULL for none */
+    int          *cost,			/* IO - Filtering cost */
+    char         *final_content_type,	/* O - FINAL_CONTENT_TYPE env variable */
+    size_t       fctsize)		/* I - Size of FINAL_CONTENT_TYPE */
+{
+  cups_array_t	*filters,		/* Filters for document */
+		*prefilters;		/* Filters with prefilters */
+  mime_filter_t	*filter,		/* Current filter */
+		*prefilter;		/* Prefilter */
+  mime_type_t	*dst = job->printer->filetype;
+					/* Destination file type */
+  const char	*ptr;			/* Pointer into type */
+  struct stat	fileinfo;		/* Job file information */
+  char		filename[1024];		/* Job filename */
+
+
+  *list = NULL;
+
+  snprintf(filename, sizeof(filename), "%s/d%05d-%03d", RequestRoot,
+           job->id, file + 1);
+  if (stat(filename, &fileinfo))
+    fileinfo.st_size = 0;
+
+  if (job->retry_as_raster)
+  {
+   /*
+    * Need to figure out whether the printer supports image/pwg-raster or
+    * image/urf, and use the corresponding type...
+    */
+
+    char	type[MIME_MAX_TYPE];	/* MIME media type for printer */
+
+    snprintf(type, sizeof(type), "%s/image/urf", job->printer->name);
+    if ((dst = mimeType(MimeDatabase, "printer", type)) == NULL)
+    {
+      snprintf(type, sizeof(type), "%s/image/pwg-raster", job->printer->name);
+      dst = mimeType(MimeDatabase, "printer", type);
+    }
+
+    if (dst)
+      cupsdLogJob(job, CUPSD_LOG_DEBUG, "Retrying job as \"%s\".", strchr(dst->type, '/') + 1);
+    else
+      cupsdLogJob(job, CUPSD_LOG_ERROR, "Unable to retry job using a supported raster format.");
+  }
+
+  filters = mimeFilter2(MimeDatabase, job->filetypes[file], (size_t)fileinfo.st_size, dst, cost);
+
+  if (!filters)
+    return (0);
+
+ /*
+  * Figure out the final content type...
+  */
+
+  cupsdLogJob(job, CUPSD_LOG_DEBUG, "%d filters for job:",
+	      cupsArrayCount(filters));
+  for (filter = (mime_filter_t *)cupsArrayFirst(filters);
+       filter;
+       filter = (mime_filter_t *)cupsArrayNext(filters))
+    cupsdLogJob(job, CUPSD_LOG_DEBUG, "%s (%s/%s to %s/%s, cost %d)",
+		filter->filter,
+		filter->src ? filter->src->super : "???",
+		filter->src ? filter->src->type : "???",
+		filter->dst ? filter->dst->super : "???",
+		filter->dst ? filter->dst->type : "???",
+		filter->cost);
+
+  if (!job->printer->remote)
+  {
+    for (filter = (mime_filter_t *)cupsArrayLast(filters);
+	 filter && filter->dst;
+	 filter = (mime_filter_t *)cupsArrayPrev(filters))
+      if (strcmp(filter->dst->super, "printer") ||
+	  strcmp(filter->dst->type, job->printer->name))
+	break;
+
+    if (filter && filter->dst)
+    {
+      if ((ptr = strchr(filter->dst->type, '/')) != NULL)
+	snprintf(final_content_type, fctsize,
+		 "FINAL_CONTENT_TYPE=%s", ptr + 1);
+      else
+	snprintf(final_content_type, fctsize,
+		 "FINAL_CONTENT_TYPE=%s/%s", filter->dst->super,
+		 filter->dst->type);
+    }
+    else
+      snprintf(final_content_type, fctsize,
+	       "FINAL_CONTENT_TYPE=printer/%s", job->printer->name);
+  }
+
+ /*
+  * Remove NULL ("-") filters...
+  */
+
+  for (filter = (mime_filter_t *)cupsArrayFirst(filters);
+       filter;
+       filter = (mime_filter_t *)cupsArrayNext(filters))
+    if (!strcmp(filter->filter, "-"))
+      cupsArrayRemove(filters, filter);
+
+  if (cupsArrayCount(filters) == 0)
+  {
+    cupsArrayDelete(filters);
+    filters = NULL;
+  }
+
+ /*
+  * If this printer has any pre-filters, insert the required pre-filter
+  * in the filters array...
+  */
+
+  if (job->printer->prefiltertype && filters)
+  {
+    prefilters = cupsArrayNew(NULL, NULL);
+
+    for (filter = (mime_filter_t *)cupsArrayFirst(filters);
+	 filter;
+	 filter = (mime_filter_t *)cupsArrayNext(filters))
+    {
+      if ((prefilter = mimeFilterLookup(MimeDatabase, filter->src,
+					job->printer->prefiltertype)))
+      {
+	cupsArrayAdd(prefilters, prefilter);
+	*cost += prefilter->cost;
+      }
+
+      cupsArrayAdd(prefilters, filter);
+    }
+
+    cupsArrayDelete(filters);
+    filters = prefilters;
+  }
+
+  *list = filters;
+
+  return (1);
 }
 
 
@@ -4118,6 +5453,24 @@ get_options(cupsd_job_t *job,		/* I - Job */
 }
 
 
+/*
+ * 'hash_count()' - Generate a lookup hash for a job counter.
+ */
+
+static int				/* O - Hash value */
+hash_count(cupsd_jobcount_t *count)	/* I - Counter */
+{
+  unsigned	hash = 0;		/* Hash value */
+  const char	*name;			/* Pointer into name */
+
+
+  for (name = count->name; *name; name ++)
+    hash = 31 * hash + (unsigned)_cups_tolower(*name);
+
+  return ((int)(hash & 255));
+}
+
+
 /*
  * 'ipp_length()' - Compute the size of the buffer needed to hold
  *		    the textual IPP attributes.
@@ -4250,48 +5603,358 @@ ipp_length(ipp_t *ipp)			/* I - IPP request */
 
 
 /*
- * 'load_job_cache()' - Load jobs from the job.cache file.
+ * 'is_worker_filter()' - Determine whether a filter is listed in
+ *                        FilterWorkers.
  */
 
-static void
-load_job_cache(const char *filename)	/* I - job.cache filename */
+static int				/* O - 1 if listed, 0 otherwise */
+is_worker_filter(const char *filter)	/* I - Filter program */
 {
-  cups_file_t	*fp;			/* job.cache file */
-  char		line[1024],		/* Line buffer */
-		*value;			/* Value on line */
-  int		linenum;		/* Line number in file */
-  cupsd_job_t	*job;			/* Current job */
-  int		jobid;			/* Job ID */
-  char		jobfile[1024];		/* Job filename */
+  const char	*name,			/* Program name */
+		*start,			/* Start of listed name */
+		*end;			/* End of listed name */
+  size_t	namelen;		/* Length of program name */
 
 
- /*
-  * Open the job.cache file...
-  */
+  if (!FilterWorkers)
+    return (0);
 
-  if ((fp = cupsdOpenConfFile(filename)) == NULL)
-  {
-    load_request_root();
-    return;
-  }
+  if ((name = strrchr(filter, '/')) != NULL)
+    name ++;
+  else
+    name = filter;
 
- /*
-  * Read entries from the job cache file and create jobs as needed.
-  */
+  namelen = strlen(name);
 
-  cupsdLogMessage(CUPSD_LOG_INFO, "Loading job cache file \"%s\"...",
-                  filename);
+  for (start = FilterWorkers; *start; start = end)
+  {
+    while (_cups_isspace(*start) || *start == ',')
+      start ++;
+
+    for (end = start; *end && !_cups_isspace(*end) && *end != ','; end ++);
+
+    if ((size_t)(end - start) == namelen && !strncmp(start, name, namelen))
+      return (1);
+  }
+
+  return (0);
+}
+
+
+/*
+ * 'journal_job()' - Append the job.cache entry for a job to the journal.
+ */
+
+static void
+journal_job(cupsd_job_t *job,		/* I - Job */
+            int         flush)		/* I - 1 to flush the journal now */
+{
+  if (!job_journal || (job->printer && job->printer->temporary))
+    return;
+
+  write_job_cache(job_journal, job);
+  job_journal_records ++;
+
+  if (flush)
+    cupsFileFlush(job_journal);
+}
+
+
+/*
+ * 'load_job_cache()' - Load jobs from the job.cache and job.journal files.
+ */
+
+static void
+load_job_cache(const char *filename)	/* I - job.cache filename */
+{
+  cups_file_t	*fp;			/* job.cache or job.journal file */
+  char		journal[1024],		/* job.journal filename */
+		jobfile[1024];		/* Job filename */
+  cupsd_job_t	*job;			/* Current job */
+
+
+ /*
+  * Open the job.cache file...
+  */
+
+  if ((fp = cupsdOpenConfFile(filename)) == NULL)
+  {
+    load_request_root();
+    return;
+  }
+
+ /*
+  * Read entries from the job cache file and then replay the changes that were
+  * journaled since it was written...
+  */
+
+  cupsdLogMessage(CUPSD_LOG_INFO, "Loading job cache file \"%s\"...",
+                  filename);
+
+  job_journal_gen = 0;
+
+  read_job_cache(fp, filename, 0);
+  cupsFileClose(fp);
+
+  snprintf(journal, sizeof(journal), "%s/job.journal", CacheDir);
+
+  if ((fp = cupsFileOpen(journal, "r")) != NULL)
+  {
+    cupsdLogMessage(CUPSD_LOG_INFO, "Replaying job journal file \"%s\"...",
+                    journal);
+
+    read_job_cache(fp, journal, 1);
+    cupsFileClose(fp);
+  }
+  else if (errno != ENOENT)
+    cupsdLogMessage(CUPSD_LOG_ERROR,
+                    "Unable to open job journal file \"%s\": %s", journal,
+		    strerror(errno));
+
+ /*
+  * Make sure the job files are still around...
+  */
+
+  for (job = (cupsd_job_t *)cupsArrayFirst(Jobs);
+       job;
+       job = (cupsd_job_t *)cupsArrayNext(Jobs))
+  {
+    snprintf(jobfile, sizeof(jobfile), "%s/c%05d", RequestRoot, job->id);
+    if (access(jobfile, 0))
+    {
+      snprintf(jobfile, sizeof(jobfile), "%s/c%05d.N", RequestRoot, job->id);
+      if (access(jobfile, 0))
+      {
+	cupsdLogJob(job, CUPSD_LOG_ERROR, "Files have gone away.");
+
+       /*
+	* job.cache file is out-of-date compared to spool directory; load
+	* that instead...
+	*/
+
+        while ((job = (cupsd_job_t *)cupsArrayFirst(Jobs)) != NULL)
+	  cupsdDeleteJob(job, CUPSD_JOB_DEFAULT);
+
+	load_request_root();
+	return;
+      }
+    }
+  }
+
+ /*
+  * Then load the active jobs...
+  */
+
+  for (job = (cupsd_job_t *)cupsArrayFirst(Jobs);
+       job;
+       job = (cupsd_job_t *)cupsArrayNext(Jobs))
+  {
+    if (job->state_value <= IPP_JOB_STOPPED && cupsdLoadJob(job))
+      cupsArrayAdd(ActiveJobs, job);
+    else if (job->state_value > IPP_JOB_STOPPED)
+    {
+      if (!job->completed_time || !job->creation_time || !job->name || !job->koctets)
+      {
+	cupsdLoadJob(job);
+	unload_job(job);
+      }
+    }
+  }
+}
+
+
+/*
+ * 'load_next_job_id()' - Load the NextJobId value from the job.cache file.
+ */
+
+static void
+load_next_job_id(const char *filename)	/* I - job.cache filename */
+{
+  cups_file_t	*fp;			/* job.cache file */
+  char		line[1024],		/* Line buffer */
+		*value;			/* Value on line */
+  int		linenum;		/* Line number in file */
+  int		next_job_id;		/* NextJobId value from line */
+
+
+ /*
+  * Read the NextJobId directive from the job.cache file and use
+  * the value (if any).
+  */
+
+  if ((fp = cupsFileOpen(filename, "r")) == NULL)
+  {
+    if (errno != ENOENT)
+      cupsdLogMessage(CUPSD_LOG_ERROR,
+                      "Unable to open job cache file \"%s\": %s",
+                      filename, strerror(errno));
+
+    return;
+  }
+
+  cupsdLogMessage(CUPSD_LOG_INFO,
+                  "Loading NextJobId from job cache file \"%s\"...", filename);
 
   linenum = 0;
-  job     = NULL;
 
   while (cupsFileGetConf(fp, line, sizeof(line), &value, &linenum))
   {
     if (!_cups_strcasecmp(line, "NextJobId"))
+    {
+      if (value)
+      {
+        next_job_id = atoi(value);
+
+        if (next_job_id > NextJobId)
+	  NextJobId = next_job_id;
+      }
+      break;
+    }
+  }
+
+  cupsFileClose(fp);
+}
+
+
+/*
+ * 'load_request_root()' - Load jobs from the RequestRoot directory.
+ */
+
+static void
+load_request_root(void)
+{
+  cups_dir_t		*dir;		/* Directory */
+  cups_dentry_t		*dent;		/* Directory entry */
+  cupsd_job_t		*job;		/* New job */
+
+
+ /*
+  * Open the requests directory...
+  */
+
+  cupsdLogMessage(CUPSD_LOG_DEBUG, "Scanning %s for jobs...", RequestRoot);
+
+  if ((dir = cupsDirOpen(RequestRoot)) == NULL)
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR,
+                    "Unable to open spool directory \"%s\": %s",
+                    RequestRoot, strerror(errno));
+    return;
+  }
+
+ /*
+  * Read all the c##### files...
+  */
+
+  while ((dent = cupsDirRead(dir)) != NULL)
+    if (strlen(dent->filename) >= 6 && dent->filename[0] == 'c')
+    {
+     /*
+      * Allocate memory for the job...
+      */
+
+      if ((job = calloc(sizeof(cupsd_job_t), 1)) == NULL)
+      {
+        cupsdLogMessage(CUPSD_LOG_ERROR, "Ran out of memory for jobs.");
+	cupsDirClose(dir);
+	return;
+      }
+
+     /*
+      * Assign the job ID...
+      */
+
+      job->id              = atoi(dent->filename + 1);
+      job->back_pipes[0]   = -1;
+      job->back_pipes[1]   = -1;
+      job->print_pipes[0]  = -1;
+      job->print_pipes[1]  = -1;
+      job->side_pipes[0]   = -1;
+      job->side_pipes[1]   = -1;
+      job->status_pipes[0] = -1;
+      job->status_pipes[1] = -1;
+      job->stream_fds[0]   = -1;
+      job->stream_fds[1]   = -1;
+
+      if (job->id >= NextJobId)
+        NextJobId = job->id + 1;
+
+     /*
+      * Load the job...
+      */
+
+      if (cupsdLoadJob(job))
+      {
+       /*
+        * Insert the job into the array, sorting by job priority and ID...
+        */
+
+	cupsArrayAdd(Jobs, job);
+
+	if (job->state_value <= IPP_JOB_STOPPED)
+	  cupsArrayAdd(ActiveJobs, job);
+	else
+	  unload_job(job);
+      }
+      else
+        free(job);
+    }
+
+  cupsDirClose(dir);
+}
+
+
+/*
+ * 'read_job_cache()' - Read job entries from a job.cache or job.journal file.
+ */
+
+static void
+read_job_cache(cups_file_t *fp,		/* I - File to read */
+               const char  *filename,	/* I - Filename */
+	       int         journal)	/* I - 1 for job.journal, 0 for job.cache */
+{
+  char		line[1024],		/* Line buffer */
+		*value;			/* Value on line */
+  int		linenum;		/* Line number in file */
+  cupsd_job_t	*job,			/* Current job */
+		*oldjob;		/* Earlier entry for job */
+  int		jobid;			/* Job ID */
+  char		jobfile[1024];		/* Job filename */
+  int		replay = 0;		/* Journal matches job.cache? */
+
+
+  linenum = 0;
+  job     = NULL;
+
+  while (cupsFileGetConf(fp, line, sizeof(line), &value, &linenum))
+  {
+    if (!_cups_strcasecmp(line, "Generation"))
+    {
+      if (!journal)
+        job_journal_gen = value ? atoi(value) : 0;
+      else if (!value || atoi(value) != job_journal_gen)
+      {
+        cupsdLogMessage(CUPSD_LOG_INFO, "Ignoring out-of-date job journal file \"%s\".", filename);
+        break;
+      }
+      else
+        replay = 1;
+    }
+    else if (journal && !replay)
+    {
+      cupsdLogMessage(CUPSD_LOG_ERROR, "Missing Generation directive on line %d of %s.", linenum, filename);
+      break;
+    }
+    else if (!_cups_strcasecmp(line, "NextJobId"))
     {
       if (value)
         NextJobId = atoi(value);
     }
+    else if (!_cups_strcasecmp(line, "DeleteJob") && !job)
+    {
+      if (value && (oldjob = cupsdFindJob(atoi(value))) != NULL)
+        cupsdDeleteJob(oldjob, CUPSD_JOB_DEFAULT);
+    }
     else if (!_cups_strcasecmp(line, "<Job"))
     {
       if (job)
@@ -4314,26 +5977,6 @@ load_job_cache(const char *filename)	/* I - job.cache filename */
         continue;
       }
 
-      snprintf(jobfile, sizeof(jobfile), "%s/c%05d", RequestRoot, jobid);
-      if (access(jobfile, 0))
-      {
-	snprintf(jobfile, sizeof(jobfile), "%s/c%05d.N", RequestRoot, jobid);
-	if (access(jobfile, 0))
-	{
-	  cupsdLogMessage(CUPSD_LOG_ERROR, "[Job %d] Files have gone away.",
-			  jobid);
-
-         /*
-          * job.cache file is out-of-date compared to spool directory; load
-          * that instead...
-          */
-
-	  cupsFileClose(fp);
-          load_request_root();
-          return;
-	}
-      }
-
       job = calloc(1, sizeof(cupsd_job_t));
       if (!job)
       {
@@ -4351,6 +5994,8 @@ load_job_cache(const char *filename)	/* I - job.cache filename */
       job->side_pipes[1]   = -1;
       job->status_pipes[0] = -1;
       job->status_pipes[1] = -1;
+      job->stream_fds[0]   = -1;
+      job->stream_fds[1]   = -1;
 
       cupsdLogJob(job, CUPSD_LOG_DEBUG, "Loading from cache...");
     }
@@ -4362,18 +6007,14 @@ load_job_cache(const char *filename)	/* I - job.cache filename */
     }
     else if (!_cups_strcasecmp(line, "</Job>"))
     {
-      cupsArrayAdd(Jobs, job);
+     /*
+      * Replace any earlier entry for this job...
+      */
 
-      if (job->state_value <= IPP_JOB_STOPPED && cupsdLoadJob(job))
-	cupsArrayAdd(ActiveJobs, job);
-      else if (job->state_value > IPP_JOB_STOPPED)
-      {
-        if (!job->completed_time || !job->creation_time || !job->name || !job->koctets)
-	{
-	  cupsdLoadJob(job);
-	  unload_job(job);
-	}
-      }
+      if ((oldjob = cupsdFindJob(job->id)) != NULL)
+        cupsdDeleteJob(oldjob, CUPSD_JOB_DEFAULT);
+
+      cupsArrayAdd(Jobs, job);
 
       job = NULL;
     }
@@ -4519,204 +6160,278 @@ load_job_cache(const char *filename)	/* I - job.cache filename */
   {
     cupsdLogMessage(CUPSD_LOG_ERROR,
 		    "Missing </Job> directive on line %d of %s.", linenum, filename);
-    cupsdDeleteJob(job, CUPSD_JOB_PURGE);
+
+   /*
+    * A partial journal entry means we crashed while appending to it, so
+    * don't touch the job files...
+    */
+
+    cupsdDeleteJob(job, journal ? CUPSD_JOB_DEFAULT : CUPSD_JOB_PURGE);
   }
+}
 
-  cupsFileClose(fp);
+
+/*
+ * 'remove_job_files()' - Remove the document files for a job.
+ */
+
+static void
+remove_job_files(cupsd_job_t *job)	/* I - Job */
+{
+  int	i;				/* Looping var */
+  char	filename[1024];			/* Document filename */
+
+
+  if (job->num_files <= 0)
+    return;
+
+  for (i = 1; i <= job->num_files; i ++)
+  {
+    snprintf(filename, sizeof(filename), "%s/d%05d-%03d", RequestRoot,
+	     job->id, i);
+    cupsdUnlinkOrRemoveFile(filename);
+  }
+
+  free(job->filetypes);
+  free(job->compressions);
+
+  job->file_time    = 0;
+  job->num_files    = 0;
+  job->filetypes    = NULL;
+  job->compressions = NULL;
+
+  LastEvent |= CUPSD_EVENT_PRINTER_STATE_CHANGED;
 }
 
 
 /*
- * 'load_next_job_id()' - Load the NextJobId value from the job.cache file.
+ * 'remove_job_history()' - Remove the control file for a job.
  */
 
 static void
-load_next_job_id(const char *filename)	/* I - job.cache filename */
+remove_job_history(cupsd_job_t *job)	/* I - Job */
 {
-  cups_file_t	*fp;			/* job.cache file */
-  char		line[1024],		/* Line buffer */
-		*value;			/* Value on line */
-  int		linenum;		/* Line number in file */
-  int		next_job_id;		/* NextJobId value from line */
+  char	filename[1024];			/* Control filename */
 
 
  /*
-  * Read the NextJobId directive from the job.cache file and use
-  * the value (if any).
+  * Remove the job info file...
   */
 
-  if ((fp = cupsFileOpen(filename, "r")) == NULL)
-  {
-    if (errno != ENOENT)
-      cupsdLogMessage(CUPSD_LOG_ERROR,
-                      "Unable to open job cache file \"%s\": %s",
-                      filename, strerror(errno));
+  snprintf(filename, sizeof(filename), "%s/c%05d", RequestRoot,
+	   job->id);
+  cupsdUnlinkOrRemoveFile(filename);
 
-    return;
-  }
+  LastEvent |= CUPSD_EVENT_PRINTER_STATE_CHANGED;
+}
 
-  cupsdLogMessage(CUPSD_LOG_INFO,
-                  "Loading NextJobId from job cache file \"%s\"...", filename);
 
-  linenum = 0;
+/*
+ * 'run_worker()' - Run a filter using a process started ahead of time.
+ *
+ * The document file, if any, is sent as the standard input instead of
+ * being named on the command-line.  Another process is started for the
+ * next job.
+ */
 
-  while (cupsFileGetConf(fp, line, sizeof(line), &value, &linenum))
+static int				/* O - Process ID or 0 */
+run_worker(cupsd_job_t *job,		/* I - Job */
+           const char  *command,	/* I - Filter program */
+           char        *argv[],		/* I - Command-line arguments */
+	   char        *envp[],		/* I - Environment */
+	   int         *fds)		/* I - File descriptors 0 to 6 */
+{
+  cupsd_worker_t	key,		/* Search key */
+			*worker;	/* Matching worker */
+  int			pid = 0,	/* Process ID */
+			docfd = -1;	/* Document file */
+  char			*docfile;	/* Document filename */
+
+
+  key.printer = job->printer->name;
+  key.command = (char *)command;
+
+  if ((worker = (cupsd_worker_t *)cupsArrayFind(filter_workers,
+                                                &key)) != NULL)
   {
-    if (!_cups_strcasecmp(line, "NextJobId"))
+    cupsArrayRemove(filter_workers, worker);
+
+    if ((docfile = argv[6]) != NULL &&
+        (docfd = open(docfile, O_RDONLY | O_CLOEXEC)) >= 0)
     {
-      if (value)
-      {
-        next_job_id = atoi(value);
+      fds[0]  = docfd;
+      argv[6] = NULL;
+    }
 
-        if (next_job_id > NextJobId)
-	  NextJobId = next_job_id;
-      }
-      break;
+    if (docfile && docfd < 0)
+      cupsdLogJob(job, CUPSD_LOG_DEBUG, "Unable to open \"%s\": %s", docfile,
+                  strerror(errno));
+#ifdef __APPLE__
+    else if (_ppdFilterWorkerSend(worker->fd, argv, envp + 1, fds))
+#else
+    else if (_ppdFilterWorkerSend(worker->fd, argv, envp, fds))
+#endif /* __APPLE__ */
+      cupsdLogJob(job, CUPSD_LOG_DEBUG,
+                  "Unable to send job to filter worker %s (PID %d): %s",
+		  command, worker->pid, strerror(errno));
+    else
+    {
+      pid = worker->pid;
+
+      cupsdSetProcessJob(pid, job);
     }
+
+    if (docfd >= 0)
+    {
+      close(docfd);
+      argv[6] = docfile;
+    }
+
+    close(worker->fd);
+    cupsdClearString(&worker->printer);
+    cupsdClearString(&worker->command);
+    free(worker);
   }
 
-  cupsFileClose(fp);
+  start_worker(job->printer, command);
+
+  return (pid);
 }
 
 
 /*
- * 'load_request_root()' - Load jobs from the RequestRoot directory.
+ * 'save_job_cache()' - Write a full job.cache file.
  */
 
 static void
-load_request_root(void)
+save_job_cache(int start_journal)	/* I - 1 to start a new job.journal */
 {
-  cups_dir_t		*dir;		/* Directory */
-  cups_dentry_t		*dent;		/* Directory entry */
-  cupsd_job_t		*job;		/* New job */
-
-
- /*
-  * Open the requests directory...
-  */
+  cups_file_t	*fp;			/* job.cache or job.journal file */
+  char		filename[1024],		/* job.cache filename */
+		journal[1024];		/* job.journal filename */
+  cupsd_job_t	*job;			/* Current job */
+  int		generation;		/* New job.cache generation */
 
-  cupsdLogMessage(CUPSD_LOG_DEBUG, "Scanning %s for jobs...", RequestRoot);
 
-  if ((dir = cupsDirOpen(RequestRoot)) == NULL)
-  {
-    cupsdLogMessage(CUPSD_LOG_ERROR,
-                    "Unable to open spool directory \"%s\": %s",
-                    RequestRoot, strerror(errno));
+  snprintf(filename, sizeof(filename), "%s/job.cache", CacheDir);
+  if ((fp = cupsdCreateConfFile(filename, ConfigFilePerm)) == NULL)
     return;
-  }
+
+  cupsdLogMessage(CUPSD_LOG_INFO, "Saving job.cache...");
 
  /*
-  * Read all the c##### files...
+  * Write a small header to the file...  The generation number ties the
+  * job.journal file to this job.cache file.
   */
 
-  while ((dent = cupsDirRead(dir)) != NULL)
-    if (strlen(dent->filename) >= 6 && dent->filename[0] == 'c')
-    {
-     /*
-      * Allocate memory for the job...
-      */
+  if ((generation = (int)time(NULL)) <= job_journal_gen)
+    generation = job_journal_gen + 1;
 
-      if ((job = calloc(sizeof(cupsd_job_t), 1)) == NULL)
-      {
-        cupsdLogMessage(CUPSD_LOG_ERROR, "Ran out of memory for jobs.");
-	cupsDirClose(dir);
-	return;
-      }
-
-     /*
-      * Assign the job ID...
-      */
-
-      job->id              = atoi(dent->filename + 1);
-      job->back_pipes[0]   = -1;
-      job->back_pipes[1]   = -1;
-      job->print_pipes[0]  = -1;
-      job->print_pipes[1]  = -1;
-      job->side_pipes[0]   = -1;
-      job->side_pipes[1]   = -1;
-      job->status_pipes[0] = -1;
-      job->status_pipes[1] = -1;
+  cupsFilePuts(fp, "# Job cache file for " CUPS_SVERSION "\n");
+  cupsFilePrintf(fp, "# Written by cupsd\n");
+  cupsFilePrintf(fp, "Generation %d\n", generation);
+  cupsFilePrintf(fp, "NextJobId %d\n", NextJobId);
 
-      if (job->id >= NextJobId)
-        NextJobId = job->id + 1;
+ /*
+  * Write each job known to the system...
+  */
 
+  for (job = (cupsd_job_t *)cupsArrayFirst(Jobs);
+       job;
+       job = (cupsd_job_t *)cupsArrayNext(Jobs))
+  {
+    if (job->printer && job->printer->temporary)
+    {
      /*
-      * Load the job...
+      * Don't save jobs on temporary printers...
       */
 
-      if (cupsdLoadJob(job))
-      {
-       /*
-        * Insert the job into the array, sorting by job priority and ID...
-        */
-
-	cupsArrayAdd(Jobs, job);
-
-	if (job->state_value <= IPP_JOB_STOPPED)
-	  cupsArrayAdd(ActiveJobs, job);
-	else
-	  unload_job(job);
-      }
-      else
-        free(job);
+      continue;
     }
 
-  cupsDirClose(dir);
-}
+    write_job_cache(fp, job);
+  }
 
+  if (cupsdCloseCreatedConfFile(fp, filename))
+    return;
 
-/*
- * 'remove_job_files()' - Remove the document files for a job.
- */
+  job_journal_gen     = generation;
+  job_journal_records = 0;
 
-static void
-remove_job_files(cupsd_job_t *job)	/* I - Job */
-{
-  int	i;				/* Looping var */
-  char	filename[1024];			/* Document filename */
+  if (!start_journal)
+    return;
 
+ /*
+  * Start a new journal for this generation...
+  */
 
-  if (job->num_files <= 0)
-    return;
+  snprintf(journal, sizeof(journal), "%s/job.journal", CacheDir);
 
-  for (i = 1; i <= job->num_files; i ++)
-  {
-    snprintf(filename, sizeof(filename), "%s/d%05d-%03d", RequestRoot,
-	     job->id, i);
-    cupsdUnlinkOrRemoveFile(filename);
-  }
+  if ((fp = cupsdCreateConfFile(journal, ConfigFilePerm)) == NULL)
+    return;
 
-  free(job->filetypes);
-  free(job->compressions);
+  cupsFilePuts(fp, "# Job journal file for " CUPS_SVERSION "\n");
+  cupsFilePrintf(fp, "# Written by cupsd\n");
+  cupsFilePrintf(fp, "Generation %d\n", generation);
 
-  job->file_time    = 0;
-  job->num_files    = 0;
-  job->filetypes    = NULL;
-  job->compressions = NULL;
+  if (cupsdCloseCreatedConfFile(fp, journal))
+    return;
 
-  LastEvent |= CUPSD_EVENT_PRINTER_STATE_CHANGED;
+  if ((job_journal = cupsFileOpen(journal, "a")) == NULL)
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to open job journal file \"%s\": %s", journal, strerror(errno));
 }
 
 
 /*
- * 'remove_job_history()' - Remove the control file for a job.
+ * 'set_job_count()' - Move a job to the counter for a destination or user.
  */
 
 static void
-remove_job_history(cupsd_job_t *job)	/* I - Job */
+set_job_count(cups_array_t     **counts,/* IO - Counter array */
+              cupsd_jobcount_t **count,	/* IO - Current counter for job */
+	      const char       *name)	/* I  - Name or NULL to uncount */
 {
-  char	filename[1024];			/* Control filename */
+  cupsd_jobcount_t	key,		/* Search key */
+			*newcount = NULL;
+					/* New counter */
 
 
- /*
-  * Remove the job info file...
-  */
+  if (*count && name && !_cups_strcasecmp((*count)->name, name))
+    return;
 
-  snprintf(filename, sizeof(filename), "%s/c%05d", RequestRoot,
-	   job->id);
-  cupsdUnlinkOrRemoveFile(filename);
+  if (name)
+  {
+    if (!*counts)
+      *counts = cupsArrayNew3((cups_array_func_t)compare_counts, NULL,
+                              (cups_ahash_func_t)hash_count, 256,
+			      (cups_acopy_func_t)NULL,
+			      (cups_afree_func_t)NULL);
 
-  LastEvent |= CUPSD_EVENT_PRINTER_STATE_CHANGED;
+    key.name = (char *)name;
+
+    if ((newcount = (cupsd_jobcount_t *)cupsArrayFind(*counts, &key)) == NULL &&
+        (newcount = calloc(1, sizeof(cupsd_jobcount_t))) != NULL)
+    {
+      cupsdSetString(&newcount->name, name);
+      cupsArrayAdd(*counts, newcount);
+    }
+
+    if (newcount)
+      newcount->count ++;
+  }
+
+  if (*count && -- (*count)->count <= 0)
+  {
+   /*
+    * Free counters that are no longer used...
+    */
+
+    cupsArrayRemove(*counts, *count);
+    cupsdClearString(&(*count)->name);
+    free(*count);
+  }
+
+  *count = newcount;
 }
 
 
@@ -4777,6 +6492,160 @@ set_time(cupsd_job_t *job,		/* I - Job to update */
 }
 
 
+/*
+ * 'start_conversion()' - Start filtering a document into a temporary file.
+ */
+
+static void
+start_conversion(
+    cupsd_job_t  *job,			/* I - Job */
+    int          doc,			/* I - Document number */
+    cups_array_t *filters,		/* I - Filters for document */
+    int          cost,			/* I - Filtering cost */
+    char         *argv[],		/* I - Filter arguments */
+    char         *envp[])		/* I - Filter environment */
+{
+  int			i,		/* Looping var */
+			slot,		/* Pipe slot */
+			envc,		/* Number of environment variables */
+			ringenvc,	/* Number with ring variables */
+			pid,		/* Process ID of filter */
+			outfd;		/* Filtered document file */
+  int			filterfds[2][2] = { { -1, -1 }, { -1, -1 } };
+					/* Pipes used between filters */
+  int			ringfds[2] = { -1, -1 };
+					/* Shared memory rings between filters */
+  mime_filter_t		*filter;	/* Current filter */
+  cupsd_jobconv_t	*conv;		/* New conversion */
+  char			command[1024];	/* Full path to command */
+
+
+  if ((conv = calloc(1, sizeof(cupsd_jobconv_t))) == NULL)
+    return;
+
+  conv->doc  = doc;
+  conv->cost = cost;
+
+  for (envc = 0; envp[envc]; envc ++)
+    if (!strncmp(envp[envc], "FINAL_CONTENT_TYPE=", 19))
+      strlcpy(conv->final_content_type, envp[envc],
+              sizeof(conv->final_content_type));
+
+  snprintf(conv->filename, sizeof(conv->filename), "%s/d%05d-%03d.prn",
+           TempDir, job->id, doc);
+  unlink(conv->filename);
+
+  if ((outfd = open(conv->filename, O_WRONLY | O_CREAT | O_EXCL, 0600)) < 0)
+  {
+    cupsdLogJob(job, CUPSD_LOG_ERROR, "Unable to create \"%s\": %s",
+                conv->filename, strerror(errno));
+    free(conv);
+    return;
+  }
+
+  fcntl(outfd, F_SETFD, fcntl(outfd, F_GETFD) | FD_CLOEXEC);
+
+  if (!job->conversions)
+    job->conversions = cupsArrayNew(NULL, NULL);
+
+  cupsArrayAdd(job->conversions, conv);
+
+  FilterLevel += cost;
+
+  cupsdLogJob(job, CUPSD_LOG_DEBUG, "Filtering document %d ahead of time.",
+              doc);
+
+  for (i = 0, slot = 0, filter = (mime_filter_t *)cupsArrayFirst(filters);
+       filter;
+       i ++, filter = (mime_filter_t *)cupsArrayNext(filters))
+  {
+    if (filter->filter[0] != '/')
+      snprintf(command, sizeof(command), "%s/filter/%s", ServerBin,
+               filter->filter);
+    else
+      strlcpy(command, filter->filter, sizeof(command));
+
+    if (i < (cupsArrayCount(filters) - 1))
+    {
+      if (cupsdOpenPipe(filterfds[slot]))
+        break;
+
+      if (FilterRingSize > 0)
+        ringfds[slot] = _cupsRingCreate(filterfds[slot][0],
+	                                (size_t)FilterRingSize);
+    }
+    else
+    {
+      filterfds[slot][0] = -1;
+      filterfds[slot][1] = outfd;
+      outfd              = -1;
+    }
+
+    ringenvc = envc;
+
+    if (ringfds[!slot] >= 0)
+      envp[ringenvc ++] = "CUPS_STDIN_RING=5";
+
+    if (ringfds[slot] >= 0)
+      envp[ringenvc ++] = "CUPS_STDOUT_RING=6";
+
+    envp[ringenvc] = NULL;
+
+    pid = cupsdStartProcess(command, argv, envp, filterfds[!slot][0],
+                            filterfds[slot][1], job->status_pipes[1], -1, -1,
+			    ringfds[!slot], ringfds[slot], 0, job->profile,
+			    job, conv->filters + i);
+
+    cupsdClosePipe(filterfds[!slot]);
+
+    if (ringfds[!slot] >= 0)
+    {
+      close(ringfds[!slot]);
+      ringfds[!slot] = -1;
+    }
+
+    if (!pid)
+    {
+      cupsdLogJob(job, CUPSD_LOG_ERROR, "Unable to start filter \"%s\" - %s.",
+		  filter->filter, strerror(errno));
+      break;
+    }
+
+    cupsdLogJob(job, CUPSD_LOG_INFO,
+                "Started filter %s (PID %d) for document %d", command, pid,
+		doc);
+
+    argv[6] = NULL;
+    slot    = !slot;
+  }
+
+  envp[envc] = NULL;
+
+  cupsdClosePipe(filterfds[0]);
+  cupsdClosePipe(filterfds[1]);
+  cupsdClosePipe(ringfds);
+
+  if (outfd >= 0)
+    close(outfd);
+
+  if (filter)
+  {
+   /*
+    * Unable to start all of the filters, stop the ones we did start and
+    * filter the document normally when it is printed...
+    */
+
+    conv->status = -1;
+
+    for (i = 0; conv->filters[i]; i ++)
+      cupsdEndProcess(conv->filters[i], 0);
+
+    if (!conv->filters[0])
+      free_conversion(job, conv);
+  }
+}
+
+
 /*
  * 'start_job()' - Start a print job.
  */
@@ -4847,6 +6716,8 @@ start_job(cupsd_job_t     *job,		/* I - Job ID */
   else
     job->cancel_time = 0;
 
+  cupsdUpdateJobTimer(job);
+
  /*
   * Check for support files...
   */
@@ -4982,6 +6853,110 @@ start_job(cupsd_job_t     *job,		/* I - Job ID */
 }
 
 
+/*
+ * 'start_worker()' - Start a filter ahead of time for the next job.
+ */
+
+static void
+start_worker(cupsd_printer_t *p,	/* I - Printer */
+             const char      *command)	/* I - Filter program */
+{
+  cupsd_worker_t	*worker;	/* New worker */
+  int			pid,		/* Process ID */
+			envc,		/* Number of environment variables */
+			fds[2];		/* Control socket */
+  void			*profile;	/* Security profile */
+  char			*argv[2],	/* Command-line arguments */
+			*envp[MAX_ENV + 5],
+					/* Environment */
+			lang[255],	/* LANG env var */
+			ppd[1024],	/* PPD env var */
+			printer_name[255];
+					/* PRINTER env var */
+
+
+  if (!filter_workers &&
+      (filter_workers = cupsArrayNew((cups_array_func_t)compare_workers,
+                                     NULL)) == NULL)
+    return;
+
+  if (socketpair(AF_LOCAL, SOCK_STREAM, 0, fds))
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to create filter worker socket: "
+                    "%s", strerror(errno));
+    return;
+  }
+
+  fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+  fcntl(fds[0], F_SETFL, O_NONBLOCK);
+  fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+
+  envc = cupsdLoadEnv(envp, (int)(sizeof(envp) / sizeof(envp[0])));
+
+  snprintf(lang, sizeof(lang), "LANG=%s.UTF-8", DefaultLanguage);
+  snprintf(ppd, sizeof(ppd), "PPD=%s/ppd/%s.ppd", ServerRoot, p->name);
+  snprintf(printer_name, sizeof(printer_name), "PRINTER=%s", p->name);
+
+  envp[envc ++] = "CUPS_FILTER_WORKER=1";
+  envp[envc ++] = lang;
+  envp[envc ++] = ppd;
+  envp[envc ++] = printer_name;
+  envp[envc]    = NULL;
+
+  argv[0] = p->name;
+  argv[1] = NULL;
+
+  profile = cupsdCreateProfile(-1, 0);
+
+  cupsdStartProcess(command, argv, envp, fds[1], -1, -1, -1, -1, -1, -1, 0,
+                    profile, NULL, &pid);
+
+  cupsdDestroyProfile(profile);
+  close(fds[1]);
+
+  if (!pid || (worker = calloc(1, sizeof(cupsd_worker_t))) == NULL)
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to start filter worker %s for "
+                    "printer %s.", command, p->name);
+    close(fds[0]);
+    return;
+  }
+
+  cupsdSetString(&worker->printer, p->name);
+  cupsdSetString(&worker->command, command);
+  worker->pid = pid;
+  worker->fd  = fds[0];
+
+  cupsArrayAdd(filter_workers, worker);
+
+  cupsdLogMessage(CUPSD_LOG_DEBUG, "Started filter worker %s (PID %d) for "
+                  "printer %s.", command, pid, p->name);
+}
+
+
+/*
+ * 'stop_conversions()' - Stop filtering documents ahead of time.
+ */
+
+static void
+stop_conversions(cupsd_job_t *job,	/* I - Job */
+                 int         force)	/* I - Kill filters? */
+{
+  int			i;		/* Looping var */
+  cupsd_jobconv_t	*conv;		/* Current conversion */
+
+
+  while ((conv = (cupsd_jobconv_t *)cupsArrayFirst(job->conversions)) != NULL)
+  {
+    for (i = 0; conv->filters[i]; i ++)
+      if (conv->filters[i] > 0)
+        cupsdEndProcess(conv->filters[i], force);
+
+    free_conversion(job, conv);
+  }
+}
+
+
 /*
  * 'stop_job()' - Stop a print job.
  */
@@ -5004,6 +6979,13 @@ stop_job(cupsd_job_t       *job,	/* I - Job */
   else if (action >= CUPSD_JOB_FORCE)
     job->kill_time = 0;
 
+  cupsdUpdateJobTimer(job);
+
+  cupsdRemoveSelect(job->stream_fds[1]);
+  cupsdClosePipe(job->stream_fds);
+
+  stop_conversions(job, action >= CUPSD_JOB_FORCE);
+
   for (i = 0; job->filters[i]; i ++)
     if (job->filters[i] > 0)
     {
@@ -5032,6 +7014,61 @@ stop_job(cupsd_job_t       *job,	/* I - Job */
 }
 
 
+/*
+ * 'touch_job()' - Move a loaded job to the front of the LRU list.
+ *
+ * Jobs that are not loaded or not stopped/completed are removed from the list.
+ */
+
+static void
+touch_job(cupsd_job_t *job)		/* I - Job */
+{
+  if (job->lru_size)
+  {
+   /*
+    * Remove the job from the list...
+    */
+
+    if (job->lru_prev)
+      job->lru_prev->lru_next = job->lru_next;
+    else
+      lru_first = job->lru_next;
+
+    if (job->lru_next)
+      job->lru_next->lru_prev = job->lru_prev;
+    else
+      lru_last = job->lru_prev;
+
+    job->lru_prev = job->lru_next = NULL;
+
+    if (!job->attrs || job->state_value < IPP_JOB_STOPPED)
+    {
+      lru_size      -= job->lru_size;
+      job->lru_size = 0;
+      return;
+    }
+  }
+  else if (!job->attrs || job->state_value < IPP_JOB_STOPPED)
+    return;
+  else
+  {
+    job->lru_size = ippLength(job->attrs);
+    lru_size      += job->lru_size;
+  }
+
+ /*
+  * Add the job to the front of the list...
+  */
+
+  if ((job->lru_next = lru_first) != NULL)
+    lru_first->lru_prev = job;
+  else
+    lru_last = job;
+
+  lru_first = job;
+}
+
+
 /*
  * 'unload_job()' - Unload a job from memory.
  */
@@ -5054,6 +7091,8 @@ unload_job(cupsd_job_t *job)		/* I - Job */
   job->job_sheets      = NULL;
   job->printer_message = NULL;
   job->printer_reasons = NULL;
+
+  touch_job(job);
 }
 
 
@@ -5215,6 +7254,8 @@ update_job(cupsd_job_t *job)		/* I - Job to check */
 	      job->cancel_time = time(NULL) + MaxJobTime;
 	    else
 	      job->cancel_time = 0;
+
+	    cupsdUpdateJobTimer(job);
 	  }
         }
       }
@@ -5578,3 +7619,36 @@ update_job_attrs(cupsd_job_t *job,	/* I - Job to update */
   job->dirty = 1;
   cupsdMarkDirty(CUPSD_DIRTY_JOBS);
 }
+
+
+/*
+ * 'write_job_cache()' - Write the job.cache entry for a job.
+ */
+
+static void
+write_job_cache(cups_file_t *fp,	/* I - job.cache or job.journal file */
+                cupsd_job_t *job)	/* I - Job */
+{
+  int	i;				/* Looping var */
+
+
+  cupsFilePrintf(fp, "<Job %d>\n", job->id);
+  cupsFilePrintf(fp, "State %d\n", job->state_value);
+  cupsFilePrintf(fp, "Created %ld\n", (long)job->creation_time);
+  if (job->completed_time)
+    cupsFilePrintf(fp, "Completed %ld\n", (long)job->completed_time);
+  cupsFilePrintf(fp, "Priority %d\n", job->priority);
+  if (job->hold_until)
+    cupsFilePrintf(fp, "HoldUntil %ld\n", (long)job->hold_until);
+  cupsFilePrintf(fp, "Username %s\n", job->username);
+  if (job->name)
+    cupsFilePutConf(fp, "Name", job->name);
+  cupsFilePrintf(fp, "Destination %s\n", job->dest);
+  cupsFilePrintf(fp, "DestType %d\n", job->dtype);
+  cupsFilePrintf(fp, "KOctets %d\n", job->koctets);
+  cupsFilePrintf(fp, "NumFiles %d\n", job->num_files);
+  for (i = 0; i < job->num_files; i ++)
+    cupsFilePrintf(fp, "File %d %s/%s %d\n", i + 1, job->filetypes[i]->super,
+                   job->filetypes[i]->type, job->compressions[i]);
+  cupsFilePuts(fp, "</Job>\n");
+}
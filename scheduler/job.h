@@ -23,6 +23,51 @@ typedef enum cupsd_jobaction_e		/**** Actions for state changes ****/
  * Job request structure...
  */
 
+typedef struct cupsd_jobcount_s		/**** Active job counter ****/
+{
+  char			*name;		/* Destination or username */
+  int			count;		/* Number of active jobs */
+} cupsd_jobcount_t;
+
+typedef struct cupsd_jobq_s		/**** Pending jobs for a destination ****/
+{
+  char			*dest;		/* Destination printer or class */
+  cups_array_t		*jobs;		/* Pending jobs, sorted by priority */
+} cupsd_jobq_t;
+
+typedef struct cupsd_jobstats_s		/**** Filter or backend resource usage ****/
+{
+  const char		*name;		/* Program name */
+  int			backend,	/* Backend? */
+			doc;		/* Document number */
+  long			user_time,	/* User CPU time in milliseconds */
+			system_time,	/* System CPU time in milliseconds */
+			wall_time,	/* Wall clock time in milliseconds */
+			max_rss;	/* Maximum resident set size in kilobytes */
+  off_t			bytes_read,	/* Octets read or -1 if unknown */
+			bytes_written;	/* Octets written or -1 if unknown */
+} cupsd_jobstats_t;
+
+typedef struct cupsd_jobconv_s		/**** Document filtered ahead of time ****/
+{
+  int			doc,		/* Document number */
+			cost,		/* Filtering cost */
+			status;		/* Exit status of first failed filter */
+  int			filters[MAX_FILTERS + 1];
+					/* Filter process IDs, 0 terminated */
+  char			filename[1024],	/* Filtered document file */
+			final_content_type[1024];
+					/* FINAL_CONTENT_TYPE env variable */
+} cupsd_jobconv_t;
+
+typedef struct cupsd_worker_s		/**** Filter started ahead of time ****/
+{
+  char			*printer,	/* Printer name */
+			*command;	/* Filter program */
+  int			pid,		/* Process ID */
+			fd;		/* Control socket */
+} cupsd_worker_t;
+
 struct cupsd_job_s			/**** Job request ****/
 {
   int			id,		/* Job ID */
@@ -84,6 +129,16 @@ struct cupsd_job_s			/**** Job request ****/
   int			progress;	/* Printing progress */
   int			num_keywords;	/* Number of PPD keywords */
   cups_option_t		*keywords;	/* PPD keywords */
+  cupsd_timer_t		timer;		/* Cancel/kill/hold deadline timer */
+  cupsd_jobq_t		*queue;		/* Pending queue, if any */
+  cupsd_jobcount_t	*dest_count,	/* Active jobs for destination */
+			*user_count;	/* Active jobs for user */
+  cupsd_job_t		*lru_prev,	/* Previous (more recent) loaded job */
+			*lru_next;	/* Next (less recent) loaded job */
+  size_t		lru_size;	/* Size of attributes, if in LRU */
+  int			streaming,	/* Document still being received, 0 if none */
+			stream_fds[2];	/* Document file and pipe for streaming */
+  cups_array_t		*conversions;	/* Documents filtered ahead of time */
 };
 
 typedef struct cupsd_joblog_s		/**** Job log message ****/
@@ -109,6 +164,8 @@ VAR int			MaxJobs		VALUE(0),
 					/* Max number of active jobs */
 			MaxHoldTime	VALUE(0),
 					/* Max time for indefinite hold */
+			MaxJobHistoryMemory VALUE(4 * 1024 * 1024),
+					/* Max size of loaded job history */
 			MaxJobsPerUser	VALUE(0),
 					/* Max jobs per user */
 			MaxJobsPerPrinter VALUE(0),
@@ -138,6 +195,8 @@ VAR int			JobKillDelay	VALUE(DEFAULT_TIMEOUT),
  */
 
 extern cupsd_job_t	*cupsdAddJob(int priority, const char *dest);
+extern void		cupsdAddJobStats(cupsd_job_t *job,
+			                 const cupsd_jobstats_t *stats);
 extern void		cupsdCancelJobs(const char *dest, const char *username,
 			                int purge);
 extern void		cupsdCheckJobs(void);
@@ -146,6 +205,9 @@ extern void		cupsdContinueJob(cupsd_job_t *job);
 extern void		cupsdDeleteJob(cupsd_job_t *job,
 			               cupsd_jobaction_t action);
 extern cupsd_job_t	*cupsdFindJob(int id);
+extern int		cupsdFinishJobConversion(cupsd_job_t *job, int pid,
+			                         int status,
+						 const cupsd_jobstats_t *stats);
 extern void		cupsdFreeAllJobs(void);
 extern cups_array_t	*cupsdGetCompletedJobs(cupsd_printer_t *p);
 extern int		cupsdGetPrinterJobCount(const char *dest);
@@ -166,8 +228,14 @@ extern void		cupsdSetJobState(cupsd_job_t *job,
 					 const char *message, ...)
 					__attribute__((__format__(__printf__,
 					                          4, 5)));
+extern void		cupsdStartFilterWorkers(cupsd_printer_t *p);
 extern void		cupsdStopAllJobs(cupsd_jobaction_t action,
 			                 int kill_delay);
+extern void		cupsdStopFilterWorkers(cupsd_printer_t *p);
 extern int		cupsdTimeoutJob(cupsd_job_t *job);
 extern void		cupsdUnloadCompletedJobs(void);
+extern void		cupsdUpdateJobCounts(cupsd_job_t *job);
+extern void		cupsdUpdateJobQueue(cupsd_job_t *job);
+extern void		cupsdUpdateJobStream(cupsd_job_t *job);
 extern void		cupsdUpdateJobs(void);
+extern void		cupsdUpdateJobTimer(cupsd_job_t *job);
@@ -156,7 +156,7 @@ cupsdStartListening(void)
       * Create a socket for listening...
       */
 
-      lis->fd = httpAddrListen(&(lis->address), p);
+      lis->fd = _httpAddrListen(&(lis->address), p, SOMAXCONN);
 
       if (lis->fd == -1)
       {
@@ -181,6 +181,13 @@ cupsdStartListening(void)
       }
     }
 
+   /*
+    * Don't block in accept() once all pending connections have been
+    * accepted...
+    */
+
+    fcntl(lis->fd, F_SETFL, fcntl(lis->fd, F_GETFL) | O_NONBLOCK);
+
     if (p)
       cupsdLogMessage(CUPSD_LOG_INFO, "Listening to %s:%d on fd %d...",
         	      s, p, lis->fd);
@@ -72,6 +72,10 @@ static long		select_timeout(int fds);
 static void		service_checkin(void);
 static void		service_checkout(int shutdown);
 static void		usage(int status) _CUPS_NORETURN;
+#ifdef HAVE_WAIT4
+static int		wait_child(int *status, struct rusage *usage,
+			           off_t *bytes_read, off_t *bytes_written);
+#endif /* HAVE_WAIT4 */
 
 
 /*
@@ -114,7 +118,6 @@ main(int  argc,				/* I - Number of command-line args */
   cupsd_job_t		*job;		/* Current job */
   cupsd_listener_t	*lis;		/* Current listener */
   time_t		current_time,	/* Current time */
-			activity,	/* Client activity timer */
 			senddoc_time,	/* Send-Document time */
 			expire_time,	/* Subscription expire time */
 			report_time,	/* Malloc/client/job report time */
@@ -1030,36 +1033,22 @@ main(int  argc,				/* I - Number of command-line args */
     }
 
    /*
-    * Check for new data on the client sockets...
+    * Process pending data in the client input buffers...
     */
 
     for (con = (cupsd_client_t *)cupsArrayFirst(Clients);
 	 con;
 	 con = (cupsd_client_t *)cupsArrayNext(Clients))
     {
-     /*
-      * Process pending data in the input buffer...
-      */
-
       if (httpGetReady(con->http))
-      {
         cupsdReadClient(con);
-	continue;
-      }
-
-     /*
-      * Check the activity and close old clients...
-      */
+    }
 
-      activity = current_time - Timeout;
-      if (httpGetActivity(con->http) < activity && !con->pipe_pid)
-      {
-        cupsdLogMessage(CUPSD_LOG_DEBUG, "Closing client %d after %d seconds of inactivity.", con->number, Timeout);
+   /*
+    * Handle expired client and job deadlines...
+    */
 
-        cupsdCloseClient(con);
-        continue;
-      }
-    }
+    cupsdRunTimers(current_time);
 
    /*
     * Log statistics at most once a minute when in debug mode...
@@ -1069,7 +1058,11 @@ main(int  argc,				/* I - Number of command-line args */
     {
       size_t		string_count,	/* String count */
 			alloc_bytes,	/* Allocated string bytes */
-			total_bytes;	/* Total string bytes */
+			total_bytes,	/* Total string bytes */
+			shard_strings,	/* Unique strings in shard */
+			shard_buckets,	/* Hash buckets in shard */
+			shard_chain;	/* Longest hash chain in shard */
+      int		shard;		/* String pool shard */
 #ifdef HAVE_MALLINFO
       struct mallinfo	mem;		/* Malloc information */
 
@@ -1102,6 +1095,14 @@ main(int  argc,				/* I - Number of command-line args */
                       "Report: stringpool-total-bytes=" CUPS_LLFMT,
 		      CUPS_LLCAST total_bytes);
 
+      for (shard = 0; shard < _CUPS_SP_SHARDS; shard ++)
+      {
+        string_count = _cupsStrShardStatistics(shard, &shard_strings, &shard_buckets, &shard_chain);
+        cupsdLogMessage(CUPSD_LOG_DEBUG,
+                        "Report: stringpool-shard-%d=" CUPS_LLFMT " references, " CUPS_LLFMT " strings, " CUPS_LLFMT " buckets, " CUPS_LLFMT " max-chain",
+                        shard, CUPS_LLCAST string_count, CUPS_LLCAST shard_strings, CUPS_LLCAST shard_buckets, CUPS_LLCAST shard_chain);
+      }
+
       report_time = current_time;
     }
 
@@ -1403,6 +1404,12 @@ process_children(void)
   int		i;			/* Looping var */
   char		name[1024];		/* Process name */
   const char	*type;			/* Type of program */
+  struct timeval start,			/* Time the process started */
+		now;			/* Current time */
+  cupsd_jobstats_t stats;		/* Resource usage */
+#ifdef HAVE_WAIT4
+  struct rusage	usage;			/* Resource usage from wait4() */
+#endif /* HAVE_WAIT4 */
 
 
   cupsdLogMessage(CUPSD_LOG_DEBUG2, "process_children()");
@@ -1417,7 +1424,12 @@ process_children(void)
   * Collect the exit status of some children...
   */
 
-#ifdef HAVE_WAITPID
+  memset(&stats, 0, sizeof(stats));
+
+#ifdef HAVE_WAIT4
+  while ((pid = wait_child(&status, &usage, &stats.bytes_read,
+                           &stats.bytes_written)) > 0)
+#elif defined(HAVE_WAITPID)
   while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
 #elif defined(HAVE_WAIT3)
   while ((pid = wait3(&status, WNOHANG, NULL)) > 0)
@@ -1429,7 +1441,7 @@ process_children(void)
     * Collect the name of the process that finished...
     */
 
-    cupsdFinishProcess(pid, name, sizeof(name), &job_id);
+    cupsdFinishProcess(pid, name, sizeof(name), &job_id, &start);
 
    /*
     * Delete certificates for CGI processes...
@@ -1438,6 +1450,31 @@ process_children(void)
     if (pid)
       cupsdDeleteCert(pid);
 
+   /*
+    * Collect the resources it used...
+    */
+
+    gettimeofday(&now, NULL);
+
+    stats.name      = name;
+    stats.wall_time = timerisset(&start) ?
+			  (long)((now.tv_sec - start.tv_sec) * 1000 +
+				 (now.tv_usec - start.tv_usec) / 1000) : 0;
+#ifdef HAVE_WAIT4
+    stats.user_time   = (long)(usage.ru_utime.tv_sec * 1000 +
+			       usage.ru_utime.tv_usec / 1000);
+    stats.system_time = (long)(usage.ru_stime.tv_sec * 1000 +
+			       usage.ru_stime.tv_usec / 1000);
+#  ifdef __APPLE__
+    stats.max_rss     = usage.ru_maxrss / 1024;
+#  else
+    stats.max_rss     = usage.ru_maxrss;
+#  endif /* __APPLE__ */
+#else
+    stats.bytes_read    = -1;
+    stats.bytes_written = -1;
+#endif /* HAVE_WAIT4 */
+
    /*
     * Handle completed job filters...
     */
@@ -1470,6 +1507,11 @@ process_children(void)
 	  type         = "Backend";
 	}
 
+	stats.backend = !job->filters[i];
+	stats.doc     = job->current_file;
+
+	cupsdAddJobStats(job, &stats);
+
 	if (status && status != SIGTERM && status != SIGKILL &&
 	    status != SIGPIPE)
 	{
@@ -1556,7 +1598,10 @@ process_children(void)
 	  for (i = 0; job->filters[i] < 0; i++);
 
 	  if (!job->filters[i] && job->backend <= 0)
+	  {
 	    cupsArrayRemove(ActiveJobs, job);
+	    cupsdUpdateJobCounts(job);
+	  }
 	}
 	else if (job->current_file < job->num_files && job->printer)
 	{
@@ -1574,6 +1619,17 @@ process_children(void)
 	  }
 	}
       }
+      else
+      {
+       /*
+        * See if this is a filter for a document being filtered ahead of
+	* time...
+	*/
+
+	stats.backend = 0;
+
+	cupsdFinishJobConversion(job, pid, status, &stats);
+      }
     }
 
    /*
@@ -1640,9 +1696,10 @@ select_timeout(int fds)			/* I - Number of descriptors returned */
 {
   long			timeout;	/* Timeout for select */
   time_t		now;		/* Current time */
+  time_t		deadline;	/* Next client/job deadline */
   cupsd_client_t	*con;		/* Client information */
-  cupsd_job_t		*job;		/* Job information */
-  const char		*why;		/* Debugging aid */
+  const char		*why,		/* Debugging aid */
+			*deadline_why;	/* Reason for next deadline */
 
 
   cupsdLogMessage(CUPSD_LOG_DEBUG2, "select_timeout: JobHistoryUpdate=%ld",
@@ -1704,17 +1761,14 @@ select_timeout(int fds)			/* I - Number of descriptors returned */
   }
 
  /*
-  * Check the activity and close old clients...
+  * Check the client and job deadlines...
   */
 
-  for (con = (cupsd_client_t *)cupsArrayFirst(Clients);
-       con;
-       con = (cupsd_client_t *)cupsArrayNext(Clients))
-    if ((httpGetActivity(con->http) + Timeout) < timeout)
-    {
-      timeout = httpGetActivity(con->http) + Timeout;
-      why     = "timeout a client connection";
-    }
+  if ((deadline = cupsdNextTimer(&deadline_why)) != 0 && deadline < timeout)
+  {
+    timeout = deadline;
+    why     = deadline_why;
+  }
 
  /*
   * Write out changes to configuration and state files...
@@ -1727,44 +1781,15 @@ select_timeout(int fds)			/* I - Number of descriptors returned */
   }
 
  /*
-  * Check for any job activity...
+  * Check for any job history activity...
   */
+
   if (JobHistoryUpdate && timeout > JobHistoryUpdate)
   {
     timeout = JobHistoryUpdate;
     why     = "update job history";
   }
 
-  for (job = (cupsd_job_t *)cupsArrayFirst(ActiveJobs);
-       job;
-       job = (cupsd_job_t *)cupsArrayNext(ActiveJobs))
-  {
-    if (job->cancel_time && job->cancel_time < timeout)
-    {
-      timeout = job->cancel_time;
-      why     = "cancel stuck jobs";
-    }
-
-    if (job->kill_time && job->kill_time < timeout)
-    {
-      timeout = job->kill_time;
-      why     = "kill unresponsive jobs";
-    }
-
-    if (job->state_value == IPP_JOB_HELD && job->hold_until < timeout)
-    {
-      timeout = job->hold_until;
-      why     = "release held jobs";
-    }
-
-    if (job->state_value == IPP_JOB_PENDING && timeout > (now + 10))
-    {
-      timeout = now + 10;
-      why     = "start pending jobs";
-      break;
-    }
-  }
-
  /*
   * Adjust from absolute to relative time.  We add 1 second to the timeout since
   * events occur after the timeout expires, and limit the timeout to 86400
@@ -2151,3 +2176,64 @@ usage(int status)			/* O - Exit status */
 
   exit(status);
 }
+
+
+#ifdef HAVE_WAIT4
+/*
+ * 'wait_child()' - Collect the exit status and resource usage of a child.
+ *
+ * On Linux the child is left as a zombie until its I/O counters have been
+ * read from /proc.
+ */
+
+static int				/* O - Process ID, 0 if none, -1 on error */
+wait_child(int           *status,	/* O - Exit status */
+           struct rusage *usage,	/* O - Resource usage */
+           off_t         *bytes_read,	/* O - Octets read or -1 */
+           off_t         *bytes_written)/* O - Octets written or -1 */
+{
+#  ifdef __linux__
+  siginfo_t	info;			/* Information about child */
+  int		fd;			/* /proc/<pid>/io file */
+  ssize_t	bytes;			/* Bytes read */
+  char		filename[64],		/* /proc/<pid>/io filename */
+		buffer[1024],		/* I/O counters */
+		*ptr;			/* Pointer into counters */
+#  endif /* __linux__ */
+
+
+  *bytes_read    = -1;
+  *bytes_written = -1;
+
+#  ifdef __linux__
+  memset(&info, 0, sizeof(info));
+
+  if (waitid(P_ALL, 0, &info, WEXITED | WNOHANG | WNOWAIT))
+    return (-1);
+  else if (info.si_pid <= 0)
+    return (0);
+
+  snprintf(filename, sizeof(filename), "/proc/%d/io", (int)info.si_pid);
+
+  if ((fd = open(filename, O_RDONLY | O_CLOEXEC)) >= 0)
+  {
+    if ((bytes = read(fd, buffer, sizeof(buffer) - 1)) > 0)
+    {
+      buffer[bytes] = '\0';
+
+      if ((ptr = strstr(buffer, "rchar: ")) != NULL)
+        *bytes_read = (off_t)strtoll(ptr + 7, NULL, 10);
+      if ((ptr = strstr(buffer, "wchar: ")) != NULL)
+        *bytes_written = (off_t)strtoll(ptr + 7, NULL, 10);
+    }
+
+    close(fd);
+  }
+
+  return (wait4(info.si_pid, status, WNOHANG, usage));
+
+#  else
+  return (wait4(-1, status, WNOHANG, usage));
+#  endif /* __linux__ */
+}
+#endif /* HAVE_WAIT4 */
@@ -27,6 +27,8 @@ extern "C" {
  */
 
 extern void	_mimeError(mime_t *mime, const char *format, ...) _CUPS_FORMAT(2, 3);
+extern void	_mimeFlushChains(mime_t *mime);
+extern void	_mimeFlushMagic(mime_t *mime);
 
 
 #  ifdef __cplusplus
@@ -88,6 +88,9 @@ mimeDelete(mime_t *mime)		/* I - MIME database */
   * Free the types and filters arrays, and then the MIME database structure.
   */
 
+  _mimeFlushChains(mime);
+  _mimeFlushMagic(mime);
+
   cupsArrayDelete(mime->types);
   cupsArrayDelete(mime->filters);
   cupsArrayDelete(mime->srcs);
@@ -124,8 +127,8 @@ mimeDeleteFilter(mime_t        *mime,	/* I - MIME database */
   free(filter);
 
  /*
-  * Deleting a filter invalidates the source lookup cache used by
-  * mimeFilter()...
+  * Deleting a filter invalidates the source lookup and filter chain caches
+  * used by mimeFilter()...
   */
 
   if (mime->srcs)
@@ -134,6 +137,8 @@ mimeDeleteFilter(mime_t        *mime,	/* I - MIME database */
     cupsArrayDelete(mime->srcs);
     mime->srcs = NULL;
   }
+
+  _mimeFlushChains(mime);
 }
 
 
@@ -158,6 +163,9 @@ mimeDeleteType(mime_t      *mime,	/* I - MIME database */
 
   cupsArrayRemove(mime->types, mt);
 
+  _mimeFlushChains(mime);
+  _mimeFlushMagic(mime);
+
   mime_delete_rules(mt->rules);
   free(mt);
 }
@@ -68,6 +68,7 @@ typedef struct _mime_magic_s		/**** MIME Magic Data ****/
   int		offset,			/* Offset in file */
 		region,			/* Region length */
 		length;			/* Length of data */
+  int		index;			/* Compiled CONTAINS rule number + 1 */
   union
   {
     char	matchv[64];		/* Match value */
@@ -83,6 +84,7 @@ typedef struct _mime_magic_s		/**** MIME Magic Data ****/
 typedef struct _mime_type_s		/**** MIME Type Data ****/
 {
   mime_magic_t	*rules;			/* Rules used to detect this type */
+  struct _mime_s *mime;			/* Database containing this type */
   int		priority;		/* Priority of this type */
   char		super[MIME_MAX_SUPER],	/* Super-type name ("image", "application", etc.) */
 		type[MIME_MAX_TYPE];	/* Type name ("png", "postscript", etc.) */
@@ -104,6 +106,10 @@ typedef struct _mime_s			/**** MIME Database ****/
   cups_array_t		*types;		/* File types */
   cups_array_t		*filters;	/* Type conversion filters */
   cups_array_t		*srcs;		/* Filters sorted by source type */
+  cups_array_t		*chains;	/* Cache of filter chains */
+  size_t		*maxsizes;	/* Sorted filter maxsize values */
+  int			num_maxsizes;	/* Number of maxsize values */
+  struct _mime_magicdb_s *magic;	/* Compiled type rules */
   mime_error_cb_t	error_cb;	/* Error message callback */
   void			*error_ctx;	/* Pointer for callback */
 } mime_t;
@@ -34,6 +34,14 @@
 #endif /* __APPLE__ */
 
 
+/*
+ * Local globals...
+ */
+
+static _cups_rwlock_t	printers_lock = _CUPS_RWLOCK_INITIALIZER;
+					/* Lock for changes to Printers array */
+
+
 /*
  * Local functions...
  */
@@ -80,6 +88,7 @@ cupsdAddPrinter(const char *name)	/* I - Name of printer */
   }
 
   _cupsRWInit(&p->lock);
+  _cupsMutexInit(&p->cache_lock);
 
   cupsdSetString(&p->name, name);
   cupsdSetString(&p->info, name);
@@ -111,13 +120,18 @@ cupsdAddPrinter(const char *name)	/* I - Name of printer */
   * Insert the printer in the printer list alphabetically...
   */
 
+  cupsdLogMessage(CUPSD_LOG_DEBUG2,
+                  "cupsdAddPrinter: Adding %s to Printers", p->name);
+
+  _cupsRWLockWrite(&printers_lock);
+
   if (!Printers)
     Printers = cupsArrayNew(compare_printers, NULL);
 
-  cupsdLogMessage(CUPSD_LOG_DEBUG2,
-                  "cupsdAddPrinter: Adding %s to Printers", p->name);
   cupsArrayAdd(Printers, p);
 
+  _cupsRWUnlock(&printers_lock);
+
  /*
   * Return the new printer...
   */
@@ -126,6 +140,54 @@ cupsdAddPrinter(const char *name)	/* I - Name of printer */
 }
 
 
+/*
+ * 'cupsdClearAttrCache()' - Clear cached Get-Printer-Attributes blocks.
+ *
+ * Passing NULL clears the cache for all printers and classes.
+ */
+
+void
+cupsdClearAttrCache(cupsd_printer_t *p)	/* I - Printer or NULL for all */
+{
+  int			i,		/* Looping var */
+			count;		/* Number of printers */
+  cupsd_attrcache_t	*cache;		/* Current cache entry */
+
+
+  if (!p)
+  {
+   /*
+    * Walk by index since this can be called from a background thread while
+    * the main thread is using the Printers array's current element...
+    */
+
+    _cupsRWLockRead(&printers_lock);
+
+    for (i = 0, count = cupsArrayCount(Printers); i < count; i ++)
+      cupsdClearAttrCache((cupsd_printer_t *)cupsArrayIndex(Printers, i));
+
+    _cupsRWUnlock(&printers_lock);
+    return;
+  }
+
+  _cupsMutexLock(&p->cache_lock);
+
+  for (cache = (cupsd_attrcache_t *)cupsArrayFirst(p->attr_cache);
+       cache;
+       cache = (cupsd_attrcache_t *)cupsArrayNext(p->attr_cache))
+  {
+    free(cache->key);
+    ippDelete(cache->attrs);
+    free(cache);
+  }
+
+  cupsArrayDelete(p->attr_cache);
+  p->attr_cache = NULL;
+
+  _cupsMutexUnlock(&p->cache_lock);
+}
+
+
 /*
  * 'cupsdCreateCommonData()' - Create the common printer data.
  */
@@ -390,7 +452,10 @@ cupsdCreateCommonData(void)
 
 
   if (CommonData)
+  {
+    cupsdClearAttrCache(NULL);
     ippDelete(CommonData);
+  }
 
   CommonData = ippNew();
 
@@ -726,6 +791,7 @@ cupsdDeletePrinter(
 {
   int	i,				/* Looping var */
 	changed = 0;			/* Class changed? */
+  cupsd_filterstats_t *stats;		/* Current filter statistics */
 
 
   cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdDeletePrinter(p=%p(%s), update=%d)",
@@ -750,13 +816,29 @@ cupsdDeletePrinter(
                      update ? "Job stopped due to printer being deleted." :
 		              "Job stopped.");
 
+ /*
+  * Stop any filters that were started ahead of time...
+  */
+
+  cupsdStopFilterWorkers(p);
+
+ /*
+  * Responses that worker threads are completing must not use the printer's
+  * cache lock after it is freed...
+  */
+
+  cupsdClearIPPWork(p);
+
  /*
   * Remove the printer from the list...
   */
 
   cupsdLogMessage(CUPSD_LOG_DEBUG2,
                   "cupsdDeletePrinter: Removing %s from Printers", p->name);
+
+  _cupsRWLockWrite(&printers_lock);
   cupsArrayRemove(Printers, p);
+  _cupsRWUnlock(&printers_lock);
 
  /*
   * If p is the default printer, assign a different one...
@@ -820,6 +902,8 @@ cupsdDeletePrinter(
   for (i = 0; i < p->num_reasons; i ++)
     _cupsStrFree(p->reasons[i]);
 
+  cupsdClearAttrCache(p);
+
   ippDelete(p->attrs);
   ippDelete(p->ppd_attrs);
 
@@ -831,6 +915,13 @@ cupsdDeletePrinter(
   cupsdFreeStrings(&(p->users));
   cupsdFreeQuotas(p);
 
+  for (stats = (cupsd_filterstats_t *)cupsArrayFirst(p->filter_stats);
+       stats;
+       stats = (cupsd_filterstats_t *)cupsArrayNext(p->filter_stats))
+    free(stats);
+
+  cupsArrayDelete(p->filter_stats);
+
   cupsdClearString(&p->uuid);
   cupsdClearString(&p->uri);
   cupsdClearString(&p->hostname);
@@ -1464,7 +1555,10 @@ cupsdRenamePrinter(
 
   cupsdLogMessage(CUPSD_LOG_DEBUG2,
                   "cupsdRenamePrinter: Removing %s from Printers", p->name);
+
+  _cupsRWLockWrite(&printers_lock);
   cupsArrayRemove(Printers, p);
+  _cupsRWUnlock(&printers_lock);
 
  /*
   * Rename the printer type...
@@ -1497,7 +1591,10 @@ cupsdRenamePrinter(
 
   cupsdLogMessage(CUPSD_LOG_DEBUG2,
                   "cupsdRenamePrinter: Adding %s to Printers", p->name);
+
+  _cupsRWLockWrite(&printers_lock);
   cupsArrayAdd(Printers, p);
+  _cupsRWUnlock(&printers_lock);
 }
 
 
@@ -2050,6 +2147,8 @@ cupsdSetPrinterAttr(
     return;
   }
 
+  cupsdClearAttrCache(p);
+
  /*
   * Copy the value string so we can do what we want with it...
   */
@@ -2621,6 +2720,41 @@ cupsdSetPrinterAttrs(cupsd_printer_t *p)/* I - Printer to setup */
 
   add_printer_defaults(p);
 
+ /*
+  * Clear cached Get-Printer-Attributes data for this printer and any classes
+  * that report it in member-uris...
+  */
+
+  cupsdClearAttrCache(p);
+
+  if (!(p->type & CUPS_PRINTER_CLASS))
+  {
+    int			j,		/* Looping var */
+			count;		/* Number of printers */
+    cupsd_printer_t	*c;		/* Current class */
+
+   /*
+    * Walk by index since create_local_bg_thread() calls us from a background
+    * thread...
+    */
+
+    _cupsRWLockRead(&printers_lock);
+
+    for (j = 0, count = cupsArrayCount(Printers); j < count; j ++)
+    {
+      c = (cupsd_printer_t *)cupsArrayIndex(Printers, j);
+
+      for (i = 0; i < c->num_printers; i ++)
+        if (c->printers[i] == p)
+	{
+	  cupsdClearAttrCache(c);
+	  break;
+	}
+    }
+
+    _cupsRWUnlock(&printers_lock);
+  }
+
   _cupsRWUnlock(&p->lock);
 
  /*
@@ -3854,6 +3988,8 @@ delete_printer_filters(
 static void
 dirty_printer(cupsd_printer_t *p)	/* I - Printer */
 {
+  cupsdClearAttrCache(p);
+
   if (p->type & CUPS_PRINTER_CLASS)
     cupsdMarkDirty(CUPSD_DIRTY_CLASSES);
   else
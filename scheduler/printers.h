@@ -23,15 +23,58 @@
  * Quota data...
  */
 
+#define CUPSD_QUOTA_BUCKETS	32	/* Number of time slices per quota */
+
+typedef struct
+{
+  time_t	start;			/* Start of time slice */
+  int		page_count,		/* Count of pages */
+		k_count;		/* Count of kilobytes */
+} cupsd_quotabucket_t;
+
 typedef struct
 {
   char		username[33];		/* User data */
-  time_t	next_update;		/* Next update time */
   int		page_count,		/* Count of pages */
 		k_count;		/* Count of kilobytes */
+  cupsd_quotabucket_t buckets[CUPSD_QUOTA_BUCKETS];
+					/* Counts for each time slice */
 } cupsd_quota_t;
 
 
+/*
+ * Filter and backend resource usage...
+ */
+
+#define CUPSD_FILTERSTATS_BUCKETS 20	/* Number of wall time buckets */
+
+typedef struct
+{
+  char		name[256];		/* Filter or backend name */
+  int		count;			/* Number of runs */
+  long long	user_time,		/* Total user CPU time in milliseconds */
+		system_time,		/* Total system CPU time in milliseconds */
+		wall_time;		/* Total wall clock time in milliseconds */
+  long		max_rss;		/* Largest resident set size in kilobytes */
+  int		wall_times[CUPSD_FILTERSTATS_BUCKETS];
+					/* Runs by wall time, powers of 2 ms */
+} cupsd_filterstats_t;
+
+
+/*
+ * Cached Get-Printer-Attributes data...
+ */
+
+#define CUPSD_ATTRCACHE_MAX	8	/* Maximum cached blocks per printer */
+
+typedef struct
+{
+  char		*key;			/* Scheme, host, port, version, and
+					 * requested attributes */
+  ipp_t		*attrs;			/* Static printer attributes */
+} cupsd_attrcache_t;
+
+
 /*
  * DNS-SD types to make the code cleaner/clearer...
  */
@@ -55,6 +98,8 @@ typedef struct cupsd_job_s cupsd_job_t;
 struct cupsd_printer_s
 {
   _cups_rwlock_t lock;			/* Concurrency lock for background updates */
+  _cups_mutex_t	cache_lock;		/* Lock for attribute cache */
+  cups_array_t	*attr_cache;		/* Cached attribute blocks, most recent first */
   int		printer_id;		/* Printer ID */
   char		*uri,			/* Printer URI */
 		*uuid,			/* Printer UUID */
@@ -113,6 +158,7 @@ struct cupsd_printer_s
 		*alert_description;	/* PSX printer-alert-description value */
   time_t	marker_time;		/* Last time marker attributes were updated */
   _ppd_cache_t	*pc;			/* PPD cache and mapping data */
+  cups_array_t	*filter_stats;		/* Filter and backend resource usage */
 
 #ifdef HAVE_DNSSD
   char		*reg_name,		/* Name used for service registration */
@@ -154,6 +200,8 @@ VAR cupsd_policy_t	*DefaultPolicyPtr
  */
 
 extern cupsd_printer_t	*cupsdAddPrinter(const char *name);
+extern void		cupsdClearAttrCache(cupsd_printer_t *p);
+extern void		cupsdClearIPPWork(cupsd_printer_t *p);
 extern void		cupsdCreateCommonData(void);
 extern void		cupsdDeleteAllPrinters(void);
 extern int		cupsdDeletePrinter(cupsd_printer_t *p, int update);
@@ -167,6 +215,7 @@ extern void		cupsdLoadAllPrinters(void);
 extern void		cupsdRenamePrinter(cupsd_printer_t *p,
 			                   const char *name);
 extern void		cupsdSaveAllPrinters(void);
+extern void		cupsdSaveQuotas(void);
 extern int		cupsdSetAuthInfoRequired(cupsd_printer_t *p,
 			                         const char *values,
 						 ipp_attribute_t *attr);
@@ -44,6 +44,7 @@ typedef struct
 {
   int	pid,				/* Process ID */
 	job_id;				/* Job associated with process */
+  struct timeval start;			/* Time process started its job */
   char	name[1];			/* Name of process */
 } cupsd_proc_t;
 
@@ -67,10 +68,14 @@ static char	*cupsd_requote(char *dst, const char *src, size_t dstsize);
 
 /*
  * 'cupsdCreateProfile()' - Create an execution profile for a subprocess.
+ *
+ * A job ID of -1 creates the profile for a filter that is started before
+ * its job is known; it gets neither the job file access of a job filter
+ * nor the exceptions for notifiers.
  */
 
 void *					/* O - Profile or NULL on error */
-cupsdCreateProfile(int job_id,		/* I - Job ID or 0 for none */
+cupsdCreateProfile(int job_id,		/* I - Job ID, 0 for none, or -1 for a filter */
                    int allow_networking)/* I - Allow networking off machine? */
 {
 #ifdef HAVE_SANDBOX_H
@@ -292,7 +297,7 @@ cupsdCreateProfile(int job_id,		/* I - Job ID or 0 for none */
 		   testroot);
     cupsFilePrintf(fp, "(allow sysctl*)\n");
   }
-  if (job_id)
+  if (job_id > 0)
   {
     /* Allow job filters to read the current job files... */
     cupsFilePrintf(fp,
@@ -300,7 +305,7 @@ cupsdCreateProfile(int job_id,		/* I - Job ID or 0 for none */
                    "       (regex #\"^%s/([ac]%05d|d%05d-[0-9][0-9][0-9])$\"))\n",
 		   request, job_id, job_id);
   }
-  else
+  else if (!job_id)
   {
     /* Allow email notifications from notifiers... */
     cupsFilePuts(fp,
@@ -419,10 +424,12 @@ cupsdEndProcess(int pid,		/* I - Process ID */
  */
 
 const char *				/* O - Process name */
-cupsdFinishProcess(int    pid,		/* I - Process ID */
-                   char   *name,	/* I - Name buffer */
-		   size_t namelen,	/* I - Size of name buffer */
-		   int    *job_id)	/* O - Job ID pointer or NULL */
+cupsdFinishProcess(
+    int            pid,			/* I - Process ID */
+    char           *name,		/* I - Name buffer */
+    size_t         namelen,		/* I - Size of name buffer */
+    int            *job_id,		/* O - Job ID pointer or NULL */
+    struct timeval *start)		/* O - Start time pointer or NULL */
 {
   cupsd_proc_t	key,			/* Search key */
 		*proc;			/* Matching process */
@@ -435,6 +442,9 @@ cupsdFinishProcess(int    pid,		/* I - Process ID */
     if (job_id)
       *job_id = proc->job_id;
 
+    if (start)
+      *start = proc->start;
+
     strlcpy(name, proc->name, namelen);
     cupsArrayRemove(process_array, proc);
     free(proc);
@@ -444,6 +454,9 @@ cupsdFinishProcess(int    pid,		/* I - Process ID */
     if (job_id)
       *job_id = 0;
 
+    if (start)
+      timerclear(start);
+
     strlcpy(name, "unknown", namelen);
   }
 
@@ -453,8 +466,39 @@ cupsdFinishProcess(int    pid,		/* I - Process ID */
 }
 
 
+/*
+ * 'cupsdSetProcessJob()' - Associate a running process with a job.
+ *
+ * The process start time is reset so that resource accounting for a
+ * pre-started filter covers the job and not the time spent waiting for it.
+ */
+
+void
+cupsdSetProcessJob(int         pid,	/* I - Process ID */
+                   cupsd_job_t *job)	/* I - Job or NULL for none */
+{
+  cupsd_proc_t	key,			/* Search key */
+		*proc;			/* Matching process */
+
+
+  key.pid = pid;
+
+  if ((proc = (cupsd_proc_t *)cupsArrayFind(process_array, &key)) != NULL)
+  {
+    proc->job_id = job ? job->id : 0;
+    gettimeofday(&proc->start, NULL);
+  }
+
+  cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdSetProcessJob(pid=%d, job=%p(%d))",
+                  pid, job, job ? job->id : 0);
+}
+
+
 /*
  * 'cupsdStartProcess()' - Start a process.
+ *
+ * The shared memory ring file descriptors for the standard input and output
+ * of a filter become file descriptors 5 and 6 in the new process.
  */
 
 int					/* O - Process ID or 0 */
@@ -467,6 +511,8 @@ cupsdStartProcess(
     int         errfd,			/* I - Standard error file descriptor */
     int         backfd,			/* I - Backchannel file descriptor */
     int         sidefd,			/* I - Sidechannel file descriptor */
+    int         inringfd,		/* I - Standard input ring file descriptor */
+    int         outringfd,		/* I - Standard output ring file descriptor */
     int         root,			/* I - Run as root? */
     void        *profile,		/* I - Security profile to use */
     cupsd_job_t *job,			/* I - Job associated with process */
@@ -637,6 +683,12 @@ cupsdStartProcess(
   if (sidefd != 4 && sidefd >= 0)
     posix_spawn_file_actions_adddup2(&actions, sidefd, 4);
 
+  if (inringfd >= 0)
+    posix_spawn_file_actions_adddup2(&actions, inringfd, 5);
+
+  if (outringfd >= 0)
+    posix_spawn_file_actions_adddup2(&actions, outringfd, 6);
+
   cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdStartProcess: Calling posix_spawn.");
 
   if (posix_spawn(pid, exec_path, &actions, &attrs, argv, envp ? envp : environ))
@@ -731,6 +783,16 @@ cupsdStartProcess(
       fcntl(4, F_SETFL, O_NDELAY);
     }
 
+    if (inringfd == 5)
+      fcntl(5, F_SETFD, 0);
+    else if (inringfd >= 0)
+      dup2(inringfd, 5);
+
+    if (outringfd == 6)
+      fcntl(6, F_SETFD, 0);
+    else if (outringfd >= 0)
+      dup2(outringfd, 6);
+
    /*
     * Change the priority of the process based on the FilterNice setting.
     * (this is not done for root processes...)
@@ -829,6 +891,7 @@ cupsdStartProcess(
       {
         proc->pid    = *pid;
 	proc->job_id = job ? job->id : 0;
+	gettimeofday(&proc->start, NULL);
 	_cups_strcpy(proc->name, command);
 
 	cupsArrayAdd(process_array, proc);
@@ -838,10 +901,12 @@ cupsdStartProcess(
 
   cupsdLogMessage(CUPSD_LOG_DEBUG2,
 		  "cupsdStartProcess(command=\"%s\", argv=%p, envp=%p, "
-		  "infd=%d, outfd=%d, errfd=%d, backfd=%d, sidefd=%d, root=%d, "
-		  "profile=%p, job=%p(%d), pid=%p) = %d",
+		  "infd=%d, outfd=%d, errfd=%d, backfd=%d, sidefd=%d, "
+		  "inringfd=%d, outringfd=%d, root=%d, profile=%p, job=%p(%d), "
+		  "pid=%p) = %d",
 		  command, argv, envp, infd, outfd, errfd, backfd, sidefd,
-		  root, profile, job, job ? job->id : 0, pid, *pid);
+		  inringfd, outringfd, root, profile, job, job ? job->id : 0,
+		  pid, *pid);
 
   return (*pid);
 }
@@ -14,13 +14,32 @@
 #include "cupsd.h"
 
 
+/*
+ * Local globals...
+ */
+
+static cups_file_t	*quota_journal = NULL;
+					/* quota.journal file */
+static int		quota_records = 0;
+					/* Number of records appended */
+
+
 /*
  * Local functions...
  */
 
 static cupsd_quota_t	*add_quota(cupsd_printer_t *p, const char *username);
+static void		add_usage(cupsd_printer_t *p, cupsd_quota_t *q,
+			          time_t t, int pages, int k);
 static int		compare_quotas(const cupsd_quota_t *q1,
 			               const cupsd_quota_t *q2);
+static void		expire_quota(cupsd_printer_t *p, cupsd_quota_t *q,
+			             time_t curtime);
+static void		load_quotas(cupsd_printer_t *p);
+static void		save_quotas(void);
+static void		seed_quotas(cupsd_printer_t *p);
+static void		write_quota(cupsd_printer_t *p, cupsd_quota_t *q,
+			            time_t t, int pages, int k);
 
 
 /*
@@ -40,6 +59,9 @@ cupsdFindQuota(
   if (!p || !username)
     return (NULL);
 
+  if (!p->quotas)
+    load_quotas(p);
+
   strlcpy(match.username, username, sizeof(match.username));
   if ((ptr = strchr(match.username, '@')) != NULL)
     *ptr = '\0';			/* Strip @domain/@KDC */
@@ -75,8 +97,39 @@ cupsdFreeQuotas(cupsd_printer_t *p)	/* I - Printer */
 }
 
 
+/*
+ * 'cupsdSaveQuotas()' - Flush the quota.journal file.
+ */
+
+void
+cupsdSaveQuotas(void)
+{
+  if (!quota_journal)
+  {
+   /*
+    * Write the usage that was taken from the job history...
+    */
+
+    save_quotas();
+    return;
+  }
+
+  if (cupsFileFlush(quota_journal))
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to write quota journal file: %s",
+                    strerror(errno));
+
+    save_quotas();
+  }
+}
+
+
 /*
  * 'cupsdUpdateQuota()' - Update quota data for the specified printer and user.
+ *
+ * Usage is kept in CUPSD_QUOTA_BUCKETS time slices covering the quota period
+ * and appended to the quota.journal file, so the job history never needs to
+ * be loaded to check a quota.
  */
 
 cupsd_quota_t *				/* O - Quota data */
@@ -87,9 +140,7 @@ cupsdUpdateQuota(
     int             k)			/* I - Number of kilobytes */
 {
   cupsd_quota_t		*q;		/* Quota data */
-  cupsd_job_t		*job;		/* Current job */
   time_t		curtime;	/* Current time */
-  ipp_attribute_t	*attr;		/* Job attribute */
 
 
   if (!p || !username)
@@ -107,73 +158,13 @@ cupsdUpdateQuota(
 
   curtime = time(NULL);
 
-  if (curtime < q->next_update)
+  if (pages || k)
   {
-    q->page_count += pages;
-    q->k_count    += k;
-
-    return (q);
+    write_quota(p, q, curtime, pages, k);
+    add_usage(p, q, curtime, pages, k);
   }
 
-  if (p->quota_period)
-    curtime -= p->quota_period;
-  else
-    curtime = 0;
-
-  q->next_update = 0;
-  q->page_count  = 0;
-  q->k_count     = 0;
-
-  for (job = (cupsd_job_t *)cupsArrayFirst(Jobs);
-       job;
-       job = (cupsd_job_t *)cupsArrayNext(Jobs))
-  {
-   /*
-    * We only care about the current printer/class and user...
-    */
-
-    if (_cups_strcasecmp(job->dest, p->name) != 0 ||
-        _cups_strcasecmp(job->username, q->username) != 0)
-      continue;
-
-   /*
-    * Make sure attributes are loaded; we always call cupsdLoadJob() to ensure
-    * the access_time member is updated so the job isn't unloaded right away...
-    */
-
-    if (!cupsdLoadJob(job))
-      continue;
-
-    if ((attr = ippFindAttribute(job->attrs, "time-at-completion",
-                                 IPP_TAG_INTEGER)) == NULL)
-      if ((attr = ippFindAttribute(job->attrs, "time-at-processing",
-                                   IPP_TAG_INTEGER)) == NULL)
-        attr = ippFindAttribute(job->attrs, "time-at-creation",
-                                IPP_TAG_INTEGER);
-
-    if (attr->values[0].integer < curtime)
-    {
-     /*
-      * This job is too old to count towards the quota, ignore it...
-      */
-
-      if (JobAutoPurge && !job->printer && job->state_value > IPP_JOB_STOPPED)
-        cupsdDeleteJob(job, CUPSD_JOB_PURGE);
-
-      continue;
-    }
-
-    if (q->next_update == 0)
-      q->next_update = attr->values[0].integer + p->quota_period;
-
-    if ((attr = ippFindAttribute(job->attrs, "job-media-sheets-completed",
-                                 IPP_TAG_INTEGER)) != NULL)
-      q->page_count += attr->values[0].integer;
-
-    if ((attr = ippFindAttribute(job->attrs, "job-k-octets",
-                                 IPP_TAG_INTEGER)) != NULL)
-      q->k_count += attr->values[0].integer;
-  }
+  expire_quota(p, q, curtime);
 
   return (q);
 }
@@ -213,6 +204,63 @@ add_quota(cupsd_printer_t *p,		/* I - Printer */
 }
 
 
+/*
+ * 'add_usage()' - Add usage to the time slice for the given time.
+ */
+
+static void
+add_usage(cupsd_printer_t *p,		/* I - Printer */
+          cupsd_quota_t   *q,		/* I - Quota data */
+          time_t          t,		/* I - Time of usage */
+          int             pages,	/* I - Number of pages */
+          int             k)		/* I - Number of kilobytes */
+{
+  cupsd_quotabucket_t	*b;		/* Time slice */
+  time_t		width,		/* Width of time slices */
+			start;		/* Start of time slice */
+
+
+  if (p->quota_period > 0)
+  {
+    width = (p->quota_period + CUPSD_QUOTA_BUCKETS - 1) / CUPSD_QUOTA_BUCKETS;
+    start = t - t % width;
+    b     = q->buckets + (t / width) % CUPSD_QUOTA_BUCKETS;
+
+    if (b->start > start)
+      return;				/* Older than the quota period */
+    else if (b->start < start)
+    {
+     /*
+      * Reuse an expired time slice...
+      */
+
+      q->page_count -= b->page_count;
+      q->k_count    -= b->k_count;
+
+      b->start      = start;
+      b->page_count = 0;
+      b->k_count    = 0;
+    }
+  }
+  else
+  {
+   /*
+    * No quota period, so everything is counted in the first slice...
+    */
+
+    b = q->buckets;
+
+    if (t > b->start)
+      b->start = t;
+  }
+
+  b->page_count += pages;
+  b->k_count    += k;
+  q->page_count += pages;
+  q->k_count    += k;
+}
+
+
 /*
  * 'compare_quotas()' - Compare two quota records...
  */
@@ -223,3 +271,302 @@ compare_quotas(const cupsd_quota_t *q1,	/* I - First quota record */
 {
   return (_cups_strcasecmp(q1->username, q2->username));
 }
+
+
+/*
+ * 'expire_quota()' - Remove usage that is older than the quota period.
+ */
+
+static void
+expire_quota(cupsd_printer_t *p,	/* I - Printer */
+             cupsd_quota_t   *q,	/* I - Quota data */
+	     time_t          curtime)	/* I - Current time */
+{
+  int			i;		/* Looping var */
+  cupsd_quotabucket_t	*b;		/* Current time slice */
+  time_t		width,		/* Width of time slices */
+			expire;		/* Expiration time */
+
+
+  if (p->quota_period <= 0)
+    return;
+
+  width  = (p->quota_period + CUPSD_QUOTA_BUCKETS - 1) / CUPSD_QUOTA_BUCKETS;
+  expire = curtime - p->quota_period;
+
+  for (i = CUPSD_QUOTA_BUCKETS, b = q->buckets; i > 0; i --, b ++)
+    if ((b->page_count || b->k_count) && (b->start + width) <= expire)
+    {
+      q->page_count -= b->page_count;
+      q->k_count    -= b->k_count;
+
+      b->page_count = 0;
+      b->k_count    = 0;
+    }
+}
+
+
+/*
+ * 'load_quotas()' - Load quota data for a printer from the quota.journal file.
+ */
+
+static void
+load_quotas(cupsd_printer_t *p)		/* I - Printer */
+{
+  cups_file_t	*fp;			/* quota.journal file */
+  char		filename[1024],		/* quota.journal filename */
+		line[1024],		/* Line from file */
+		name[256],		/* Printer name */
+		*username;		/* Username */
+  long		t;			/* Time of usage */
+  int		pages,			/* Number of pages */
+		k,			/* Number of kilobytes */
+		linenum;		/* Line number in file */
+  cupsd_quota_t	*q;			/* Quota data */
+  time_t	curtime;		/* Current time */
+
+
+  if (!p->quotas)
+    p->quotas = cupsArrayNew((cups_array_func_t)compare_quotas, NULL);
+
+  if (!p->quotas)
+    return;
+
+  snprintf(filename, sizeof(filename), "%s/quota.journal", CacheDir);
+  if ((fp = cupsFileOpen(filename, "r")) == NULL)
+  {
+    if (errno != ENOENT)
+      cupsdLogMessage(CUPSD_LOG_ERROR,
+		      "Unable to open quota journal file \"%s\": %s",
+		      filename, strerror(errno));
+    else
+      seed_quotas(p);
+
+    return;
+  }
+
+  cupsdLogMessage(CUPSD_LOG_DEBUG, "Loading quotas for %s from \"%s\"...",
+                  p->name, filename);
+
+  linenum = 0;
+
+  while (cupsFileGets(fp, line, sizeof(line)))
+  {
+    linenum ++;
+
+    if (line[0] == '#' || !line[0])
+      continue;
+
+   /*
+    * Each record is "time pages kbytes printer username"...
+    */
+
+    if (sscanf(line, "%ld%d%d%255s", &t, &pages, &k, name) != 4 ||
+        (username = strchr(line, ' ')) == NULL ||
+	(username = strchr(username + 1, ' ')) == NULL ||
+	(username = strchr(username + 1, ' ')) == NULL ||
+	(username = strchr(username + 1, ' ')) == NULL || !username[1])
+    {
+      cupsdLogMessage(CUPSD_LOG_ERROR,
+                      "Bad quota record on line %d of \"%s\".", linenum,
+		      filename);
+      continue;
+    }
+
+    if (_cups_strcasecmp(name, p->name))
+      continue;
+
+    if ((q = cupsdFindQuota(p, username + 1)) != NULL)
+      add_usage(p, q, (time_t)t, pages, k);
+  }
+
+  cupsFileClose(fp);
+
+  curtime = time(NULL);
+
+  for (q = (cupsd_quota_t *)cupsArrayFirst(p->quotas);
+       q;
+       q = (cupsd_quota_t *)cupsArrayNext(p->quotas))
+    expire_quota(p, q, curtime);
+}
+
+
+/*
+ * 'save_quotas()' - Write a new quota.journal file with the current usage.
+ */
+
+static void
+save_quotas(void)
+{
+  int			i;		/* Looping var */
+  cups_file_t		*fp;		/* quota.journal file */
+  char			filename[1024];	/* quota.journal filename */
+  cupsd_printer_t	*p;		/* Current printer */
+  cupsd_quota_t		*q;		/* Current quota data */
+  cupsd_quotabucket_t	*b;		/* Current time slice */
+  time_t		curtime;	/* Current time */
+
+
+  if (quota_journal)
+  {
+    cupsFileClose(quota_journal);
+    quota_journal = NULL;
+  }
+
+  snprintf(filename, sizeof(filename), "%s/quota.journal", CacheDir);
+  if ((fp = cupsdCreateConfFile(filename, ConfigFilePerm)) == NULL)
+    return;
+
+  cupsdLogMessage(CUPSD_LOG_INFO, "Saving quota.journal...");
+
+  cupsFilePuts(fp, "# Quota journal file for " CUPS_SVERSION "\n");
+  cupsFilePuts(fp, "# Written by cupsd\n");
+
+ /*
+  * Write the non-empty time slices for every printer with quotas...
+  */
+
+  curtime = time(NULL);
+
+  cupsArraySave(Printers);
+
+  for (p = (cupsd_printer_t *)cupsArrayFirst(Printers);
+       p;
+       p = (cupsd_printer_t *)cupsArrayNext(Printers))
+  {
+    if (!p->k_limit && !p->page_limit)
+      continue;
+
+    if (!p->quotas)
+      load_quotas(p);
+
+    for (q = (cupsd_quota_t *)cupsArrayFirst(p->quotas);
+	 q;
+	 q = (cupsd_quota_t *)cupsArrayNext(p->quotas))
+    {
+      expire_quota(p, q, curtime);
+
+      for (i = CUPSD_QUOTA_BUCKETS, b = q->buckets; i > 0; i --, b ++)
+	if (b->page_count || b->k_count)
+	  cupsFilePrintf(fp, "%ld %d %d %s %s\n", (long)b->start,
+			 b->page_count, b->k_count, p->name, q->username);
+    }
+  }
+
+  cupsArrayRestore(Printers);
+
+  if (cupsdCloseCreatedConfFile(fp, filename))
+    return;
+
+  quota_records = 0;
+
+  if ((quota_journal = cupsFileOpen(filename, "a")) == NULL)
+    cupsdLogMessage(CUPSD_LOG_ERROR,
+		    "Unable to open quota journal file \"%s\": %s", filename,
+		    strerror(errno));
+}
+
+
+/*
+ * 'seed_quotas()' - Compute the usage for a printer from the job history.
+ *
+ * This is only done when there is no quota.journal file yet, for example
+ * after upgrading from a version that did not keep one.
+ */
+
+static void
+seed_quotas(cupsd_printer_t *p)		/* I - Printer */
+{
+  int			i,		/* Looping var */
+			count,		/* Number of jobs */
+			pages,		/* Number of pages */
+			k;		/* Number of kilobytes */
+  cupsd_job_t		*job;		/* Current job */
+  cupsd_quota_t		*q;		/* Quota data */
+  ipp_attribute_t	*attr;		/* Job attribute */
+  time_t		t,		/* Time of usage */
+			expire;		/* Oldest usage to count */
+
+
+  cupsdLogMessage(CUPSD_LOG_INFO,
+                  "Computing quotas for %s from the job history...", p->name);
+
+  if (p->quota_period > 0)
+    expire = time(NULL) - p->quota_period;
+  else
+    expire = 0;
+
+  for (i = 0, count = cupsArrayCount(Jobs); i < count; i ++)
+  {
+    job = (cupsd_job_t *)cupsArrayIndex(Jobs, i);
+
+   /*
+    * We only care about the current printer/class...
+    */
+
+    if (_cups_strcasecmp(job->dest, p->name) || !cupsdLoadJob(job))
+      continue;
+
+    if ((attr = ippFindAttribute(job->attrs, "time-at-completed",
+                                 IPP_TAG_INTEGER)) == NULL)
+      if ((attr = ippFindAttribute(job->attrs, "time-at-processing",
+                                   IPP_TAG_INTEGER)) == NULL)
+        attr = ippFindAttribute(job->attrs, "time-at-creation",
+                                IPP_TAG_INTEGER);
+
+    if (!attr || (t = (time_t)attr->values[0].integer) < expire)
+      continue;				/* Too old to count towards the quota */
+
+    if ((attr = ippFindAttribute(job->attrs, "job-media-sheets-completed",
+                                 IPP_TAG_INTEGER)) != NULL)
+      pages = attr->values[0].integer;
+    else
+      pages = 0;
+
+    if ((attr = ippFindAttribute(job->attrs, "job-k-octets",
+                                 IPP_TAG_INTEGER)) != NULL)
+      k = attr->values[0].integer;
+    else
+      k = 0;
+
+    if ((pages || k) && (q = cupsdFindQuota(p, job->username)) != NULL)
+      add_usage(p, q, t, pages, k);
+  }
+
+ /*
+  * Write the usage to a new quota.journal file...
+  */
+
+  cupsdMarkDirty(CUPSD_DIRTY_QUOTAS);
+}
+
+
+/*
+ * 'write_quota()' - Append usage to the quota.journal file.
+ */
+
+static void
+write_quota(cupsd_printer_t *p,		/* I - Printer */
+            cupsd_quota_t   *q,		/* I - Quota data */
+            time_t          t,		/* I - Time of usage */
+            int             pages,	/* I - Number of pages */
+            int             k)		/* I - Number of kilobytes */
+{
+ /*
+  * Start with a new file the first time and after every 1000 records; the
+  * new file only contains the time slices that are still in use...
+  */
+
+  if (!quota_journal || quota_records >= 1000)
+    save_quotas();
+
+  if (!quota_journal)
+    return;
+
+  cupsFilePrintf(quota_journal, "%ld %d %d %s %s\n", (long)t, pages, k,
+                 p->name, q->username);
+
+  quota_records ++;
+
+  cupsdMarkDirty(CUPSD_DIRTY_QUOTAS);
+}
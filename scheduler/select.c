@@ -16,6 +16,11 @@
 #ifdef HAVE_EPOLL
 #  include <sys/epoll.h>
 #  include <poll.h>
+#  ifdef HAVE_IO_URING
+#    include <linux/io_uring.h>
+#    include <sys/mman.h>
+#    include <sys/syscall.h>
+#  endif /* HAVE_IO_URING */
 #elif defined(HAVE_KQUEUE)
 #  include <sys/event.h>
 #  include <sys/time.h>
@@ -126,7 +131,29 @@
  *         e. cupsdStopSelect() closes the kqueue() file descriptor
  *            and frees all of the memory used by the event buffer.
  *
- *     5. /dev/poll - O(n log n) - NOT YET IMPLEMENTED
+ *     5. io_uring - O(active fds)
+ *         a. cupsdStartSelect() creates a submission/completion ring
+ *            pair with io_uring_setup() and maps it into memory; on
+ *            failure (old kernel, seccomp, etc.) revert to epoll().
+ *         b. cupsdAddSelect() queues a one-shot IORING_OP_POLL_ADD
+ *            request for the file descriptor, or an in-place poll
+ *            update when the callbacks change.  The request user data
+ *            is a pointer to the callback array element, which holds a
+ *            reference for as long as the poll is armed.
+ *         c. cupsdRemoveSelect() queues an IORING_OP_POLL_REMOVE
+ *            request and submits it immediately so that the file
+ *            descriptor can be closed safely.
+ *         d. cupsdDoSelect() submits all queued requests and waits for
+ *            completions using a single io_uring_enter() call, then
+ *            runs the callbacks for each completion and queues a new
+ *            poll request for every file descriptor that is still
+ *            active.  Re-arming after the callbacks preserves the
+ *            level-triggered semantics of the other implementations
+ *            while batching all of the changes into the next wait.
+ *         e. cupsdStopSelect() unmaps the rings and closes the
+ *            io_uring file descriptor.
+ *
+ *     6. /dev/poll - O(n log n) - NOT YET IMPLEMENTED
  *         a. cupsdStartSelect() opens /dev/poll and allocates an
  *            array of pollfd structs; on failure to open /dev/poll,
  *            revert to poll() system call.
@@ -143,6 +170,23 @@
  *         e. cupsdStopSelect() closes /dev/poll and frees the
  *            pollfd array.
  *
+ * DEADLINE TIMERS
+ *
+ *     void cupsdSetTimer(cupsd_timer_t *timer, time_t when,
+ *                        cupsd_timerfunc_t cb, void *data,
+ *                        const char *why);
+ *     void cupsdClearTimer(cupsd_timer_t *timer);
+ *     time_t cupsdNextTimer(const char **why);
+ *     int cupsdRunTimers(time_t curtime);
+ *
+ *     Objects with deadlines (clients, jobs, etc.) embed a cupsd_timer_t
+ *     and schedule it with cupsdSetTimer().  The timers are kept in a
+ *     binary min-heap so that the main loop can find the next wakeup time
+ *     in O(1) and run the expired timers in O(k log n) instead of
+ *     rescanning every client and job.  Callbacks may reschedule their
+ *     own timer; timers scheduled while cupsdRunTimers() is running are
+ *     not run until the next call.
+ *
  * PERFORMANCE
  *
  *   In tests using the "make test" target with option 0 (keep cupsd
@@ -181,8 +225,33 @@ typedef struct _cupsd_fd_s
   cupsd_selfunc_t	read_cb,	/* Read callback */
 			write_cb;	/* Write callback */
   void			*data;		/* Data pointer for callbacks */
+#ifdef HAVE_IO_URING
+  int			uring_armed,	/* Is an io_uring poll armed? */
+			uring_events;	/* Events for the armed poll */
+#endif /* HAVE_IO_URING */
 } _cupsd_fd_t;
 
+#ifdef HAVE_IO_URING
+typedef struct _cupsd_uring_s
+{
+  int			fd,		/* io_uring file descriptor */
+			skip_success;	/* Can we skip successful CQEs? */
+  void			*ring;		/* Mapped SQ/CQ rings */
+  size_t		ring_size;	/* Size of mapped rings */
+  struct io_uring_sqe	*sqes;		/* Submission queue entries */
+  size_t		sqes_size;	/* Size of mapped entries */
+  unsigned		*sq_head,	/* Submission queue head (kernel) */
+			*sq_tail,	/* Submission queue tail (kernel) */
+			sq_mask,	/* Submission queue index mask */
+			sq_entries,	/* Number of submission queue entries */
+			sq_local;	/* Local (unpublished) submission tail */
+  unsigned		*cq_head,	/* Completion queue head */
+			*cq_tail,	/* Completion queue tail */
+			cq_mask;	/* Completion queue index mask */
+  struct io_uring_cqe	*cqes;		/* Completion queue entries */
+} _cupsd_uring_t;
+#endif /* HAVE_IO_URING */
+
 
 /*
  * Local globals...
@@ -206,6 +275,9 @@ static struct pollfd	*cupsd_pollfds = NULL;
 static int		cupsd_epoll_fd = -1;
 static struct epoll_event *cupsd_epoll_events = NULL;
 #  endif /* HAVE_EPOLL */
+#  ifdef HAVE_IO_URING
+static _cupsd_uring_t	cupsd_uring = { -1 };
+#  endif /* HAVE_IO_URING */
 #else /* select() */
 static fd_set		cupsd_global_input,
 			cupsd_global_output,
@@ -213,6 +285,21 @@ static fd_set		cupsd_global_input,
 			cupsd_current_output;
 #endif /* HAVE_KQUEUE */
 
+static cupsd_timer_t	**cupsd_timers = NULL;
+					/* Heap of deadline timers */
+static int		cupsd_num_timers = 0,
+					/* Number of timers */
+			cupsd_alloc_timers = 0,
+					/* Allocated timers */
+			cupsd_timer_serial = 0;
+					/* Current cupsdRunTimers() serial */
+static cupsd_timer_t	**cupsd_held_timers = NULL;
+					/* Timers held back by cupsdRunTimers() */
+static int		cupsd_num_held = 0,
+					/* Number of held timers */
+			cupsd_alloc_held = 0;
+					/* Allocated held timers */
+
 
 /*
  * Local functions...
@@ -220,11 +307,23 @@ static fd_set		cupsd_global_input,
 
 static int		compare_fds(_cupsd_fd_t *a, _cupsd_fd_t *b);
 static _cupsd_fd_t	*find_fd(int fd);
+static int		hold_timer(cupsd_timer_t *timer);
 #define			release_fd(f) { \
 			  (f)->use --; \
 			  if (!(f)->use) free((f));\
 			}
 #define			retain_fd(f) (f)->use++
+static void		remove_timer(int i);
+static void		sift_timer(int i);
+#ifdef HAVE_IO_URING
+static void		uring_arm(_cupsd_fd_t *fdptr);
+static int		uring_enter(long timeout, int wait);
+static int		uring_events(_cupsd_fd_t *fdptr);
+static void		uring_fallback(void);
+static struct io_uring_sqe *uring_get_sqe(void);
+static int		uring_start(void);
+static void		uring_stop(void);
+#endif /* HAVE_IO_URING */
 
 
 /*
@@ -327,6 +426,50 @@ cupsdAddSelect(int             fd,	/* I - File descriptor */
   }
 
 #elif defined(HAVE_POLL)
+#  ifdef HAVE_IO_URING
+  if (cupsd_uring.fd >= 0)
+  {
+   /*
+    * Save the new callbacks and then arm or update the poll request; the
+    * request is not submitted until the next cupsdDoSelect()...
+    */
+
+    fdptr->read_cb  = read_cb;
+    fdptr->write_cb = write_cb;
+    fdptr->data     = data;
+
+    if (!fdptr->uring_armed)
+    {
+      if (read_cb || write_cb)
+        uring_arm(fdptr);
+    }
+    else if (fdptr->uring_events != uring_events(fdptr))
+    {
+      struct io_uring_sqe *sqe;		/* Poll update request */
+
+      if ((sqe = uring_get_sqe()) != NULL)
+      {
+	sqe->opcode        = IORING_OP_POLL_REMOVE;
+	sqe->fd            = -1;
+	sqe->addr          = (__u64)(uintptr_t)fdptr;
+	sqe->len           = IORING_POLL_UPDATE_EVENTS;
+	sqe->poll32_events = (__u32)uring_events(fdptr);
+#    if __BYTE_ORDER == __BIG_ENDIAN
+	sqe->poll32_events = (sqe->poll32_events << 16) | (sqe->poll32_events >> 16);
+#    endif /* __BYTE_ORDER == __BIG_ENDIAN */
+#    ifdef IOSQE_CQE_SKIP_SUCCESS
+	if (cupsd_uring.skip_success)
+	  sqe->flags |= IOSQE_CQE_SKIP_SUCCESS;
+#    endif /* IOSQE_CQE_SKIP_SUCCESS */
+
+	fdptr->uring_events = uring_events(fdptr);
+      }
+    }
+
+    return (1);
+  }
+  else
+#  endif /* HAVE_IO_URING */
 #  ifdef HAVE_EPOLL
   if (cupsd_epoll_fd >= 0)
   {
@@ -391,6 +534,41 @@ cupsdAddSelect(int             fd,	/* I - File descriptor */
 }
 
 
+/*
+ * 'cupsdClearTimer()' - Cancel a deadline timer.
+ */
+
+void
+cupsdClearTimer(cupsd_timer_t *timer)	/* I - Timer */
+{
+  int	i;				/* Index of timer */
+
+
+  if (!timer->when)
+    return;
+
+  i           = timer->index;
+  timer->when = 0;
+
+  if (i < 0)
+  {
+   /*
+    * Held back by cupsdRunTimers(), move the last held timer into the hole...
+    */
+
+    i = -1 - i;
+
+    if (i < -- cupsd_num_held)
+    {
+      cupsd_held_timers[i]        = cupsd_held_timers[cupsd_num_held];
+      cupsd_held_timers[i]->index = -1 - i;
+    }
+  }
+  else
+    remove_timer(i);
+}
+
+
 /*
  * 'cupsdDoSelect()' - Do a select-like operation.
  */
@@ -448,6 +626,80 @@ cupsdDoSelect(long timeout)		/* I - Timeout in seconds */
 #  ifdef HAVE_EPOLL
   cupsd_in_select = 1;
 
+#    ifdef HAVE_IO_URING
+  if (cupsd_uring.fd >= 0)
+  {
+    unsigned		head;		/* Current completion */
+    struct io_uring_cqe	cqe;		/* Copy of completion */
+
+
+    if (uring_enter(timeout, 1) < 0 && errno != ETIME)
+    {
+      if (errno == EINTR)
+      {
+        nfds = -1;
+	goto release_inactive;
+      }
+
+      cupsdLogMessage(CUPSD_LOG_ERROR, "io_uring_enter() failed - %s, falling back to poll().", strerror(errno));
+      uring_fallback();
+    }
+    else
+    {
+     /*
+      * Run the callbacks for each completed poll request.  The completion
+      * is consumed before doing the callbacks since they may queue and
+      * submit new requests...
+      */
+
+      nfds = 0;
+
+      for (head = *cupsd_uring.cq_head; head != __atomic_load_n(cupsd_uring.cq_tail, __ATOMIC_ACQUIRE); head = *cupsd_uring.cq_head)
+      {
+	cqe = cupsd_uring.cqes[head & cupsd_uring.cq_mask];
+
+	__atomic_store_n(cupsd_uring.cq_head, head + 1, __ATOMIC_RELEASE);
+
+	if ((fdptr = (_cupsd_fd_t *)(uintptr_t)cqe.user_data) == NULL)
+	  continue;			/* Update or removal request */
+
+	fdptr->uring_armed = 0;
+
+	if (cqe.res < 0 && cqe.res != -ECANCELED)
+	{
+	  cupsdLogMessage(CUPSD_LOG_DEBUG, "io_uring poll of fd %d failed - %s", fdptr->fd, strerror(-cqe.res));
+	}
+	else
+	{
+	  if (cqe.res > 0)
+	  {
+	    nfds ++;
+
+	    if (fdptr->read_cb && (cqe.res & (POLLIN | POLLERR | POLLHUP)))
+	      (*(fdptr->read_cb))(fdptr->data);
+
+	    if (fdptr->use > 1 && fdptr->write_cb &&
+		(cqe.res & (POLLOUT | POLLERR | POLLHUP)) &&
+		!cupsArrayFind(cupsd_inactive_fds, fdptr))
+	      (*(fdptr->write_cb))(fdptr->data);
+	  }
+
+	  if (cupsd_uring.fd >= 0 && !fdptr->uring_armed &&
+	      (fdptr->read_cb || fdptr->write_cb))
+	    uring_arm(fdptr);
+	}
+
+	release_fd(fdptr);
+
+	if (cupsd_uring.fd < 0)
+	  break;
+      }
+
+      goto release_inactive;
+    }
+  }
+#    endif /* HAVE_IO_URING */
+
   if (cupsd_epoll_fd >= 0)
   {
     int			i;		/* Looping var */
@@ -678,6 +930,23 @@ cupsdIsSelecting(int fd)		/* I - File descriptor */
 #endif /* CUPSD_IS_SELECTING */
 
 
+/*
+ * 'cupsdNextTimer()' - Get the time of the next deadline.
+ */
+
+time_t					/* O - Time of next deadline or 0 if none */
+cupsdNextTimer(const char **why)	/* O - Reason for deadline or NULL */
+{
+  if (!cupsd_num_timers)
+    return (0);
+
+  if (why)
+    *why = cupsd_timers[0]->why;
+
+  return (cupsd_timers[0]->when);
+}
+
+
 /*
  * 'cupsdRemoveSelect()' - Remove a file descriptor from the list.
  */
@@ -713,6 +982,39 @@ cupsdRemoveSelect(int fd)		/* I - File descriptor */
     return;
 
 #ifdef HAVE_EPOLL
+#  ifdef HAVE_IO_URING
+  if (cupsd_uring.fd >= 0)
+  {
+   /*
+    * Clear the callbacks so that any completion still in flight is ignored,
+    * then cancel the poll request and submit the removal right away so the
+    * caller can close the file descriptor...
+    */
+
+    fdptr->read_cb  = NULL;
+    fdptr->write_cb = NULL;
+
+    if (fdptr->uring_armed)
+    {
+      struct io_uring_sqe *sqe;		/* Poll removal request */
+
+      if ((sqe = uring_get_sqe()) != NULL)
+      {
+	sqe->opcode = IORING_OP_POLL_REMOVE;
+	sqe->fd     = -1;
+	sqe->addr   = (__u64)(uintptr_t)fdptr;
+#    ifdef IOSQE_CQE_SKIP_SUCCESS
+	if (cupsd_uring.skip_success)
+	  sqe->flags |= IOSQE_CQE_SKIP_SUCCESS;
+#    endif /* IOSQE_CQE_SKIP_SUCCESS */
+
+	if (uring_enter(0, 0) < 0 && errno != EINTR)
+	  uring_fallback();
+      }
+    }
+  }
+  else
+#  endif /* HAVE_IO_URING */
   if (epoll_ctl(cupsd_epoll_fd, EPOLL_CTL_DEL, fd, &event))
   {
     close(cupsd_epoll_fd);
@@ -783,6 +1085,127 @@ cupsdRemoveSelect(int fd)		/* I - File descriptor */
 }
 
 
+/*
+ * 'cupsdRunTimers()' - Run the callbacks for all expired deadline timers.
+ */
+
+int					/* O - Number of timers run */
+cupsdRunTimers(time_t curtime)		/* I - Current time */
+{
+  int			count = 0;	/* Number of timers run */
+  cupsd_timer_t		*timer;		/* Current timer */
+  cupsd_timerfunc_t	cb;		/* Callback */
+  void			*data;		/* Callback data */
+
+
+  cupsd_timer_serial ++;
+
+  while (cupsd_num_timers > 0 && (timer = cupsd_timers[0])->when <= curtime)
+  {
+    if (timer->serial == cupsd_timer_serial)
+    {
+     /*
+      * Scheduled by one of the callbacks below - hold it back until the next
+      * call and keep going so the expired timers behind it still run...
+      */
+
+      if (!hold_timer(timer))
+        break;
+
+      continue;
+    }
+
+    cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdRunTimers: %s (%ld)", timer->why, (long)timer->when);
+
+    cb   = timer->cb;
+    data = timer->data;
+
+    cupsdClearTimer(timer);
+
+    (*cb)(data);
+
+    count ++;
+  }
+
+ /*
+  * Put the held timers back into the heap...
+  */
+
+  while (cupsd_num_held > 0)
+  {
+    timer        = cupsd_held_timers[-- cupsd_num_held];
+    timer->index = cupsd_num_timers;
+
+    cupsd_timers[cupsd_num_timers ++] = timer;
+
+    sift_timer(timer->index);
+  }
+
+  return (count);
+}
+
+
+/*
+ * 'cupsdSetTimer()' - Schedule or reschedule a deadline timer.
+ */
+
+void
+cupsdSetTimer(cupsd_timer_t     *timer,	/* I - Timer */
+              time_t            when,	/* I - Deadline or 0 to cancel */
+	      cupsd_timerfunc_t cb,	/* I - Expiration callback */
+	      void              *data,	/* I - Data to pass to callback */
+	      const char        *why)	/* I - Debugging aid */
+{
+  if (!when)
+  {
+    cupsdClearTimer(timer);
+    return;
+  }
+
+  timer->cb     = cb;
+  timer->data   = data;
+  timer->why    = why;
+  timer->serial = cupsd_timer_serial;
+
+  if (timer->when)
+  {
+   /*
+    * Already scheduled, just move it (held timers go back into the heap at
+    * the end of cupsdRunTimers)...
+    */
+
+    timer->when = when;
+
+    if (timer->index >= 0)
+      sift_timer(timer->index);
+    return;
+  }
+
+  if (cupsd_num_timers + cupsd_num_held >= cupsd_alloc_timers)
+  {
+    cupsd_timer_t	**temp;		/* New heap array */
+    int			alloc_timers = cupsd_alloc_timers + 1024;
+					/* New allocation */
+
+    if ((temp = realloc(cupsd_timers, (size_t)alloc_timers * sizeof(cupsd_timer_t *))) == NULL)
+    {
+      cupsdLogMessage(CUPSD_LOG_EMERG, "Unable to allocate memory for %d timers.", alloc_timers);
+      return;
+    }
+
+    cupsd_timers       = temp;
+    cupsd_alloc_timers = alloc_timers;
+  }
+
+  timer->when  = when;
+  timer->index = cupsd_num_timers;
+
+  cupsd_timers[cupsd_num_timers ++] = timer;
+
+  sift_timer(timer->index);
+}
+
+
 /*
  * 'cupsdStartSelect()' - Initialize the file polling engine.
  */
@@ -799,6 +1222,15 @@ cupsdStartSelect(void)
 #endif /* HAVE_EPOLL || HAVE_KQUEUE */
 
 #ifdef HAVE_EPOLL
+#  ifdef HAVE_IO_URING
+  if (uring_start())
+  {
+    cupsdLogMessage(CUPSD_LOG_DEBUG, "cupsdStartSelect: Using io_uring.");
+    cupsd_update_pollfds = 0;
+    return;
+  }
+#  endif /* HAVE_IO_URING */
+
   cupsd_epoll_fd       = epoll_create(MaxFDs);
   cupsd_epoll_events   = calloc((size_t)MaxFDs, sizeof(struct epoll_event));
   cupsd_update_pollfds = 0;
@@ -859,6 +1291,10 @@ cupsdStopSelect(void)
   cupsd_kqueue_changes = 0;
 
 #elif defined(HAVE_POLL)
+#  ifdef HAVE_IO_URING
+  uring_stop();
+#  endif /* HAVE_IO_URING */
+
 #  ifdef HAVE_EPOLL
   if (cupsd_epoll_events)
   {
@@ -921,3 +1357,367 @@ find_fd(int fd)				/* I - File descriptor */
 
   return (fdptr);
 }
+
+
+/*
+ * 'hold_timer()' - Move the first timer out of the heap until the end of
+ *                  cupsdRunTimers().
+ */
+
+static int				/* O - 1 on success, 0 on error */
+hold_timer(cupsd_timer_t *timer)	/* I - Timer at the top of the heap */
+{
+  if (cupsd_num_held >= cupsd_alloc_held)
+  {
+    cupsd_timer_t	**temp;		/* New held array */
+    int			alloc_held = cupsd_alloc_held + 64;
+					/* New allocation */
+
+    if ((temp = realloc(cupsd_held_timers, (size_t)alloc_held * sizeof(cupsd_timer_t *))) == NULL)
+      return (0);
+
+    cupsd_held_timers = temp;
+    cupsd_alloc_held  = alloc_held;
+  }
+
+  remove_timer(timer->index);
+
+  timer->index = -1 - cupsd_num_held;
+
+  cupsd_held_timers[cupsd_num_held ++] = timer;
+
+  return (1);
+}
+
+
+/*
+ * 'remove_timer()' - Remove a timer from the heap.
+ */
+
+static void
+remove_timer(int i)			/* I - Index of timer */
+{
+  if (i < -- cupsd_num_timers)
+  {
+   /*
+    * Move the last timer into the hole and restore the heap order...
+    */
+
+    cupsd_timers[i]        = cupsd_timers[cupsd_num_timers];
+    cupsd_timers[i]->index = i;
+
+    sift_timer(i);
+  }
+}
+
+
+/*
+ * 'sift_timer()' - Move a timer up or down to restore the heap order.
+ */
+
+static void
+sift_timer(int i)			/* I - Index of timer */
+{
+  int		child;			/* Index of child timer */
+  cupsd_timer_t	*timer = cupsd_timers[i];
+					/* Timer to move */
+
+
+ /*
+  * Move up while the timer is earlier than its parent...
+  */
+
+  while (i > 0 && timer->when < cupsd_timers[(i - 1) / 2]->when)
+  {
+    cupsd_timers[i]        = cupsd_timers[(i - 1) / 2];
+    cupsd_timers[i]->index = i;
+    i                      = (i - 1) / 2;
+  }
+
+ /*
+  * Then move down while a child is earlier than the timer...
+  */
+
+  while ((child = 2 * i + 1) < cupsd_num_timers)
+  {
+    if (child + 1 < cupsd_num_timers && cupsd_timers[child + 1]->when < cupsd_timers[child]->when)
+      child ++;
+
+    if (timer->when <= cupsd_timers[child]->when)
+      break;
+
+    cupsd_timers[i]        = cupsd_timers[child];
+    cupsd_timers[i]->index = i;
+    i                      = child;
+  }
+
+  cupsd_timers[i] = timer;
+  timer->index    = i;
+}
+
+
+#ifdef HAVE_IO_URING
+/*
+ * 'uring_arm()' - Queue a one-shot poll request for a file descriptor.
+ */
+
+static void
+uring_arm(_cupsd_fd_t *fdptr)		/* I - File descriptor record */
+{
+  struct io_uring_sqe	*sqe;		/* Poll request */
+
+
+  if ((sqe = uring_get_sqe()) == NULL)
+    return;
+
+  sqe->opcode        = IORING_OP_POLL_ADD;
+  sqe->fd            = fdptr->fd;
+  sqe->user_data     = (__u64)(uintptr_t)fdptr;
+  sqe->poll32_events = (__u32)uring_events(fdptr);
+#  if __BYTE_ORDER == __BIG_ENDIAN
+  sqe->poll32_events = (sqe->poll32_events << 16) | (sqe->poll32_events >> 16);
+#  endif /* __BYTE_ORDER == __BIG_ENDIAN */
+
+  fdptr->uring_armed  = 1;
+  fdptr->uring_events = uring_events(fdptr);
+
+  retain_fd(fdptr);
+}
+
+
+/*
+ * 'uring_enter()' - Submit queued requests and optionally wait for completions.
+ */
+
+static int				/* O - Number of requests submitted or -1 on error */
+uring_enter(long timeout,		/* I - Timeout in seconds */
+            int  wait)			/* I - 1 to wait for a completion, 0 to just submit */
+{
+  unsigned	to_submit;		/* Number of requests to submit */
+  struct io_uring_getevents_arg	arg;	/* Extended arguments */
+  struct __kernel_timespec	ts;	/* Timeout */
+
+
+  __atomic_store_n(cupsd_uring.sq_tail, cupsd_uring.sq_local, __ATOMIC_RELEASE);
+
+  to_submit = cupsd_uring.sq_local - __atomic_load_n(cupsd_uring.sq_head, __ATOMIC_ACQUIRE);
+
+  if (!wait)
+  {
+    if (!to_submit)
+      return (0);
+
+    return ((int)syscall(__NR_io_uring_enter, cupsd_uring.fd, to_submit, 0, 0, NULL, 0));
+  }
+
+  memset(&arg, 0, sizeof(arg));
+
+  if (timeout >= 0 && timeout < 86400)
+  {
+    ts.tv_sec  = timeout;
+    ts.tv_nsec = 0;
+    arg.ts     = (__u64)(uintptr_t)&ts;
+  }
+
+  return ((int)syscall(__NR_io_uring_enter, cupsd_uring.fd, to_submit, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg)));
+}
+
+
+/*
+ * 'uring_events()' - Get the poll events for a file descriptor.
+ */
+
+static int				/* O - Poll events */
+uring_events(_cupsd_fd_t *fdptr)	/* I - File descriptor record */
+{
+  int	events = 0;			/* Poll events */
+
+
+  if (fdptr->read_cb)
+    events |= POLLIN;
+
+  if (fdptr->write_cb)
+    events |= POLLOUT;
+
+  return (events);
+}
+
+
+/*
+ * 'uring_fallback()' - Stop using io_uring and fall back to poll().
+ */
+
+static void
+uring_fallback(void)
+{
+  _cupsd_fd_t	*fdptr;			/* Current file descriptor */
+
+
+ /*
+  * Drop the references held by armed poll requests for active file
+  * descriptors - records that were already removed are simply leaked since
+  * their completions will never arrive...
+  */
+
+  for (fdptr = (_cupsd_fd_t *)cupsArrayFirst(cupsd_fds);
+       fdptr;
+       fdptr = (_cupsd_fd_t *)cupsArrayNext(cupsd_fds))
+  {
+    if (fdptr->uring_armed)
+    {
+      fdptr->uring_armed = 0;
+      fdptr->use --;
+    }
+  }
+
+  uring_stop();
+
+  cupsd_update_pollfds = 1;
+}
+
+
+/*
+ * 'uring_get_sqe()' - Get the next free submission queue entry.
+ */
+
+static struct io_uring_sqe *		/* O - Submission queue entry or NULL */
+uring_get_sqe(void)
+{
+  struct io_uring_sqe	*sqe;		/* Submission queue entry */
+
+
+  if ((cupsd_uring.sq_local - __atomic_load_n(cupsd_uring.sq_head, __ATOMIC_ACQUIRE)) >= cupsd_uring.sq_entries)
+  {
+   /*
+    * Queue is full, submit what we have so far...
+    */
+
+    if (uring_enter(0, 0) < 0)
+    {
+      cupsdLogMessage(CUPSD_LOG_ERROR, "io_uring_enter() failed - %s, falling back to poll().", strerror(errno));
+      uring_fallback();
+      return (NULL);
+    }
+  }
+
+  sqe = cupsd_uring.sqes + (cupsd_uring.sq_local & cupsd_uring.sq_mask);
+  cupsd_uring.sq_local ++;
+
+  memset(sqe, 0, sizeof(struct io_uring_sqe));
+
+  return (sqe);
+}
+
+
+/*
+ * 'uring_start()' - Create and map the io_uring rings.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+uring_start(void)
+{
+  struct io_uring_params params;	/* Ring parameters */
+  unsigned		entries,	/* Number of submission entries */
+			i;		/* Looping var */
+  size_t		sq_size,	/* Size of submission ring */
+			cq_size;	/* Size of completion ring */
+  unsigned char		*ring;		/* Mapped rings */
+
+
+ /*
+  * Size the rings based on the maximum number of file descriptors, staying
+  * within the kernel limit of 32768 submission entries...
+  */
+
+  for (entries = 64; entries < (unsigned)MaxFDs && entries < 32768; entries <<= 1);
+
+  memset(&params, 0, sizeof(params));
+  params.flags      = IORING_SETUP_CQSIZE;
+  params.cq_entries = 2 * entries;
+
+  if ((cupsd_uring.fd = (int)syscall(__NR_io_uring_setup, entries, &params)) < 0)
+  {
+    cupsdLogMessage(CUPSD_LOG_DEBUG, "cupsdStartSelect: io_uring_setup() failed - %s", strerror(errno));
+    cupsd_uring.fd = -1;
+    return (0);
+  }
+
+ /*
+  * We need a single mapping for both rings (5.4), extended wait arguments
+  * (5.11), and in-place poll updates (5.13, same release as resource tags)...
+  */
+
+  if ((params.features & (IORING_FEAT_SINGLE_MMAP | IORING_FEAT_EXT_ARG | IORING_FEAT_RSRC_TAGS)) != (IORING_FEAT_SINGLE_MMAP | IORING_FEAT_EXT_ARG | IORING_FEAT_RSRC_TAGS))
+  {
+    cupsdLogMessage(CUPSD_LOG_DEBUG, "cupsdStartSelect: io_uring is missing required features (0x%x).", params.features);
+    uring_stop();
+    return (0);
+  }
+
+#  ifdef IOSQE_CQE_SKIP_SUCCESS
+  cupsd_uring.skip_success = (params.features & IORING_FEAT_CQE_SKIP) != 0;
+#  endif /* IOSQE_CQE_SKIP_SUCCESS */
+
+  sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+  cupsd_uring.ring_size = sq_size > cq_size ? sq_size : cq_size;
+  cupsd_uring.sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+  if ((cupsd_uring.ring = mmap(NULL, cupsd_uring.ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, cupsd_uring.fd, IORING_OFF_SQ_RING)) == MAP_FAILED)
+  {
+    cupsd_uring.ring = NULL;
+    uring_stop();
+    return (0);
+  }
+
+  if ((cupsd_uring.sqes = mmap(NULL, cupsd_uring.sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, cupsd_uring.fd, IORING_OFF_SQES)) == MAP_FAILED)
+  {
+    cupsd_uring.sqes = NULL;
+    uring_stop();
+    return (0);
+  }
+
+  ring = (unsigned char *)cupsd_uring.ring;
+
+  cupsd_uring.sq_head    = (unsigned *)(ring + params.sq_off.head);
+  cupsd_uring.sq_tail    = (unsigned *)(ring + params.sq_off.tail);
+  cupsd_uring.sq_mask    = *(unsigned *)(ring + params.sq_off.ring_mask);
+  cupsd_uring.sq_entries = params.sq_entries;
+  cupsd_uring.sq_local   = *cupsd_uring.sq_tail;
+  cupsd_uring.cq_head    = (unsigned *)(ring + params.cq_off.head);
+  cupsd_uring.cq_tail    = (unsigned *)(ring + params.cq_off.tail);
+  cupsd_uring.cq_mask    = *(unsigned *)(ring + params.cq_off.ring_mask);
+  cupsd_uring.cqes       = (struct io_uring_cqe *)(ring + params.cq_off.cqes);
+
+ /*
+  * Submission queue entries are always used in order...
+  */
+
+  for (i = 0; i < params.sq_entries; i ++)
+    ((unsigned *)(ring + params.sq_off.array))[i] = i;
+
+  return (1);
+}
+
+
+/*
+ * 'uring_stop()' - Unmap the io_uring rings and close the file descriptor.
+ */
+
+static void
+uring_stop(void)
+{
+  if (cupsd_uring.sqes)
+    munmap(cupsd_uring.sqes, cupsd_uring.sqes_size);
+
+  if (cupsd_uring.ring)
+    munmap(cupsd_uring.ring, cupsd_uring.ring_size);
+
+  if (cupsd_uring.fd >= 0)
+    close(cupsd_uring.fd);
+
+  memset(&cupsd_uring, 0, sizeof(cupsd_uring));
+  cupsd_uring.fd = -1;
+}
+#endif /* HAVE_IO_URING */
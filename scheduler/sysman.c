@@ -57,18 +57,26 @@ cupsdCleanDirty(void)
   {
     cupsd_job_t	*job;			/* Current job */
 
-    cupsdSaveAllJobs();
+   /*
+    * Save the job control files first so that their job.journal records are
+    * flushed by cupsdSaveAllJobs...
+    */
 
     for (job = (cupsd_job_t *)cupsArrayFirst(Jobs);
          job;
 	 job = (cupsd_job_t *)cupsArrayNext(Jobs))
       if (job->dirty)
         cupsdSaveJob(job);
+
+    cupsdSaveAllJobs();
   }
 
   if (DirtyFiles & CUPSD_DIRTY_SUBSCRIPTIONS)
     cupsdSaveAllSubscriptions();
 
+  if (DirtyFiles & CUPSD_DIRTY_QUOTAS)
+    cupsdSaveQuotas();
+
   DirtyFiles     = CUPSD_DIRTY_NONE;
   DirtyCleanTime = 0;
 
@@ -83,12 +91,13 @@ cupsdCleanDirty(void)
 void
 cupsdMarkDirty(int what)		/* I - What file(s) are dirty? */
 {
-  cupsdLogMessage(CUPSD_LOG_DEBUG, "cupsdMarkDirty(%c%c%c%c%c)",
+  cupsdLogMessage(CUPSD_LOG_DEBUG, "cupsdMarkDirty(%c%c%c%c%c%c)",
 		  (what & CUPSD_DIRTY_PRINTERS) ? 'P' : '-',
 		  (what & CUPSD_DIRTY_CLASSES) ? 'C' : '-',
 		  (what & CUPSD_DIRTY_PRINTCAP) ? 'p' : '-',
 		  (what & CUPSD_DIRTY_JOBS) ? 'J' : '-',
-		  (what & CUPSD_DIRTY_SUBSCRIPTIONS) ? 'S' : '-');
+		  (what & CUPSD_DIRTY_SUBSCRIPTIONS) ? 'S' : '-',
+		  (what & CUPSD_DIRTY_QUOTAS) ? 'Q' : '-');
 
   if (what == CUPSD_DIRTY_PRINTCAP && !Printcap)
     return;
@@ -957,6 +966,8 @@ sysUpdate(void)
               job->cancel_time = time(NULL) + ippGetInteger(cancel_after, 0);
             else
               job->cancel_time = time(NULL) + MaxJobTime;
+
+            cupsdUpdateJobTimer(job);
           }
         }
       }
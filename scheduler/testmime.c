@@ -15,7 +15,7 @@
 #include <cups/dir.h>
 #include <cups/debug-private.h>
 #include <cups/ppd-private.h>
-#include "mime.h"
+#include "mime-private.h"
 
 
 /*
@@ -25,7 +25,11 @@
 static void	add_ppd_filter(mime_t *mime, mime_type_t *filtertype,
 		               const char *filter);
 static void	add_ppd_filters(mime_t *mime, ppd_file_t *ppd);
+static int	compare_chains(cups_array_t *a, int acost, cups_array_t *b,
+		               int bcost);
 static void	print_rules(mime_magic_t *rules);
+static int	test_chains(mime_t *mime);
+static int	test_rules(void);
 static void	type_dir(mime_t *mime, const char *dirname);
 
 
@@ -183,6 +187,14 @@ main(int  argc,				/* I - Number of command-line args */
 	     filter->filter, filter->cost);
 
     type_dir(mime, "../doc");
+
+    puts("");
+
+    if (!test_chains(mime))
+      return (1);
+
+    if (!test_rules())
+      return (1);
   }
 
   return (0);
@@ -334,6 +346,30 @@ add_ppd_filters(mime_t     *mime,	/* I - MIME database */
 }
 
 
+/*
+ * 'compare_chains()' - Compare two filter chains.
+ */
+
+static int				/* O - 1 if the same, 0 otherwise */
+compare_chains(cups_array_t *a,		/* I - First chain */
+               int          acost,	/* I - Cost of first chain */
+               cups_array_t *b,		/* I - Second chain */
+	       int          bcost)	/* I - Cost of second chain */
+{
+  int	i;				/* Looping var */
+
+
+  if (acost != bcost || cupsArrayCount(a) != cupsArrayCount(b))
+    return (0);
+
+  for (i = 0; i < cupsArrayCount(a); i ++)
+    if (cupsArrayIndex(a, i) != cupsArrayIndex(b, i))
+      return (0);
+
+  return (1);
+}
+
+
 /*
  * 'print_rules()' - Print the rules for a file type...
  */
@@ -494,3 +530,242 @@ type_dir(mime_t     *mime,		/* I - MIME database */
 
   cupsDirClose(dir);
 }
+
+
+/*
+ * 'test_chains()' - Test that cached filter chains match a fresh search.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+test_chains(mime_t *mime)		/* I - MIME database */
+{
+  int		i, j, k,		/* Looping vars */
+		num_types,		/* Number of source types */
+		status = 1;		/* Test status */
+  mime_type_t	*types[1024],		/* Source types */
+		*dsts[4],		/* Destination types */
+		*src,			/* Source type */
+		*dst;			/* Destination type */
+  cups_array_t	*cached,		/* Cached chain */
+		*fresh;			/* Chain from a fresh search */
+  int		cached_cost,		/* Cost of cached chain */
+		fresh_cost;		/* Cost of fresh chain */
+  mime_t	*test;			/* Test database with size limits */
+  mime_filter_t	*direct,		/* Direct filter for small files */
+		*via_a,			/* First filter for medium files */
+		*via_b;			/* First filter for large files */
+  static const size_t sizes[] =		/* File sizes to test */
+  {
+    0, 500, 1000, 1001, 50000, 100000, 100001, 10000000
+  };
+
+
+  fputs("mimeFilter2 (cached vs. uncached): ", stdout);
+
+ /*
+  * Look up every source type to a few printer formats with the cache warm,
+  * then compare each result to a search with an empty cache...
+  */
+
+  for (num_types = 0, src = mimeFirstType(mime);
+       src && num_types < (int)(sizeof(types) / sizeof(types[0]));
+       src = mimeNextType(mime))
+    types[num_types ++] = src;
+
+  dsts[0] = mimeType(mime, "application", "vnd.cups-postscript");
+  dsts[1] = mimeType(mime, "application", "vnd.cups-raster");
+  dsts[2] = mimeType(mime, "application", "pdf");
+  dsts[3] = mimeType(mime, "image", "pwg-raster");
+
+  for (i = 0; i < num_types && status; i ++)
+    for (j = 0; j < 4 && status; j ++)
+    {
+      if ((dst = dsts[j]) == NULL)
+        continue;
+
+      cached = mimeFilter2(mime, types[i], 0, dst, NULL);
+      cupsArrayDelete(cached);
+
+      cached = mimeFilter2(mime, types[i], 0, dst, &cached_cost);
+
+      _mimeFlushChains(mime);
+
+      fresh = mimeFilter2(mime, types[i], 0, dst, &fresh_cost);
+
+      if (!compare_chains(cached, cached_cost, fresh, fresh_cost))
+      {
+        printf("FAIL (%s/%s to %s/%s)\n", types[i]->super, types[i]->type,
+	       dst->super, dst->type);
+	status = 0;
+      }
+
+      cupsArrayDelete(cached);
+      cupsArrayDelete(fresh);
+    }
+
+  if (!status)
+    return (0);
+
+ /*
+  * Then use a small database where the filter maxsize values pick the
+  * chain...
+  */
+
+  test = mimeNew();
+  src  = mimeAddType(test, "test", "src");
+  dst  = mimeAddType(test, "test", "dst");
+
+  direct = mimeAddFilter(test, src, dst, 10, "direct");
+  direct->maxsize = 1000;
+
+  via_a = mimeAddFilter(test, src, mimeAddType(test, "test", "a"), 10, "via-a");
+  via_a->maxsize = 100000;
+  mimeAddFilter(test, mimeType(test, "test", "a"), dst, 10, "a-to-dst");
+
+  via_b = mimeAddFilter(test, src, mimeAddType(test, "test", "b"), 50, "via-b");
+  mimeAddFilter(test, mimeType(test, "test", "b"), dst, 50, "b-to-dst");
+
+  for (k = 0; k < 2 && status; k ++)
+  {
+   /*
+    * Go through the sizes in both directions so every cache entry is
+    * looked up after the others were added...
+    */
+
+    for (i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])) && status; i ++)
+    {
+      size_t		size = sizes[k ? (int)(sizeof(sizes) / sizeof(sizes[0])) - 1 - i : i];
+					/* Size to look up */
+      mime_filter_t	*expected;	/* Expected first filter */
+
+      if (size <= 1000)
+        expected = direct;
+      else if (size <= 100000)
+        expected = via_a;
+      else
+        expected = via_b;
+
+      cached = mimeFilter2(test, src, size, dst, &cached_cost);
+
+      _mimeFlushChains(test);
+
+      fresh = mimeFilter2(test, src, size, dst, &fresh_cost);
+
+      if (!compare_chains(cached, cached_cost, fresh, fresh_cost) ||
+          cupsArrayFirst(cached) != expected)
+      {
+        printf("FAIL (size " CUPS_LLFMT " got %s, expected %s)\n",
+	       CUPS_LLCAST size,
+	       cupsArrayFirst(cached) ? ((mime_filter_t *)cupsArrayFirst(cached))->filter : "nothing",
+	       expected->filter);
+	status = 0;
+      }
+
+      cupsArrayDelete(cached);
+      cupsArrayDelete(fresh);
+
+     /*
+      * Put this size back in the cache for the next lookup...
+      */
+
+      cupsArrayDelete(mimeFilter2(test, src, size, dst, NULL));
+    }
+  }
+
+  mimeDelete(test);
+
+  if (status)
+    puts("PASS");
+
+  return (status);
+}
+
+
+/*
+ * 'test_rules()' - Test that rules added after a lookup are used.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+test_rules(void)
+{
+  int		i,			/* Looping var */
+		status = 1;		/* Test status */
+  mime_t	*test;			/* Test database */
+  mime_type_t	*a,			/* First type */
+		*b,			/* Second type */
+		*type;			/* Detected type */
+  cups_file_t	*fp;			/* Test file */
+  char		filename[2][1024];	/* Test files */
+  static const char * const data[2] =	/* Test file contents */
+  {
+    "WORLD",
+    "xyzzy MARKER xyzzy"
+  };
+
+
+  fputs("mimeAddTypeRule after mimeFileType: ", stdout);
+
+  for (i = 0; i < 2; i ++)
+  {
+    if ((fp = cupsTempFile2(filename[i], sizeof(filename[i]))) == NULL)
+    {
+      printf("FAIL (%s)\n", cupsLastErrorString());
+      return (0);
+    }
+
+    cupsFilePuts(fp, data[i]);
+    cupsFileClose(fp);
+  }
+
+  test = mimeNew();
+  a    = mimeAddType(test, "test", "a");
+  b    = mimeAddType(test, "test", "b");
+
+  mimeAddTypeRule(a, "string(0,HELLO)");
+
+ /*
+  * Look up both files so the rules are compiled, then add a string rule to
+  * one existing type and a contains rule to the other...
+  */
+
+  if ((type = mimeFileType(test, filename[0], NULL, NULL)) != NULL ||
+      (type = mimeFileType(test, filename[1], NULL, NULL)) != NULL)
+  {
+    printf("FAIL (got %s/%s before adding rules)\n", type->super, type->type);
+    status = 0;
+  }
+
+  if (status)
+  {
+    mimeAddTypeRule(b, "string(0,WORLD)");
+
+    if ((type = mimeFileType(test, filename[0], NULL, NULL)) != b)
+    {
+      printf("FAIL (got %s for string rule, expected test/b)\n",
+             type ? type->type : "nothing");
+      status = 0;
+    }
+  }
+
+  if (status)
+  {
+    mimeAddTypeRule(a, "contains(0,100,MARKER)");
+
+    if ((type = mimeFileType(test, filename[1], NULL, NULL)) != a)
+    {
+      printf("FAIL (got %s for contains rule, expected test/a)\n",
+             type ? type->type : "nothing");
+      status = 0;
+    }
+  }
+
+  mimeDelete(test);
+
+  unlink(filename[0]);
+  unlink(filename[1]);
+
+  if (status)
+    puts("PASS");
+
+  return (status);
+}
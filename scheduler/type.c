@@ -15,7 +15,7 @@
 
 #include <cups/string-private.h>
 #include <locale.h>
-#include "mime.h"
+#include "mime-private.h"
 
 
 /*
@@ -38,6 +38,42 @@ typedef struct _mime_filebuf_s		/**** File buffer for MIME typing ****/
   unsigned char	buffer[MIME_MAX_BUFFER];/* Buffered data */
 } _mime_filebuf_t;
 
+typedef struct _mime_acedge_s		/**** Aho-Corasick goto edge ****/
+{
+  int		next,			/* Next edge from the same state */
+		state;			/* State to go to */
+  unsigned char	ch;			/* Character for this edge */
+} _mime_acedge_t;
+
+typedef struct _mime_acstate_s		/**** Aho-Corasick state ****/
+{
+  int		edges,			/* First edge or -1 */
+		fail,			/* Failure state */
+		dict,			/* Next state with outputs or -1 */
+		outs;			/* First output or -1 */
+} _mime_acstate_t;
+
+typedef struct _mime_acout_s		/**** Aho-Corasick output ****/
+{
+  int		rule,			/* CONTAINS rule number */
+		next;			/* Next output for the same state */
+} _mime_acout_t;
+
+typedef struct _mime_magicdb_s		/**** Compiled type rules ****/
+{
+  int		num_types;		/* Number of types */
+  mime_type_t	**types;		/* Types in database order */
+  unsigned char	(*firsts)[32];		/* Possible first bytes for each type */
+  int		num_contains;		/* Number of CONTAINS rules at offset 0 */
+  mime_magic_t	**contains;		/* CONTAINS rules */
+  int		num_states,		/* Number of states */
+		num_edges,		/* Number of edges */
+		num_outs;		/* Number of outputs */
+  _mime_acstate_t *states;		/* States, 0 is the root */
+  _mime_acedge_t *edges;		/* Edges */
+  _mime_acout_t	*outs;			/* Outputs */
+} _mime_magicdb_t;
+
 
 /*
  * Local functions...
@@ -45,8 +81,17 @@ typedef struct _mime_filebuf_s		/**** File buffer for MIME typing ****/
 
 static int	mime_compare_types(mime_type_t *t0, mime_type_t *t1);
 static int	mime_check_rules(const char *filename, _mime_filebuf_t *fb,
-		                 mime_magic_t *rules);
+		                 mime_magic_t *rules,
+				 const unsigned char *contains);
+static int	mime_compile(mime_t *mime);
+static int	mime_compile_contains(_mime_magicdb_t *db,
+		                      mime_magic_t *rules);
+static int	mime_compile_firsts(mime_magic_t *rules,
+		                    unsigned char *firsts);
+static int	mime_goto(_mime_magicdb_t *db, int state, int ch);
 static int	mime_patmatch(const char *s, const char *pat);
+static void	mime_scan_contains(_mime_magicdb_t *db, _mime_filebuf_t *fb,
+		                   unsigned char *contains);
 
 
 /*
@@ -133,10 +178,13 @@ mimeAddType(mime_t     *mime,		/* I - MIME database */
 
   strlcpy(temp->super, super, sizeof(temp->super));
   memcpy(temp->type, type, typelen);
+  temp->mime     = mime;
   temp->priority = 100;
 
   cupsArrayAdd(mime->types, temp);
 
+  _mimeFlushMagic(mime);
+
   DEBUG_printf(("1mimeAddType: Returning %p (new).", temp));
   return (temp);
 }
@@ -173,6 +221,13 @@ mimeAddTypeRule(mime_type_t *mt,	/* I - Type to add to */
   if (!mt || !rule)
     return (-1);
 
+ /*
+  * The compiled rules no longer match this type...
+  */
+
+  if (mt->mime)
+    _mimeFlushMagic(mt->mime);
+
  /*
   * Find the last rule in the top-level of the rules tree.
   */
@@ -593,6 +648,10 @@ mimeFileType(mime_t     *mime,		/* I - MIME database */
   const char		*base;		/* Base filename of file */
   mime_type_t		*type,		/* File type */
 			*best;		/* Best match */
+  _mime_magicdb_t	*db;		/* Compiled type rules */
+  unsigned char		*contains;	/* CONTAINS results */
+  int			i,		/* Looping var */
+			first;		/* First byte in file or -1 */
 
 
   DEBUG_printf(("mimeFileType(mime=%p, pathname=\"%s\", filename=\"%s\", "
@@ -655,18 +714,53 @@ mimeFileType(mime_t     *mime,		/* I - MIME database */
     base = pathname;
 
  /*
-  * Then check it against all known types...
+  * Then check it against all known types.  The compiled rules let us skip the
+  * types that cannot match the first byte of the file and find all of the
+  * CONTAINS strings in a single pass over the buffer...
   */
 
-  for (type = (mime_type_t *)cupsArrayFirst(mime->types), best = NULL;
-       type;
-       type = (mime_type_t *)cupsArrayNext(mime->types))
-    if (mime_check_rules(base, &fb, type->rules))
+  if (!mime->magic && mime->types)
+    mime_compile(mime);
+
+  best = NULL;
+
+  if ((db = mime->magic) != NULL &&
+      (contains = calloc((size_t)db->num_contains + 1, 1)) != NULL)
+  {
+    mime_scan_contains(db, &fb, contains);
+
+   /*
+    * Only use the first byte table when we actually have a first byte...
+    */
+
+    first = fb.length > 0 ? fb.buffer[0] : -1;
+
+    for (i = 0; i < db->num_types; i ++)
     {
-      if (!best || type->priority > best->priority)
-        best = type;
+      type = db->types[i];
+
+      if ((first < 0 || (db->firsts[i][first >> 3] & (1 << (first & 7)))) &&
+          mime_check_rules(base, &fb, type->rules, contains))
+      {
+	if (!best || type->priority > best->priority)
+	  best = type;
+      }
     }
 
+    free(contains);
+  }
+  else
+  {
+    for (type = (mime_type_t *)cupsArrayFirst(mime->types);
+	 type;
+	 type = (mime_type_t *)cupsArrayNext(mime->types))
+      if (mime_check_rules(base, &fb, type->rules, NULL))
+      {
+	if (!best || type->priority > best->priority)
+	  best = type;
+      }
+  }
+
  /*
   * Finally, close the file and return a match (if any)...
   */
@@ -724,6 +818,37 @@ mimeType(mime_t     *mime,		/* I - MIME database */
 }
 
 
+/*
+ * '_mimeFlushMagic()' - Free the compiled type rules.
+ */
+
+void
+_mimeFlushMagic(mime_t *mime)		/* I - MIME database */
+{
+  _mime_magicdb_t	*db;		/* Compiled type rules */
+  int			i;		/* Looping var */
+
+
+  if ((db = mime->magic) == NULL)
+    return;
+
+  DEBUG_puts("2_mimeFlushMagic: Deleting compiled type rules.");
+
+  for (i = 0; i < db->num_contains; i ++)
+    db->contains[i]->index = 0;
+
+  free(db->types);
+  free(db->firsts);
+  free(db->contains);
+  free(db->states);
+  free(db->edges);
+  free(db->outs);
+  free(db);
+
+  mime->magic = NULL;
+}
+
+
 /*
  * 'mime_compare_types()' - Compare two MIME super/type names.
  */
@@ -748,9 +873,10 @@ mime_compare_types(mime_type_t *t0,	/* I - First type */
 
 static int				/* O - 1 if match, 0 if no match */
 mime_check_rules(
-    const char      *filename,		/* I - Filename */
-    _mime_filebuf_t *fb,		/* I - File to check */
-    mime_magic_t    *rules)		/* I - Rules to check */
+    const char          *filename,	/* I - Filename */
+    _mime_filebuf_t     *fb,		/* I - File to check */
+    mime_magic_t        *rules,		/* I - Rules to check */
+    const unsigned char *contains)	/* I - CONTAINS results or NULL */
 {
   int		n;			/* Looping var */
   int		region;			/* Region to look at */
@@ -1154,6 +1280,16 @@ mime_check_rules(
 	  break;
 
       case MIME_MAGIC_CONTAINS :
+         /*
+	  * Use the result from mime_scan_contains() if we have one...
+	  */
+
+          if (contains && rules->index && contains[rules->index])
+	  {
+	    result = contains[rules->index] - 1;
+	    break;
+	  }
+
          /*
 	  * Load the buffer if necessary...
 	  */
@@ -1203,7 +1339,7 @@ mime_check_rules(
 
       default :
           if (rules->child != NULL)
-	    result = mime_check_rules(filename, fb, rules->child);
+	    result = mime_check_rules(filename, fb, rules->child, contains);
 	  else
 	    result = 0;
 	  break;
@@ -1240,6 +1376,328 @@ mime_check_rules(
 }
 
 
+/*
+ * 'mime_compile()' - Compile the type rules for mimeFileType().
+ *
+ * The compiled rules contain the possible first bytes for each type and an
+ * Aho-Corasick automaton for all of the CONTAINS rules at offset 0.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+mime_compile(mime_t *mime)		/* I - MIME database */
+{
+  _mime_magicdb_t	*db;		/* Compiled type rules */
+  mime_type_t		*type;		/* Current type */
+  _mime_acedge_t	*edge;		/* Current edge */
+  int			i,		/* Looping var */
+			*queue,		/* Breadth-first queue of states */
+			head,		/* Head of queue */
+			tail,		/* Tail of queue */
+			state,		/* Current state */
+			fail;		/* Failure state */
+
+
+  DEBUG_printf(("2mime_compile(mime=%p)", mime));
+
+  if ((db = calloc(1, sizeof(_mime_magicdb_t))) == NULL)
+    return (0);
+
+  mime->magic   = db;
+  db->num_types = cupsArrayCount(mime->types);
+
+  if ((db->types = calloc((size_t)db->num_types, sizeof(mime_type_t *))) == NULL ||
+      (db->firsts = calloc((size_t)db->num_types, sizeof(db->firsts[0]))) == NULL ||
+      (db->states = calloc(1, sizeof(_mime_acstate_t))) == NULL)
+  {
+    _mimeFlushMagic(mime);
+    return (0);
+  }
+
+  db->num_states       = 1;
+  db->states[0].edges  = -1;
+  db->states[0].dict   = -1;
+  db->states[0].outs   = -1;
+
+ /*
+  * Compile the rules for each type...
+  */
+
+  for (i = 0, type = (mime_type_t *)cupsArrayFirst(mime->types);
+       type;
+       i ++, type = (mime_type_t *)cupsArrayNext(mime->types))
+  {
+    db->types[i] = type;
+
+    if (!mime_compile_firsts(type->rules, db->firsts[i]))
+      memset(db->firsts[i], 255, sizeof(db->firsts[i]));
+
+    if (!mime_compile_contains(db, type->rules))
+    {
+      _mimeFlushMagic(mime);
+      return (0);
+    }
+  }
+
+ /*
+  * Then compute the failure and dictionary links for the states, breadth
+  * first...
+  */
+
+  if ((queue = calloc((size_t)db->num_states, sizeof(int))) == NULL)
+  {
+    _mimeFlushMagic(mime);
+    return (0);
+  }
+
+  for (head = 0, tail = 0, i = db->states[0].edges; i >= 0; i = edge->next)
+  {
+    edge = db->edges + i;
+
+    db->states[edge->state].fail = 0;
+    db->states[edge->state].dict = -1;
+    queue[tail ++]               = edge->state;
+  }
+
+  while (head < tail)
+  {
+    state = queue[head ++];
+
+    for (i = db->states[state].edges; i >= 0; i = edge->next)
+    {
+      edge = db->edges + i;
+
+      for (fail = db->states[state].fail;
+           fail && mime_goto(db, fail, edge->ch) < 0;
+	   fail = db->states[fail].fail);
+
+      if ((fail = mime_goto(db, fail, edge->ch)) < 0)
+        fail = 0;
+
+      db->states[edge->state].fail = fail;
+      db->states[edge->state].dict = db->states[fail].outs >= 0 ? fail : db->states[fail].dict;
+      queue[tail ++]               = edge->state;
+    }
+  }
+
+  free(queue);
+
+  DEBUG_printf(("3mime_compile: %d types, %d contains rules, %d states.",
+                db->num_types, db->num_contains, db->num_states));
+
+  return (1);
+}
+
+
+/*
+ * 'mime_compile_contains()' - Add the CONTAINS rules at offset 0 to the
+ *                             Aho-Corasick automaton.
+ */
+
+static int				/* O - 1 on success, 0 on failure */
+mime_compile_contains(
+    _mime_magicdb_t *db,		/* I - Compiled type rules */
+    mime_magic_t    *rules)		/* I - Rules to add */
+{
+  int		i,			/* Looping var */
+		state,			/* Current state */
+		next;			/* Next state */
+  void		*temp;			/* Reallocated array */
+
+
+  for (; rules; rules = rules->next)
+  {
+    if (rules->child && !mime_compile_contains(db, rules->child))
+      return (0);
+
+    if (rules->op != MIME_MAGIC_CONTAINS || rules->offset != 0 ||
+        rules->length <= 0)
+      continue;
+
+   /*
+    * Allocate room for the rule, its output, and its states...
+    */
+
+    if ((temp = realloc(db->contains, (size_t)(db->num_contains + 1) * sizeof(mime_magic_t *))) == NULL)
+      return (0);
+    db->contains = (mime_magic_t **)temp;
+
+    if ((temp = realloc(db->outs, (size_t)(db->num_contains + 1) * sizeof(_mime_acout_t))) == NULL)
+      return (0);
+    db->outs = (_mime_acout_t *)temp;
+
+    if ((temp = realloc(db->states, (size_t)(db->num_states + rules->length) * sizeof(_mime_acstate_t))) == NULL)
+      return (0);
+    db->states = (_mime_acstate_t *)temp;
+
+    if ((temp = realloc(db->edges, (size_t)(db->num_edges + rules->length) * sizeof(_mime_acedge_t))) == NULL)
+      return (0);
+    db->edges = (_mime_acedge_t *)temp;
+
+   /*
+    * Add the string to the trie...
+    */
+
+    for (i = 0, state = 0; i < rules->length; i ++, state = next)
+    {
+      if ((next = mime_goto(db, state, rules->value.stringv[i] & 255)) >= 0)
+        continue;
+
+      next = db->num_states ++;
+
+      db->states[next].edges = -1;
+      db->states[next].fail  = 0;
+      db->states[next].dict  = -1;
+      db->states[next].outs  = -1;
+
+      db->edges[db->num_edges].ch    = (unsigned char)rules->value.stringv[i];
+      db->edges[db->num_edges].state = next;
+      db->edges[db->num_edges].next  = db->states[state].edges;
+      db->states[state].edges        = db->num_edges ++;
+    }
+
+    db->contains[db->num_contains] = rules;
+    rules->index                   = ++ db->num_contains;
+
+    db->outs[db->num_outs].rule = rules->index;
+    db->outs[db->num_outs].next = db->states[state].outs;
+    db->states[state].outs      = db->num_outs ++;
+  }
+
+  return (1);
+}
+
+
+/*
+ * 'mime_compile_firsts()' - Compute the possible first bytes for a list of
+ *                           rules.
+ *
+ * Only STRING, ISTRING, and CHAR rules at offset 0 limit the first byte;
+ * everything else can match any first byte.
+ */
+
+static int				/* O - 1 if limited, 0 if any byte */
+mime_compile_firsts(
+    mime_magic_t  *rules,		/* I - Rules */
+    unsigned char *firsts)		/* O - Bitmap of possible first bytes */
+{
+  int		logic,			/* Logic to apply */
+		limited,		/* Is the current rule limited? */
+		ch;			/* Current character */
+  unsigned char	temp[32];		/* Bytes for the current rule */
+
+
+  if (rules == NULL || rules->parent == NULL)
+    logic = MIME_MAGIC_OR;
+  else
+    logic = rules->parent->op;
+
+  if (logic != MIME_MAGIC_AND && logic != MIME_MAGIC_OR)
+    return (0);
+
+  memset(firsts, 0, 32);
+
+  for (; rules; rules = rules->next)
+  {
+    memset(temp, 0, sizeof(temp));
+
+    limited = 0;
+
+    if (!rules->invert)
+    {
+      switch (rules->op)
+      {
+        case MIME_MAGIC_STRING :
+        case MIME_MAGIC_ISTRING :
+	    if (rules->offset == 0 && rules->length > 0)
+	    {
+	      ch = rules->value.stringv[0] & 255;
+	      temp[ch >> 3] |= (unsigned char)(1 << (ch & 7));
+
+              if (rules->op == MIME_MAGIC_ISTRING &&
+	          ((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z')))
+	      {
+	        ch ^= 0x20;
+		temp[ch >> 3] |= (unsigned char)(1 << (ch & 7));
+	      }
+
+	      limited = 1;
+	    }
+	    break;
+
+        case MIME_MAGIC_CHAR :
+	    if (rules->offset == 0)
+	    {
+	      ch = rules->value.charv;
+	      temp[ch >> 3] |= (unsigned char)(1 << (ch & 7));
+	      limited = 1;
+	    }
+	    break;
+
+        case MIME_MAGIC_NOP :
+        case MIME_MAGIC_AND :
+        case MIME_MAGIC_OR :
+	    if (rules->child)
+	      limited = mime_compile_firsts(rules->child, temp);
+	    else
+	      limited = 1;		/* Never matches */
+	    break;
+
+        default :
+	    break;
+      }
+    }
+
+    if (logic == MIME_MAGIC_AND)
+    {
+     /*
+      * Every rule has to match, so any limited rule limits the list...
+      */
+
+      if (limited)
+      {
+        memcpy(firsts, temp, sizeof(temp));
+	return (1);
+      }
+    }
+    else if (!limited)
+    {
+     /*
+      * Any rule can match, so every rule must be limited...
+      */
+
+      return (0);
+    }
+    else
+    {
+      for (ch = 0; ch < 32; ch ++)
+        firsts[ch] |= temp[ch];
+    }
+  }
+
+  return (logic == MIME_MAGIC_OR);
+}
+
+
+/*
+ * 'mime_goto()' - Find the Aho-Corasick state for a character.
+ */
+
+static int				/* O - Next state or -1 */
+mime_goto(_mime_magicdb_t *db,		/* I - Compiled type rules */
+          int             state,	/* I - Current state */
+          int             ch)		/* I - Character */
+{
+  int	i;				/* Current edge */
+
+
+  for (i = db->states[state].edges; i >= 0; i = db->edges[i].next)
+    if (db->edges[i].ch == ch)
+      return (db->edges[i].state);
+
+  return (-1);
+}
+
+
 /*
  * 'mime_patmatch()' - Pattern matching.
  */
@@ -1342,3 +1800,84 @@ mime_patmatch(const char *s,		/* I - String to match against */
 
   return (*s == *pat);
 }
+
+
+/*
+ * 'mime_scan_contains()' - Find the CONTAINS strings in the file buffer.
+ *
+ * The results are 0 if the rule must be checked by mime_check_rules(), 1 if
+ * the rule does not match, and 2 if the rule matches.
+ */
+
+static void
+mime_scan_contains(
+    _mime_magicdb_t *db,		/* I - Compiled type rules */
+    _mime_filebuf_t *fb,		/* I - File buffer at offset 0 */
+    unsigned char   *contains)		/* O - Results for each rule */
+{
+  int		i,			/* Looping var */
+		pos,			/* Position in buffer */
+		state,			/* Current state */
+		next,			/* Next state */
+		out,			/* Current output */
+		region;			/* Region to look at */
+  mime_magic_t	*rule;			/* Current rule */
+
+
+ /*
+  * Only use the scan for rules that mime_check_rules() would look at with
+  * this buffer...
+  */
+
+  for (i = 0; i < db->num_contains; i ++)
+  {
+    rule = db->contains[i];
+
+    if (rule->length > fb->length)
+      contains[i + 1] = 1;
+    else
+    {
+      if (fb->length > rule->region)
+        region = rule->region - rule->length;
+      else
+        region = fb->length - rule->length;
+
+      if (region > 0)
+        contains[i + 1] = 1;
+    }
+  }
+
+  if (db->num_states < 2)
+    return;
+
+  for (pos = 0, state = 0; pos < fb->length; pos ++)
+  {
+    while ((next = mime_goto(db, state, fb->buffer[pos])) < 0 && state)
+      state = db->states[state].fail;
+
+    if ((state = next) < 0)
+      state = 0;
+
+    for (next = db->states[state].outs >= 0 ? state : db->states[state].dict;
+         next >= 0;
+	 next = db->states[next].dict)
+    {
+      for (out = db->states[next].outs; out >= 0; out = db->outs[out].next)
+      {
+        i    = db->outs[out].rule;
+        rule = db->contains[i - 1];
+
+        if (contains[i] != 1)
+	  continue;
+
+        if (fb->length > rule->region)
+	  region = rule->region - rule->length;
+	else
+	  region = fb->length - rule->length;
+
+        if ((pos + 1 - rule->length) < region)
+	  contains[i] = 2;
+      }
+    }
+  }
+}
@@ -498,6 +498,8 @@ LogLevel $loglevel
 LogTimeFormat usecs
 PreserveJobHistory $jobhistory
 PreserveJobFiles $jobfiles
+FilterAhead 2
+IPPWorkers 2
 <Policy default>
 <Limit All>
 Order Allow,Deny
@@ -829,6 +831,271 @@ else
 fi
 
 
+#
+# Perform filter-ahead test...
+#
+
+echo $ac_n "Starting filter-ahead test: $ac_c"
+echo "" >>$strfile
+echo "`date '+[%d/%b/%Y:%H:%M:%S %z]'` \"5.13-filter-ahead\":" >>$strfile
+
+echo "    lpadmin -p Ahead -E -v file:$BASE/ahead.prn -P testps.ppd" >>$strfile
+$runcups ../systemv/lpadmin -p Ahead -E -v file:$BASE/ahead.prn -P testps.ppd >>$strfile 2>&1
+
+cat >$BASE/ahead.test <<EOF
+{
+	NAME "Create Job on Ahead"
+	OPERATION create-job
+	RESOURCE /printers/Ahead
+	GROUP operation
+	ATTR charset attributes-charset utf-8
+	ATTR language attributes-natural-language en
+	ATTR uri printer-uri \$uri
+	ATTR name requesting-user-name $user
+	STATUS successful-ok
+	EXPECT job-id
+}
+EOF
+
+for doc in 1 2 3 4; do
+	cat >$BASE/ahead-$doc.ps <<EOF
+%!PS-Adobe-3.0
+%%Pages: 1
+%%EndComments
+%%Page: 1 1
+/Courier findfont 12 scalefont setfont
+72 720 moveto (FilterAhead document $doc) show
+showpage
+%%EOF
+EOF
+
+	if test $doc = 4; then
+		last=true
+	else
+		last=false
+	fi
+
+	cat >>$BASE/ahead.test <<EOF
+{
+	NAME "Send Document $doc to Ahead"
+	OPERATION send-document
+	RESOURCE /printers/Ahead
+	GROUP operation
+	ATTR charset attributes-charset utf-8
+	ATTR language attributes-natural-language en
+	ATTR uri printer-uri \$uri
+	ATTR integer job-id \$job-id
+	ATTR name requesting-user-name $user
+	ATTR mimeMediaType document-format application/postscript
+	ATTR boolean last-document $last
+	FILE $BASE/ahead-$doc.ps
+	STATUS successful-ok
+}
+EOF
+done
+
+echo "    ipptool ipp://localhost:$port/printers/Ahead ahead.test" >>$strfile
+$runcups ../tools/ipptool -t ipp://localhost:$port/printers/Ahead $BASE/ahead.test >>$strfile
+status=$?
+
+./waitjobs.sh >>$strfile
+
+order=`$GREP -a -o 'FilterAhead document [0-9]' $BASE/ahead.prn 2>/dev/null | awk '{printf "%s ", $3}'`
+
+if test $status != 0; then
+	echo "FAIL (unable to queue test job)"
+	echo "    FAILED" >>$strfile
+	fail=`expr $fail + 1`
+elif test "x$order" != "x1 2 3 4 "; then
+	echo "FAIL (got documents '$order', expected '1 2 3 4 ')"
+	echo "    FAILED (got documents '$order', expected '1 2 3 4 ')" >>$strfile
+	fail=`expr $fail + 1`
+elif ! $GREP -q 'was filtered ahead of time' $BASE/log/error_log; then
+	echo "FAIL (documents not filtered ahead of time)"
+	echo "    FAILED (documents not filtered ahead of time)" >>$strfile
+	fail=`expr $fail + 1`
+else
+	echo "PASS"
+	echo "    PASSED" >>$strfile
+fi
+
+echo "    lpadmin -x Ahead" >>$strfile
+$runcups ../systemv/lpadmin -x Ahead >>$strfile 2>&1
+
+
+#
+# Perform request spooling test...
+#
+
+echo $ac_n "Starting request spooling test: $ac_c"
+echo "" >>$strfile
+echo "`date '+[%d/%b/%Y:%H:%M:%S %z]'` \"5.14-spool\":" >>$strfile
+
+# A body bigger than the scheduler's splice pipe, sent with Content-Length...
+awk 'BEGIN {for (i = 0; i < 40000; i ++) printf("Request spooling test line %d.\n", i);}' >$BASE/spool.txt
+
+cat >$BASE/spool.test <<EOF
+{
+	NAME "Print Held Job with Content-Length to Test1"
+	OPERATION print-job
+	RESOURCE /printers/Test1
+
+	GROUP operation
+	ATTR charset attributes-charset utf-8
+	ATTR language attributes-natural-language en
+	ATTR uri printer-uri \$uri
+	ATTR name requesting-user-name $user
+	ATTR mimeMediaType document-format text/plain
+
+	GROUP job
+	ATTR keyword job-hold-until indefinite
+
+	TRANSFER length
+	FILE $BASE/spool.txt
+
+	STATUS successful-ok
+	EXPECT job-id
+}
+EOF
+
+echo "    ipptool ipp://localhost:$port/printers/Test1 spool.test" >>$strfile
+$runcups ../tools/ipptool -t ipp://localhost:$port/printers/Test1 $BASE/spool.test >>$strfile
+status=$?
+
+docfile=`ls -t $BASE/spool/d*-001 2>/dev/null | head -1`
+jobid=`echo $docfile | sed -e '1,$s/.*\/d0*\([0-9]*\)-001$/\1/'`
+
+if test $status != 0; then
+	echo "FAIL (unable to queue test job)"
+	echo "    FAILED" >>$strfile
+	fail=`expr $fail + 1`
+elif ! cmp -s $BASE/spool.txt "$docfile"; then
+	echo "FAIL (spooled document differs)"
+	echo "    FAILED (spooled document $docfile differs)" >>$strfile
+	fail=`expr $fail + 1`
+else
+	echo "PASS"
+	echo "    PASSED" >>$strfile
+fi
+
+echo "    cancel Test1-$jobid" >>$strfile
+$runcups ../systemv/cancel Test1-$jobid >>$strfile 2>&1
+
+
+#
+# Perform streaming print test...
+#
+
+echo $ac_n "Starting streaming print test: $ac_c"
+echo "" >>$strfile
+echo "`date '+[%d/%b/%Y:%H:%M:%S %z]'` \"5.12-streaming\":" >>$strfile
+
+echo "StreamingPrint Yes" >>$BASE/cupsd.conf
+kill -HUP $cupsd
+
+while true; do
+	sleep 10
+
+	running=`$runcups ../systemv/lpstat -r 2>/dev/null`
+	if test "x$running" = "xscheduler is running"; then
+		break
+	fi
+done
+
+echo "    cat testfile.txt | lp -d Test1 -o document-format=text/plain" >>$strfile
+
+cat ../examples/testfile.txt | $runcups ../systemv/lp -d Test1 -o document-format=text/plain 2>&1 >>$strfile
+if test $? != 0; then
+	echo "FAIL (unable to queue test job)"
+	echo "    FAILED" >>$strfile
+	fail=`expr $fail + 1`
+elif ! $GREP -q 'Streaming document data to job' $BASE/log/error_log; then
+	echo "FAIL (document not streamed)"
+	echo "    FAILED (document not streamed)" >>$strfile
+	fail=`expr $fail + 1`
+else
+	echo "PASS"
+	echo "    PASSED" >>$strfile
+fi
+
+echo $ac_n "Starting empty streaming print test: $ac_c"
+echo "    lp -d Test1 -H indefinite -o document-format=text/plain </dev/null" >>$strfile
+
+$runcups ../systemv/lp -d Test1 -H indefinite -o document-format=text/plain </dev/null 2>&1 >>$strfile
+if test $? = 0; then
+	echo "FAIL (empty document accepted)"
+	echo "    FAILED (empty document accepted)" >>$strfile
+	fail=`expr $fail + 1`
+else
+	echo "PASS"
+	echo "    PASSED" >>$strfile
+fi
+
+echo $ac_n "Starting streaming Print-Job test: $ac_c"
+
+cat >$BASE/stream.test <<EOF
+{
+	NAME "Print Streamed Job to Test1"
+	OPERATION print-job
+	RESOURCE /printers/Test1
+
+	GROUP operation
+	ATTR charset attributes-charset utf-8
+	ATTR language attributes-natural-language en
+	ATTR uri printer-uri \$uri
+	ATTR name requesting-user-name $user
+	ATTR mimeMediaType document-format text/plain
+
+	FILE $root/examples/testfile.txt
+
+	STATUS successful-ok
+	EXPECT job-id
+}
+{
+	NAME "Print Streamed Job with bad copies value to Test1"
+	OPERATION print-job
+	RESOURCE /printers/Test1
+
+	GROUP operation
+	ATTR charset attributes-charset utf-8
+	ATTR language attributes-natural-language en
+	ATTR uri printer-uri \$uri
+	ATTR name requesting-user-name $user
+	ATTR mimeMediaType document-format text/plain
+
+	GROUP job
+	ATTR integer copies 0
+
+	FILE $root/examples/testfile.txt
+
+	STATUS client-error-attributes-or-values-not-supported
+}
+EOF
+
+streamed=`$GREP -c 'Streaming document data to job' $BASE/log/error_log`
+
+echo "    ipptool ipp://localhost:$port/printers/Test1 stream.test" >>$strfile
+$runcups ../tools/ipptool -t ipp://localhost:$port/printers/Test1 $BASE/stream.test >>$strfile
+if test $? != 0; then
+	echo "FAIL (unexpected response)"
+	echo "    FAILED" >>$strfile
+	fail=`expr $fail + 1`
+elif test `$GREP -c 'Streaming document data to job' $BASE/log/error_log` != `expr $streamed + 1`; then
+	echo "FAIL (document not streamed)"
+	echo "    FAILED (document not streamed)" >>$strfile
+	fail=`expr $fail + 1`
+elif test `$GREP -c 'Bad copies value 0' $BASE/log/error_log` != 2; then
+	echo "FAIL (rejected request not processed again)"
+	echo "    FAILED (rejected request not processed again)" >>$strfile
+	fail=`expr $fail + 1`
+else
+	echo "PASS"
+	echo "    PASSED" >>$strfile
+fi
+
+./waitjobs.sh >>$strfile
+
+
 #
 # Perform job history test...
 #
@@ -1002,7 +1269,9 @@ count=`$GREP '^Test1 ' $BASE/log/page_log | awk 'BEGIN{count=0}{count=count+$7}E
 # expected numbers of pages from page ranges tests:
 # - 5 pages for the job with a lower limit undefined (-5)
 # - 4 pages for the job with a upper limit undefined (5-)
-expected=`expr $pjobs \* 2 + 34 + 5 + 4`
+# - 2 pages for the streaming print test
+# - 1 page for the streaming Print-Job test
+expected=`expr $pjobs \* 2 + 34 + 5 + 4 + 2 + 1`
 expected2=`expr $expected + 2`
 if test $count -lt $expected -a $count -gt $expected2; then
 	echo "FAIL: Printer 'Test1' produced $count page(s), expected $expected."
@@ -1047,9 +1316,33 @@ fi
 # 2 requests (Create-Job, Send-Document) * number of jobs (2 - one for undefined
 # low limit, one for undefined upper limit)
 
+# Number of requests from the streaming print tests - total 7 in 'expected':
+# - 2 requests for the streamed job - Create-Job and Send-Document
+# - 3 requests for the empty streamed job - Create-Job, Send-Document, and
+#   Cancel-Job
+# - 2 requests for the streamed Print-Job test - Print-Job and the rejected
+#   Print-Job
+
+# Number of requests from 4.2-cups-printer-ops.test: attribute cache tests - total 2 in 'expected':
+# - 1 request for pausing Test2 - Pause-Printer
+# - 1 request for resuming Test2 - Resume-Printer
+
+# Number of requests from 4.3-job-ops.test: nameWithLanguage job-name tests - total 2 in 'expected':
+# - 1 request for the held job - Print-Job
+# - 1 request for canceling the held job - Cancel-Job
+
+# Number of requests from the filter-ahead test - total 7 in 'expected':
+# - 1 request for creating the queue - CUPS-Add-Modify-Printer
+# - 5 requests for the job - Create-Job and 4 Send-Document
+# - 1 request for deleting the queue - CUPS-Delete-Printer
+
+# Number of requests from the request spooling test - total 2 in 'expected':
+# - 1 request for the held job - Print-Job
+# - 1 request for canceling the held job - Cancel-Job
+
 # Requests logged
 count=`wc -l $BASE/log/access_log | awk '{print $1}'`
-expected=`expr 35 + 18 + 30 + $pjobs \* 8 + $pprinters \* $pjobs \* 4 + 2 + 2 + 5 + 4`
+expected=`expr 35 + 18 + 30 + $pjobs \* 8 + $pprinters \* $pjobs \* 4 + 2 + 2 + 5 + 4 + 7 + 2 + 2 + 7 + 2`
 if test $count != $expected; then
 	echo "FAIL: $count requests logged, expected $expected."
 	echo "    <p>FAIL: $count requests logged, expected $expected.</p>" >>$strfile
@@ -1117,12 +1410,13 @@ else
 	echo "    <p>PASS: $count critical messages.</p>" >>$strfile
 fi
 
-# Error log messages
+# Error log messages (3 from the empty streaming print test, 1 from the
+# streaming Print-Job test)
 count=`$GREP '^E ' $BASE/log/error_log | $GREP -v 'Unknown default SystemGroup' | wc -l | awk '{print $1}'`
-if test $count != 33; then
-	echo "FAIL: $count error messages, expected 33."
+if test $count != 37; then
+	echo "FAIL: $count error messages, expected 37."
 	$GREP '^E ' $BASE/log/error_log
-	echo "    <p>FAIL: $count error messages, expected 33.</p>" >>$strfile
+	echo "    <p>FAIL: $count error messages, expected 37.</p>" >>$strfile
 	echo "    <pre>" >>$strfile
 	$GREP '^E ' $BASE/log/error_log | sed -e '1,$s/&/&amp;/g' -e '1,$s/</&lt;/g' >>$strfile
 	echo "    </pre>" >>$strfile
@@ -1132,12 +1426,12 @@ else
 	echo "    <p>PASS: $count error messages.</p>" >>$strfile
 fi
 
-# Warning log messages
+# Warning log messages (5 from reloading cupsd.conf for the streaming print test)
 count=`$GREP '^W ' $BASE/log/error_log | $GREP -v CreateProfile | $GREP -v 'libusb error' | $GREP -v ColorManager | $GREP -v 'Avahi client failed' | wc -l | awk '{print $1}'`
-if test $count != 14; then
-	echo "FAIL: $count warning messages, expected 14."
+if test $count != 19; then
+	echo "FAIL: $count warning messages, expected 19."
 	$GREP '^W ' $BASE/log/error_log
-	echo "    <p>FAIL: $count warning messages, expected 14.</p>" >>$strfile
+	echo "    <p>FAIL: $count warning messages, expected 19.</p>" >>$strfile
 	echo "    <pre>" >>$strfile
 	$GREP '^W ' $BASE/log/error_log | sed -e '1,$s/&/&amp;/g' -e '1,$s/</&lt;/g' >>$strfile
 	echo "    </pre>" >>$strfile
@@ -224,6 +224,13 @@ typedef unsigned long useconds_t;
 /* #undef HAVE_POSIX_SPAWN */
 
 
+/*
+ * Do we have memfd_create?
+ */
+
+/* #undef HAVE_MEMFD_CREATE */
+
+
 /*
  * Do we have ZLIB?
  */
@@ -357,6 +364,7 @@ typedef unsigned long useconds_t;
 
 /* #undef HAVE_WAITPID */
 /* #undef HAVE_WAIT3 */
+/* #undef HAVE_WAIT4 */
 
 
 /*
@@ -472,6 +480,20 @@ typedef unsigned long useconds_t;
 /* #undef HAVE_TM_GMTOFF */
 
 
+/*
+ * Do we have accept4()?
+ */
+
+/* #undef HAVE_ACCEPT4 */
+
+
+/*
+ * Do we have splice()?
+ */
+
+/* #undef HAVE_SPLICE */
+
+
 /*
  * Do we have rresvport_af()?
  */
@@ -651,6 +673,7 @@ typedef unsigned long useconds_t;
 /* #undef HAVE_POLL */
 /* #undef HAVE_EPOLL */
 /* #undef HAVE_KQUEUE */
+/* #undef HAVE_IO_URING */
 
 
 /*
@@ -143,6 +143,13 @@
 #define HAVE_POSIX_SPAWN 1
 
 
+/*
+ * Do we have memfd_create?
+ */
+
+/* #undef HAVE_MEMFD_CREATE */
+
+
 /*
  * Do we have ZLIB?
  */
@@ -278,6 +285,7 @@
 
 #define HAVE_WAITPID 1
 #define HAVE_WAIT3 1
+#define HAVE_WAIT4 1
 
 
 /*
@@ -398,6 +406,20 @@
 #define HAVE_TM_GMTOFF 1
 
 
+/*
+ * Do we have accept4()?
+ */
+
+/* #undef HAVE_ACCEPT4 */
+
+
+/*
+ * Do we have splice()?
+ */
+
+/* #undef HAVE_SPLICE */
+
+
 /*
  * Do we have rresvport_af()?
  */
@@ -583,6 +605,7 @@
 #define HAVE_POLL 1
 /* #undef HAVE_EPOLL */
 #define HAVE_KQUEUE 1
+/* #undef HAVE_IO_URING */
 
 
 /*